@@ -6,10 +6,31 @@
 
 namespace vtlib {
 
-//FIXME
+// The contents of one character cell on the screen: a character (with
+// attributes) and its foreground and background colors. A (default) codepoint
+// of 0 indicates an empty cell (which should be rendered as a space).
+//
+// Cells are small (12 bytes) and trivially copyable, so that rows of cells can
+// be stored contiguously and copied/moved in bulk.
 class Cell {
  public:
-//FIXME
+  Cell() = default;
+  Cell(const Character& character, const Color& fg, const Color& bg)
+      : character_(character), fg_(fg), bg_(bg) {}
+
+  const Character& character() const { return character_; }
+  const Color& fg() const { return fg_; }
+  const Color& bg() const { return bg_; }
+
+  void set_character(const Character& character) { character_ = character; }
+  void set_fg(const Color& fg) { fg_ = fg; }
+  void set_bg(const Color& bg) { bg_ = bg; }
+
+  bool operator==(const Cell& other) const {
+    return character_ == other.character_ && fg_ == other.fg_ &&
+           bg_ == other.bg_;
+  }
+  bool operator!=(const Cell& other) const { return !(*this == other); }
 
  private:
   Character character_;
@@ -17,6 +38,8 @@ class Cell {
   Color bg_;
 };
 
+static_assert(sizeof(Cell) == 12u, "Cell should be 12 bytes");
+
 }  // namespace vtlib
 
 #endif  // VTLIB_INCLUDE_VTLIB_CELL_H_
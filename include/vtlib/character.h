@@ -4,6 +4,8 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <vtlib/codepoint.h>
+
 namespace vtlib {
 
 //FIXME
@@ -27,26 +29,18 @@ class Character {
     RESERVED_1 = 1u << 9u,
     RESERVED_2 = 1u << 10u,
   };
-  Attribute operator|(Attribute a, Attribute b) {
-    return static_cast<Attribute>(static_cast<uint32_t>(a) |
-                                  static_cast<uint32_t>(b));
-  }
-  Attribute operator&(Attribute a, Attribute b) {
-    return static_cast<Attribute>(static_cast<uint32_t>(a) &
-                                  static_cast<uint32_t>(b));
-  }
-  bool operator!(Attribute a) { return !static_cast<uint32_t>(a); }
-
   explicit Character(Attribute attribute = Attribute::NONE,
                      uint32_t codepoint = 0u) {
     set(attribute, codepoint);
   }
 
   Attribute attribute() const {
-    return (character_ & static_cast<uint32_t>(0xffe00000u)) >> 21u;
+    return static_cast<Attribute>(
+        (character_ & static_cast<uint32_t>(0xffe00000u)) >> 21u);
   }
 
-  // Returns the Unicode codepoint (from 0..0x10ffff) for the character.
+  // Returns the Unicode codepoint (from 0..0x10ffff) for the character, or
+  // |CODEPOINT_WIDE_PADDING| or a grapheme cluster (see codepoint.h).
   uint32_t codepoint() const {
     return character_ & static_cast<uint32_t>(0x001fffffu);
   }
@@ -59,21 +53,42 @@ class Character {
   }
 
   void set_codepoint(uint32_t codepoint) {
-    assert(codepoint <= 0x10ffffu);
+    assert(codepoint <= CODEPOINT_LAST_CLUSTER);
     character_ = (character_ & ~static_cast<uint32_t>(0x001fffffu)) | codepoint;
   }
 
   void set(Attribute attribute, uint32_t codepoint) {
     assert(
         !(static_cast<uint32_t>(attribute) & ~static_cast<uint32_t>(0x7ffu)));
-    assert(codepoint <= 0x10ffffu);
+    assert(codepoint <= CODEPOINT_LAST_CLUSTER);
     character_ = (static_cast<uint32_t>(attribute) << 21u) | codepoint;
   }
 
+  bool operator==(const Character& other) const {
+    return character_ == other.character_;
+  }
+  bool operator!=(const Character& other) const {
+    return character_ != other.character_;
+  }
+
  private:
   uint32_t character_;
 };
 
+inline Character::Attribute operator|(Character::Attribute a,
+                                      Character::Attribute b) {
+  return static_cast<Character::Attribute>(static_cast<uint32_t>(a) |
+                                           static_cast<uint32_t>(b));
+}
+inline Character::Attribute operator&(Character::Attribute a,
+                                      Character::Attribute b) {
+  return static_cast<Character::Attribute>(static_cast<uint32_t>(a) &
+                                           static_cast<uint32_t>(b));
+}
+inline bool operator!(Character::Attribute a) {
+  return !static_cast<uint32_t>(a);
+}
+
 }  // namespace vtlib
 
 #endif  // VTLIB_INCLUDE_VTLIB_CHARACTER_H_
@@ -15,10 +15,23 @@ class CharacterDecoder {
  public:
   virtual ~CharacterDecoder() = default;
 
-  // Static factory method. Returns null if a character encoding is not
+  // Alternative implementations of character decoders. For a given character
+  // encoding, all implementations produce identical output. (If a character
+  // encoding has only one implementation, it is used for all values.)
+  enum class Implementation {
+    DEFAULT,
+    // A decoder driven by a state-transition table (currently only different
+    // for UTF-8).
+    TABLE_DRIVEN,
+  };
+
+  // Static factory methods. Returns null if a character encoding is not
   // supported.
   static std::unique_ptr<CharacterDecoder> Create(
       CharacterEncoding character_encoding);
+  static std::unique_ptr<CharacterDecoder> Create(
+      CharacterEncoding character_encoding,
+      Implementation implementation);
 
   // Returns true if the character encoding that this |CharacterDecoder| decodes
   // can support 8-bit C1 control characters (i.e., those in the range
@@ -41,6 +54,28 @@ class CharacterDecoder {
   virtual void ProcessByte(uint8_t input_byte,
                            CodepointVector* output_codepoints) = 0;
 
+  // The maximum number of codepoints that processing a single input byte may
+  // produce.
+  static constexpr size_t kMaxCodepointsPerByte = 4u;
+
+  // Decodes (up to) |num_input_bytes| bytes from |input_bytes|, writing the
+  // output codepoints to |output_codepoints|, which must have room for
+  // |output_capacity| codepoints (at least |kMaxCodepointsPerByte|). Returns
+  // the number of input bytes consumed; the number of codepoints written is
+  // stored in |*num_output_codepoints|. This never allocates.
+  //
+  // This stops *before* the first control code (a C0 control code or, if
+  // |Supports8bitC1()| returns true, a C1 control code), so that the caller may
+  // dispatch it (typically after calling |Flush()|). It also stops early if
+  // there may not be enough room in the output for the codepoints produced by
+  // the next byte. Otherwise, the result is the same as calling |ProcessByte()|
+  // on each byte consumed.
+  virtual size_t Decode(const uint8_t* input_bytes,
+                        size_t num_input_bytes,
+                        Codepoint* output_codepoints,
+                        size_t output_capacity,
+                        size_t* num_output_codepoints) = 0;
+
   // Resets the state of the character decoder, appending any resulting
   // codepoints to |*output_codepoints| (e.g., if the decoder was in the middle
   // of a multibyte encoding, it may wish to output replacement characters for
@@ -53,6 +88,10 @@ class CharacterDecoder {
   static bool is_control_code(uint8_t b) {
     return is_C0_control_code(b) || is_C1_control_code(b);
   }
+  // Returns true if |Decode()| should stop before |b| (see above).
+  static bool is_control_code(uint8_t b, bool supports_8bit_C1) {
+    return is_C0_control_code(b) || (supports_8bit_C1 && is_C1_control_code(b));
+  }
 
  protected:
   CharacterDecoder() {}
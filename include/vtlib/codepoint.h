@@ -84,8 +84,26 @@ enum CodepointNames : Codepoint {
 
   // Unicode replacement character:
   CODEPOINT_REPLACEMENT = 0xfffdu,
+
+  // Not a Unicode codepoint (it's past 0x10ffff): stored in the cell to the
+  // right of a wide character (which occupies two cells, and is stored in the
+  // left one).
+  CODEPOINT_WIDE_PADDING = 0x110000u,
+
+  // Also not Unicode codepoints: a cell containing a grapheme cluster of more
+  // than one codepoint (e.g., a base character followed by combining marks, or
+  // an emoji ZWJ sequence) stores a value in this range, identifying the
+  // cluster (see |Terminal::GetCluster()|).
+  CODEPOINT_FIRST_CLUSTER = 0x110001u,
+  CODEPOINT_LAST_CLUSTER = 0x1fffffu,
 };
 
+// Returns true if |codepoint| (e.g., from a cell) identifies a grapheme
+// cluster.
+inline bool IsClusterCodepoint(Codepoint codepoint) {
+  return codepoint >= CODEPOINT_FIRST_CLUSTER;
+}
+
 }  // namespace vtlib
 
 #endif  // VTLIB_INCLUDE_VTLIB_CODEPOINT_H_
@@ -25,6 +25,9 @@ namespace vtlib {
 class Color {
  public:
   enum class Type : uint8_t {
+    // The default (foreground or background) color, as determined by the
+    // renderer (the data is ignored, and should be 0).
+    DEFAULT,
     // The 8 standard ANSI colors followed by high-intensity versions of them.
     ANSI_16,
     // Standard 24-bit RGB values, defined in ISO 8613-3 (reportedly):
@@ -33,21 +36,23 @@ class Color {
     RGB,
   };
 
-  explicit Color(Type type = Type::ANSI, uint32_t data = 0u) {
+  explicit Color(Type type = Type::DEFAULT, uint32_t data = 0u) {
     set(type, data);
   }
 
   Type type() const {
-    return (color_ & static_cast<uint32_t>(0xff000000u)) >> 24u;
+    return static_cast<Type>((color_ & static_cast<uint32_t>(0xff000000u)) >>
+                             24u);
   }
 
   // Color data is:
-  //   - |Type::ANSI_16|: an index 0..255, encoded as follows:
+  //   - |Type::DEFAULT|: 0
+  //   - |Type::ANSI_16|: an index 0..15, encoded as follows:
   //       - 0..7: the standard ANSI colors (black, red, green, yellow, blue,
   //         magenta, cyan, white, respectively)
   //       - 8..15: corresponding to the high-intensity versions of the ANSI
   //         colors
-  //   - |Type::RGB|: encoding a 256x256x256 RGB cube (0xrrbbgg, where rr, gg,
+  //   - |Type::RGB|: encoding a 256x256x256 RGB cube (0xrrggbb, where rr, gg,
   //     bb are 0x00..0xff)
   uint32_t data() const { return color_ & static_cast<uint32_t>(0x00ffffffu); }
 
@@ -56,6 +61,9 @@ class Color {
     color_ = (static_cast<uint32_t>(type) << 24u) | data;
   }
 
+  bool operator==(const Color& other) const { return color_ == other.color_; }
+  bool operator!=(const Color& other) const { return color_ != other.color_; }
+
  private:
   // |Type| is stored in the high-order byte of |color_|. The three low-order
   // bytes store type-dependent color data (see |data()| above).
@@ -1,13 +1,123 @@
 #ifndef VTLIB_INCLUDE_VTLIB_DISPLAY_UPDATES_H_
 #define VTLIB_INCLUDE_VTLIB_DISPLAY_UPDATES_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <chrono>
+#include <vector>
+
 #include <vtlib/coordinates.h>
 
 namespace vtlib {
 
+// Per-row "damage" for the rows of the viewport: for each row, whether it has
+// changed and, if so, the span of columns that has changed. Rows are identified
+// by row number (as elsewhere), so rows that have merely moved up (by
+// scrolling) aren't dirty.
+//
+// This is maintained as a ring of per-row column spans plus a bitset of dirty
+// rows (in the same order), so marking a row dirty and scrolling are O(1), and
+// finding the dirty rows skips clean rows 64 at a time.
+class RowDamage {
+ public:
+  RowDamage() = default;
+  // Tracks the |rows| rows starting at row number |first_row| (all clean).
+  RowDamage(uint32_t rows, ColumnNumber columns, RowNumber first_row = 0u);
+
+  // The rows tracked are |first_row()| to |first_row() + rows() - 1| (i.e.,
+  // the viewport).
+  RowNumber first_row() const { return first_row_; }
+  uint32_t rows() const { return rows_; }
+  ColumnNumber columns() const { return columns_; }
+
+  bool is_empty() const { return !num_dirty_rows_; }
+  uint32_t num_dirty_rows() const { return num_dirty_rows_; }
+
+  bool IsRowDirty(RowNumber row) const {
+    return row >= first_row_ && row - first_row_ < rows_ &&
+           IsSlotDirty(GetSlot(row));
+  }
+  // Returns true if |row| is dirty, in which case |*left| and |*right| are set
+  // to the (bounding) span of columns that have changed, from |*left| up to
+  // (but not including) |*right|. Rows that aren't tracked are never dirty.
+  bool GetDirtyColumns(RowNumber row,
+                       ColumnNumber* left,
+                       ColumnNumber* right) const;
+
+  // Returns the first dirty row at or after |row|, or |first_row() + rows()| if
+  // there is none. E.g., to visit all the dirty rows:
+  //
+  //   for (RowNumber row = damage.FindNextDirtyRow(damage.first_row());
+  //        row < damage.first_row() + damage.rows();
+  //        row = damage.FindNextDirtyRow(row + 1u)) {
+  //     ...
+  //   }
+  RowNumber FindNextDirtyRow(RowNumber row) const;
+
+  // The following are for use by the |Terminal| implementation.
+
+  // Adds columns |left| to |right - 1| of |row| to the damage. Does nothing if
+  // |row| isn't tracked or the span is empty.
+  void MarkDirty(RowNumber row, ColumnNumber left, ColumnNumber right);
+  // Advances |first_row()| by |count|: the damage for the rows that are no
+  // longer tracked is discarded, and the newly-tracked rows are clean.
+  void ScrollUp(uint32_t count);
+  // Marks all the rows clean. This takes time proportional to the number of
+  // dirty rows (plus |rows() / 64|).
+  void Clear();
+
+ private:
+  struct Span {
+    ColumnNumber left;
+    ColumnNumber right;
+  };
+
+  static constexpr uint32_t kBitsPerWord = 64u;
+
+  // Returns the index in |spans_| (and |dirty_bits_|) for |row|, which must be
+  // tracked.
+  uint32_t GetSlot(RowNumber row) const {
+    uint32_t slot = top_slot_ + static_cast<uint32_t>(row - first_row_);
+    return slot >= rows_ ? slot - rows_ : slot;
+  }
+  bool IsSlotDirty(uint32_t slot) const {
+    return (dirty_bits_[slot / kBitsPerWord] >> (slot % kBitsPerWord)) & 1u;
+  }
+  void ClearSlot(uint32_t slot);
+  // Returns the first dirty slot in |begin| to |end - 1|, or |end| if none.
+  uint32_t FindNextDirtySlot(uint32_t begin, uint32_t end) const;
+
+  uint32_t rows_ = 0u;
+  ColumnNumber columns_ = 0u;
+  RowNumber first_row_ = 0u;
+  // |first_row_| is in slot |top_slot_|, and the following rows are in
+  // consecutive slots (modulo |rows_|).
+  uint32_t top_slot_ = 0u;
+  uint32_t num_dirty_rows_ = 0u;
+  // Only meaningful for dirty slots.
+  std::vector<Span> spans_;
+  std::vector<uint64_t> dirty_bits_;
+};
+
 struct DisplayUpdates {
+  // A move of the contents of (part of) the viewport, e.g., from scrolling.
+  struct Scroll {
+    Scroll() = default;
+    Scroll(uint32_t top, uint32_t bottom, int32_t count)
+        : top(top), bottom(bottom), count(count) {}
+
+    // The rows of the viewport that moved, as offsets from its top: |top| to
+    // |bottom - 1|. (In terms of row numbers, scrolling the whole viewport
+    // doesn't move anything; it just advances |Terminal::viewport_top()|.)
+    uint32_t top = 0u;
+    uint32_t bottom = 0u;
+    // The contents moved up by |count| rows if it's positive, and down by
+    // |-count| rows if it's negative. Its magnitude is at most |bottom - top|.
+    // The rows that were vacated are marked in |row_damage|.
+    int32_t count = 0;
+  };
+
   DisplayUpdates() = default;
 
   // Number of times the bell should be "sounded".
@@ -17,7 +127,36 @@ struct DisplayUpdates {
   // that are now outside the viewport, i.e., are "offscreen".)
   Rectangle dirty;
 
-  bool needs_update() const { return bell_count || !dirty.is_empty(); }
+  // The changes to the rows of the (current) viewport, in more detail than
+  // |dirty|: e.g., a change at the top left and one at the bottom right don't
+  // mark the whole viewport dirty.
+  RowDamage row_damage;
+
+  // The moves of the viewport's contents, in order; consecutive scrolls of the
+  // same region are merged. A renderer can update its image of the viewport by
+  // applying these (e.g., as blits) and then redrawing just |row_damage|.
+  std::vector<Scroll> scrolls;
+
+  // Set while the application is drawing a "synchronized" frame (DECSET 2026),
+  // until |synchronized_update_deadline| (see
+  // |Terminal::Options::synchronized_update_timeout|). Changes still accumulate
+  // above, but |needs_update()| is false until the frame ends (or times out),
+  // so that it's drawn all at once.
+  bool synchronized_update = false;
+  std::chrono::steady_clock::time_point synchronized_update_deadline;
+
+  // |now| is the current time (e.g., the time of the frame to be drawn).
+  bool needs_update(std::chrono::steady_clock::time_point now) const {
+    if (synchronized_update && now < synchronized_update_deadline)
+      return false;
+    return bell_count || !dirty.is_empty() || !scrolls.empty();
+  }
+  bool needs_update() const {
+    // (Only read the clock if it matters.)
+    return needs_update(synchronized_update
+                            ? std::chrono::steady_clock::now()
+                            : std::chrono::steady_clock::time_point());
+  }
 };
 
 }  // namespace vtlib
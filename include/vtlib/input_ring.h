@@ -0,0 +1,100 @@
+#ifndef VTLIB_INCLUDE_VTLIB_INPUT_RING_H_
+#define VTLIB_INCLUDE_VTLIB_INPUT_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+namespace vtlib {
+
+class Terminal;
+
+// A bounded, lock-free, single-producer/single-consumer byte queue, for
+// handing input from an I/O thread (e.g., one reading from a PTY) to the
+// thread that owns a |Terminal|. One thread may call the "producer" methods
+// while another calls the "consumer" methods.
+//
+// Both sides can work in place: the producer can read directly into the ring
+// (|BeginWrite()|/|EndWrite()|), and the consumer can process data directly
+// from the ring (|BeginRead()|/|EndRead()|, or |DrainInto()| to feed a
+// |Terminal|), so that no intermediate copies are needed.
+class InputRing {
+ public:
+  // Optional wakeup hooks (e.g., to signal an eventfd or a condition
+  // variable). Each is called on the opposite thread to the one that waits.
+  class Delegate {
+   public:
+    // Called (on the producer thread) when data is added to a ring that the
+    // consumer may have found empty.
+    virtual void OnDataAvailable() = 0;
+    // Called (on the consumer thread) when space is freed in a ring that the
+    // producer may have found full.
+    virtual void OnSpaceAvailable() = 0;
+
+   protected:
+    virtual ~Delegate() = default;
+  };
+
+  // Creates a ring that can hold |capacity| bytes (rounded up to a power of
+  // 2). |delegate| may be null; otherwise it must outlive the ring.
+  InputRing(size_t capacity, Delegate* delegate);
+  ~InputRing();
+
+  InputRing(const InputRing&) = delete;
+  InputRing& operator=(const InputRing&) = delete;
+
+  size_t capacity() const { return mask_ + 1u; }
+
+  // Producer methods:
+
+  // Copies as much of |bytes| as fits into the ring. Returns the number of
+  // bytes copied.
+  size_t Push(const uint8_t* bytes, size_t num_bytes);
+  // Sets |*buffer| to the (contiguous) free space in the ring, and returns its
+  // size (possibly 0, if the ring is full). Write to it and then call
+  // |EndWrite()| with the number of bytes written.
+  size_t BeginWrite(uint8_t** buffer);
+  void EndWrite(size_t num_bytes);
+
+  // Consumer methods:
+
+  // Copies up to |max_bytes| bytes out of the ring. Returns the number of
+  // bytes copied.
+  size_t Pop(uint8_t* bytes, size_t max_bytes);
+  // Sets |*buffer| to the (contiguous) data available in the ring, and returns
+  // its size (possibly 0, if the ring is empty). Process it and then call
+  // |EndRead()| with the number of bytes consumed.
+  size_t BeginRead(const uint8_t** buffer);
+  void EndRead(size_t num_bytes);
+  // Processes all the data available in the ring with
+  // |terminal->ProcessBytes()| (in at most two calls, directly from the ring).
+  // Returns true if any of the calls did. If |num_bytes| is non-null,
+  // |*num_bytes| is set to the number of bytes processed.
+  bool DrainInto(Terminal* terminal, size_t* num_bytes);
+
+ private:
+  static constexpr size_t kCacheLineSize = 64u;
+
+  const size_t mask_;
+  Delegate* const delegate_;
+  std::unique_ptr<uint8_t[]> buffer_;
+
+  // The number of bytes ever written and read, respectively (so that
+  // |write_index_ - read_index_| is the number of bytes in the ring). Each
+  // index is written only by its own side, and is kept a cache line away from
+  // the other (along with that side's cached copy of the other side's index),
+  // to avoid false sharing.
+  char padding0_[kCacheLineSize];
+  std::atomic<size_t> write_index_;
+  size_t cached_read_index_ = 0u;  // Producer only.
+  char padding1_[kCacheLineSize];
+  std::atomic<size_t> read_index_;
+  size_t cached_write_index_ = 0u;  // Consumer only.
+  char padding2_[kCacheLineSize];
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_INCLUDE_VTLIB_INPUT_RING_H_
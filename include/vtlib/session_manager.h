@@ -0,0 +1,103 @@
+#ifndef VTLIB_INCLUDE_VTLIB_SESSION_MANAGER_H_
+#define VTLIB_INCLUDE_VTLIB_SESSION_MANAGER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+
+// Owns many |Terminal|s (e.g., thousands, for log viewers or shared shells),
+// and processes input for them on a pool of worker threads.
+//
+// Input for a terminal is processed in the order it was submitted, by one
+// worker at a time; different terminals are processed in parallel. Each worker
+// has its own queue of terminals with pending input, and idle workers steal
+// from the others, so busy terminals get spread across the workers.
+//
+// For fairness, a worker processes at most |Options::max_bytes_per_slice| bytes
+// for a terminal before moving it to the back of its queue, so that a terminal
+// with a flood of input (e.g., from |yes|) can't starve interactive ones.
+//
+// The methods of |SessionManager| itself must all be called on one thread
+// (e.g., the I/O thread).
+class SessionManager {
+ public:
+  using TerminalId = uint64_t;
+
+  struct Options {
+    Options() = default;
+
+    // Number of worker threads (if 0, the number of hardware threads).
+    unsigned num_threads = 0u;
+    // Maximum number of bytes processed for a terminal in one go (nonzero).
+    size_t max_bytes_per_slice = 16u * 1024u;
+  };
+
+  // Counters, summed over the workers.
+  struct Stats {
+    Stats() = default;
+
+    // Number of times some input was processed for a terminal.
+    uint64_t num_slices = 0u;
+    // Number of times a worker took a terminal from another worker's queue.
+    uint64_t num_steals = 0u;
+  };
+
+  class Delegate {
+   public:
+    // Called on a worker thread after it processes some input for the
+    // terminal |id| (with exclusive access to |terminal| for the duration of
+    // the call, e.g., to look at its |display_updates()| or to publish a
+    // snapshot). It may be called concurrently for different terminals.
+    virtual void OnInputProcessed(TerminalId id, Terminal* terminal) = 0;
+
+   protected:
+    virtual ~Delegate() = default;
+  };
+
+  // Stops the workers (after they finish their current slices). Input that
+  // hasn't been processed is discarded.
+  virtual ~SessionManager() = default;
+
+  SessionManager(const SessionManager&) = delete;
+  SessionManager& operator=(const SessionManager&) = delete;
+
+  // |delegate| may be null; otherwise it must outlive the session manager.
+  static std::unique_ptr<SessionManager> Create(const Options& options,
+                                                Delegate* delegate);
+
+  virtual const Options& options() const = 0;
+
+  // Creates a terminal, returning its ID (IDs aren't reused).
+  virtual TerminalId AddTerminal(const Terminal::Options& options) = 0;
+  // Destroys the terminal |id| (once a worker is done with it), discarding
+  // any pending input.
+  virtual void RemoveTerminal(TerminalId id) = 0;
+
+  // Queues (a copy of) |num_input_bytes| bytes from |input_bytes| for the
+  // terminal |id|.
+  virtual void SubmitInput(TerminalId id,
+                           const uint8_t* input_bytes,
+                           size_t num_input_bytes) = 0;
+  // Blocks until all the submitted input has been processed.
+  virtual void WaitUntilIdle() = 0;
+
+  // Returns the terminal |id| (which remains valid until it's removed). It may
+  // only be used while it has no pending input (e.g., after |WaitUntilIdle()|,
+  // until input is next submitted for it), except that its
+  // |AcquireSnapshot()| may be called at any time, on any thread.
+  virtual Terminal* GetTerminal(TerminalId id) = 0;
+
+  virtual Stats GetStats() const = 0;
+
+ protected:
+  SessionManager() = default;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_INCLUDE_VTLIB_SESSION_MANAGER_H_
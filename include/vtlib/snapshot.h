@@ -0,0 +1,143 @@
+#ifndef VTLIB_INCLUDE_VTLIB_SNAPSHOT_H_
+#define VTLIB_INCLUDE_VTLIB_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <vtlib/cell.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/coordinates.h>
+
+namespace vtlib {
+
+// An immutable copy of the viewport (and cursor position), as published by
+// |Terminal::PublishSnapshot()|. Rows that haven't changed are shared (not
+// copied) between successive snapshots.
+//
+// Each snapshot has a generation number (increasing with each snapshot
+// published by a terminal), and each row records the generation in which its
+// contents last changed. So a renderer that remembers, for each row number it
+// drew, the row generation it drew can skip the rows that are unchanged.
+//
+// Each row also has its own copy of the grapheme clusters that its cells use
+// (see |GetCluster()|), so a snapshot is self-contained: it can be read on any
+// thread, and the terminal may reuse a cluster's value for another cluster
+// after it's no longer in use, without affecting earlier snapshots.
+class Snapshot {
+ public:
+  // Creates a snapshot with |rows| rows, each of which must then be set with
+  // |SetRow()| or |ShareRow()|. (This is for use by the |Terminal|
+  // implementation.)
+  Snapshot(uint64_t generation,
+           RowNumber viewport_top,
+           uint32_t rows,
+           ColumnNumber columns,
+           RowNumber cursor_row,
+           ColumnNumber cursor_column);
+  ~Snapshot();
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+  uint64_t generation() const { return generation_; }
+  // The snapshot contains rows |viewport_top()| to |viewport_top() + rows() -
+  // 1|.
+  RowNumber viewport_top() const { return viewport_top_; }
+  uint32_t rows() const { return static_cast<uint32_t>(rows_.size()); }
+  ColumnNumber columns() const { return columns_; }
+  RowNumber cursor_row() const { return cursor_row_; }
+  ColumnNumber cursor_column() const { return cursor_column_; }
+
+  // Returns the |columns()| cells of row |viewport_top() + i|, where |i| is
+  // less than |rows()|.
+  const Cell* GetRow(uint32_t i) const { return rows_[i]->cells.data(); }
+  // Returns the generation in which row |viewport_top() + i| last changed.
+  uint64_t GetRowGeneration(uint32_t i) const { return rows_[i]->generation; }
+  // Like |Terminal::GetCluster()|, returns the codepoints of the grapheme
+  // cluster |cluster| (which must be in a cell of row |viewport_top() + i|),
+  // storing their number in |*num_codepoints|. The returned pointer is valid
+  // for as long as the snapshot is.
+  const Codepoint* GetCluster(uint32_t i,
+                              Codepoint cluster,
+                              size_t* num_codepoints) const;
+
+  // These set row |viewport_top() + i|, either to a copy of |cells| (which has
+  // |columns()| cells) or to the same row as row |viewport_top() + other_i|
+  // of |other| (which must have the same number of columns). (These are for
+  // use by the |Terminal| implementation.)
+  void SetRow(uint32_t i, const Cell* cells);
+  void ShareRow(uint32_t i, const Snapshot& other, uint32_t other_i);
+  // Adds the grapheme cluster |cluster| (which has the |num_codepoints| given
+  // codepoints) to row |viewport_top() + i|, which must have been set with
+  // |SetRow()|. Each row's clusters must be added in increasing order. (This
+  // is for use by the |Terminal| implementation.)
+  void AddCluster(uint32_t i,
+                  Codepoint cluster,
+                  const Codepoint* codepoints,
+                  size_t num_codepoints);
+
+ private:
+  struct Cluster {
+    Codepoint cluster;
+    // The cluster's codepoints are |Row::cluster_codepoints[offset]| to
+    // |Row::cluster_codepoints[offset + length - 1]|.
+    uint32_t offset;
+    uint32_t length;
+  };
+  struct Row {
+    uint64_t generation;
+    std::vector<Cell> cells;
+    // The clusters used by |cells|, in increasing order of |Cluster::cluster|.
+    std::vector<Cluster> clusters;
+    std::vector<Codepoint> cluster_codepoints;
+  };
+
+  const uint64_t generation_;
+  const RowNumber viewport_top_;
+  const ColumnNumber columns_;
+  const RowNumber cursor_row_;
+  const ColumnNumber cursor_column_;
+  // (Rows are only modified before the snapshot is published.)
+  std::vector<std::shared_ptr<Row>> rows_;
+};
+
+// A reference to a published |Snapshot|, as returned by
+// |Terminal::AcquireSnapshot()|. The snapshot remains valid (and is not
+// reclaimed) until the handle is reset or destroyed. Handles must not outlive
+// the terminal that they came from.
+//
+// Holding a handle doesn't block the terminal, but does delay the reclamation
+// of snapshots published in the meantime, so handles shouldn't be held for
+// longer than necessary (e.g., for more than a frame).
+class SnapshotHandle {
+ public:
+  SnapshotHandle() = default;
+  // (This is for use by the implementation.) |reader_count| is decremented
+  // when the handle is reset.
+  SnapshotHandle(const Snapshot* snapshot,
+                 std::atomic<uint64_t>* reader_count);
+  SnapshotHandle(SnapshotHandle&& other);
+  SnapshotHandle& operator=(SnapshotHandle&& other);
+  ~SnapshotHandle();
+
+  SnapshotHandle(const SnapshotHandle&) = delete;
+  SnapshotHandle& operator=(const SnapshotHandle&) = delete;
+
+  const Snapshot* get() const { return snapshot_; }
+  const Snapshot* operator->() const { return snapshot_; }
+  const Snapshot& operator*() const { return *snapshot_; }
+  explicit operator bool() const { return !!snapshot_; }
+
+  void reset();
+
+ private:
+  const Snapshot* snapshot_ = nullptr;
+  std::atomic<uint64_t>* reader_count_ = nullptr;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_INCLUDE_VTLIB_SNAPSHOT_H_
@@ -1,12 +1,18 @@
 #ifndef VTLIB_INCLUDE_VTLIB_TERMINAL_H_
 #define VTLIB_INCLUDE_VTLIB_TERMINAL_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <chrono>
 #include <memory>
 
+#include <vtlib/cell.h>
 #include <vtlib/character_encoding.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/coordinates.h>
 #include <vtlib/display_updates.h>
+#include <vtlib/snapshot.h>
 
 namespace vtlib {
 
@@ -16,12 +22,76 @@ namespace vtlib {
 //FIXME moar
 class Terminal {
  public:
+  // How the cells of the viewport and the (hot) scrollback are stored.
+  enum class CellStorage {
+    // As |Cell|s (12 bytes each).
+    FULL,
+    // As 4-byte cells (a codepoint and an index into a per-terminal table of
+    // interned attribute/color combinations). This uses a third of the memory,
+    // but reading rows is slower (since they must be decoded).
+    COMPACT,
+  };
+
   struct Options {
+    Options() = default;
+
 //FIXME much moar
+    // Size of the viewport (both must be nonzero). See also |Resize()|.
+    uint32_t rows = 24u;
+    ColumnNumber columns = 80u;
+    // Maximum number of rows kept in the scrollback (i.e., after they've
+    // scrolled off the top of the viewport). Memory for the scrollback is only
+    // allocated as it's used.
+    uint32_t scrollback_rows = 10000u;
+    // The most recent |hot_scrollback_rows| rows of the scrollback are kept as
+    // is; older rows are stored in a compact encoding (and decoded when
+    // accessed), optionally also compressed.
+    uint32_t hot_scrollback_rows = 1000u;
+    bool compress_scrollback = true;
+    CellStorage cell_storage = CellStorage::FULL;
+    // Longest time that a synchronized update (DECSET 2026) may hold back
+    // display updates and snapshots, in case the application never ends it.
+    std::chrono::milliseconds synchronized_update_timeout =
+        std::chrono::milliseconds(1000);
 
     // These can also be changed via escape sequences:
-    bool accept_8bit_C1;
-    CharacterEncoding character_encoding;
+    bool accept_8bit_C1 = false;
+    CharacterEncoding character_encoding = CharacterEncoding::UTF8;
+  };
+
+  // Memory used for the contents of the viewport and the scrollback (see
+  // |GetMemoryUsage()|).
+  struct MemoryUsage {
+    MemoryUsage() = default;
+
+    size_t viewport_bytes = 0u;
+    // For the alternate screen (which is allocated up front, so that switching
+    // to it doesn't allocate).
+    size_t alternate_screen_bytes = 0u;
+    // For the most recent |Options::hot_scrollback_rows| rows.
+    uint64_t num_hot_scrollback_rows = 0u;
+    size_t hot_scrollback_bytes = 0u;
+    // For the rest of the scrollback.
+    uint64_t num_cold_scrollback_rows = 0u;
+    size_t cold_scrollback_bytes = 0u;
+    // For grapheme clusters (see |GetCluster()|).
+    uint64_t num_clusters = 0u;
+    size_t cluster_bytes = 0u;
+  };
+
+  // Counters for the pool that the cold scrollback is stored in (see
+  // |GetAllocationStats()|). Blocks of scrollback are stored in fixed-size
+  // chunks (about the size of a row of cells), which are carved out of larger
+  // slabs; the chunks of discarded blocks are reused. So once the scrollback
+  // is full, the number of slab allocations stays constant.
+  struct AllocationStats {
+    AllocationStats() = default;
+
+    // Slabs are allocated from the heap.
+    uint64_t num_slab_allocations = 0u;
+    uint64_t num_chunk_allocations = 0u;
+    size_t num_chunks_in_use = 0u;
+    size_t num_free_chunks = 0u;
   };
 
   virtual ~Terminal() = default;
@@ -34,14 +104,85 @@ class Terminal {
 //FIXME
   virtual bool ProcessByte(uint8_t input_byte) = 0;
 
+  // Processes |num_input_bytes| bytes from |input_bytes|. This is equivalent to
+  // calling |ProcessByte()| on each of the bytes in turn (and returns true if
+  // any of those calls would have returned true), but is much more efficient
+  // for large inputs (e.g., an entire read from a PTY).
+  virtual bool ProcessBytes(const uint8_t* input_bytes,
+                            size_t num_input_bytes) = 0;
+
   virtual const Options& options() const = 0;
   virtual bool options_set_accept_8bit_C1(bool accept_8bit_C1) = 0;
   virtual bool options_set_character_encoding(
       CharacterEncoding character_encoding) = 0;
 
+  // The viewport consists of the |options().rows| rows starting at row number
+  // |viewport_top()|, and the scrollback consists of the rows from
+  // |scrollback_top()| up to (but not including) |viewport_top()|.
+  virtual RowNumber viewport_top() const = 0;
+  virtual RowNumber scrollback_top() const = 0;
+  // Returns the |options().columns| cells of |row|, which must be in the
+  // viewport or the scrollback. The returned pointer is only valid until the
+  // terminal is next modified or the next call to |GetRow()|.
+  virtual const Cell* GetRow(RowNumber row) const = 0;
+  // Returns the codepoints of the grapheme cluster |cluster| (which must be
+  // from a cell returned by |GetRow()|, i.e., |IsClusterCodepoint(cluster)|),
+  // storing their number in |*num_codepoints|. E.g., a base character followed
+  // by combining marks, or an emoji ZWJ sequence. The returned pointer is only
+  // valid until the terminal is next modified. (The clusters in a snapshot's
+  // cells are looked up with |Snapshot::GetCluster()| instead.)
+  virtual const Codepoint* GetCluster(Codepoint cluster,
+                                      size_t* num_codepoints) const = 0;
+  // Returns true if |row| (as for |GetRow()|) was soft-wrapped, i.e., its line
+  // continues on the next row (e.g., so that copied text can omit the line
+  // break).
+  virtual bool IsRowWrapped(RowNumber row) const = 0;
+
+  virtual RowNumber cursor_row() const = 0;
+  virtual ColumnNumber cursor_column() const = 0;
+
+  virtual MemoryUsage GetMemoryUsage() const = 0;
+  virtual AllocationStats GetAllocationStats() const = 0;
+
   virtual const DisplayUpdates& display_updates() const = 0;
   virtual void reset_display_updates() = 0;
 
+  // Changes the size of the viewport (i.e., |options().rows| and
+  // |options().columns|) to |rows| by |columns| (both must be nonzero). On the
+  // main screen, the lines of the viewport and the hot scrollback are reflowed
+  // to the new width (joining the rows that they were soft-wrapped onto); rows
+  // move between the viewport and the scrollback as needed, and the cursor
+  // stays with its character. Empty rows below the cursor are dropped. The
+  // alternate screen is just cropped (or extended), and the scrolling region
+  // is reset.
+  //
+  // Rows in the cold scrollback are only reflowed when they're read (with
+  // |GetRow()| or |IsRowWrapped()|), a block of rows at a time, so this takes
+  // time proportional to the size of the viewport and the hot scrollback, and
+  // reading takes time proportional to the rows read. (A line that continues
+  // from the cold scrollback into the hot scrollback is reflowed as a whole
+  // now.) Until they're read, |scrollback_top()| counts the cold rows as they
+  // were; reflowing them may change it (but not the row numbers of the newer
+  // rows).
+  //
+  // Row numbers may change, and the whole viewport is marked dirty.
+  virtual void Resize(uint32_t rows, ColumnNumber columns) = 0;
+
+  // A |Terminal| isn't thread-safe: it must only be used on one thread at a
+  // time. The exception is |AcquireSnapshot()|, which lets other threads
+  // (e.g., a render thread) read the viewport as of the last call to
+  // |PublishSnapshot()|.
+  //
+  // Publishes a snapshot of the current viewport (and cursor position). Only
+  // the rows that have changed since the previous snapshot are copied. This
+  // does nothing while a synchronized update is in progress (see
+  // |DisplayUpdates::synchronized_update|), so partial frames aren't published.
+  virtual void PublishSnapshot() = 0;
+  // Returns the most recently published snapshot (a null handle if none has
+  // been published yet). This may be called on any thread, concurrently with
+  // any other method; it never blocks (nor blocks the terminal's thread).
+  virtual SnapshotHandle AcquireSnapshot() const = 0;
+
  protected:
   Terminal() = default;
 };
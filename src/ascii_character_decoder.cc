@@ -1,8 +1,20 @@
 #include "src/ascii_character_decoder.h"
 
+#include <assert.h>
+
 #include <vtlib/codepoint.h>
 
+#include "src/printable_ascii.h"
+
 namespace vtlib {
+namespace {
+
+Codepoint DecodeByte(uint8_t input_byte) {
+  return (input_byte <= 0x7f) ? static_cast<Codepoint>(input_byte)
+                              : CODEPOINT_REPLACEMENT;
+}
+
+}  // namespace
 
 AsciiCharacterDecoder::AsciiCharacterDecoder() = default;
 
@@ -14,9 +26,32 @@ bool AsciiCharacterDecoder::Supports8bitC1() const {
 
 void AsciiCharacterDecoder::ProcessByte(uint8_t input_byte,
                                         CodepointVector* output_codepoints) {
-  output_codepoints->push_back((input_byte <= 0x7f)
-                                   ? static_cast<Codepoint>(input_byte)
-                                   : CODEPOINT_REPLACEMENT);
+  output_codepoints->push_back(DecodeByte(input_byte));
+}
+
+size_t AsciiCharacterDecoder::Decode(const uint8_t* input_bytes,
+                                     size_t num_input_bytes,
+                                     Codepoint* output_codepoints,
+                                     size_t output_capacity,
+                                     size_t* num_output_codepoints) {
+  assert(output_capacity >= kMaxCodepointsPerByte);
+  // Each byte produces exactly one codepoint.
+  size_t n = (num_input_bytes < output_capacity) ? num_input_bytes
+                                                 : output_capacity;
+  size_t i = 0u;
+  while (i < n) {
+    uint8_t input_byte = input_bytes[i];
+    if (IsPrintableAscii(input_byte)) {
+      i += DecodePrintableAscii(input_bytes + i, n - i, output_codepoints + i);
+      continue;
+    }
+    if (is_control_code(input_byte))  // We support 8-bit C1 control codes.
+      break;
+    output_codepoints[i] = DecodeByte(input_byte);
+    i++;
+  }
+  *num_output_codepoints = i;
+  return i;
 }
 
 void AsciiCharacterDecoder::Flush(CodepointVector* output_codepoints) {
@@ -20,6 +20,11 @@ class AsciiCharacterDecoder : public CharacterDecoder {
   bool Supports8bitC1() const override;
   void ProcessByte(uint8_t input_byte,
                    CodepointVector* output_codepoints) override;
+  size_t Decode(const uint8_t* input_bytes,
+                size_t num_input_bytes,
+                Codepoint* output_codepoints,
+                size_t output_capacity,
+                size_t* num_output_codepoints) override;
   void Flush(CodepointVector* output_codepoints) override;
 };
 
@@ -0,0 +1,67 @@
+#include "src/block_pool.h"
+
+#include <assert.h>
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kAlignment = alignof(max_align_t);
+
+size_t RoundUpBlockSize(size_t block_size) {
+  return (block_size + kAlignment - 1u) / kAlignment * kAlignment;
+}
+
+}  // namespace
+
+BlockPool::BlockPool(size_t block_size, size_t blocks_per_slab)
+    : block_size_(RoundUpBlockSize(block_size)),
+      blocks_per_slab_(blocks_per_slab) {
+  assert(block_size >= sizeof(FreeBlock));
+  assert(blocks_per_slab > 0u);
+}
+
+BlockPool::~BlockPool() {
+  assert(!stats_.num_blocks_in_use);
+}
+
+void* BlockPool::Allocate() {
+  if (!free_list_) {
+    // Allocate a new slab, and put its blocks on the free list (in order, so
+    // that they're handed out in increasing address order).
+    // TODO(C++14): No make_unique in C++11.
+    slabs_.push_back(std::unique_ptr<uint8_t[]>(
+        new uint8_t[block_size_ * blocks_per_slab_]));
+    stats_.num_slab_allocations++;
+    uint8_t* slab = slabs_.back().get();
+    for (size_t i = blocks_per_slab_; i-- > 0u;) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * block_size_);
+      block->next = free_list_;
+      free_list_ = block;
+    }
+    stats_.num_free_blocks += blocks_per_slab_;
+  }
+
+  FreeBlock* block = free_list_;
+  free_list_ = block->next;
+  stats_.num_free_blocks--;
+  stats_.num_blocks_in_use++;
+  stats_.num_block_allocations++;
+  return block;
+}
+
+void BlockPool::Free(void* block) {
+  assert(block);
+  assert(stats_.num_blocks_in_use > 0u);
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = free_list_;
+  free_list_ = free_block;
+  stats_.num_free_blocks++;
+  stats_.num_blocks_in_use--;
+}
+
+size_t BlockPool::GetMemoryUsage() const {
+  return sizeof(*this) + slabs_.capacity() * sizeof(slabs_[0]) +
+         slabs_.size() * blocks_per_slab_ * block_size_;
+}
+
+}  // namespace vtlib
@@ -0,0 +1,69 @@
+#ifndef VTLIB_SRC_BLOCK_POOL_H_
+#define VTLIB_SRC_BLOCK_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+namespace vtlib {
+
+// A pool ("slab allocator") of fixed-size blocks of memory. Blocks are carved
+// out of larger "slabs" (each |blocks_per_slab| blocks), which are allocated
+// from the heap as needed, and freed blocks are kept on a free list to be
+// reused (slabs are only freed when the pool is destroyed). So once a pool has
+// grown to its working size, allocating and freeing blocks never touches the
+// heap.
+//
+// Not thread-safe.
+class BlockPool {
+ public:
+  // Counters, e.g., for checking that a steady-state workload doesn't allocate
+  // from the heap.
+  struct Stats {
+    Stats() = default;
+
+    // The number of slabs allocated (from the heap).
+    uint64_t num_slab_allocations = 0u;
+    // The number of calls to |Allocate()|.
+    uint64_t num_block_allocations = 0u;
+    size_t num_blocks_in_use = 0u;
+    size_t num_free_blocks = 0u;
+  };
+
+  // |block_size| must be at least |sizeof(void*)|; it's rounded up to a
+  // multiple of |alignof(max_align_t)|.
+  BlockPool(size_t block_size, size_t blocks_per_slab);
+  ~BlockPool();
+
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  size_t block_size() const { return block_size_; }
+  const Stats& stats() const { return stats_; }
+
+  // Returns a block of |block_size()| bytes (with unspecified contents).
+  void* Allocate();
+  // Returns |block| (from |Allocate()|) to the pool.
+  void Free(void* block);
+
+  // Returns the number of bytes of memory used (including free blocks).
+  size_t GetMemoryUsage() const;
+
+ private:
+  // The start of a free block holds a pointer to the next free block.
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  const size_t block_size_;
+  const size_t blocks_per_slab_;
+  std::vector<std::unique_ptr<uint8_t[]>> slabs_;
+  FreeBlock* free_list_ = nullptr;
+  Stats stats_;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_BLOCK_POOL_H_
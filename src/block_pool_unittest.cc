@@ -0,0 +1,71 @@
+#include "src/block_pool.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace vtlib {
+namespace {
+
+TEST(BlockPoolTest, Basic) {
+  BlockPool pool(100u, 4u);
+  // Rounded up.
+  EXPECT_EQ(0u, pool.block_size() % alignof(max_align_t));
+  EXPECT_GE(pool.block_size(), 100u);
+  EXPECT_EQ(0u, pool.stats().num_slab_allocations);
+
+  std::vector<void*> blocks;
+  for (size_t i = 0u; i < 10u; i++) {
+    void* block = pool.Allocate();
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(block) % alignof(max_align_t));
+    // Blocks don't overlap.
+    memset(block, static_cast<int>(i), 100u);
+    blocks.push_back(block);
+  }
+  for (size_t i = 0u; i < 10u; i++) {
+    const uint8_t* block = static_cast<const uint8_t*>(blocks[i]);
+    EXPECT_EQ(i, block[0]);
+    EXPECT_EQ(i, block[99]);
+  }
+  EXPECT_EQ(3u, pool.stats().num_slab_allocations);
+  EXPECT_EQ(10u, pool.stats().num_block_allocations);
+  EXPECT_EQ(10u, pool.stats().num_blocks_in_use);
+  EXPECT_EQ(2u, pool.stats().num_free_blocks);
+  EXPECT_GE(pool.GetMemoryUsage(), 12u * 100u);
+
+  for (void* block : blocks)
+    pool.Free(block);
+  EXPECT_EQ(0u, pool.stats().num_blocks_in_use);
+  EXPECT_EQ(12u, pool.stats().num_free_blocks);
+}
+
+TEST(BlockPoolTest, Reuse) {
+  BlockPool pool(sizeof(void*), 8u);
+  std::set<void*> all_blocks;
+  std::vector<void*> blocks;
+  for (size_t i = 0u; i < 8u; i++) {
+    blocks.push_back(pool.Allocate());
+    all_blocks.insert(blocks.back());
+  }
+
+  // Freed blocks get reused, without allocating more slabs.
+  for (size_t i = 0u; i < 1000u; i++) {
+    size_t j = (i * 5u) % blocks.size();
+    pool.Free(blocks[j]);
+    blocks[j] = pool.Allocate();
+    EXPECT_EQ(1u, all_blocks.count(blocks[j]));
+  }
+  EXPECT_EQ(1u, pool.stats().num_slab_allocations);
+  EXPECT_EQ(1008u, pool.stats().num_block_allocations);
+  EXPECT_EQ(0u, pool.stats().num_free_blocks);
+
+  for (void* block : blocks)
+    pool.Free(block);
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -1,19 +1,34 @@
 #include <vtlib/character_decoder.h>
 
 #include "src/ascii_character_decoder.h"
+#include "src/utf8_character_decoder.h"
+#include "src/utf8_dfa_character_decoder.h"
 
 namespace vtlib {
 
+// static
+constexpr size_t CharacterDecoder::kMaxCodepointsPerByte;
+
 // static
 std::unique_ptr<CharacterDecoder> CharacterDecoder::Create(
     CharacterEncoding character_encoding) {
+  return Create(character_encoding, Implementation::DEFAULT);
+}
+
+// static
+std::unique_ptr<CharacterDecoder> CharacterDecoder::Create(
+    CharacterEncoding character_encoding,
+    Implementation implementation) {
   switch (character_encoding) {
     case CharacterEncoding::ASCII:
       // TODO(C++14): Here and below, no make_unique in C++11. :(
       return std::unique_ptr<CharacterDecoder>(new AsciiCharacterDecoder());
     case CharacterEncoding::UTF8:
-      // TODO(vtl)
-      break;
+      if (implementation == Implementation::TABLE_DRIVEN) {
+        return std::unique_ptr<CharacterDecoder>(
+            new Utf8DfaCharacterDecoder());
+      }
+      return std::unique_ptr<CharacterDecoder>(new Utf8CharacterDecoder());
   }
   return nullptr;
 }
@@ -0,0 +1,124 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <vtlib/character_decoder.h>
+#include <vtlib/character_encoding.h>
+#include <vtlib/codepoint.h>
+
+#include "testing/benchmark_corpora.h"
+
+namespace vtlib {
+namespace {
+
+using Implementation = CharacterDecoder::Implementation;
+
+constexpr size_t kCorpusSize = 1u << 20;  // 1 MiB.
+constexpr size_t kBufferSize = 1024u;
+
+// Decodes all of |input| using |CharacterDecoder::Decode()|, handling control
+// codes like |TerminalImpl::ProcessBytes()| does. Returns the number of
+// codepoints produced.
+size_t DecodeAll(CharacterDecoder* decoder,
+                 const std::vector<uint8_t>& input,
+                 Codepoint* buffer,
+                 CodepointVector* scratch) {
+  bool supports_8bit_C1 = decoder->Supports8bitC1();
+  size_t num_codepoints = 0u;
+  const uint8_t* input_bytes = input.data();
+  size_t num_input_bytes = input.size();
+  while (num_input_bytes) {
+    size_t num_output = 0u;
+    size_t n = decoder->Decode(input_bytes, num_input_bytes, buffer,
+                               kBufferSize, &num_output);
+    benchmark::DoNotOptimize(buffer);
+    num_codepoints += num_output;
+    input_bytes += n;
+    num_input_bytes -= n;
+    if (num_input_bytes &&
+        CharacterDecoder::is_control_code(*input_bytes, supports_8bit_C1)) {
+      scratch->clear();
+      decoder->Flush(scratch);
+      num_codepoints += scratch->size() + 1u;
+      input_bytes++;
+      num_input_bytes--;
+    }
+  }
+  return num_codepoints;
+}
+
+void BM_Decode(benchmark::State& state,
+               CharacterEncoding character_encoding,
+               Implementation implementation,
+               Corpus corpus) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  std::unique_ptr<CharacterDecoder> decoder =
+      CharacterDecoder::Create(character_encoding, implementation);
+  Codepoint buffer[kBufferSize];
+  CodepointVector scratch;
+  scratch.reserve(kBufferSize);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(DecodeAll(decoder.get(), input, buffer, &scratch));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+// For comparison: decodes using |CharacterDecoder::ProcessByte()|.
+void BM_ProcessByte(benchmark::State& state,
+                    CharacterEncoding character_encoding,
+                    Implementation implementation,
+                    Corpus corpus) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  std::unique_ptr<CharacterDecoder> decoder =
+      CharacterDecoder::Create(character_encoding, implementation);
+  CodepointVector output;
+  output.reserve(CharacterDecoder::kMaxCodepointsPerByte);
+  for (auto _ : state) {
+    for (uint8_t input_byte : input) {
+      output.clear();
+      decoder->ProcessByte(input_byte, &output);
+      benchmark::DoNotOptimize(output.data());
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+#define DECODER_BENCHMARKS(func, name, character_encoding, implementation) \
+  BENCHMARK_CAPTURE(func, name##_ascii, character_encoding, implementation, \
+                    Corpus::ASCII);                                         \
+  BENCHMARK_CAPTURE(func, name##_latin_cjk, character_encoding,             \
+                    implementation, Corpus::LATIN_CJK);                     \
+  BENCHMARK_CAPTURE(func, name##_emoji, character_encoding, implementation, \
+                    Corpus::EMOJI);                                         \
+  BENCHMARK_CAPTURE(func, name##_invalid_utf8, character_encoding,          \
+                    implementation, Corpus::INVALID_UTF8);                  \
+  BENCHMARK_CAPTURE(func, name##_control_dense, character_encoding,         \
+                    implementation, Corpus::CONTROL_DENSE)
+
+DECODER_BENCHMARKS(BM_Decode,
+                   ascii,
+                   CharacterEncoding::ASCII,
+                   Implementation::DEFAULT);
+DECODER_BENCHMARKS(BM_Decode,
+                   utf8,
+                   CharacterEncoding::UTF8,
+                   Implementation::DEFAULT);
+DECODER_BENCHMARKS(BM_Decode,
+                   utf8_table_driven,
+                   CharacterEncoding::UTF8,
+                   Implementation::TABLE_DRIVEN);
+DECODER_BENCHMARKS(BM_ProcessByte,
+                   utf8,
+                   CharacterEncoding::UTF8,
+                   Implementation::DEFAULT);
+DECODER_BENCHMARKS(BM_ProcessByte,
+                   utf8_table_driven,
+                   CharacterEncoding::UTF8,
+                   Implementation::TABLE_DRIVEN);
+
+}  // namespace
+}  // namespace vtlib
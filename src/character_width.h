@@ -0,0 +1,69 @@
+#ifndef VTLIB_SRC_CHARACTER_WIDTH_H_
+#define VTLIB_SRC_CHARACTER_WIDTH_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+
+// How many columns a character occupies (the value is the number of columns).
+enum class CharacterWidth : uint8_t {
+  // Zero width: combining marks, Hangul medial vowels and final consonants,
+  // and (invisible) format characters such as ZWJ and variation selectors.
+  // These belong to the preceding character.
+  COMBINING = 0u,
+  NARROW = 1u,
+  // East Asian Wide and Fullwidth characters (including most emoji).
+  WIDE = 2u,
+};
+
+namespace internal {
+
+// All codepoints below this are narrow (this covers ASCII and Latin-1).
+constexpr Codepoint kFirstNonNarrowCodepoint = 0x300u;
+
+// Two-stage lookup table (generated by make_character_width_tables.py, in
+// character_width_tables.cc): |kCharacterWidthBlockIndices| maps each block of
+// 2^|kCharacterWidthBlockShift| codepoints to a block in
+// |kCharacterWidthBlocks| (most blocks are the same, e.g., all narrow or all
+// wide, so only the distinct ones are stored).
+constexpr uint32_t kCharacterWidthBlockShift = 7u;
+extern const uint8_t kCharacterWidthBlockIndices[];
+extern const uint8_t kCharacterWidthBlocks[];
+
+}  // namespace internal
+
+// Returns the width of (the character for) |codepoint|, which must be at most
+// 0x10ffff. This is O(1): two table lookups (or none for codepoints below
+// U+0300).
+inline CharacterWidth GetCharacterWidth(Codepoint codepoint) {
+  if (codepoint < internal::kFirstNonNarrowCodepoint)
+    return CharacterWidth::NARROW;
+  assert(codepoint <= 0x10ffffu);
+  using internal::kCharacterWidthBlockShift;
+  const uint32_t block = internal::kCharacterWidthBlockIndices
+      [codepoint >> kCharacterWidthBlockShift];
+  const uint32_t offset =
+      codepoint & ((1u << kCharacterWidthBlockShift) - 1u);
+  return static_cast<CharacterWidth>(
+      internal::kCharacterWidthBlocks[(block << kCharacterWidthBlockShift) |
+                                      offset]);
+}
+
+// Returns the length of the longest prefix of |codepoints| (of which there are
+// |num_codepoints|) consisting of narrow characters.
+inline size_t CountNarrowCharacters(const Codepoint* codepoints,
+                                    size_t num_codepoints) {
+  size_t i = 0u;
+  while (i < num_codepoints &&
+         GetCharacterWidth(codepoints[i]) == CharacterWidth::NARROW)
+    i++;
+  return i;
+}
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_CHARACTER_WIDTH_H_
@@ -0,0 +1,93 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <vtlib/character_decoder.h>
+#include <vtlib/character_encoding.h>
+#include <vtlib/codepoint.h>
+
+#include "src/character_width.h"
+#include "testing/benchmark_corpora.h"
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kCorpusSize = 1u << 20;  // 1 MiB.
+
+// Decodes all of |input| (as UTF-8) using |CharacterDecoder::ProcessByte()|.
+CodepointVector DecodeCorpus(const std::vector<uint8_t>& input) {
+  std::unique_ptr<CharacterDecoder> decoder =
+      CharacterDecoder::Create(CharacterEncoding::UTF8);
+  CodepointVector output;
+  for (uint8_t input_byte : input)
+    decoder->ProcessByte(input_byte, &output);
+  decoder->Flush(&output);
+  return output;
+}
+
+// Measures |GetCharacterWidth()| on the codepoints of a corpus (the number of
+// columns is summed, so that the lookups aren't optimized away).
+void BM_GetCharacterWidth(benchmark::State& state, Corpus corpus) {
+  CodepointVector codepoints =
+      DecodeCorpus(GenerateCorpus(corpus, kCorpusSize));
+  for (auto _ : state) {
+    size_t columns = 0u;
+    for (Codepoint codepoint : codepoints)
+      columns += static_cast<size_t>(GetCharacterWidth(codepoint));
+    benchmark::DoNotOptimize(columns);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(codepoints.size()));
+}
+
+BENCHMARK_CAPTURE(BM_GetCharacterWidth, ascii, Corpus::ASCII);
+BENCHMARK_CAPTURE(BM_GetCharacterWidth, latin_cjk, Corpus::LATIN_CJK);
+BENCHMARK_CAPTURE(BM_GetCharacterWidth, emoji, Corpus::EMOJI);
+
+// For comparison: the same, using a binary search in a table of ranges (the
+// start of each run of codepoints with the same width), without a fast path
+// for ASCII.
+struct WidthRange {
+  Codepoint first;
+  CharacterWidth width;
+};
+
+std::vector<WidthRange> MakeWidthRanges() {
+  std::vector<WidthRange> ranges;
+  for (Codepoint codepoint = 0u; codepoint <= 0x10ffffu; codepoint++) {
+    CharacterWidth width = GetCharacterWidth(codepoint);
+    if (ranges.empty() || ranges.back().width != width)
+      ranges.push_back(WidthRange{codepoint, width});
+  }
+  return ranges;
+}
+
+void BM_BinarySearchCharacterWidth(benchmark::State& state, Corpus corpus) {
+  CodepointVector codepoints =
+      DecodeCorpus(GenerateCorpus(corpus, kCorpusSize));
+  const std::vector<WidthRange> ranges = MakeWidthRanges();
+  for (auto _ : state) {
+    size_t columns = 0u;
+    for (Codepoint codepoint : codepoints) {
+      auto it = std::upper_bound(
+          ranges.begin(), ranges.end(), codepoint,
+          [](Codepoint c, const WidthRange& range) { return c < range.first; });
+      columns += static_cast<size_t>((it - 1)->width);
+    }
+    benchmark::DoNotOptimize(columns);
+  }
+  state.counters["num_ranges"] = static_cast<double>(ranges.size());
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(codepoints.size()));
+}
+
+BENCHMARK_CAPTURE(BM_BinarySearchCharacterWidth, ascii, Corpus::ASCII);
+BENCHMARK_CAPTURE(BM_BinarySearchCharacterWidth, latin_cjk, Corpus::LATIN_CJK);
+BENCHMARK_CAPTURE(BM_BinarySearchCharacterWidth, emoji, Corpus::EMOJI);
+
+}  // namespace
+}  // namespace vtlib
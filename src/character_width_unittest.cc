@@ -0,0 +1,61 @@
+#include "src/character_width.h"
+
+#include <gtest/gtest.h>
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+namespace {
+
+TEST(CharacterWidthTest, Narrow) {
+  for (Codepoint codepoint = 0u; codepoint < 0x300u; codepoint++)
+    EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(codepoint));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0x0391u));
+  // Visible format characters.
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0x00adu));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0x0600u));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0x2500u));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0xe000u));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0xff61u));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(CODEPOINT_REPLACEMENT));
+  EXPECT_EQ(CharacterWidth::NARROW, GetCharacterWidth(0x10ffffu));
+}
+
+TEST(CharacterWidthTest, Wide) {
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x1100u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x3042u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x4e00u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0xac00u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0xff01u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x1f600u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x1f3fbu));
+  // Regional indicators (a pair of which is a flag).
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x1f1e6u));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x1f1ffu));
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x20000u));
+  // Unassigned, but East Asian Wide by default.
+  EXPECT_EQ(CharacterWidth::WIDE, GetCharacterWidth(0x3fffdu));
+}
+
+TEST(CharacterWidthTest, Combining) {
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x0300u));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x036fu));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x0488u));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x1160u));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x200bu));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x200du));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0x20e3u));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0xfe0fu));
+  EXPECT_EQ(CharacterWidth::COMBINING, GetCharacterWidth(0xe0100u));
+}
+
+TEST(CharacterWidthTest, CountNarrowCharacters) {
+  const Codepoint codepoints[] = {'a', 0xe9u, 0x0391u, 0x0301u, 'b', 0x4e00u};
+  EXPECT_EQ(0u, CountNarrowCharacters(codepoints, 0u));
+  EXPECT_EQ(2u, CountNarrowCharacters(codepoints, 2u));
+  EXPECT_EQ(3u, CountNarrowCharacters(codepoints, 6u));
+  EXPECT_EQ(0u, CountNarrowCharacters(codepoints + 3, 3u));
+  EXPECT_EQ(1u, CountNarrowCharacters(codepoints + 4, 2u));
+}
+
+}  // namespace
+}  // namespace vtlib
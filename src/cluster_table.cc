@@ -0,0 +1,144 @@
+#include "src/cluster_table.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kMinHashTableSize = 64u;
+
+size_t HashCluster(const Codepoint* codepoints, size_t num_codepoints) {
+  uint64_t h = num_codepoints;
+  for (size_t i = 0u; i < num_codepoints; i++)
+    h = h * 0x9e3779b97f4a7c15u + codepoints[i];
+  return static_cast<size_t>((h * 0x9e3779b97f4a7c15u) >> 32u);
+}
+
+}  // namespace
+
+constexpr size_t ClusterTable::kMaxClusters;
+constexpr uint32_t ClusterTable::kEmpty;
+
+ClusterTable::ClusterTable() : hash_table_(kMinHashTableSize, kEmpty) {}
+
+ClusterTable::~ClusterTable() = default;
+
+bool ClusterTable::Intern(const Codepoint* codepoints,
+                          size_t num_codepoints,
+                          Codepoint* cluster) {
+  assert(num_codepoints >= 2u);
+  size_t position = Find(codepoints, num_codepoints);
+  if (hash_table_[position] != kEmpty) {
+    *cluster = CODEPOINT_FIRST_CLUSTER + hash_table_[position];
+    return true;
+  }
+
+  uint32_t index;
+  if (!free_list_.empty()) {
+    index = free_list_.back();
+    free_list_.pop_back();
+  } else if (entries_.size() < kMaxClusters) {
+    index = static_cast<uint32_t>(entries_.size());
+    entries_.emplace_back();
+  } else {
+    return false;
+  }
+  entries_[index].offset = static_cast<uint32_t>(arena_.size());
+  entries_[index].length = static_cast<uint32_t>(num_codepoints);
+  arena_.insert(arena_.end(), codepoints, codepoints + num_codepoints);
+  *cluster = CODEPOINT_FIRST_CLUSTER + index;
+
+  if (2u * entries_.size() > hash_table_.size())
+    RebuildHashTable(2u * hash_table_.size());
+  else
+    hash_table_[position] = index;
+  return true;
+}
+
+void ClusterTable::BeginGarbageCollection() {
+  marks_.assign(entries_.size(), false);
+}
+
+void ClusterTable::EndGarbageCollection() {
+  assert(marks_.size() == entries_.size());
+
+  // Drop trailing unused entries, so that |entries_| can shrink.
+  size_t num_entries = entries_.size();
+  while (num_entries && !marks_[num_entries - 1u])
+    num_entries--;
+  entries_.resize(num_entries);
+
+  // Compact the arena (keeping the clusters in order), and add the free
+  // indices in decreasing order, so that lower indices get reused first.
+  // (|scratch_arena_| keeps its capacity, so that in steady state, this doesn't
+  // allocate.)
+  std::vector<Codepoint>& arena = scratch_arena_;
+  arena.clear();
+  free_list_.clear();
+  for (size_t i = 0u; i < num_entries; i++) {
+    Entry& entry = entries_[i];
+    if (marks_[i]) {
+      uint32_t offset = static_cast<uint32_t>(arena.size());
+      arena.insert(arena.end(), arena_.begin() + entry.offset,
+                   arena_.begin() + entry.offset + entry.length);
+      entry.offset = offset;
+    } else {
+      entry.offset = 0u;
+      entry.length = 0u;
+    }
+  }
+  for (size_t i = num_entries; i-- > 0u;) {
+    if (!marks_[i])
+      free_list_.push_back(static_cast<uint32_t>(i));
+  }
+  arena_.swap(arena);
+  // But if most of the clusters were freed, release the memory.
+  if (scratch_arena_.capacity() > 4u * arena_.size())
+    std::vector<Codepoint>().swap(scratch_arena_);
+
+  size_t size = kMinHashTableSize;
+  while (size < 2u * num_entries)
+    size *= 2u;
+  RebuildHashTable(size);
+}
+
+size_t ClusterTable::GetMemoryUsage() const {
+  return sizeof(*this) + entries_.capacity() * sizeof(Entry) +
+         free_list_.capacity() * sizeof(uint32_t) +
+         (arena_.capacity() + scratch_arena_.capacity()) * sizeof(Codepoint) +
+         marks_.capacity() / 8u +
+         hash_table_.capacity() * sizeof(uint32_t);
+}
+
+size_t ClusterTable::Find(const Codepoint* codepoints,
+                          size_t num_codepoints) const {
+  const size_t mask = hash_table_.size() - 1u;
+  size_t position = HashCluster(codepoints, num_codepoints) & mask;
+  while (hash_table_[position] != kEmpty) {
+    const Entry& entry = entries_[hash_table_[position]];
+    if (entry.length == num_codepoints &&
+        !memcmp(&arena_[entry.offset], codepoints,
+                num_codepoints * sizeof(Codepoint)))
+      break;
+    position = (position + 1u) & mask;
+  }
+  return position;
+}
+
+void ClusterTable::RebuildHashTable(size_t size) {
+  assert(!(size & (size - 1u)));
+  hash_table_.assign(size, kEmpty);
+  for (size_t i = 0u; i < entries_.size(); i++) {
+    const Entry& entry = entries_[i];
+    if (!entry.length)
+      continue;
+    size_t position = Find(&arena_[entry.offset], entry.length);
+    assert(hash_table_[position] == kEmpty);
+    hash_table_[position] = static_cast<uint32_t>(i);
+  }
+  if (hash_table_.capacity() > 4u * size)
+    hash_table_.shrink_to_fit();
+}
+
+}  // namespace vtlib
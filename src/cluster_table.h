@@ -0,0 +1,100 @@
+#ifndef VTLIB_SRC_CLUSTER_TABLE_H_
+#define VTLIB_SRC_CLUSTER_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+
+// A table of interned grapheme clusters (sequences of more than one codepoint,
+// e.g., a base character followed by combining marks), so that a cell can hold
+// a cluster as a single "codepoint" (from |CODEPOINT_FIRST_CLUSTER| to
+// |CODEPOINT_LAST_CLUSTER|). The codepoints of all the clusters are stored
+// contiguously in one arena, so looking up a cluster is O(1).
+//
+// Like |StyleTable|, unused clusters are reclaimed by (mark-and-sweep) garbage
+// collection, driven by the owner of the cells: it calls
+// |BeginGarbageCollection()|, then |Mark()| for every cluster still in use
+// (e.g., in the viewport and the scrollback), and then
+// |EndGarbageCollection()|. This also compacts the arena.
+class ClusterTable {
+ public:
+  static constexpr size_t kMaxClusters =
+      CODEPOINT_LAST_CLUSTER - CODEPOINT_FIRST_CLUSTER + 1u;
+
+  ClusterTable();
+  ~ClusterTable();
+
+  ClusterTable(const ClusterTable&) = delete;
+  ClusterTable& operator=(const ClusterTable&) = delete;
+
+  // Looks up (adding if necessary) the cluster consisting of the
+  // |num_codepoints| (at least 2) |codepoints|, storing the value identifying
+  // it in |*cluster|. Returns false (only) if the cluster isn't present and the
+  // table is full. (|codepoints| must not point into the table, e.g., to the
+  // result of |Get()|.)
+  bool Intern(const Codepoint* codepoints,
+              size_t num_codepoints,
+              Codepoint* cluster);
+
+  // Returns the codepoints of |cluster| (which must be in use), storing their
+  // number in |*num_codepoints|. The returned pointer is valid until the next
+  // call to |Intern()| or |EndGarbageCollection()|.
+  const Codepoint* Get(Codepoint cluster, size_t* num_codepoints) const {
+    const Entry& entry = entries_[cluster - CODEPOINT_FIRST_CLUSTER];
+    *num_codepoints = entry.length;
+    return &arena_[entry.offset];
+  }
+
+  // The number of clusters in use.
+  size_t num_clusters() const { return entries_.size() - free_list_.size(); }
+
+  void BeginGarbageCollection();
+  void Mark(Codepoint cluster) {
+    marks_[cluster - CODEPOINT_FIRST_CLUSTER] = true;
+  }
+  void EndGarbageCollection();
+
+  // Returns the (approximate) number of bytes of memory used.
+  size_t GetMemoryUsage() const;
+
+ private:
+  // The codepoints of a cluster are |arena_[offset..offset + length - 1]|.
+  // Free entries have length 0.
+  struct Entry {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  // Returns the position in |hash_table_| for the given cluster: either the
+  // one containing its index or the (empty) one where it should be added.
+  size_t Find(const Codepoint* codepoints, size_t num_codepoints) const;
+  // Rebuilds |hash_table_| with the given size (a power of 2).
+  void RebuildHashTable(size_t size);
+
+  // Indexed by cluster index (the cluster minus |CODEPOINT_FIRST_CLUSTER|).
+  // Free entries are in |free_list_|.
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> free_list_;
+  std::vector<Codepoint> arena_;
+  // The arena is compacted into this (and then they're swapped) during garbage
+  // collection.
+  std::vector<Codepoint> scratch_arena_;
+  // Used for garbage collection (indexed by cluster index).
+  std::vector<bool> marks_;
+
+  // An open-addressing (linear probing) hash table of cluster indices (with
+  // |kEmpty| for empty entries); its size is a power of 2, at least twice the
+  // number of entries. It is rebuilt when it grows and after garbage
+  // collection (so there are no deletions).
+  static constexpr uint32_t kEmpty = 0xffffffffu;
+  std::vector<uint32_t> hash_table_;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_CLUSTER_TABLE_H_
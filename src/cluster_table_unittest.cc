@@ -0,0 +1,95 @@
+#include "src/cluster_table.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+namespace {
+
+// Returns the codepoints of |cluster|.
+std::vector<Codepoint> GetCluster(const ClusterTable& cluster_table,
+                                  Codepoint cluster) {
+  size_t num_codepoints = 0u;
+  const Codepoint* codepoints = cluster_table.Get(cluster, &num_codepoints);
+  return std::vector<Codepoint>(codepoints, codepoints + num_codepoints);
+}
+
+TEST(ClusterTableTest, Intern) {
+  ClusterTable cluster_table;
+  EXPECT_EQ(0u, cluster_table.num_clusters());
+
+  const std::vector<Codepoint> e_acute = {'e', 0x0301u};
+  const std::vector<Codepoint> family = {0x1f468u, 0x200du, 0x1f469u};
+  Codepoint cluster1 = 0u;
+  ASSERT_TRUE(cluster_table.Intern(e_acute.data(), e_acute.size(), &cluster1));
+  EXPECT_TRUE(IsClusterCodepoint(cluster1));
+  Codepoint cluster2 = 0u;
+  ASSERT_TRUE(cluster_table.Intern(family.data(), family.size(), &cluster2));
+  EXPECT_TRUE(IsClusterCodepoint(cluster2));
+  EXPECT_NE(cluster1, cluster2);
+  EXPECT_EQ(2u, cluster_table.num_clusters());
+  EXPECT_EQ(e_acute, GetCluster(cluster_table, cluster1));
+  EXPECT_EQ(family, GetCluster(cluster_table, cluster2));
+
+  // Interning the same cluster again gives the same value.
+  Codepoint cluster = 0u;
+  ASSERT_TRUE(cluster_table.Intern(e_acute.data(), e_acute.size(), &cluster));
+  EXPECT_EQ(cluster1, cluster);
+  // A prefix is a different cluster.
+  ASSERT_TRUE(cluster_table.Intern(family.data(), 2u, &cluster));
+  EXPECT_NE(cluster2, cluster);
+  EXPECT_EQ(3u, cluster_table.num_clusters());
+}
+
+TEST(ClusterTableTest, GarbageCollection) {
+  ClusterTable cluster_table;
+  // Enough clusters that the hash table has to grow.
+  std::vector<Codepoint> clusters;
+  for (Codepoint i = 0u; i < 1000u; i++) {
+    const Codepoint codepoints[] = {'a' + i, 0x0300u + i % 0x70u};
+    Codepoint cluster = 0u;
+    ASSERT_TRUE(cluster_table.Intern(codepoints, 2u, &cluster));
+    clusters.push_back(cluster);
+  }
+  EXPECT_EQ(1000u, cluster_table.num_clusters());
+  size_t memory_usage = cluster_table.GetMemoryUsage();
+
+  // Keep every tenth cluster.
+  cluster_table.BeginGarbageCollection();
+  for (size_t i = 0u; i < clusters.size(); i += 10u)
+    cluster_table.Mark(clusters[i]);
+  cluster_table.EndGarbageCollection();
+  EXPECT_EQ(100u, cluster_table.num_clusters());
+  EXPECT_LT(cluster_table.GetMemoryUsage(), memory_usage);
+
+  // The remaining clusters are unchanged (and can still be found).
+  for (Codepoint i = 0u; i < 1000u; i += 10u) {
+    const std::vector<Codepoint> codepoints = {'a' + i, 0x0300u + i % 0x70u};
+    EXPECT_EQ(codepoints, GetCluster(cluster_table, clusters[i]));
+    Codepoint cluster = 0u;
+    ASSERT_TRUE(cluster_table.Intern(codepoints.data(), 2u, &cluster));
+    EXPECT_EQ(clusters[i], cluster);
+  }
+  EXPECT_EQ(100u, cluster_table.num_clusters());
+
+  // Freed values get reused (lowest first).
+  const Codepoint codepoints[] = {'x', 0x0308u, 0x0308u};
+  Codepoint cluster = 0u;
+  ASSERT_TRUE(cluster_table.Intern(codepoints, 3u, &cluster));
+  EXPECT_EQ(clusters[1], cluster);
+
+  // Collecting everything.
+  cluster_table.BeginGarbageCollection();
+  cluster_table.EndGarbageCollection();
+  EXPECT_EQ(0u, cluster_table.num_clusters());
+  ASSERT_TRUE(cluster_table.Intern(codepoints, 3u, &cluster));
+  EXPECT_EQ(clusters[0], cluster);
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,628 @@
+#include "src/cold_scrollback.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <vtlib/character.h>
+#include <vtlib/color.h>
+
+#include "src/lz_codec.h"
+#include "src/reflow.h"
+
+namespace vtlib {
+namespace {
+
+void AppendVarint(uint32_t value, std::vector<uint8_t>* output) {
+  while (value >= 0x80u) {
+    output->push_back(static_cast<uint8_t>(value | 0x80u));
+    value >>= 7u;
+  }
+  output->push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t** input) {
+  uint32_t value = 0u;
+  for (unsigned shift = 0u;; shift += 7u) {
+    uint8_t b = *(*input)++;
+    value |= static_cast<uint32_t>(b & 0x7fu) << shift;
+    if (!(b & 0x80u))
+      return value;
+  }
+}
+
+// Appends |codepoint| in UTF-8. Values up to 0x1fffff (i.e., anything that
+// fits in a |Character|) are encoded, using the natural extension of UTF-8's
+// 4-byte form.
+void AppendCodepoint(uint32_t codepoint, std::vector<uint8_t>* output) {
+  if (codepoint < 0x80u) {
+    output->push_back(static_cast<uint8_t>(codepoint));
+  } else if (codepoint < 0x800u) {
+    output->push_back(static_cast<uint8_t>(0xc0u | (codepoint >> 6u)));
+    output->push_back(static_cast<uint8_t>(0x80u | (codepoint & 0x3fu)));
+  } else if (codepoint < 0x10000u) {
+    output->push_back(static_cast<uint8_t>(0xe0u | (codepoint >> 12u)));
+    output->push_back(
+        static_cast<uint8_t>(0x80u | ((codepoint >> 6u) & 0x3fu)));
+    output->push_back(static_cast<uint8_t>(0x80u | (codepoint & 0x3fu)));
+  } else {
+    output->push_back(static_cast<uint8_t>(0xf0u | (codepoint >> 18u)));
+    output->push_back(
+        static_cast<uint8_t>(0x80u | ((codepoint >> 12u) & 0x3fu)));
+    output->push_back(
+        static_cast<uint8_t>(0x80u | ((codepoint >> 6u) & 0x3fu)));
+    output->push_back(static_cast<uint8_t>(0x80u | (codepoint & 0x3fu)));
+  }
+}
+
+// Reads a codepoint encoded by |AppendCodepoint()| (the input is trusted).
+uint32_t ReadCodepoint(const uint8_t** input) {
+  uint8_t b = *(*input)++;
+  if (b < 0x80u)
+    return b;
+  unsigned num_continuation_bytes = b < 0xe0u ? 1u : (b < 0xf0u ? 2u : 3u);
+  uint32_t codepoint = b & (0x3fu >> num_continuation_bytes);
+  for (unsigned i = 0u; i < num_continuation_bytes; i++)
+    codepoint = (codepoint << 6u) | (*(*input)++ & 0x3fu);
+  return codepoint;
+}
+
+uint32_t ColorToRaw(const Color& color) {
+  return (static_cast<uint32_t>(color.type()) << 24u) | color.data();
+}
+
+Color RawToColor(uint32_t raw) {
+  return Color(static_cast<Color::Type>(raw >> 24u), raw & 0x00ffffffu);
+}
+
+bool HaveSameStyle(const Cell& a, const Cell& b) {
+  return a.character().attribute() == b.character().attribute() &&
+         a.fg() == b.fg() && a.bg() == b.bg();
+}
+
+// Encodes a row as: the number of cells N (after dropping trailing empty
+// cells, unless the row is wrapped, in which case they're part of its line)
+// shifted left by one, ORed with 1 if the row is wrapped; the style runs (each
+// a length, attributes, foreground and background colors; the lengths add up
+// to N); and then the N codepoints.
+void EncodeRow(const Cell* cells,
+               ColumnNumber num_cells,
+               bool wrapped,
+               std::vector<uint8_t>* output) {
+  while (!wrapped && num_cells && cells[num_cells - 1u] == Cell())
+    num_cells--;
+  AppendVarint((num_cells << 1u) | (wrapped ? 1u : 0u), output);
+
+  for (ColumnNumber i = 0u; i < num_cells;) {
+    ColumnNumber run_end = i + 1u;
+    while (run_end < num_cells && HaveSameStyle(cells[i], cells[run_end]))
+      run_end++;
+    AppendVarint(run_end - i, output);
+    AppendVarint(static_cast<uint32_t>(cells[i].character().attribute()),
+                 output);
+    AppendVarint(ColorToRaw(cells[i].fg()), output);
+    AppendVarint(ColorToRaw(cells[i].bg()), output);
+    i = run_end;
+  }
+
+  for (ColumnNumber i = 0u; i < num_cells; i++)
+    AppendCodepoint(cells[i].character().codepoint(), output);
+}
+
+void DecodeRow(const uint8_t* input, Cell* cells, ColumnNumber num_cells) {
+  uint32_t encoded_num_cells = ReadVarint(&input) >> 1u;
+
+  // Decode the styles first (leaving the codepoints 0).
+  for (uint32_t i = 0u; i < encoded_num_cells;) {
+    uint32_t run_length = ReadVarint(&input);
+    Character character(static_cast<Character::Attribute>(ReadVarint(&input)));
+    Color fg = RawToColor(ReadVarint(&input));
+    Color bg = RawToColor(ReadVarint(&input));
+    for (uint32_t j = i; j < i + run_length && j < num_cells; j++)
+      cells[j] = Cell(character, fg, bg);
+    i += run_length;
+  }
+
+  for (uint32_t i = 0u; i < encoded_num_cells; i++) {
+    uint32_t codepoint = ReadCodepoint(&input);
+    if (i < num_cells) {
+      Character character = cells[i].character();
+      character.set_codepoint(codepoint);
+      cells[i].set_character(character);
+    }
+  }
+
+  for (ColumnNumber i = encoded_num_cells; i < num_cells; i++)
+    cells[i] = Cell();
+}
+
+// Returns the end of the row (encoded by |EncodeRow()|) starting at |input|.
+const uint8_t* SkipRow(const uint8_t* input) {
+  uint32_t num_cells = ReadVarint(&input) >> 1u;
+  for (uint32_t i = 0u; i < num_cells;) {
+    i += ReadVarint(&input);
+    for (int j = 0; j < 3; j++)
+      ReadVarint(&input);
+  }
+  for (uint32_t i = 0u; i < num_cells; i++)
+    ReadCodepoint(&input);
+  return input;
+}
+
+bool IsRowWrapped(const uint8_t* input) {
+  return ReadVarint(&input) & 1u;
+}
+
+// Appends the cells of the row (encoded by |EncodeRow()|) starting at |input|
+// to |*line|, like |AppendRowToLine()|. (|EncodeRow()| has already dropped the
+// trailing empty cells, if the row isn't wrapped.)
+void AppendEncodedRowToLine(const uint8_t* input, std::vector<Cell>* line) {
+  const uint8_t* header = input;
+  uint32_t num_cells = ReadVarint(&header) >> 1u;
+  const size_t size = line->size();
+  line->resize(size + num_cells);
+  DecodeRow(input, line->data() + size, num_cells);
+}
+
+}  // namespace
+
+constexpr size_t ColdScrollback::kRowsPerBlock;
+constexpr size_t ColdScrollback::kMaxRowsPerBlock;
+
+namespace {
+
+// So that each chunk holds a reasonable amount of data (after its next
+// pointer).
+constexpr size_t kMinChunkSize = 64u;
+constexpr size_t kChunksPerSlab = 64u;
+
+uint8_t* GetNextChunk(const uint8_t* chunk) {
+  uint8_t* next;
+  memcpy(&next, chunk, sizeof(next));
+  return next;
+}
+
+void SetNextChunk(uint8_t* chunk, uint8_t* next) {
+  memcpy(chunk, &next, sizeof(next));
+}
+
+}  // namespace
+
+bool ColdScrollback::BlockBuilder::IsFull() const {
+  if (num_rows() < kRowsPerBlock)
+    return false;
+  return num_rows() >= kMaxRowsPerBlock ||
+         !IsRowWrapped(data.data() + row_offsets.back());
+}
+
+void ColdScrollback::BlockBuilder::AppendRow(const Cell* cells,
+                                             ColumnNumber num_cells,
+                                             bool wrapped) {
+  row_offsets.push_back(static_cast<uint32_t>(data.size()));
+  EncodeRow(cells, num_cells, wrapped, &data);
+  for (ColumnNumber i = 0u; i < num_cells; i++) {
+    Codepoint codepoint = cells[i].character().codepoint();
+    if (IsClusterCodepoint(codepoint))
+      clusters.push_back(codepoint);
+  }
+}
+
+void ColdScrollback::BlockBuilder::Clear() {
+  row_offsets.clear();
+  data.clear();
+  clusters.clear();
+}
+
+ColdScrollback::ColdScrollback(size_t capacity,
+                               ColumnNumber columns,
+                               bool compress,
+                               size_t chunk_size)
+    : capacity_(capacity),
+      columns_(columns),
+      compress_(compress),
+      chunk_data_size_(std::max(chunk_size, kMinChunkSize) - sizeof(uint8_t*)),
+      chunk_pool_(chunk_data_size_ + sizeof(uint8_t*), kChunksPerSlab) {
+  assert(columns > 0u);
+}
+
+ColdScrollback::~ColdScrollback() {
+  while (num_blocks())
+    DiscardFirstBlock();
+}
+
+void ColdScrollback::set_columns(ColumnNumber columns) {
+  assert(columns > 0u);
+  if (columns == columns_)
+    return;
+  columns_ = columns;
+
+  // Reflow the open block (its rows that haven't been discarded), sealing
+  // blocks as needed. (|reflow_builder_| is empty.)
+  const size_t begin = num_blocks() ? 0u : num_discarded_rows_;
+  std::swap(open_, reflow_builder_);
+  const size_t end = reflow_builder_.num_rows();
+  num_rows_ -= end - begin;
+  open_first_row_ += begin;
+  num_discarded_rows_ -= begin;
+  reflowed_blocks_.clear();
+  ReflowRows(reflow_builder_.data.data(), reflow_builder_.row_offsets.data(),
+             begin, end, &open_, &reflowed_blocks_);
+  reflow_builder_.Clear();
+  for (const Block& b : reflowed_blocks_) {
+    AppendBlock(b);
+    num_rows_ += b.num_rows;
+  }
+  num_rows_ += open_.num_rows();
+  DiscardExcessRows();
+}
+
+void ColdScrollback::AppendRow(const Cell* cells,
+                               ColumnNumber num_cells,
+                               bool wrapped) {
+  if (!capacity_)
+    return;
+
+  assert(num_cells == columns_);
+  open_.AppendRow(cells, num_cells, wrapped);
+  num_rows_++;
+  if (open_.IsFull())
+    SealOpenBlock();
+  DiscardExcessRows();
+}
+
+void ColdScrollback::Clear() {
+  while (num_blocks())
+    DiscardFirstBlock();
+  open_first_row_ += open_.num_rows();
+  open_.Clear();
+  num_discarded_rows_ = 0u;
+  num_rows_ = 0u;
+}
+
+void ColdScrollback::RemoveUnfinishedLine(std::vector<Cell>* line) {
+  // The line's rows are the wrapped rows at the end of the open block.
+  const size_t begin = num_blocks() ? 0u : num_discarded_rows_;
+  const size_t end = open_.num_rows();
+  size_t first = end;
+  while (first > begin &&
+         IsRowWrapped(open_.data.data() + open_.row_offsets[first - 1u]))
+    first--;
+  if (first == end)
+    return;
+
+  for (size_t i = first; i < end; i++)
+    AppendEncodedRowToLine(open_.data.data() + open_.row_offsets[i], line);
+  // (Their grapheme clusters are left in |open_.clusters|.)
+  open_.data.resize(open_.row_offsets[first]);
+  open_.row_offsets.resize(first);
+  num_rows_ -= end - first;
+}
+
+void ColdScrollback::GetRow(size_t index, Cell* cells, ColumnNumber num_cells) {
+  DecodeRow(FindRow(index), cells, num_cells);
+}
+
+ColumnNumber ColdScrollback::GetRowLength(size_t index, bool* wrapped) {
+  const uint8_t* input = FindRow(index);
+  uint32_t header = ReadVarint(&input);
+  *wrapped = header & 1u;
+  return header >> 1u;
+}
+
+void ColdScrollback::MarkClusters(ClusterTable* cluster_table) const {
+  Codepoint clusters[64];
+  for (size_t i = 0u; i < num_blocks(); i++) {
+    const Block& b = block(i);
+    for (uint32_t j = 0u; j < b.num_clusters;) {
+      uint32_t n = std::min(b.num_clusters - j, 64u);
+      ReadChunks(b.first_chunk, b.data_size + j * sizeof(Codepoint),
+                 n * sizeof(Codepoint), clusters);
+      for (uint32_t k = 0u; k < n; k++)
+        cluster_table->Mark(clusters[k]);
+      j += n;
+    }
+  }
+  for (Codepoint cluster : open_.clusters)
+    cluster_table->Mark(cluster);
+}
+
+size_t ColdScrollback::GetMemoryUsage() const {
+  size_t rv = sizeof(*this) + chunk_pool_.GetMemoryUsage() +
+              blocks_.capacity() * sizeof(Block) + compressed_.capacity() +
+              cache_.capacity() +
+              cache_row_offsets_.capacity() * sizeof(uint32_t) +
+              gathered_.capacity() +
+              reflowed_blocks_.capacity() * sizeof(Block) +
+              (reflow_row_.capacity() + reflow_line_.capacity()) * sizeof(Cell);
+  for (const BlockBuilder* builder : {&open_, &reflow_builder_}) {
+    rv += builder->row_offsets.capacity() * sizeof(uint32_t) +
+          builder->data.capacity() +
+          builder->clusters.capacity() * sizeof(Codepoint);
+  }
+  return rv;
+}
+
+void ColdScrollback::SealOpenBlock() {
+  assert(open_.IsFull());
+  Block b;
+  EncodeBlock(&open_, &b);
+  AppendBlock(b);
+}
+
+void ColdScrollback::AppendBlock(const Block& b) {
+  if (blocks_size_ == blocks_.size()) {
+    std::vector<Block> blocks(std::max(blocks_.size() * 2u, size_t{4u}));
+    for (size_t i = 0u; i < blocks_size_; i++)
+      blocks[i] = block(i);
+    blocks_.swap(blocks);
+    blocks_begin_ = 0u;
+  }
+  blocks_size_++;
+  Block& new_block = block(blocks_size_ - 1u);
+  new_block = b;
+  new_block.first_row = open_first_row_;
+  open_first_row_ += b.num_rows;
+}
+
+void ColdScrollback::EncodeBlock(BlockBuilder* builder, Block* b) {
+  const std::vector<uint8_t>* data = &builder->data;
+  b->compressed = false;
+  if (compress_) {
+    compressed_.clear();
+    LzCompress(builder->data.data(), builder->data.size(), &compressed_);
+    if (compressed_.size() < builder->data.size()) {
+      data = &compressed_;
+      b->compressed = true;
+    }
+  }
+  std::vector<Codepoint>& clusters = builder->clusters;
+  std::sort(clusters.begin(), clusters.end());
+  clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+
+  ChunkWriter writer;
+  WriteChunks(data->data(), data->size(), &writer);
+  WriteChunks(clusters.data(), clusters.size() * sizeof(Codepoint), &writer);
+  b->first_chunk = writer.first_chunk;
+  b->data_size = static_cast<uint32_t>(data->size());
+  b->uncompressed_size = static_cast<uint32_t>(builder->data.size());
+  b->num_clusters = static_cast<uint32_t>(clusters.size());
+  b->columns = columns_;
+  b->num_rows = static_cast<uint32_t>(builder->num_rows());
+  b->first_row = 0u;
+
+  builder->Clear();
+}
+
+void ColdScrollback::ReplaceBlock(size_t index,
+                                  const std::vector<Block>& blocks) {
+  const uint64_t first_row = block(index).first_row;
+  FreeChunks(block(index).first_chunk);
+
+  const size_t size = blocks_size_ - 1u + blocks.size();
+  size_t ring_size = std::max(blocks_.size(), size_t{4u});
+  while (ring_size < size)
+    ring_size *= 2u;
+  std::vector<Block> ring(ring_size);
+  size_t n = 0u;
+  for (size_t i = 0u; i < index; i++)
+    ring[n++] = block(i);
+  for (const Block& b : blocks)
+    ring[n++] = b;
+  for (size_t i = index + 1u; i < blocks_size_; i++)
+    ring[n++] = block(i);
+  blocks_.swap(ring);
+  blocks_begin_ = 0u;
+  blocks_size_ = size;
+
+  uint64_t row = first_row;
+  for (size_t i = index; i < blocks_size_; i++) {
+    block(i).first_row = row;
+    row += block(i).num_rows;
+  }
+  open_first_row_ = row;
+  // (The blocks' absolute indices have changed.)
+  cached_block_ = UINT64_MAX;
+}
+
+void ColdScrollback::ReflowBlock(size_t index) {
+  const uint32_t* row_offsets;
+  const uint8_t* data = GetBlockData(index, &row_offsets);
+  const size_t begin = index ? 0u : num_discarded_rows_;
+  const size_t end = block(index).num_rows;
+
+  // (|reflow_builder_| is empty.)
+  reflowed_blocks_.clear();
+  ReflowRows(data, row_offsets, begin, end, &reflow_builder_,
+             &reflowed_blocks_);
+  if (reflow_builder_.num_rows()) {
+    reflowed_blocks_.emplace_back();
+    EncodeBlock(&reflow_builder_, &reflowed_blocks_.back());
+  }
+
+  // The discarded rows aren't in the reflowed blocks.
+  if (!index) {
+    block(0u).first_row += begin;
+    num_discarded_rows_ = 0u;
+  }
+  num_rows_ -= end - begin;
+  for (const Block& b : reflowed_blocks_)
+    num_rows_ += b.num_rows;
+  ReplaceBlock(index, reflowed_blocks_);
+  DiscardExcessRows();
+}
+
+void ColdScrollback::ReflowRows(const uint8_t* data,
+                                const uint32_t* row_offsets,
+                                size_t begin,
+                                size_t end,
+                                BlockBuilder* builder,
+                                std::vector<Block>* blocks) {
+  std::vector<Cell>& line = reflow_line_;
+  std::vector<Cell>& row = reflow_row_;
+  row.resize(columns_);
+  line.clear();
+  for (size_t i = begin; i < end; i++) {
+    const uint8_t* input = data + row_offsets[i];
+    AppendEncodedRowToLine(input, &line);
+    // (If the last row is wrapped, its line continues in the next block, which
+    // is reflowed separately.)
+    const bool wrapped = IsRowWrapped(input);
+    if (wrapped && i + 1u < end)
+      continue;
+
+    size_t offset = 0u;
+    bool more;
+    do {
+      more = LayOutRow(line, &offset, columns_, row.data());
+      builder->AppendRow(row.data(), columns_, more || wrapped);
+      if (builder->IsFull()) {
+        blocks->emplace_back();
+        EncodeBlock(builder, &blocks->back());
+      }
+    } while (more);
+    line.clear();
+  }
+}
+
+void ColdScrollback::DiscardExcessRows() {
+  while (num_rows_ > capacity_) {
+    num_rows_--;
+    num_discarded_rows_++;
+    // (If there are no sealed blocks, the rows are discarded from the open
+    // block, which still has more rows.)
+    if (num_blocks() && num_discarded_rows_ == block(0u).num_rows) {
+      DiscardFirstBlock();
+      num_discarded_rows_ = 0u;
+    }
+  }
+}
+
+void ColdScrollback::DiscardFirstBlock() {
+  assert(num_blocks());
+  FreeChunks(block(0u).first_chunk);
+  blocks_begin_ = (blocks_begin_ + 1u) & (blocks_.size() - 1u);
+  blocks_size_--;
+  num_discarded_blocks_++;
+}
+
+void ColdScrollback::FreeChunks(uint8_t* chunk) {
+  while (chunk) {
+    uint8_t* next = GetNextChunk(chunk);
+    chunk_pool_.Free(chunk);
+    chunk = next;
+  }
+}
+
+const uint8_t* ColdScrollback::FindRow(size_t index) {
+  assert(index < num_rows_);
+  // Reflowing a block changes the positions of the newer rows, but not how far
+  // they are from the newest row.
+  const size_t num_newer_rows = num_rows_ - index;
+  for (;;) {
+    const uint64_t row = end_row() - std::min(num_newer_rows, num_rows_);
+    size_t block_index = num_blocks();
+    uint64_t first_row = open_first_row_;
+    if (row < open_first_row_) {
+      // Find the last block that starts at or before |row|.
+      size_t low = 0u;
+      size_t high = num_blocks() - 1u;
+      while (low < high) {
+        size_t middle = low + (high - low + 1u) / 2u;
+        if (block(middle).first_row <= row)
+          low = middle;
+        else
+          high = middle - 1u;
+      }
+      if (block(low).columns != columns_) {
+        ReflowBlock(low);
+        continue;
+      }
+      block_index = low;
+      first_row = block(low).first_row;
+    }
+    const uint32_t* row_offsets;
+    const uint8_t* data = GetBlockData(block_index, &row_offsets);
+    return data + row_offsets[row - first_row];
+  }
+}
+
+void ColdScrollback::WriteChunks(const void* data,
+                                 size_t size,
+                                 ChunkWriter* writer) {
+  const uint8_t* input = static_cast<const uint8_t*>(data);
+  while (size) {
+    if (!writer->chunk || writer->offset == chunk_data_size_) {
+      uint8_t* chunk = static_cast<uint8_t*>(chunk_pool_.Allocate());
+      SetNextChunk(chunk, nullptr);
+      if (writer->chunk)
+        SetNextChunk(writer->chunk, chunk);
+      else
+        writer->first_chunk = chunk;
+      writer->chunk = chunk;
+      writer->offset = 0u;
+    }
+    size_t n = std::min(size, chunk_data_size_ - writer->offset);
+    memcpy(writer->chunk + sizeof(uint8_t*) + writer->offset, input, n);
+    writer->offset += n;
+    input += n;
+    size -= n;
+  }
+}
+
+void ColdScrollback::ReadChunks(const uint8_t* chunk,
+                                size_t offset,
+                                size_t size,
+                                void* output) const {
+  uint8_t* out = static_cast<uint8_t*>(output);
+  while (offset >= chunk_data_size_) {
+    chunk = GetNextChunk(chunk);
+    offset -= chunk_data_size_;
+  }
+  while (size) {
+    size_t n = std::min(size, chunk_data_size_ - offset);
+    memcpy(out, chunk + sizeof(uint8_t*) + offset, n);
+    out += n;
+    size -= n;
+    if (size)
+      chunk = GetNextChunk(chunk);
+    offset = 0u;
+  }
+}
+
+const uint8_t* ColdScrollback::GetBlockData(
+    size_t block_index,
+    const uint32_t** row_offsets) const {
+  if (block_index == num_blocks()) {
+    *row_offsets = open_.row_offsets.data();
+    return open_.data.data();
+  }
+
+  uint64_t absolute_block_index = num_discarded_blocks_ + block_index;
+  if (cached_block_ != absolute_block_index) {
+    const Block& b = block(block_index);
+    cache_.resize(b.uncompressed_size);
+    if (b.compressed) {
+      gathered_.resize(b.data_size);
+      ReadChunks(b.first_chunk, 0u, b.data_size, gathered_.data());
+      bool ok = LzDecompress(gathered_.data(), gathered_.size(), cache_.data(),
+                             cache_.size());
+      assert(ok);
+      (void)ok;
+    } else {
+      ReadChunks(b.first_chunk, 0u, b.data_size, cache_.data());
+    }
+    cache_row_offsets_.resize(b.num_rows);
+    const uint8_t* row = cache_.data();
+    for (uint32_t i = 0u; i < b.num_rows; i++) {
+      cache_row_offsets_[i] = static_cast<uint32_t>(row - cache_.data());
+      row = SkipRow(row);
+    }
+    assert(row == cache_.data() + cache_.size());
+    cached_block_ = absolute_block_index;
+  }
+  *row_offsets = cache_row_offsets_.data();
+  return cache_.data();
+}
+
+}  // namespace vtlib
@@ -0,0 +1,254 @@
+#ifndef VTLIB_SRC_COLD_SCROLLBACK_H_
+#define VTLIB_SRC_COLD_SCROLLBACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <vtlib/cell.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/coordinates.h>
+
+#include "src/block_pool.h"
+#include "src/cluster_table.h"
+
+namespace vtlib {
+
+// The "cold" tier of the scrollback: old rows (i.e., those evicted from the
+// |ScreenBuffer|'s ring), stored compactly. Each row is encoded as its length
+// (not counting trailing empty cells, unless it's wrapped) and whether it's
+// wrapped, its attributes and colors as runs, and its text as UTF-8. (So rows
+// needn't all have the same width.) Rows are appended to blocks of (at least)
+// |kRowsPerBlock| rows: a block is only sealed at the end of a line, unless it
+// has |kMaxRowsPerBlock| rows. Once a block is sealed, it's (optionally)
+// further compressed with |LzCompress()|.
+// Reading a row decodes it (decompressing its block, if necessary; the most
+// recently decompressed block is cached).
+//
+// Rows are laid out at a width of |columns()|, which each block records. When
+// it changes (e.g., the terminal is resized), the open block is reflowed, but
+// each sealed block is only reflowed (as a whole, to a block or more of rows of
+// the new width) when one of its rows is next read. So the cost of a resize is
+// proportional to the number of rows that are read afterwards, rather than to
+// the size of the scrollback. (A line longer than |kMaxRowsPerBlock| rows may
+// span blocks; its rows in each block are then reflowed separately.)
+//
+// Sealed blocks are stored in chains of fixed-size chunks from a |BlockPool|,
+// and the chunks of discarded blocks are recycled, so that once the scrollback
+// is full, appending rows doesn't allocate from the heap.
+//
+// Rows are identified by index, with 0 being the oldest row. Once there are
+// |capacity()| rows, appending a row (or reflowing rows to a narrower width)
+// discards the oldest rows. Reflowing a block changes the number of rows in it,
+// and so |num_rows()| and the indices of the newer rows.
+class ColdScrollback {
+ public:
+  static constexpr size_t kRowsPerBlock = 64u;
+  static constexpr size_t kMaxRowsPerBlock = 16u * kRowsPerBlock;
+
+  // Sealed blocks are stored in chunks of (about) |chunk_size| bytes, e.g., the
+  // size of a row of cells.
+  ColdScrollback(size_t capacity,
+                 ColumnNumber columns,
+                 bool compress,
+                 size_t chunk_size);
+  ~ColdScrollback();
+
+  ColdScrollback(const ColdScrollback&) = delete;
+  ColdScrollback& operator=(const ColdScrollback&) = delete;
+
+  size_t capacity() const { return capacity_; }
+  size_t num_rows() const { return num_rows_; }
+  ColumnNumber columns() const { return columns_; }
+
+  // Changes the width that rows are laid out at to |columns| (which must be
+  // nonzero). Only the open block is reflowed now (see above).
+  void set_columns(ColumnNumber columns);
+
+  // Appends a row of |num_cells| cells (which must be |columns()|) as the
+  // newest row. |wrapped| is set if the row was soft-wrapped (i.e., its line
+  // continues on the next row). Does nothing if |capacity()| is 0.
+  void AppendRow(const Cell* cells, ColumnNumber num_cells, bool wrapped);
+
+  // Discards all the rows.
+  void Clear();
+
+  // If the newest row is wrapped (i.e., its line continues in rows that
+  // haven't been appended, e.g., in the hot scrollback), removes the rows of
+  // that line from the open block, and appends their cells to |*line| (see
+  // |AppendRowToLine()|). This lets the caller reflow the line as a whole.
+  void RemoveUnfinishedLine(std::vector<Cell>* line);
+
+  // Decodes row |index| (which must be less than |num_rows()|) to |cells|,
+  // which has room for |num_cells| cells. If the row was shorter, the remaining
+  // cells are set to |Cell()|; if it was longer, it's truncated.
+  //
+  // If the row's block was laid out at a different width than |columns()|, it's
+  // reflowed first. The row is then the one that's as far from the newest row
+  // as row |index| was (blocks that are newer than it don't change), or the
+  // oldest row if there are no longer that many rows.
+  void GetRow(size_t index, Cell* cells, ColumnNumber num_cells);
+  // Returns the number of cells stored for row |index| (which must be less
+  // than |num_rows()|), i.e., the cells that |GetRow()| doesn't set to
+  // |Cell()|, and sets |*wrapped| to whether the row was wrapped. (This may
+  // reflow the row's block, like |GetRow()|.)
+  ColumnNumber GetRowLength(size_t index, bool* wrapped);
+
+  // Marks (in |cluster_table|, during its garbage collection) the grapheme
+  // clusters used by the rows. (Discarded rows' clusters are only released
+  // once their whole block is discarded.)
+  void MarkClusters(ClusterTable* cluster_table) const;
+
+  // Returns the (approximate) number of bytes of memory used.
+  size_t GetMemoryUsage() const;
+
+  const BlockPool::Stats& chunk_pool_stats() const {
+    return chunk_pool_.stats();
+  }
+
+ private:
+  // A sealed block. Its (possibly compressed) encoded rows, followed by the
+  // grapheme clusters used by the rows (sorted and deduplicated), are stored in
+  // a chain of chunks: each chunk starts with a pointer to the next one. (The
+  // offsets of the rows aren't stored; they're recomputed when it's read.)
+  struct Block {
+    uint8_t* first_chunk;
+    // The size of the stored (i.e., possibly compressed) encoded rows.
+    uint32_t data_size;
+    uint32_t uncompressed_size;
+    uint32_t num_clusters;
+    bool compressed;
+    // The width that the rows were laid out at.
+    ColumnNumber columns;
+    uint32_t num_rows;
+    // The position of the first row, counting from the first row ever appended
+    // (including discarded rows, and rows before reflowing).
+    uint64_t first_row;
+  };
+
+  // The encoded rows of a block that hasn't been sealed yet.
+  struct BlockBuilder {
+    size_t num_rows() const { return row_offsets.size(); }
+    // Returns true if the block should be sealed, i.e., it has enough rows, and
+    // doesn't end in the middle of a line (unless it's too long).
+    bool IsFull() const;
+    void AppendRow(const Cell* cells, ColumnNumber num_cells, bool wrapped);
+    void Clear();
+
+    std::vector<uint32_t> row_offsets;
+    std::vector<uint8_t> data;
+    // The grapheme clusters used by the rows (possibly also by rows that have
+    // been removed).
+    std::vector<Codepoint> clusters;
+  };
+
+  // Appends to a chain of chunks.
+  struct ChunkWriter {
+    uint8_t* first_chunk = nullptr;
+    uint8_t* chunk = nullptr;
+    size_t offset = 0u;
+  };
+
+  size_t num_blocks() const { return blocks_size_; }
+  Block& block(size_t index) {
+    return blocks_[(blocks_begin_ + index) & (blocks_.size() - 1u)];
+  }
+  const Block& block(size_t index) const {
+    return blocks_[(blocks_begin_ + index) & (blocks_.size() - 1u)];
+  }
+
+  // Returns the position (see |Block::first_row|) of the newest row, plus 1.
+  uint64_t end_row() const { return open_first_row_ + open_.num_rows(); }
+
+  // Moves the open block (which must be full) to |blocks_|.
+  void SealOpenBlock();
+  // Appends |b| to |blocks_| (as the newest sealed block), setting its
+  // |first_row|.
+  void AppendBlock(const Block& b);
+  // Encodes the rows of |*builder| (compressing them, if enabled) into |*b|,
+  // and clears |*builder|. (Doesn't set |b->first_row|.)
+  void EncodeBlock(BlockBuilder* builder, Block* b);
+  // Replaces |block(index)| with |blocks| (which may be empty), and updates the
+  // |first_row| of it and the newer blocks.
+  void ReplaceBlock(size_t index, const std::vector<Block>& blocks);
+  // Reflows |block(index)| to |columns()|.
+  void ReflowBlock(size_t index);
+  // Lays out the lines of rows |begin| to |end - 1| of |data| (encoded rows,
+  // starting at |row_offsets|) in rows of |columns()|, appending them to
+  // |*builder|. Each time it's full, it's encoded to a block, which is
+  // appended to |*blocks|.
+  void ReflowRows(const uint8_t* data,
+                  const uint32_t* row_offsets,
+                  size_t begin,
+                  size_t end,
+                  BlockBuilder* builder,
+                  std::vector<Block>* blocks);
+  // Discards the oldest rows until there are at most |capacity()|.
+  void DiscardExcessRows();
+  // Discards |block(0)|.
+  void DiscardFirstBlock();
+  // Returns the chain of chunks starting with |chunk| to |chunk_pool_|.
+  void FreeChunks(uint8_t* chunk);
+  // Returns the encoded row |index| (reflowing its block first, if necessary;
+  // see |GetRow()|).
+  const uint8_t* FindRow(size_t index);
+  void WriteChunks(const void* data, size_t size, ChunkWriter* writer);
+  // Copies |size| bytes, starting at |offset|, from the chain of chunks
+  // starting with |chunk| to |output|.
+  void ReadChunks(const uint8_t* chunk,
+                  size_t offset,
+                  size_t size,
+                  void* output) const;
+  // Returns the (uncompressed) encoded data for block |block_index| (which is
+  // |num_blocks()| for the open block), storing the offsets of its rows in
+  // |*row_offsets|.
+  const uint8_t* GetBlockData(size_t block_index,
+                              const uint32_t** row_offsets) const;
+
+  const size_t capacity_;
+  ColumnNumber columns_;
+  const bool compress_;
+  // The number of bytes of data in each chunk (after the next pointer).
+  const size_t chunk_data_size_;
+  BlockPool chunk_pool_;
+
+  // The sealed blocks, as a ring buffer (its size is a power of 2, or 0) of
+  // |blocks_size_| blocks starting at |blocks_[blocks_begin_]|.
+  std::vector<Block> blocks_;
+  size_t blocks_begin_ = 0u;
+  size_t blocks_size_ = 0u;
+
+  // The (last) block being appended to. Its rows are always laid out at
+  // |columns_|.
+  BlockBuilder open_;
+  uint64_t open_first_row_ = 0u;
+  // Used by |EncodeBlock()|. This is here so we don't have to re-create it
+  // each time.
+  std::vector<uint8_t> compressed_;
+  // Used when reflowing.
+  BlockBuilder reflow_builder_;
+  std::vector<Block> reflowed_blocks_;
+  std::vector<Cell> reflow_row_;
+  std::vector<Cell> reflow_line_;
+
+  // The number of rows that have been discarded from |block(0)| (or from the
+  // open block, if there are no sealed blocks).
+  size_t num_discarded_rows_ = 0u;
+  size_t num_rows_ = 0u;
+  // The number of blocks that have been discarded (the "absolute" index of
+  // |block(0)|, until a block is reflowed).
+  uint64_t num_discarded_blocks_ = 0u;
+
+  // The most recently read sealed block, identified by absolute index
+  // (|UINT64_MAX| if none).
+  mutable uint64_t cached_block_ = UINT64_MAX;
+  mutable std::vector<uint8_t> cache_;
+  mutable std::vector<uint32_t> cache_row_offsets_;
+  // Compressed data is first gathered from its chunks into this.
+  mutable std::vector<uint8_t> gathered_;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_COLD_SCROLLBACK_H_
@@ -0,0 +1,335 @@
+#include "src/cold_scrollback.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/character.h>
+#include <vtlib/color.h>
+
+namespace vtlib {
+namespace {
+
+constexpr ColumnNumber kColumns = 20u;
+constexpr size_t kChunkSize = kColumns * sizeof(Cell);
+
+// Makes a row with some text, styles, and a varying number of trailing empty
+// cells (depending on |n|).
+std::vector<Cell> MakeRow(uint32_t n) {
+  std::vector<Cell> row(kColumns);
+  ColumnNumber length = n % (kColumns + 1u);
+  for (ColumnNumber i = 0u; i < length; i++) {
+    // Mix in some non-ASCII codepoints (up to 21 bits).
+    uint32_t codepoint = (i % 7u == 3u) ? 0x4e00u + n % 1000u
+                         : (i % 11u == 5u) ? 0x1f600u + i
+                                           : 'a' + (n + i) % 26u;
+    Character::Attribute attribute = (i / 4u) % 2u
+                                         ? Character::Attribute::BOLD
+                                         : Character::Attribute::NONE;
+    Color fg = i < 10u ? Color() : Color(Color::Type::ANSI_16, n % 16u);
+    Color bg = i % 9u == 0u ? Color(Color::Type::RGB, 0x102030u * (n % 5u))
+                            : Color();
+    row[i] = Cell(Character(attribute, codepoint), fg, bg);
+  }
+  return row;
+}
+
+void CheckRow(ColdScrollback* cold_scrollback,
+              size_t index,
+              uint32_t n) {
+  std::vector<Cell> expected = MakeRow(n);
+  std::vector<Cell> actual(kColumns, Cell(Character(Character::Attribute::NONE,
+                                                    'x'),
+                                          Color(), Color()));
+  cold_scrollback->GetRow(index, actual.data(), kColumns);
+  EXPECT_EQ(expected, actual) << "index " << index << ", n " << n;
+}
+
+TEST(ColdScrollbackTest, Basic) {
+  for (bool compress : {false, true}) {
+    ColdScrollback cold_scrollback(1000u, kColumns, compress, kChunkSize);
+    EXPECT_EQ(1000u, cold_scrollback.capacity());
+    EXPECT_EQ(0u, cold_scrollback.num_rows());
+
+    for (uint32_t n = 0u; n < 500u; n++) {
+      cold_scrollback.AppendRow(MakeRow(n).data(), kColumns, false);
+      EXPECT_EQ(n + 1u, cold_scrollback.num_rows());
+    }
+    for (uint32_t n = 0u; n < 500u; n++)
+      CheckRow(&cold_scrollback, n, n);
+    // In reverse, too (to exercise the cache).
+    for (uint32_t n = 500u; n-- > 0u;)
+      CheckRow(&cold_scrollback, n, n);
+  }
+}
+
+TEST(ColdScrollbackTest, Capacity) {
+  for (bool compress : {false, true}) {
+    ColdScrollback cold_scrollback(100u, kColumns, compress, kChunkSize);
+    for (uint32_t n = 0u; n < 1000u; n++) {
+      cold_scrollback.AppendRow(MakeRow(n).data(), kColumns, false);
+      EXPECT_EQ(std::min(n + 1u, 100u), cold_scrollback.num_rows());
+      if (n % 37u == 0u) {
+        size_t first = n + 1u - cold_scrollback.num_rows();
+        for (size_t i = 0u; i < cold_scrollback.num_rows(); i++)
+          CheckRow(&cold_scrollback, i, static_cast<uint32_t>(first + i));
+      }
+    }
+  }
+
+  ColdScrollback cold_scrollback(0u, kColumns, true, kChunkSize);
+  cold_scrollback.AppendRow(MakeRow(1u).data(), kColumns, false);
+  EXPECT_EQ(0u, cold_scrollback.num_rows());
+}
+
+TEST(ColdScrollbackTest, RecyclesChunks) {
+  for (bool compress : {false, true}) {
+    ColdScrollback cold_scrollback(1000u, kColumns, compress, kChunkSize);
+    // The rows repeat with a period that's a multiple of the block size, so
+    // the blocks repeat, too.
+    const uint32_t kPeriod = 16u * ColdScrollback::kRowsPerBlock;
+    uint32_t n = 0u;
+    // Fill it (and then some).
+    for (; n < 3u * kPeriod; n++)
+      cold_scrollback.AppendRow(MakeRow(n % kPeriod).data(), kColumns, false);
+    uint64_t num_slab_allocations =
+        cold_scrollback.chunk_pool_stats().num_slab_allocations;
+    EXPECT_GT(cold_scrollback.chunk_pool_stats().num_blocks_in_use, 0u);
+
+    // Discarded blocks' chunks are reused.
+    for (; n < 10000u; n++)
+      cold_scrollback.AppendRow(MakeRow(n % kPeriod).data(), kColumns, false);
+    EXPECT_EQ(num_slab_allocations,
+              cold_scrollback.chunk_pool_stats().num_slab_allocations);
+    for (size_t i = 0u; i < cold_scrollback.num_rows(); i++) {
+      CheckRow(&cold_scrollback, i,
+               static_cast<uint32_t>((n - 1000u + i) % kPeriod));
+    }
+  }
+}
+
+TEST(ColdScrollbackTest, Clear) {
+  ColdScrollback cold_scrollback(100u, kColumns, true, kChunkSize);
+  for (uint32_t n = 0u; n < 150u; n++)
+    cold_scrollback.AppendRow(MakeRow(n).data(), kColumns, false);
+  CheckRow(&cold_scrollback, 0u, 50u);
+  cold_scrollback.Clear();
+  EXPECT_EQ(0u, cold_scrollback.num_rows());
+  EXPECT_EQ(0u, cold_scrollback.chunk_pool_stats().num_blocks_in_use);
+
+  for (uint32_t n = 0u; n < 150u; n++)
+    cold_scrollback.AppendRow(MakeRow(n).data(), kColumns, false);
+  EXPECT_EQ(100u, cold_scrollback.num_rows());
+  for (size_t i = 0u; i < 100u; i++)
+    CheckRow(&cold_scrollback, i, static_cast<uint32_t>(50u + i));
+}
+
+TEST(ColdScrollbackTest, DifferentWidths) {
+  ColdScrollback cold_scrollback(10u, kColumns, true, kChunkSize);
+  cold_scrollback.AppendRow(MakeRow(kColumns).data(), kColumns, false);
+
+  // Narrower: truncated.
+  std::vector<Cell> row(5u);
+  cold_scrollback.GetRow(0u, row.data(), 5u);
+  std::vector<Cell> expected = MakeRow(kColumns);
+  EXPECT_EQ(std::vector<Cell>(expected.begin(), expected.begin() + 5), row);
+
+  // Wider: padded.
+  row.resize(kColumns + 5u);
+  cold_scrollback.GetRow(0u, row.data(), kColumns + 5u);
+  expected.resize(kColumns + 5u);
+  EXPECT_EQ(expected, row);
+}
+
+TEST(ColdScrollbackTest, WrappedRows) {
+  ColdScrollback cold_scrollback(10u, kColumns, false, kChunkSize);
+  std::vector<Cell> row = MakeRow(3u);
+  cold_scrollback.AppendRow(row.data(), kColumns, false);
+  cold_scrollback.AppendRow(row.data(), kColumns, true);
+
+  // The trailing empty cells of a wrapped row are kept (since they're part of
+  // its line).
+  bool wrapped = true;
+  EXPECT_EQ(3u, cold_scrollback.GetRowLength(0u, &wrapped));
+  EXPECT_FALSE(wrapped);
+  EXPECT_EQ(kColumns, cold_scrollback.GetRowLength(1u, &wrapped));
+  EXPECT_TRUE(wrapped);
+  CheckRow(&cold_scrollback, 0u, 3u);
+  CheckRow(&cold_scrollback, 1u, 3u);
+}
+
+// Appends line |n|: |length| copies of a letter, wrapped at |columns()|.
+void AppendLine(ColdScrollback* cold_scrollback,
+                uint32_t n,
+                ColumnNumber length) {
+  const ColumnNumber columns = cold_scrollback->columns();
+  const Cell cell(Character(Character::Attribute::NONE, 'a' + n % 26u),
+                  Color(), Color());
+  for (ColumnNumber i = 0u; i < length; i += columns) {
+    std::vector<Cell> row(columns);
+    std::fill(row.begin(), row.begin() + std::min(columns, length - i), cell);
+    cold_scrollback->AppendRow(row.data(), columns, i + columns < length);
+  }
+}
+
+// Checks that row |index| holds the cells of line |n| (see |AppendLine()|)
+// from |begin| to |end - 1|, and whether it's wrapped.
+void CheckLineRow(ColdScrollback* cold_scrollback,
+                  size_t index,
+                  uint32_t n,
+                  ColumnNumber begin,
+                  ColumnNumber end,
+                  bool wrapped) {
+  const ColumnNumber columns = cold_scrollback->columns();
+  std::vector<Cell> expected(columns);
+  std::fill(expected.begin(), expected.begin() + (end - begin),
+            Cell(Character(Character::Attribute::NONE, 'a' + n % 26u), Color(),
+                 Color()));
+  std::vector<Cell> actual(columns);
+  // (If this reflows the row's block, the row's index may change.)
+  const size_t num_newer_rows = cold_scrollback->num_rows() - index;
+  cold_scrollback->GetRow(index, actual.data(), columns);
+  EXPECT_EQ(expected, actual) << "index " << index << ", n " << n;
+  index = cold_scrollback->num_rows() -
+          std::min(num_newer_rows, cold_scrollback->num_rows());
+  bool actual_wrapped = !wrapped;
+  EXPECT_EQ(wrapped ? columns : end - begin,
+            cold_scrollback->GetRowLength(index, &actual_wrapped));
+  EXPECT_EQ(wrapped, actual_wrapped);
+}
+
+TEST(ColdScrollbackTest, Reflow) {
+  for (bool compress : {false, true}) {
+    ColdScrollback cold_scrollback(1000u, kColumns, compress, kChunkSize);
+    // 100 lines, each on 2 rows. The first 96 are in 3 sealed blocks.
+    for (uint32_t n = 0u; n < 100u; n++)
+      AppendLine(&cold_scrollback, n, kColumns + 5u);
+    EXPECT_EQ(200u, cold_scrollback.num_rows());
+
+    // Only the open block is reflowed now.
+    cold_scrollback.set_columns(2u * kColumns);
+    EXPECT_EQ(2u * kColumns, cold_scrollback.columns());
+    EXPECT_EQ(192u + 4u, cold_scrollback.num_rows());
+    CheckLineRow(&cold_scrollback, 195u, 99u, 0u, kColumns + 5u, false);
+    EXPECT_EQ(196u, cold_scrollback.num_rows());
+
+    // Reading a row reflows (just) its block.
+    CheckLineRow(&cold_scrollback, 0u, 0u, 0u, kColumns + 5u, false);
+    EXPECT_EQ(32u + 128u + 4u, cold_scrollback.num_rows());
+    // Going from the newest row to the oldest, each row keeps its distance
+    // from the newest row.
+    for (size_t i = 1u; i <= cold_scrollback.num_rows(); i++) {
+      CheckLineRow(&cold_scrollback, cold_scrollback.num_rows() - i,
+                   static_cast<uint32_t>(100u - i), 0u, kColumns + 5u, false);
+    }
+    EXPECT_EQ(100u, cold_scrollback.num_rows());
+
+    // And back (so each block is reflowed again).
+    cold_scrollback.set_columns(kColumns);
+    for (size_t i = 1u; i <= cold_scrollback.num_rows(); i++) {
+      size_t index = cold_scrollback.num_rows() - i;
+      uint32_t n = static_cast<uint32_t>(100u - (i + 1u) / 2u);
+      if (i % 2u) {
+        CheckLineRow(&cold_scrollback, index, n, kColumns, kColumns + 5u,
+                     false);
+      } else {
+        CheckLineRow(&cold_scrollback, index, n, 0u, kColumns, true);
+      }
+    }
+    EXPECT_EQ(200u, cold_scrollback.num_rows());
+  }
+}
+
+TEST(ColdScrollbackTest, ReflowCapacity) {
+  ColdScrollback cold_scrollback(100u, kColumns, true, kChunkSize);
+  for (uint32_t n = 0u; n < 100u; n++)
+    AppendLine(&cold_scrollback, n, kColumns);
+
+  // Reflowing to a narrower width discards the oldest rows, to keep the
+  // newest 100.
+  cold_scrollback.set_columns(kColumns / 2u);
+  EXPECT_EQ(100u, cold_scrollback.num_rows());
+  for (size_t i = 1u; i <= cold_scrollback.num_rows(); i++) {
+    size_t index = cold_scrollback.num_rows() - i;
+    uint32_t n = static_cast<uint32_t>(100u - (i + 1u) / 2u);
+    if (i % 2u)
+      CheckLineRow(&cold_scrollback, index, n, kColumns / 2u, kColumns, false);
+    else
+      CheckLineRow(&cold_scrollback, index, n, 0u, kColumns / 2u, true);
+  }
+  EXPECT_EQ(100u, cold_scrollback.num_rows());
+}
+
+TEST(ColdScrollbackTest, LongLines) {
+  ColdScrollback cold_scrollback(10000u, kColumns, false, kChunkSize);
+  // A line that's too long for a block is split between blocks.
+  const ColumnNumber kLength =
+      (ColdScrollback::kMaxRowsPerBlock + 10u) * kColumns;
+  AppendLine(&cold_scrollback, 0u, kLength);
+  AppendLine(&cold_scrollback, 1u, 5u);
+  EXPECT_EQ(ColdScrollback::kMaxRowsPerBlock + 11u, cold_scrollback.num_rows());
+
+  // Its rows in each block are reflowed separately.
+  cold_scrollback.set_columns(2u * kColumns);
+  CheckLineRow(&cold_scrollback, 0u, 0u, 0u, 2u * kColumns, true);
+  EXPECT_EQ(ColdScrollback::kMaxRowsPerBlock / 2u + 5u + 1u,
+            cold_scrollback.num_rows());
+  CheckLineRow(&cold_scrollback, ColdScrollback::kMaxRowsPerBlock / 2u - 1u,
+               0u, 0u, 2u * kColumns, true);
+  CheckLineRow(&cold_scrollback, ColdScrollback::kMaxRowsPerBlock / 2u, 0u, 0u,
+               2u * kColumns, true);
+  CheckLineRow(&cold_scrollback, cold_scrollback.num_rows() - 1u, 1u, 0u, 5u,
+               false);
+}
+
+TEST(ColdScrollbackTest, RemoveUnfinishedLine) {
+  ColdScrollback cold_scrollback(100u, kColumns, true, kChunkSize);
+  AppendLine(&cold_scrollback, 0u, 5u);
+  AppendLine(&cold_scrollback, 1u, 2u * kColumns);
+  // The newest row isn't wrapped, so there's nothing to remove.
+  std::vector<Cell> line;
+  cold_scrollback.RemoveUnfinishedLine(&line);
+  EXPECT_TRUE(line.empty());
+  EXPECT_EQ(3u, cold_scrollback.num_rows());
+
+  // The rows of a line that continues after the newest row are removed.
+  std::vector<Cell> row(
+      kColumns,
+      Cell(Character(Character::Attribute::NONE, 'x'), Color(), Color()));
+  cold_scrollback.AppendRow(row.data(), kColumns, true);
+  cold_scrollback.AppendRow(row.data(), kColumns, true);
+  cold_scrollback.RemoveUnfinishedLine(&line);
+  EXPECT_EQ(std::vector<Cell>(2u * kColumns, row[0]), line);
+  EXPECT_EQ(3u, cold_scrollback.num_rows());
+  CheckLineRow(&cold_scrollback, 2u, 1u, kColumns, 2u * kColumns, false);
+}
+
+TEST(ColdScrollbackTest, MemoryUsage) {
+  const size_t kNumRows = 10000u;
+  const size_t kUncompressedSize = kNumRows * kColumns * sizeof(Cell);
+  // The number of distinct rows (the rows get more repetitive as this
+  // decreases).
+  for (uint32_t period : {1000u, 10u}) {
+    size_t memory_usage[2] = {};
+    for (bool compress : {false, true}) {
+      ColdScrollback cold_scrollback(kNumRows, kColumns, compress,
+                                     kChunkSize);
+      size_t initial_memory_usage = cold_scrollback.GetMemoryUsage();
+      for (uint32_t n = 0u; n < kNumRows; n++)
+        cold_scrollback.AppendRow(MakeRow(n % period).data(), kColumns, false);
+      memory_usage[compress] =
+          cold_scrollback.GetMemoryUsage() - initial_memory_usage;
+      EXPECT_LT(memory_usage[compress], kUncompressedSize / 2u);
+    }
+    EXPECT_LT(memory_usage[true], memory_usage[false]);
+    if (period <= 10u) {
+      EXPECT_LT(memory_usage[true], memory_usage[false] / 4u);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,156 @@
+#include "src/color_tables.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+namespace vtlib {
+namespace {
+
+// Compile-time table generation.
+// TODO(C++14): Use |std::index_sequence| (and |std::array|, whose
+// |operator[]| isn't constexpr in C++11).
+
+template <size_t... Is>
+struct IndexSequence {};
+
+template <typename A, typename B>
+struct ConcatIndexSequences;
+template <size_t... Is, size_t... Js>
+struct ConcatIndexSequences<IndexSequence<Is...>, IndexSequence<Js...>> {
+  using Type = IndexSequence<Is..., (sizeof...(Is) + Js)...>;
+};
+
+// |MakeIndexSequence<N>::Type| is |IndexSequence<0, 1, ..., N - 1>| (built by
+// halving, so that the template recursion depth is only O(log N)).
+template <size_t N>
+struct MakeIndexSequence {
+  using Type = typename ConcatIndexSequences<
+      typename MakeIndexSequence<N / 2u>::Type,
+      typename MakeIndexSequence<N - N / 2u>::Type>::Type;
+};
+template <>
+struct MakeIndexSequence<0u> {
+  using Type = IndexSequence<>;
+};
+template <>
+struct MakeIndexSequence<1u> {
+  using Type = IndexSequence<0u>;
+};
+
+template <typename T, size_t N>
+struct Table {
+  T values[N];
+};
+
+// Returns the table |{F(0), F(1), ..., F(N - 1)}|.
+template <typename T, T (*F)(size_t), size_t... Is>
+constexpr Table<T, sizeof...(Is)> MakeTable(IndexSequence<Is...>) {
+  return Table<T, sizeof...(Is)>{{F(Is)...}};
+}
+
+constexpr uint32_t Rgb(uint32_t r, uint32_t g, uint32_t b) {
+  return (r << 16) | (g << 8) | b;
+}
+
+// The component values of the 6x6x6 color cube are 0, 95, 135, ..., 255.
+constexpr uint32_t CubeLevel(size_t i) {
+  return i ? static_cast<uint32_t>(55u + 40u * i) : 0u;
+}
+
+// The grayscale ramp is 8, 18, ..., 238.
+constexpr size_t kNumGrays = 24u;
+constexpr uint32_t Gray(size_t i) {
+  return static_cast<uint32_t>(8u + 10u * i);
+}
+
+// The |Color| data for each 256-color index (the type is |ANSI_16| for indices
+// less than 16, and |RGB| otherwise).
+constexpr uint32_t Color256Data(size_t index) {
+  return index < 16u
+             ? static_cast<uint32_t>(index)
+             : index < 232u ? Rgb(CubeLevel((index - 16u) / 36u),
+                                  CubeLevel((index - 16u) / 6u % 6u),
+                                  CubeLevel((index - 16u) % 6u))
+                            : Rgb(Gray(index - 232u), Gray(index - 232u),
+                                  Gray(index - 232u));
+}
+
+// The index of the cube level nearest to the component value |value|. (The
+// midpoints between the levels are 47.5, 115, 155, 195, and 235.)
+constexpr uint8_t NearestCubeLevel(size_t value) {
+  return value < 48u ? 0u
+                     : value < 115u ? 1u
+                                    : static_cast<uint8_t>((value - 35u) / 40u);
+}
+
+// The index of the gray nearest to (g, g, g) for g = |sum| / 3, where |sum| is
+// the sum of the components of a color (this is also the nearest gray to the
+// color itself). I.e., the k for which 3 * Gray(k) = 24 + 30k is nearest to
+// |sum|.
+constexpr uint8_t NearestGray(size_t sum) {
+  return sum < 9u ? 0u
+                  : (sum - 9u) / 30u >= kNumGrays
+                        ? static_cast<uint8_t>(kNumGrays - 1u)
+                        : static_cast<uint8_t>((sum - 9u) / 30u);
+}
+
+constexpr Table<uint32_t, 256u> kColor256Data =
+    MakeTable<uint32_t, Color256Data>(MakeIndexSequence<256u>::Type());
+constexpr Table<uint8_t, 256u> kNearestCubeLevels =
+    MakeTable<uint8_t, NearestCubeLevel>(MakeIndexSequence<256u>::Type());
+constexpr Table<uint8_t, 3u * 255u + 1u> kNearestGrays =
+    MakeTable<uint8_t, NearestGray>(MakeIndexSequence<3u * 255u + 1u>::Type());
+
+static_assert(kColor256Data.values[15] == 15u, "Bad 256-color table");
+static_assert(kColor256Data.values[16] == 0x000000u, "Bad 256-color table");
+static_assert(kColor256Data.values[196] == 0xff0000u, "Bad 256-color table");
+static_assert(kColor256Data.values[231] == 0xffffffu, "Bad 256-color table");
+static_assert(kColor256Data.values[232] == 0x080808u, "Bad 256-color table");
+static_assert(kColor256Data.values[255] == 0xeeeeeeu, "Bad 256-color table");
+static_assert(kNearestCubeLevels.values[47] == 0u &&
+                  kNearestCubeLevels.values[48] == 1u &&
+                  kNearestCubeLevels.values[155] == 3u &&
+                  kNearestCubeLevels.values[255] == 5u,
+              "Bad cube level table");
+static_assert(kNearestGrays.values[0] == 0u &&
+                  kNearestGrays.values[3u * 13u] == 1u &&
+                  kNearestGrays.values[3u * 255u] == kNumGrays - 1u,
+              "Bad gray table");
+
+uint32_t SquaredDistance(uint32_t rgb1, uint32_t rgb2) {
+  uint32_t rv = 0u;
+  for (int shift = 0; shift < 24; shift += 8) {
+    int32_t d = static_cast<int32_t>((rgb1 >> shift) & 0xffu) -
+                static_cast<int32_t>((rgb2 >> shift) & 0xffu);
+    rv += static_cast<uint32_t>(d * d);
+  }
+  return rv;
+}
+
+}  // namespace
+
+Color Color256(uint32_t index) {
+  assert(index <= 255u);
+  return Color(index < 16u ? Color::Type::ANSI_16 : Color::Type::RGB,
+               kColor256Data.values[index]);
+}
+
+uint32_t NearestColor256(uint32_t rgb) {
+  assert(!(rgb & ~static_cast<uint32_t>(0x00ffffffu)));
+  const uint32_t r = rgb >> 16;
+  const uint32_t g = (rgb >> 8) & 0xffu;
+  const uint32_t b = rgb & 0xffu;
+
+  // The nearest color in the cube is made up of the nearest level for each
+  // component.
+  uint32_t cube_index = 16u + 36u * kNearestCubeLevels.values[r] +
+                        6u * kNearestCubeLevels.values[g] +
+                        kNearestCubeLevels.values[b];
+  uint32_t gray_index = 232u + kNearestGrays.values[r + g + b];
+  return SquaredDistance(rgb, kColor256Data.values[gray_index]) <
+                 SquaredDistance(rgb, kColor256Data.values[cube_index])
+             ? gray_index
+             : cube_index;
+}
+
+}  // namespace vtlib
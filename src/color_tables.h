@@ -0,0 +1,28 @@
+#ifndef VTLIB_SRC_COLOR_TABLES_H_
+#define VTLIB_SRC_COLOR_TABLES_H_
+
+#include <stdint.h>
+
+#include <vtlib/color.h>
+
+namespace vtlib {
+
+// Conversions between XTerm 256-color indices and |Color|s, using lookup tables
+// that are computed at compile time.
+
+// Returns the |Color| for the XTerm 256-color index |index| (0..255): 0..15
+// map to |Color::Type::ANSI_16|, 16..231 (the 6x6x6 color cube) and 232..255
+// (the grayscale ramp) to |Color::Type::RGB|.
+Color Color256(uint32_t index);
+
+// Returns the XTerm 256-color index whose color is nearest (in Euclidean
+// distance) to the RGB value |rgb| (0xrrggbb), e.g., to downsample RGB colors
+// for clients that only support 256 colors. Only indices 16..255 are
+// considered, since the colors of the first 16 are up to the renderer. This is
+// O(1): the nearest cube level and gray for each component value are
+// precomputed.
+uint32_t NearestColor256(uint32_t rgb);
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_COLOR_TABLES_H_
@@ -0,0 +1,83 @@
+#include "src/color_tables.h"
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+#include <vtlib/color.h>
+
+namespace vtlib {
+namespace {
+
+Color Ansi(uint32_t index) {
+  return Color(Color::Type::ANSI_16, index);
+}
+
+Color Rgb(uint32_t rgb) {
+  return Color(Color::Type::RGB, rgb);
+}
+
+uint32_t SquaredDistance(uint32_t rgb1, uint32_t rgb2) {
+  uint32_t rv = 0u;
+  for (int shift = 0; shift < 24; shift += 8) {
+    int32_t d = static_cast<int32_t>((rgb1 >> shift) & 0xffu) -
+                static_cast<int32_t>((rgb2 >> shift) & 0xffu);
+    rv += static_cast<uint32_t>(d * d);
+  }
+  return rv;
+}
+
+// The straightforward search that |NearestColor256()| avoids.
+uint32_t SlowNearestColor256(uint32_t rgb) {
+  uint32_t rv = 16u;
+  for (uint32_t i = 17u; i < 256u; i++) {
+    if (SquaredDistance(rgb, Color256(i).data()) <
+        SquaredDistance(rgb, Color256(rv).data()))
+      rv = i;
+  }
+  return rv;
+}
+
+TEST(ColorTablesTest, Color256) {
+  EXPECT_EQ(Ansi(0u), Color256(0u));
+  EXPECT_EQ(Ansi(15u), Color256(15u));
+  // The color cube.
+  EXPECT_EQ(Rgb(0x000000u), Color256(16u));
+  EXPECT_EQ(Rgb(0x00005fu), Color256(17u));
+  EXPECT_EQ(Rgb(0x5f8700u), Color256(64u));
+  EXPECT_EQ(Rgb(0xff8700u), Color256(208u));
+  EXPECT_EQ(Rgb(0xffffffu), Color256(231u));
+  // The grayscale ramp.
+  EXPECT_EQ(Rgb(0x080808u), Color256(232u));
+  EXPECT_EQ(Rgb(0x767676u), Color256(243u));
+  EXPECT_EQ(Rgb(0xeeeeeeu), Color256(255u));
+}
+
+TEST(ColorTablesTest, NearestColor256) {
+  // Each color of the cube and the ramp maps to itself.
+  for (uint32_t i = 16u; i < 256u; i++)
+    EXPECT_EQ(i, NearestColor256(Color256(i).data()));
+
+  EXPECT_EQ(16u, NearestColor256(0x000000u));
+  EXPECT_EQ(231u, NearestColor256(0xffffffu));
+  EXPECT_EQ(196u, NearestColor256(0xfe0102u));
+  EXPECT_EQ(244u, NearestColor256(0x818181u));
+
+  // Compare with a brute-force search over a grid of colors. (Ties may be
+  // broken differently, so compare distances.)
+  for (uint32_t r = 0u; r < 256u; r += 5u) {
+    for (uint32_t g = 0u; g < 256u; g += 7u) {
+      for (uint32_t b = 0u; b < 256u; b += 3u) {
+        uint32_t rgb = (r << 16) | (g << 8) | b;
+        uint32_t expected = SlowNearestColor256(rgb);
+        uint32_t actual = NearestColor256(rgb);
+        ASSERT_EQ(SquaredDistance(rgb, Color256(expected).data()),
+                  SquaredDistance(rgb, Color256(actual).data()))
+            << std::hex << rgb << ": expected " << std::dec << expected
+            << ", got " << actual;
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace vtlib
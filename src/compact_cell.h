@@ -0,0 +1,53 @@
+#ifndef VTLIB_SRC_COMPACT_CELL_H_
+#define VTLIB_SRC_COMPACT_CELL_H_
+
+#include <assert.h>
+#include <stdint.h>
+
+namespace vtlib {
+
+// A compact (4-byte) alternative to |Cell|: a 21-bit codepoint and an 11-bit
+// index into a |StyleTable| (which holds the attributes and colors). Like
+// |Cell()|, |CompactCell()| is all zero bits (style 0 is always the default
+// style).
+//
+// The largest style index, |kOverflowStyleIndex|, is reserved for cells whose
+// style didn't fit in the table: for those, the "codepoint" is instead an index
+// into a table of full |Cell|s (see |CompactCellCodec| in screen_buffer.cc).
+class CompactCell {
+ public:
+  static constexpr uint32_t kMaxStyleIndex = 0x7ffu;
+  static constexpr uint32_t kOverflowStyleIndex = kMaxStyleIndex;
+  static constexpr uint32_t kMaxCodepoint = 0x1fffffu;
+
+  CompactCell() = default;
+  CompactCell(uint32_t codepoint, uint32_t style_index)
+      : value_((style_index << 21u) | codepoint) {
+    assert(codepoint <= kMaxCodepoint);
+    assert(style_index <= kMaxStyleIndex);
+  }
+
+  uint32_t codepoint() const { return value_ & 0x001fffffu; }
+  uint32_t style_index() const { return value_ >> 21u; }
+
+  void set_codepoint(uint32_t codepoint) {
+    assert(codepoint <= kMaxCodepoint);
+    value_ = (value_ & 0xffe00000u) | codepoint;
+  }
+
+  bool operator==(const CompactCell& other) const {
+    return value_ == other.value_;
+  }
+  bool operator!=(const CompactCell& other) const {
+    return value_ != other.value_;
+  }
+
+ private:
+  uint32_t value_ = 0u;
+};
+
+static_assert(sizeof(CompactCell) == 4u, "CompactCell should be 4 bytes");
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_COMPACT_CELL_H_
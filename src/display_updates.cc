@@ -0,0 +1,118 @@
+#include <vtlib/display_updates.h>
+
+#include <assert.h>
+
+#include <algorithm>
+
+namespace vtlib {
+
+constexpr uint32_t RowDamage::kBitsPerWord;
+
+RowDamage::RowDamage(uint32_t rows, ColumnNumber columns, RowNumber first_row)
+    : rows_(rows),
+      columns_(columns),
+      first_row_(first_row),
+      spans_(rows),
+      dirty_bits_((rows + kBitsPerWord - 1u) / kBitsPerWord) {}
+
+bool RowDamage::GetDirtyColumns(RowNumber row,
+                                ColumnNumber* left,
+                                ColumnNumber* right) const {
+  if (row < first_row_ || row - first_row_ >= rows_)
+    return false;
+  uint32_t slot = GetSlot(row);
+  if (!IsSlotDirty(slot))
+    return false;
+  *left = spans_[slot].left;
+  *right = spans_[slot].right;
+  return true;
+}
+
+RowNumber RowDamage::FindNextDirtyRow(RowNumber row) const {
+  RowNumber end = first_row_ + rows_;
+  if (row < first_row_)
+    row = first_row_;
+  if (row >= end || !num_dirty_rows_)
+    return end;
+
+  // Search the slots from |row|'s to the end of the ring, and then (if the
+  // tracked rows wrap around) from the start of the ring to |top_slot_|.
+  uint32_t slot = GetSlot(row);
+  if (slot >= top_slot_) {
+    uint32_t found = FindNextDirtySlot(slot, rows_);
+    if (found < rows_)
+      return first_row_ + (found - top_slot_);
+    slot = 0u;
+  }
+  uint32_t found = FindNextDirtySlot(slot, top_slot_);
+  if (found < top_slot_)
+    return first_row_ + (rows_ - top_slot_) + found;
+  return end;
+}
+
+void RowDamage::MarkDirty(RowNumber row,
+                          ColumnNumber left,
+                          ColumnNumber right) {
+  if (row < first_row_ || row - first_row_ >= rows_ || left >= right)
+    return;
+  uint32_t slot = GetSlot(row);
+  Span& span = spans_[slot];
+  if (IsSlotDirty(slot)) {
+    span.left = std::min(span.left, left);
+    span.right = std::max(span.right, right);
+    return;
+  }
+  dirty_bits_[slot / kBitsPerWord] |= uint64_t{1} << (slot % kBitsPerWord);
+  span.left = left;
+  span.right = right;
+  num_dirty_rows_++;
+}
+
+void RowDamage::ScrollUp(uint32_t count) {
+  if (count >= rows_) {
+    Clear();
+  } else {
+    // The slots of the rows that are scrolled out become those of the new
+    // rows.
+    for (uint32_t i = 0u; i < count; i++) {
+      ClearSlot(top_slot_);
+      top_slot_ = top_slot_ + 1u == rows_ ? 0u : top_slot_ + 1u;
+    }
+  }
+  first_row_ += count;
+}
+
+void RowDamage::Clear() {
+  for (size_t i = 0u; num_dirty_rows_ && i < dirty_bits_.size(); i++) {
+    if (dirty_bits_[i]) {
+      num_dirty_rows_ -=
+          static_cast<uint32_t>(__builtin_popcountll(dirty_bits_[i]));
+      dirty_bits_[i] = 0u;
+    }
+  }
+  assert(!num_dirty_rows_);
+}
+
+void RowDamage::ClearSlot(uint32_t slot) {
+  uint64_t bit = uint64_t{1} << (slot % kBitsPerWord);
+  uint64_t& word = dirty_bits_[slot / kBitsPerWord];
+  if (word & bit) {
+    word &= ~bit;
+    num_dirty_rows_--;
+  }
+}
+
+uint32_t RowDamage::FindNextDirtySlot(uint32_t begin, uint32_t end) const {
+  uint32_t slot = begin;
+  while (slot < end) {
+    uint64_t word = dirty_bits_[slot / kBitsPerWord] >> (slot % kBitsPerWord);
+    if (word) {
+      slot += static_cast<uint32_t>(__builtin_ctzll(word));
+      return std::min(slot, end);
+    }
+    slot = (slot / kBitsPerWord + 1u) * kBitsPerWord;
+  }
+  return end;
+}
+
+}  // namespace vtlib
@@ -0,0 +1,114 @@
+#include <vtlib/display_updates.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/coordinates.h>
+
+namespace vtlib {
+namespace {
+
+// Returns the dirty rows, using |RowDamage::FindNextDirtyRow()|.
+std::vector<RowNumber> GetDirtyRows(const RowDamage& damage) {
+  std::vector<RowNumber> rv;
+  RowNumber end = damage.first_row() + damage.rows();
+  for (RowNumber row = damage.FindNextDirtyRow(damage.first_row()); row < end;
+       row = damage.FindNextDirtyRow(row + 1u))
+    rv.push_back(row);
+  return rv;
+}
+
+TEST(RowDamageTest, Basic) {
+  RowDamage damage(5u, 80u);
+  EXPECT_EQ(0u, damage.first_row());
+  EXPECT_EQ(5u, damage.rows());
+  EXPECT_EQ(80u, damage.columns());
+  EXPECT_TRUE(damage.is_empty());
+  EXPECT_EQ(5u, damage.FindNextDirtyRow(0u));
+
+  damage.MarkDirty(0u, 0u, 1u);
+  damage.MarkDirty(4u, 10u, 20u);
+  // Empty spans and untracked rows are ignored.
+  damage.MarkDirty(2u, 10u, 10u);
+  damage.MarkDirty(5u, 0u, 80u);
+  EXPECT_FALSE(damage.is_empty());
+  EXPECT_EQ(2u, damage.num_dirty_rows());
+  EXPECT_EQ(std::vector<RowNumber>({0u, 4u}), GetDirtyRows(damage));
+
+  ColumnNumber left = 0u;
+  ColumnNumber right = 0u;
+  EXPECT_TRUE(damage.GetDirtyColumns(0u, &left, &right));
+  EXPECT_EQ(0u, left);
+  EXPECT_EQ(1u, right);
+  EXPECT_FALSE(damage.GetDirtyColumns(1u, &left, &right));
+  EXPECT_FALSE(damage.GetDirtyColumns(5u, &left, &right));
+
+  // Spans are unioned.
+  damage.MarkDirty(4u, 30u, 40u);
+  damage.MarkDirty(4u, 5u, 6u);
+  EXPECT_TRUE(damage.GetDirtyColumns(4u, &left, &right));
+  EXPECT_EQ(5u, left);
+  EXPECT_EQ(40u, right);
+  EXPECT_EQ(2u, damage.num_dirty_rows());
+
+  damage.Clear();
+  EXPECT_TRUE(damage.is_empty());
+  EXPECT_TRUE(GetDirtyRows(damage).empty());
+  EXPECT_FALSE(damage.GetDirtyColumns(4u, &left, &right));
+}
+
+TEST(RowDamageTest, ScrollUp) {
+  RowDamage damage(4u, 10u);
+  damage.MarkDirty(0u, 0u, 10u);
+  damage.MarkDirty(2u, 3u, 4u);
+
+  // Row 0 is no longer tracked; row 2 stays dirty; the new row (4) is clean.
+  damage.ScrollUp(1u);
+  EXPECT_EQ(1u, damage.first_row());
+  EXPECT_EQ(1u, damage.num_dirty_rows());
+  EXPECT_EQ(std::vector<RowNumber>({2u}), GetDirtyRows(damage));
+  ColumnNumber left = 0u;
+  ColumnNumber right = 0u;
+  EXPECT_TRUE(damage.GetDirtyColumns(2u, &left, &right));
+  EXPECT_EQ(3u, left);
+  EXPECT_EQ(4u, right);
+
+  // Rows now wrap around the ring.
+  damage.MarkDirty(4u, 1u, 2u);
+  damage.MarkDirty(3u, 1u, 2u);
+  EXPECT_EQ(std::vector<RowNumber>({2u, 3u, 4u}), GetDirtyRows(damage));
+  EXPECT_EQ(4u, damage.FindNextDirtyRow(4u));
+  EXPECT_EQ(3u, damage.FindNextDirtyRow(0u) + 1u);
+
+  damage.ScrollUp(2u);
+  EXPECT_EQ(3u, damage.first_row());
+  EXPECT_EQ(std::vector<RowNumber>({3u, 4u}), GetDirtyRows(damage));
+
+  damage.ScrollUp(100u);
+  EXPECT_EQ(103u, damage.first_row());
+  EXPECT_TRUE(damage.is_empty());
+  damage.MarkDirty(106u, 0u, 1u);
+  EXPECT_EQ(std::vector<RowNumber>({106u}), GetDirtyRows(damage));
+}
+
+// Many rows (so that the bitset has several words), scrolling by odd amounts.
+TEST(RowDamageTest, Large) {
+  const uint32_t kRows = 150u;
+  RowDamage damage(kRows, 10u);
+  for (uint32_t i = 0u; i < 20u; i++) {
+    damage.ScrollUp(i * 7u);
+    RowNumber top = damage.first_row();
+    std::vector<RowNumber> expected;
+    for (RowNumber row = top + i; row < top + kRows; row += 13u + i) {
+      damage.MarkDirty(row, 0u, 1u);
+      expected.push_back(row);
+    }
+    EXPECT_EQ(expected, GetDirtyRows(damage)) << i;
+    damage.Clear();
+  }
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,154 @@
+#include <vtlib/input_ring.h>
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <vtlib/terminal.h>
+
+// Memory ordering: the producer publishes data by storing |write_index_|
+// (release), and the consumer acquires it by loading |write_index_|; likewise
+// for freed space and |read_index_|.
+//
+// With a delegate, each side must also detect whether the other side may have
+// seen the ring empty (respectively, full) and gone to sleep: after storing its
+// own index, it loads the other side's. These stores and loads (and the loads
+// with which each side checks for data or space) are sequentially consistent,
+// so that (as in Dekker's algorithm) at least one side sees the other's update:
+// either the consumer sees the new data, or the producer sees that the
+// consumer had caught up and wakes it (and similarly for the producer waiting
+// for space). (On x86, only the stores with a delegate cost anything extra.)
+
+namespace vtlib {
+namespace {
+
+size_t RoundUpToPowerOf2(size_t n) {
+  size_t rv = 1u;
+  while (rv < n)
+    rv *= 2u;
+  return rv;
+}
+
+}  // namespace
+
+constexpr size_t InputRing::kCacheLineSize;
+
+InputRing::InputRing(size_t capacity, Delegate* delegate)
+    : mask_(RoundUpToPowerOf2(std::max(capacity, size_t{1})) - 1u),
+      delegate_(delegate),
+      buffer_(new uint8_t[mask_ + 1u]),
+      write_index_(0u),
+      read_index_(0u) {}
+
+InputRing::~InputRing() = default;
+
+size_t InputRing::Push(const uint8_t* bytes, size_t num_bytes) {
+  const size_t write_index = write_index_.load(std::memory_order_relaxed);
+  size_t free_space = capacity() - (write_index - cached_read_index_);
+  if (free_space < num_bytes) {
+    cached_read_index_ = read_index_.load(std::memory_order_seq_cst);
+    free_space = capacity() - (write_index - cached_read_index_);
+  }
+  size_t n = std::min(free_space, num_bytes);
+  if (!n)
+    return 0u;
+
+  // The free space may wrap around the end of the buffer.
+  size_t offset = write_index & mask_;
+  size_t first_part = std::min(n, capacity() - offset);
+  memcpy(buffer_.get() + offset, bytes, first_part);
+  memcpy(buffer_.get(), bytes + first_part, n - first_part);
+  EndWrite(n);
+  return n;
+}
+
+size_t InputRing::BeginWrite(uint8_t** buffer) {
+  const size_t write_index = write_index_.load(std::memory_order_relaxed);
+  size_t free_space = capacity() - (write_index - cached_read_index_);
+  if (free_space < capacity() / 2u) {
+    cached_read_index_ = read_index_.load(std::memory_order_seq_cst);
+    free_space = capacity() - (write_index - cached_read_index_);
+  }
+  size_t offset = write_index & mask_;
+  *buffer = buffer_.get() + offset;
+  return std::min(free_space, capacity() - offset);
+}
+
+void InputRing::EndWrite(size_t num_bytes) {
+  if (!num_bytes)
+    return;
+  const size_t old_write_index = write_index_.load(std::memory_order_relaxed);
+  assert(num_bytes <= capacity() - (old_write_index - cached_read_index_));
+  if (!delegate_) {
+    write_index_.store(old_write_index + num_bytes, std::memory_order_release);
+    return;
+  }
+
+  write_index_.store(old_write_index + num_bytes, std::memory_order_seq_cst);
+  // If the consumer has read everything that was there before, it may be
+  // waiting for more.
+  if (read_index_.load(std::memory_order_seq_cst) == old_write_index)
+    delegate_->OnDataAvailable();
+}
+
+size_t InputRing::Pop(uint8_t* bytes, size_t max_bytes) {
+  const size_t read_index = read_index_.load(std::memory_order_relaxed);
+  cached_write_index_ = write_index_.load(std::memory_order_seq_cst);
+  size_t n = std::min(cached_write_index_ - read_index, max_bytes);
+  if (!n)
+    return 0u;
+
+  // The data may wrap around the end of the buffer.
+  size_t offset = read_index & mask_;
+  size_t first_part = std::min(n, capacity() - offset);
+  memcpy(bytes, buffer_.get() + offset, first_part);
+  memcpy(bytes + first_part, buffer_.get(), n - first_part);
+  EndRead(n);
+  return n;
+}
+
+size_t InputRing::BeginRead(const uint8_t** buffer) {
+  const size_t read_index = read_index_.load(std::memory_order_relaxed);
+  cached_write_index_ = write_index_.load(std::memory_order_seq_cst);
+  size_t offset = read_index & mask_;
+  *buffer = buffer_.get() + offset;
+  return std::min(cached_write_index_ - read_index, capacity() - offset);
+}
+
+void InputRing::EndRead(size_t num_bytes) {
+  if (!num_bytes)
+    return;
+  const size_t old_read_index = read_index_.load(std::memory_order_relaxed);
+  assert(num_bytes <= cached_write_index_ - old_read_index);
+  if (!delegate_) {
+    read_index_.store(old_read_index + num_bytes, std::memory_order_release);
+    return;
+  }
+
+  read_index_.store(old_read_index + num_bytes, std::memory_order_seq_cst);
+  // If the ring was full, the producer may be waiting for space.
+  if (write_index_.load(std::memory_order_seq_cst) - old_read_index ==
+      capacity())
+    delegate_->OnSpaceAvailable();
+}
+
+bool InputRing::DrainInto(Terminal* terminal, size_t* num_bytes) {
+  bool rv = false;
+  size_t total = 0u;
+  // The data may wrap around the end of the buffer.
+  for (int i = 0; i < 2; i++) {
+    const uint8_t* buffer;
+    size_t n = BeginRead(&buffer);
+    if (!n)
+      break;
+    rv |= terminal->ProcessBytes(buffer, n);
+    EndRead(n);
+    total += n;
+  }
+  if (num_bytes)
+    *num_bytes = total;
+  return rv;
+}
+
+}  // namespace vtlib
@@ -0,0 +1,147 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <vtlib/input_ring.h>
+#include <vtlib/terminal.h>
+
+#include "testing/benchmark_corpora.h"
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kCorpusSize = 1u << 20;  // 1 MiB.
+// The producer writes in chunks of (up to) this size (like reads from a PTY).
+constexpr size_t kChunkSize = 4096u;
+
+// Pins the calling thread to |cpu|. Failure (e.g., on a single-core machine) is
+// ignored: the benchmark still runs, just not necessarily across two cores.
+void PinToCpu(int cpu) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+// Runs a producer thread (on CPU 0) that repeatedly writes |input| into
+// |ring|, in place, until |*stop| is set.
+std::thread StartProducer(InputRing* ring,
+                          const std::vector<uint8_t>* input,
+                          const std::atomic<bool>* stop) {
+  return std::thread([ring, input, stop]() {
+    PinToCpu(0);
+    size_t offset = 0u;
+    while (!stop->load(std::memory_order_relaxed)) {
+      uint8_t* buffer;
+      size_t n = std::min(ring->BeginWrite(&buffer), kChunkSize);
+      if (!n) {
+        std::this_thread::yield();
+        continue;
+      }
+      n = std::min(n, input->size() - offset);
+      std::copy(input->data() + offset, input->data() + offset + n, buffer);
+      ring->EndWrite(n);
+      offset = (offset + n) % input->size();
+    }
+  });
+}
+
+// Restores the calling thread's CPU affinity when destroyed.
+class ScopedAffinity {
+ public:
+  ScopedAffinity() {
+    pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_), &cpu_set_);
+  }
+  ~ScopedAffinity() {
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_), &cpu_set_);
+  }
+
+  ScopedAffinity(const ScopedAffinity&) = delete;
+  ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+ private:
+  cpu_set_t cpu_set_;
+};
+
+// Measures the throughput of an |InputRing| (of capacity |state.range(0)|)
+// alone, with the producer and the consumer (which copies the data out) on two
+// cores.
+void BM_InputRingThroughput(benchmark::State& state) {
+  std::vector<uint8_t> input = GenerateCorpus(Corpus::ASCII, kCorpusSize);
+  InputRing ring(static_cast<size_t>(state.range(0)), nullptr);
+  std::vector<uint8_t> output(kChunkSize);
+  ScopedAffinity scoped_affinity;
+  PinToCpu(1);
+  std::atomic<bool> stop(false);
+  std::thread producer = StartProducer(&ring, &input, &stop);
+
+  for (auto _ : state) {
+    size_t total = 0u;
+    while (total < kCorpusSize) {
+      size_t n = ring.Pop(output.data(), output.size());
+      if (!n)
+        std::this_thread::yield();
+      total += n;
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  stop.store(true);
+  producer.join();
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kCorpusSize));
+}
+
+// (Real time, since the work is split between two threads.)
+BENCHMARK(BM_InputRingThroughput)
+    ->Arg(4096)
+    ->Arg(65536)
+    ->Arg(1 << 20)
+    ->UseRealTime();
+
+// Measures feeding a |Terminal| from another core via an |InputRing| (of
+// capacity |state.range(0)|), with |InputRing::DrainInto()|. Compare with
+// |BM_ProcessBytes/ascii| (in terminal_benchmark), which does all the work on
+// one thread.
+void BM_InputRingDrainIntoTerminal(benchmark::State& state) {
+  std::vector<uint8_t> input = GenerateCorpus(Corpus::ASCII, kCorpusSize);
+  InputRing ring(static_cast<size_t>(state.range(0)), nullptr);
+  Terminal::Options options;
+  options.rows = 50u;
+  options.columns = 200u;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  ScopedAffinity scoped_affinity;
+  PinToCpu(1);
+  std::atomic<bool> stop(false);
+  std::thread producer = StartProducer(&ring, &input, &stop);
+
+  for (auto _ : state) {
+    size_t total = 0u;
+    while (total < kCorpusSize) {
+      size_t n;
+      benchmark::DoNotOptimize(ring.DrainInto(terminal.get(), &n));
+      if (!n)
+        std::this_thread::yield();
+      total += n;
+    }
+    terminal->reset_display_updates();
+  }
+
+  stop.store(true);
+  producer.join();
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kCorpusSize));
+}
+
+BENCHMARK(BM_InputRingDrainIntoTerminal)->Arg(4096)->Arg(65536)->UseRealTime();
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,228 @@
+#include <vtlib/input_ring.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+namespace {
+
+class CountingDelegate : public InputRing::Delegate {
+ public:
+  CountingDelegate() {}
+  ~CountingDelegate() override {}
+
+  int num_data_available() const { return num_data_available_; }
+  int num_space_available() const { return num_space_available_; }
+
+  // |InputRing::Delegate|:
+  void OnDataAvailable() override { num_data_available_++; }
+  void OnSpaceAvailable() override { num_space_available_++; }
+
+ private:
+  int num_data_available_ = 0;
+  int num_space_available_ = 0;
+};
+
+std::string PopString(InputRing* ring, size_t max_bytes) {
+  std::vector<uint8_t> buffer(max_bytes);
+  size_t n = ring->Pop(buffer.data(), buffer.size());
+  return std::string(buffer.begin(), buffer.begin() + n);
+}
+
+size_t PushString(InputRing* ring, const std::string& s) {
+  return ring->Push(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+TEST(InputRingTest, Capacity) {
+  EXPECT_EQ(1u, InputRing(0u, nullptr).capacity());
+  EXPECT_EQ(1u, InputRing(1u, nullptr).capacity());
+  EXPECT_EQ(8u, InputRing(5u, nullptr).capacity());
+  EXPECT_EQ(4096u, InputRing(4096u, nullptr).capacity());
+}
+
+TEST(InputRingTest, PushPop) {
+  InputRing ring(8u, nullptr);
+  EXPECT_EQ("", PopString(&ring, 8u));
+
+  EXPECT_EQ(3u, PushString(&ring, "abc"));
+  EXPECT_EQ("ab", PopString(&ring, 2u));
+  EXPECT_EQ("c", PopString(&ring, 8u));
+  EXPECT_EQ("", PopString(&ring, 8u));
+
+  // Fill the ring (wrapping around).
+  EXPECT_EQ(8u, PushString(&ring, "0123456789"));
+  EXPECT_EQ(0u, PushString(&ring, "x"));
+  EXPECT_EQ("01234", PopString(&ring, 5u));
+  EXPECT_EQ(5u, PushString(&ring, "abcdef"));
+  EXPECT_EQ("567abcde", PopString(&ring, 100u));
+}
+
+TEST(InputRingTest, InPlace) {
+  InputRing ring(8u, nullptr);
+  EXPECT_EQ(6u, PushString(&ring, "abcdef"));
+  EXPECT_EQ("abcd", PopString(&ring, 4u));
+
+  // The free space is contiguous only up to the end of the buffer.
+  uint8_t* write_buffer;
+  ASSERT_EQ(2u, ring.BeginWrite(&write_buffer));
+  memcpy(write_buffer, "gh", 2u);
+  ring.EndWrite(2u);
+  ASSERT_EQ(4u, ring.BeginWrite(&write_buffer));
+  memcpy(write_buffer, "ij", 2u);
+  ring.EndWrite(2u);
+
+  const uint8_t* read_buffer;
+  ASSERT_EQ(4u, ring.BeginRead(&read_buffer));
+  EXPECT_EQ("efgh", std::string(read_buffer, read_buffer + 4u));
+  ring.EndRead(3u);
+  ASSERT_EQ(1u, ring.BeginRead(&read_buffer));
+  EXPECT_EQ('h', read_buffer[0]);
+  ring.EndRead(1u);
+  ASSERT_EQ(2u, ring.BeginRead(&read_buffer));
+  EXPECT_EQ("ij", std::string(read_buffer, read_buffer + 2u));
+  ring.EndRead(2u);
+  EXPECT_EQ(0u, ring.BeginRead(&read_buffer));
+}
+
+TEST(InputRingTest, Delegate) {
+  CountingDelegate delegate;
+  InputRing ring(4u, &delegate);
+
+  // Adding to an empty ring signals; adding to a non-empty ring doesn't.
+  PushString(&ring, "a");
+  EXPECT_EQ(1, delegate.num_data_available());
+  PushString(&ring, "b");
+  EXPECT_EQ(1, delegate.num_data_available());
+  EXPECT_EQ("ab", PopString(&ring, 4u));
+  PushString(&ring, "c");
+  EXPECT_EQ(2, delegate.num_data_available());
+
+  // Freeing space in a full ring signals; otherwise it doesn't.
+  PushString(&ring, "def");
+  EXPECT_EQ("c", PopString(&ring, 1u));
+  EXPECT_EQ(1, delegate.num_space_available());
+  EXPECT_EQ("d", PopString(&ring, 1u));
+  EXPECT_EQ(1, delegate.num_space_available());
+}
+
+TEST(InputRingTest, DrainInto) {
+  Terminal::Options options;
+  options.rows = 2u;
+  options.columns = 8u;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+
+  InputRing ring(8u, nullptr);
+  size_t num_bytes = 1u;
+  EXPECT_FALSE(ring.DrainInto(terminal.get(), &num_bytes));
+  EXPECT_EQ(0u, num_bytes);
+
+  // Wrap around, so that the data is processed in two parts.
+  PushString(&ring, "xxxxx");
+  PopString(&ring, 5u);
+  PushString(&ring, "ab\r\ncdef");
+  EXPECT_TRUE(ring.DrainInto(terminal.get(), &num_bytes));
+  EXPECT_EQ(8u, num_bytes);
+  EXPECT_EQ('b', terminal->GetRow(0u)[1].character().codepoint());
+  EXPECT_EQ('f', terminal->GetRow(1u)[3].character().codepoint());
+  EXPECT_EQ(1u, terminal->cursor_row());
+  EXPECT_EQ(4u, terminal->cursor_column());
+}
+
+// A delegate that lets each side block until the other signals it.
+class BlockingDelegate : public InputRing::Delegate {
+ public:
+  BlockingDelegate() {}
+  ~BlockingDelegate() override {}
+
+  void WaitForData() { Wait(&data_available_); }
+  void WaitForSpace() { Wait(&space_available_); }
+
+  // |InputRing::Delegate|:
+  void OnDataAvailable() override { Signal(&data_available_); }
+  void OnSpaceAvailable() override { Signal(&space_available_); }
+
+ private:
+  void Wait(bool* flag) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [flag]() { return *flag; });
+    *flag = false;
+  }
+
+  void Signal(bool* flag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *flag = true;
+    cv_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool data_available_ = false;
+  bool space_available_ = false;
+};
+
+constexpr size_t kTotalBytes = 4u << 20;
+
+uint8_t ByteAt(size_t i) {
+  return static_cast<uint8_t>((i * 131u) ^ (i >> 8));
+}
+
+// A producer thread pushes a byte sequence in variously sized chunks (blocking
+// when the ring is full), while the consumer pops it (blocking when the ring is
+// empty) and checks it. A lost wakeup would deadlock. Run this under
+// ThreadSanitizer (e.g., with |is_tsan = true|).
+TEST(InputRingTest, Threaded) {
+  BlockingDelegate delegate;
+  InputRing ring(1024u, &delegate);
+
+  std::thread producer([&ring, &delegate]() {
+    std::vector<uint8_t> chunk;
+    size_t i = 0u;
+    while (i < kTotalBytes) {
+      size_t chunk_size = std::min(1u + (i % 1500u), kTotalBytes - i);
+      chunk.resize(chunk_size);
+      for (size_t j = 0u; j < chunk_size; j++)
+        chunk[j] = ByteAt(i + j);
+      size_t pushed = 0u;
+      while (pushed < chunk_size) {
+        size_t n = ring.Push(chunk.data() + pushed, chunk_size - pushed);
+        if (!n)
+          delegate.WaitForSpace();
+        pushed += n;
+      }
+      i += chunk_size;
+    }
+  });
+
+  std::vector<uint8_t> buffer(700u);
+  size_t i = 0u;
+  size_t num_mismatches = 0u;
+  while (i < kTotalBytes) {
+    size_t n = ring.Pop(buffer.data(), 1u + (i % buffer.size()));
+    if (!n) {
+      delegate.WaitForData();
+      continue;
+    }
+    for (size_t j = 0u; j < n; j++)
+      num_mismatches += buffer[j] != ByteAt(i + j);
+    i += n;
+  }
+  producer.join();
+
+  EXPECT_EQ(kTotalBytes, i);
+  EXPECT_EQ(0u, num_mismatches);
+}
+
+}  // namespace
+}  // namespace vtlib
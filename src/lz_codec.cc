@@ -0,0 +1,150 @@
+#include "src/lz_codec.h"
+
+#include <string.h>
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kMinMatchLength = 4u;
+constexpr size_t kMaxOffset = 65535u;
+constexpr unsigned kHashBits = 12u;
+constexpr size_t kHashTableSize = 1u << kHashBits;
+
+uint32_t Read32(const uint8_t* p) {
+  uint32_t rv;
+  memcpy(&rv, p, sizeof(rv));
+  return rv;
+}
+
+uint32_t Hash(uint32_t value) {
+  return (value * 2654435761u) >> (32u - kHashBits);
+}
+
+// Appends the "extra" bytes for a length field (of the token) whose value is
+// |length| (for lengths >= 15).
+void AppendLength(size_t length, std::vector<uint8_t>* output) {
+  length -= 15u;
+  while (length >= 255u) {
+    output->push_back(255u);
+    length -= 255u;
+  }
+  output->push_back(static_cast<uint8_t>(length));
+}
+
+// Appends a sequence with the given literals and match (if |match_length| is
+// zero, there's no match and this is the final sequence).
+void AppendSequence(const uint8_t* literals,
+                    size_t num_literals,
+                    size_t offset,
+                    size_t match_length,
+                    std::vector<uint8_t>* output) {
+  size_t match_code = match_length ? match_length - kMinMatchLength : 0u;
+  output->push_back(static_cast<uint8_t>(
+      ((num_literals < 15u ? num_literals : 15u) << 4u) |
+      (match_code < 15u ? match_code : 15u)));
+  if (num_literals >= 15u)
+    AppendLength(num_literals, output);
+  output->insert(output->end(), literals, literals + num_literals);
+  if (!match_length)
+    return;
+  output->push_back(static_cast<uint8_t>(offset & 0xffu));
+  output->push_back(static_cast<uint8_t>(offset >> 8u));
+  if (match_code >= 15u)
+    AppendLength(match_code, output);
+}
+
+// Reads the "extra" bytes of a length field (see |AppendLength()|), adding
+// them to |*length|. Returns false on malformed input.
+bool ReadLength(const uint8_t** input,
+                const uint8_t* input_end,
+                size_t* length) {
+  uint8_t b;
+  do {
+    if (*input == input_end)
+      return false;
+    b = *(*input)++;
+    *length += b;
+  } while (b == 255u);
+  return true;
+}
+
+}  // namespace
+
+void LzCompress(const uint8_t* input,
+                size_t size,
+                std::vector<uint8_t>* output) {
+  // Entries are positions plus 1 (so that 0 means "empty").
+  uint32_t hash_table[kHashTableSize] = {};
+  size_t anchor = 0u;
+  size_t i = 0u;
+  while (i + kMinMatchLength <= size) {
+    uint32_t value = Read32(input + i);
+    uint32_t& entry = hash_table[Hash(value)];
+    size_t candidate = entry;
+    entry = static_cast<uint32_t>(i + 1u);
+    if (!candidate || i - (candidate - 1u) > kMaxOffset ||
+        Read32(input + candidate - 1u) != value) {
+      i++;
+      continue;
+    }
+    candidate--;
+
+    size_t match_length = kMinMatchLength;
+    while (i + match_length < size &&
+           input[candidate + match_length] == input[i + match_length])
+      match_length++;
+    AppendSequence(input + anchor, i - anchor, i - candidate, match_length,
+                   output);
+    i += match_length;
+    anchor = i;
+  }
+  AppendSequence(input + anchor, size - anchor, 0u, 0u, output);
+}
+
+bool LzDecompress(const uint8_t* input,
+                  size_t size,
+                  uint8_t* output,
+                  size_t output_size) {
+  const uint8_t* input_end = input + size;
+  uint8_t* output_start = output;
+  uint8_t* output_end = output + output_size;
+  for (;;) {
+    if (input == input_end)
+      return false;
+    uint8_t token = *input++;
+
+    size_t num_literals = token >> 4u;
+    if (num_literals == 15u && !ReadLength(&input, input_end, &num_literals))
+      return false;
+    if (static_cast<size_t>(input_end - input) < num_literals ||
+        static_cast<size_t>(output_end - output) < num_literals)
+      return false;
+    memcpy(output, input, num_literals);
+    input += num_literals;
+    output += num_literals;
+
+    // The final sequence has no match.
+    if (input == input_end)
+      return output == output_end;
+
+    if (input_end - input < 2)
+      return false;
+    size_t offset = static_cast<size_t>(input[0]) |
+                    (static_cast<size_t>(input[1]) << 8u);
+    input += 2;
+    size_t match_length = token & 0xfu;
+    if (match_length == 15u && !ReadLength(&input, input_end, &match_length))
+      return false;
+    match_length += kMinMatchLength;
+    if (!offset || offset > static_cast<size_t>(output - output_start) ||
+        static_cast<size_t>(output_end - output) < match_length)
+      return false;
+    // The match may overlap the output, so copy byte by byte.
+    const uint8_t* match = output - offset;
+    for (size_t j = 0u; j < match_length; j++)
+      output[j] = match[j];
+    output += match_length;
+  }
+}
+
+}  // namespace vtlib
@@ -0,0 +1,33 @@
+#ifndef VTLIB_SRC_LZ_CODEC_H_
+#define VTLIB_SRC_LZ_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace vtlib {
+
+// A simple, fast LZ77-style byte compressor, using a format similar to LZ4's
+// block format: a sequence of "sequences", each consisting of a token byte (the
+// high nibble is the number of literal bytes and the low nibble is the match
+// length minus 4, with the value 15 meaning that more length bytes follow, as
+// in LZ4), the literal bytes, and a 2-byte (little-endian) offset back to the
+// match. The last sequence consists of only a token and literals. It's meant
+// for compressing blocks of (encoded) scrollback, which tend to be repetitive,
+// and favors speed over compression ratio.
+
+// Compresses |size| bytes from |input|, appending the result to |output|.
+void LzCompress(const uint8_t* input, size_t size, std::vector<uint8_t>* output);
+
+// Decompresses |size| bytes from |input| (produced by |LzCompress()|) to
+// |output|, which must have room for exactly |output_size| bytes (the size of
+// the original, uncompressed data). Returns false if |input| is malformed.
+bool LzDecompress(const uint8_t* input,
+                  size_t size,
+                  uint8_t* output,
+                  size_t output_size);
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_LZ_CODEC_H_
@@ -0,0 +1,95 @@
+#include "src/lz_codec.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace vtlib {
+namespace {
+
+std::vector<uint8_t> ToBytes(const std::string& s) {
+  return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+// Compresses and decompresses |input|, checking that the result is the same.
+// Returns the compressed size.
+size_t CheckRoundTrip(const std::vector<uint8_t>& input) {
+  std::vector<uint8_t> compressed;
+  LzCompress(input.data(), input.size(), &compressed);
+  std::vector<uint8_t> decompressed(input.size());
+  EXPECT_TRUE(LzDecompress(compressed.data(), compressed.size(),
+                           decompressed.data(), decompressed.size()));
+  EXPECT_EQ(input, decompressed);
+  return compressed.size();
+}
+
+TEST(LzCodecTest, RoundTrip) {
+  CheckRoundTrip(std::vector<uint8_t>());
+  CheckRoundTrip(ToBytes("a"));
+  CheckRoundTrip(ToBytes("abcd"));
+  CheckRoundTrip(ToBytes("abcdabcd"));
+  CheckRoundTrip(ToBytes("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+  CheckRoundTrip(ToBytes("Hello, world! Hello, world! Hello, world?"));
+
+  // Long literal runs and long matches (needing extra length bytes).
+  std::vector<uint8_t> input;
+  uint32_t x = 12345u;
+  for (size_t i = 0u; i < 1000u; i++) {
+    x = x * 1103515245u + 12345u;
+    input.push_back(static_cast<uint8_t>(x >> 16u));
+  }
+  EXPECT_GT(CheckRoundTrip(input), 1000u);
+  input.insert(input.end(), input.begin(), input.end());
+  EXPECT_LT(CheckRoundTrip(input), 1100u);
+  input.insert(input.end(), 5000u, 'x');
+  EXPECT_LT(CheckRoundTrip(input), 1200u);
+
+  // Matches that are too far back to be used.
+  std::vector<uint8_t> far(input.begin(), input.begin() + 1000);
+  far.resize(100000u, 'y');
+  far.insert(far.end(), input.begin(), input.begin() + 1000);
+  CheckRoundTrip(far);
+}
+
+TEST(LzCodecTest, Compresses) {
+  std::string s;
+  for (int i = 0; i < 100; i++)
+    s += "[" + std::to_string(i) + "] Compiling src/some_file.cc\n";
+  EXPECT_LT(CheckRoundTrip(ToBytes(s)), s.size() / 4u);
+}
+
+TEST(LzCodecTest, Malformed) {
+  std::vector<uint8_t> compressed;
+  std::vector<uint8_t> input = ToBytes("abcabcabcabcabcabc");
+  LzCompress(input.data(), input.size(), &compressed);
+  std::vector<uint8_t> output(input.size() + 1u);
+
+  // Wrong output size.
+  EXPECT_FALSE(LzDecompress(compressed.data(), compressed.size(),
+                            output.data(), input.size() - 1u));
+  EXPECT_FALSE(LzDecompress(compressed.data(), compressed.size(),
+                            output.data(), input.size() + 1u));
+  // Truncated.
+  for (size_t n = 0u; n < compressed.size(); n++)
+    EXPECT_FALSE(LzDecompress(compressed.data(), n, output.data(),
+                              input.size()))
+        << n;
+
+  // Offset of 0 or too far back.
+  const uint8_t kBadOffset1[] = {0x10u, 'a', 0x00u, 0x00u, 0x00u};
+  EXPECT_FALSE(LzDecompress(kBadOffset1, sizeof(kBadOffset1), output.data(),
+                            5u));
+  const uint8_t kBadOffset2[] = {0x10u, 'a', 0x02u, 0x00u, 0x00u};
+  EXPECT_FALSE(LzDecompress(kBadOffset2, sizeof(kBadOffset2), output.data(),
+                            5u));
+  const uint8_t kGood[] = {0x10u, 'a', 0x01u, 0x00u, 0x00u};
+  EXPECT_TRUE(LzDecompress(kGood, sizeof(kGood), output.data(), 5u));
+  EXPECT_EQ(ToBytes("aaaaa"), std::vector<uint8_t>(output.begin(),
+                                                   output.begin() + 5));
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Generates character_width_tables.cc (the tables used by
+|GetCharacterWidth()|, in character_width.h) from Python's Unicode database.
+
+Usage: make_character_width_tables.py > character_width_tables.cc
+"""
+
+import sys
+import unicodedata
+
+# Must match the values in character_width.h.
+COMBINING = 0
+NARROW = 1
+WIDE = 2
+BLOCK_SHIFT = 7
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+NUM_CODEPOINTS = 0x110000
+
+# Unassigned codepoints in these ranges default to East Asian Wide (see
+# EastAsianWidth.txt).
+DEFAULT_WIDE_RANGES = [
+    (0x3400, 0x4dbf),
+    (0x4e00, 0x9fff),
+    (0xf900, 0xfaff),
+    (0x20000, 0x2fffd),
+    (0x30000, 0x3fffd),
+]
+
+# Format characters (category Cf) that are visible, and so take up a column:
+# the soft hyphen and the prepended concatenation marks.
+VISIBLE_FORMAT_CHARACTERS = set(
+    [0x00ad, 0x0600, 0x0601, 0x0602, 0x0603, 0x0604, 0x0605, 0x06dd, 0x070f,
+     0x0890, 0x0891, 0x08e2, 0x110bd, 0x110cd])
+
+
+def get_width(codepoint):
+  c = chr(codepoint)
+  category = unicodedata.category(c)
+  if category in ('Mn', 'Me'):
+    return COMBINING
+  if category == 'Cf' and codepoint not in VISIBLE_FORMAT_CHARACTERS:
+    return COMBINING
+  # Hangul medial vowels and final consonants (which combine with the initial
+  # consonant into a syllable block).
+  if 0x1160 <= codepoint <= 0x11ff or 0xd7b0 <= codepoint <= 0xd7ff:
+    return COMBINING
+  if category == 'Cn':
+    # (Python's database doesn't have the default widths of unassigned
+    # codepoints.)
+    for first, last in DEFAULT_WIDE_RANGES:
+      if first <= codepoint <= last:
+        return WIDE
+    return NARROW
+  if unicodedata.east_asian_width(c) in ('W', 'F'):
+    return WIDE
+  # Regional indicators are East Asian Neutral, but a pair of them is a flag
+  # (an emoji). A lone one is wide too, so that the pair is one wide character.
+  if 0x1f1e6 <= codepoint <= 0x1f1ff:
+    return WIDE
+  return NARROW
+
+
+def format_array(values, indent='    ', width=80):
+  lines = []
+  line = indent
+  for value in values:
+    item = '%d,' % value
+    if len(line) + 1 + len(item) > width:
+      lines.append(line)
+      line = indent
+    line += (' ' if line != indent else '') + item
+  lines.append(line)
+  return '\n'.join(lines)
+
+
+def main():
+  widths = [get_width(codepoint) for codepoint in range(NUM_CODEPOINTS)]
+
+  first_non_narrow = next(
+      codepoint for codepoint in range(NUM_CODEPOINTS)
+      if widths[codepoint] != NARROW)
+
+  # Two-stage table: |kCharacterWidthBlockIndices| maps each block of
+  # |BLOCK_SIZE| codepoints to one of the distinct blocks in
+  # |kCharacterWidthBlocks|.
+  blocks = []
+  block_numbers = {}
+  block_indices = []
+  for start in range(0, NUM_CODEPOINTS, BLOCK_SIZE):
+    block = tuple(widths[start:start + BLOCK_SIZE])
+    if block not in block_numbers:
+      block_numbers[block] = len(blocks)
+      blocks.append(block)
+    block_indices.append(block_numbers[block])
+  assert len(blocks) <= 256
+
+  out = sys.stdout
+  out.write('// Generated by make_character_width_tables.py (from Unicode %s);'
+            ' do not\n// edit.\n\n' % unicodedata.unidata_version)
+  out.write('#include "src/character_width.h"\n\n')
+  out.write('#include <stdint.h>\n\n')
+  out.write('namespace vtlib {\n')
+  out.write('namespace internal {\n\n')
+  out.write('static_assert(kFirstNonNarrowCodepoint == 0x%x,\n'
+            '              "Mismatched character width tables");\n'
+            % first_non_narrow)
+  out.write('static_assert(kCharacterWidthBlockShift == %d,\n'
+            '              "Mismatched character width tables");\n\n'
+            % BLOCK_SHIFT)
+  out.write('// %d blocks.\n' % len(block_indices))
+  out.write('const uint8_t kCharacterWidthBlockIndices[%d] = {\n'
+            % len(block_indices))
+  out.write(format_array(block_indices))
+  out.write('\n};\n\n')
+  out.write('// %d distinct blocks of %d.\n' % (len(blocks), BLOCK_SIZE))
+  out.write('const uint8_t kCharacterWidthBlocks[%d] = {\n'
+            % (len(blocks) * BLOCK_SIZE))
+  for i, block in enumerate(blocks):
+    out.write('    // %d\n' % i)
+    out.write(format_array(block))
+    out.write('\n')
+  out.write('};\n\n')
+  out.write('}  // namespace internal\n')
+  out.write('}  // namespace vtlib\n')
+
+
+if __name__ == '__main__':
+  main()
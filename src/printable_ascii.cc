@@ -0,0 +1,111 @@
+#include "src/printable_ascii.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VTLIB_HAVE_X86 1
+#endif
+
+namespace vtlib {
+namespace {
+
+using DecodeFunction = size_t (*)(const uint8_t*, size_t, Codepoint*);
+
+size_t DecodeScalar(const uint8_t* input_bytes,
+                    size_t num_input_bytes,
+                    Codepoint* output_codepoints) {
+  size_t i = 0u;
+  for (; i < num_input_bytes && IsPrintableAscii(input_bytes[i]); i++)
+    output_codepoints[i] = static_cast<Codepoint>(input_bytes[i]);
+  return i;
+}
+
+#if defined(VTLIB_HAVE_X86) && defined(__SSE2__)
+
+// Each iteration handles 16 bytes: a (signed) comparison against 31 classifies
+// them (bytes >= 128 are negative), and two rounds of unpacking with zero widen
+// them to 32 bits. All 16 codepoints are stored, even if the printable prefix
+// is shorter (which is why the output may be written past the returned
+// length).
+size_t DecodeSse2(const uint8_t* input_bytes,
+                  size_t num_input_bytes,
+                  Codepoint* output_codepoints) {
+  const __m128i threshold = _mm_set1_epi8(31);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0u;
+  for (; num_input_bytes - i >= 16u; i += 16u) {
+    __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input_bytes + i));
+    unsigned mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(v, threshold)));
+
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    __m128i* out = reinterpret_cast<__m128i*>(output_codepoints + i);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+
+    if (mask != 0xffffu)
+      return i + static_cast<size_t>(__builtin_ctz(~mask));
+  }
+  return i + DecodeScalar(input_bytes + i, num_input_bytes - i,
+                          output_codepoints + i);
+}
+
+#endif  // defined(VTLIB_HAVE_X86) && defined(__SSE2__)
+
+#if defined(VTLIB_HAVE_X86)
+
+// Like |DecodeSse2()|, but handles 32 bytes at a time.
+__attribute__((target("avx2"))) size_t DecodeAvx2(
+    const uint8_t* input_bytes,
+    size_t num_input_bytes,
+    Codepoint* output_codepoints) {
+  const __m256i threshold = _mm256_set1_epi8(31);
+  size_t i = 0u;
+  for (; num_input_bytes - i >= 32u; i += 32u) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input_bytes + i));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, threshold)));
+
+    __m128i lo = _mm256_castsi256_si128(v);
+    __m128i hi = _mm256_extracti128_si256(v, 1);
+    __m256i* out = reinterpret_cast<__m256i*>(output_codepoints + i);
+    _mm256_storeu_si256(out + 0, _mm256_cvtepu8_epi32(lo));
+    _mm256_storeu_si256(out + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+    _mm256_storeu_si256(out + 2, _mm256_cvtepu8_epi32(hi));
+    _mm256_storeu_si256(out + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+
+    if (mask != 0xffffffffu)
+      return i + static_cast<size_t>(__builtin_ctz(~mask));
+  }
+  return i + DecodeScalar(input_bytes + i, num_input_bytes - i,
+                          output_codepoints + i);
+}
+
+#endif  // defined(VTLIB_HAVE_X86)
+
+DecodeFunction GetDecodeFunction() {
+#if defined(VTLIB_HAVE_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return &DecodeAvx2;
+#if defined(__SSE2__)
+  return &DecodeSse2;
+#endif
+#endif
+  return &DecodeScalar;
+}
+
+}  // namespace
+
+size_t DecodePrintableAscii(const uint8_t* input_bytes,
+                            size_t num_input_bytes,
+                            Codepoint* output_codepoints) {
+  static const DecodeFunction decode_function = GetDecodeFunction();
+  return decode_function(input_bytes, num_input_bytes, output_codepoints);
+}
+
+}  // namespace vtlib
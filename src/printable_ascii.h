@@ -0,0 +1,34 @@
+#ifndef VTLIB_SRC_PRINTABLE_ASCII_H_
+#define VTLIB_SRC_PRINTABLE_ASCII_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+
+// Decodes the longest prefix of |input_bytes| (of which there are
+// |num_input_bytes|) consisting of printable (7-bit) ASCII, i.e., bytes in the
+// range 32..127, writing the corresponding codepoints to |output_codepoints|.
+// Returns the length of this prefix (i.e., the number of bytes consumed and the
+// number of codepoints written).
+//
+// |output_codepoints| must have room for |num_input_bytes| codepoints. Note
+// that the contents of |output_codepoints| past the returned length are
+// unspecified (this may write past it).
+//
+// This is vectorized (using SSE2 or AVX2, as determined at run time), when
+// possible.
+size_t DecodePrintableAscii(const uint8_t* input_bytes,
+                            size_t num_input_bytes,
+                            Codepoint* output_codepoints);
+
+// Returns true if |b| is printable (7-bit) ASCII (in the sense above).
+inline bool IsPrintableAscii(uint8_t b) {
+  return b >= 32u && b <= 127u;
+}
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_PRINTABLE_ASCII_H_
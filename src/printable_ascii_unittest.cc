@@ -0,0 +1,50 @@
+#include "src/printable_ascii.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace vtlib {
+namespace {
+
+TEST(PrintableAsciiTest, IsPrintableAscii) {
+  for (uint32_t b = 0u; b < 256u; b++) {
+    EXPECT_EQ(b >= 32u && b < 128u, IsPrintableAscii(static_cast<uint8_t>(b)))
+        << b;
+  }
+}
+
+// Tests all (reasonable) lengths, with a non-printable byte at each position
+// (and with no non-printable byte at all).
+TEST(PrintableAsciiTest, DecodePrintableAscii) {
+  const size_t kMaxLength = 100u;
+
+  std::vector<uint8_t> input(kMaxLength);
+  for (size_t i = 0u; i < kMaxLength; i++)
+    input[i] = static_cast<uint8_t>(32u + i % 96u);
+
+  // Some non-printable bytes (including bytes that are just outside the
+  // printable range).
+  const uint8_t kNonPrintable[] = {0x00u, 0x1bu, 0x1fu, 0x80u, 0x9bu, 0xffu};
+
+  for (size_t length = 0u; length <= kMaxLength; length++) {
+    for (size_t position = 0u; position <= length; position++) {
+      for (uint8_t b : kNonPrintable) {
+        std::vector<uint8_t> in(input.begin(), input.begin() + length);
+        if (position < length)
+          in[position] = b;
+
+        std::vector<Codepoint> out(length + 1u, 0xdeadbeefu);
+        size_t n = DecodePrintableAscii(in.data(), length, out.data());
+        ASSERT_EQ(position, n) << length << " " << position;
+        for (size_t i = 0u; i < n; i++)
+          EXPECT_EQ(static_cast<Codepoint>(in[i]), out[i]) << i;
+        // It must not write past |length|.
+        EXPECT_EQ(0xdeadbeefu, out[length]);
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace vtlib
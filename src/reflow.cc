@@ -0,0 +1,50 @@
+#include "src/reflow.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <algorithm>
+
+#include <vtlib/character.h>
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+
+void AppendRowToLine(const Cell* cells,
+                     ColumnNumber num_cells,
+                     bool wrapped,
+                     std::vector<Cell>* line) {
+  while (!wrapped && num_cells && cells[num_cells - 1u] == Cell())
+    num_cells--;
+  line->insert(line->end(), cells, cells + num_cells);
+}
+
+bool LayOutRow(const std::vector<Cell>& line,
+               size_t* offset,
+               ColumnNumber columns,
+               Cell* row) {
+  assert(columns > 0u);
+  const size_t begin = *offset;
+  assert(begin <= line.size());
+  size_t n = std::min(line.size() - begin, static_cast<size_t>(columns));
+  size_t end = begin + n;
+  // Don't split a wide character (i.e., separate it from its padding cell).
+  if (end < line.size() &&
+      line[end].character().codepoint() == CODEPOINT_WIDE_PADDING) {
+    if (n > 1u) {
+      n--;
+      end--;
+    } else {
+      n = 0u;
+      end++;
+    }
+  }
+
+  std::copy(line.begin() + static_cast<ptrdiff_t>(begin),
+            line.begin() + static_cast<ptrdiff_t>(begin + n), row);
+  std::fill(row + n, row + columns, Cell());
+  *offset = end;
+  return end < line.size();
+}
+
+}  // namespace vtlib
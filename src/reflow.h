@@ -0,0 +1,37 @@
+#ifndef VTLIB_SRC_REFLOW_H_
+#define VTLIB_SRC_REFLOW_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <vtlib/cell.h>
+#include <vtlib/coordinates.h>
+
+namespace vtlib {
+
+// Helpers for reflowing rows to a new width (i.e., when the terminal is
+// resized): the rows of each line (a row, and the rows that it was soft-wrapped
+// onto) are joined, and the line is then split into rows of the new width.
+
+// Appends the |num_cells| cells of a row to |*line|. If the row isn't wrapped
+// (i.e., it ends the line), its trailing empty cells (|Cell()|s) are dropped.
+void AppendRowToLine(const Cell* cells,
+                     ColumnNumber num_cells,
+                     bool wrapped,
+                     std::vector<Cell>* line);
+
+// Lays out the next row of |line|, starting at |*offset|, in |row| (which has
+// |columns| cells): as many cells as fit, padded with |Cell()|s. A wide
+// character that doesn't fit goes on the next row (or, if |columns| is 1, is
+// replaced by an empty cell). Advances |*offset| past the cells laid out, and
+// returns true if the line continues on the next row (i.e., |row| is wrapped).
+// An empty line is laid out as a single empty row.
+bool LayOutRow(const std::vector<Cell>& line,
+               size_t* offset,
+               ColumnNumber columns,
+               Cell* row);
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_REFLOW_H_
@@ -0,0 +1,85 @@
+#include "src/reflow.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/character.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/color.h>
+
+namespace vtlib {
+namespace {
+
+// Makes a row from |text|: each character is a cell, with ' ' being an empty
+// cell, 'W' a wide character, and '_' its padding.
+std::vector<Cell> MakeRow(const std::string& text) {
+  std::vector<Cell> row;
+  for (char c : text) {
+    Codepoint codepoint = c == ' '   ? 0u
+                          : c == 'W' ? 0x4e00u
+                          : c == '_' ? CODEPOINT_WIDE_PADDING
+                                     : static_cast<Codepoint>(c);
+    row.push_back(
+        Cell(Character(Character::Attribute::NONE, codepoint), Color(), Color()));
+  }
+  return row;
+}
+
+// Lays out all of |line| in rows of |columns| cells, returning them in the
+// form taken by |MakeRow()|, with wrapped rows followed by '+'.
+std::vector<std::string> LayOutLine(const std::vector<Cell>& line,
+                                    ColumnNumber columns) {
+  std::vector<std::string> rv;
+  std::vector<Cell> row(columns);
+  size_t offset = 0u;
+  bool wrapped;
+  do {
+    wrapped = LayOutRow(line, &offset, columns, row.data());
+    std::string text;
+    for (const Cell& cell : row) {
+      Codepoint codepoint = cell.character().codepoint();
+      text += !codepoint                          ? ' '
+              : codepoint == 0x4e00u              ? 'W'
+              : codepoint == CODEPOINT_WIDE_PADDING ? '_'
+                                                  : static_cast<char>(codepoint);
+    }
+    rv.push_back(wrapped ? text + "+" : text);
+  } while (wrapped);
+  return rv;
+}
+
+TEST(ReflowTest, AppendRowToLine) {
+  std::vector<Cell> line;
+  // Trailing empty cells are part of the line if the row is wrapped.
+  std::vector<Cell> row = MakeRow("ab  ");
+  AppendRowToLine(row.data(), 4u, true, &line);
+  EXPECT_EQ(4u, line.size());
+  AppendRowToLine(row.data(), 4u, false, &line);
+  EXPECT_EQ(MakeRow("ab  ab"), line);
+}
+
+TEST(ReflowTest, LayOutRow) {
+  EXPECT_EQ((std::vector<std::string>{"    "}), LayOutLine(MakeRow(""), 4u));
+  EXPECT_EQ((std::vector<std::string>{"abcd"}),
+            LayOutLine(MakeRow("abcd"), 4u));
+  EXPECT_EQ((std::vector<std::string>{"abcd+", "ef  "}),
+            LayOutLine(MakeRow("abcdef"), 4u));
+  EXPECT_EQ((std::vector<std::string>{"abcdef  "}),
+            LayOutLine(MakeRow("abcdef"), 8u));
+
+  // Wide characters aren't split.
+  EXPECT_EQ((std::vector<std::string>{"abc +", "W_d "}),
+            LayOutLine(MakeRow("abcW_d"), 4u));
+  EXPECT_EQ((std::vector<std::string>{"abW_+", "d   "}),
+            LayOutLine(MakeRow("abW_d"), 4u));
+  // ... unless there's only one column.
+  EXPECT_EQ((std::vector<std::string>{"a+", " +", "b"}),
+            LayOutLine(MakeRow("aW_b"), 1u));
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,562 @@
+#include "src/screen_buffer.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <algorithm>
+#include <type_traits>
+
+#include <vtlib/character.h>
+
+#include "src/compact_cell.h"
+#include "src/style_table.h"
+
+namespace vtlib {
+namespace {
+
+static_assert(std::is_trivially_copyable<Cell>::value,
+              "Cell must be trivially copyable");
+static_assert(std::is_trivially_copyable<CompactCell>::value,
+              "CompactCell must be trivially copyable");
+
+// Below this many cells, |FillCellArray()| just uses a simple loop.
+constexpr size_t kMinCellsForDoubling = 16u;
+
+// After a garbage collection (of unused styles), another one isn't done until
+// the number of cells in the codec's overflow table has grown by at least
+// 1/|kGarbageCollectionCostRatio| of the number of cells that were scanned.
+constexpr size_t kGarbageCollectionCostRatio = 16u;
+
+// Sets |cells[0..num_cells - 1]| to |cell|. The common case of filling with an
+// all-zero-bytes cell (e.g., |Cell()| or |CompactCell()|) is just a |memset()|.
+// Otherwise, for long runs, the filled prefix is repeatedly |memcpy()|-ed onto
+// the rest (doubling its length each time).
+template <typename T>
+void FillCellArray(T* cells, size_t num_cells, const T& cell) {
+  static const char kZeros[sizeof(T)] = {};
+  if (!memcmp(&cell, kZeros, sizeof(T))) {
+    memset(static_cast<void*>(cells), 0, num_cells * sizeof(T));
+    return;
+  }
+
+  if (num_cells < kMinCellsForDoubling) {
+    for (size_t i = 0u; i < num_cells; i++)
+      cells[i] = cell;
+    return;
+  }
+
+  for (size_t i = 0u; i < kMinCellsForDoubling; i++)
+    cells[i] = cell;
+  size_t num_filled = kMinCellsForDoubling;
+  while (num_filled < num_cells) {
+    size_t n = std::min(num_filled, num_cells - num_filled);
+    memcpy(static_cast<void*>(cells + num_filled), cells, n * sizeof(T));
+    num_filled += n;
+  }
+}
+
+// A "codec" converts between |Cell|s and the cells actually stored by a
+// |ScreenBufferImpl| (of type |StoredCell|).
+
+// For |Terminal::CellStorage::FULL|: |Cell|s are stored as is.
+class FullCellCodec {
+ public:
+  using StoredCell = Cell;
+
+  explicit FullCellCodec(ColumnNumber columns) {}
+  ~FullCellCodec() = default;
+
+  // Encodes |cell|, returning false if that isn't possible (never, here).
+  bool Encode(const Cell& cell, StoredCell* stored_cell) {
+    *stored_cell = cell;
+    return true;
+  }
+  // Encodes |cell| as well as possible; used if |Encode()| fails even after
+  // garbage collection.
+  StoredCell EncodeFallback(const Cell& cell) { return cell; }
+
+  // Sets |stored_cells[0..num_codepoints - 1]| to |codepoints| with the style of
+  // |style| (an encoded cell).
+  void EncodeRun(const Codepoint* codepoints,
+                 size_t num_codepoints,
+                 const StoredCell& style,
+                 StoredCell* stored_cells) {
+    const Character::Attribute attribute = style.character().attribute();
+    const Color fg = style.fg();
+    const Color bg = style.bg();
+    for (size_t i = 0u; i < num_codepoints; i++)
+      stored_cells[i] = Cell(Character(attribute, codepoints[i]), fg, bg);
+  }
+
+  // Decodes a row of |columns| cells, returning a pointer to the decoded cells
+  // (valid until the next call).
+  const Cell* DecodeRow(const StoredCell* stored_cells,
+                        ColumnNumber columns) const {
+    return stored_cells;
+  }
+  // Decodes just the codepoint of a stored cell.
+  Codepoint DecodeCodepoint(const StoredCell& stored_cell) const {
+    return stored_cell.character().codepoint();
+  }
+
+  // Garbage collection of unused styles (not needed here).
+  void BeginGarbageCollection() {}
+  void Mark(const StoredCell& stored_cell) {}
+  void EndGarbageCollection() {}
+  // The number of cells that |EncodeFallback()| stored in an overflow table.
+  size_t num_overflow_cells() const { return 0u; }
+
+  // Returns the number of bytes of memory used (other than for stored cells).
+  size_t GetMemoryUsage() const { return 0u; }
+};
+
+// For |Terminal::CellStorage::COMPACT|: cells are stored as |CompactCell|s, with
+// their styles interned in a |StyleTable|. If more than |StyleTable::kMaxStyles|
+// styles are in use at once (which takes a pathological mix of colors and
+// attributes), the cells whose styles don't fit are stored in full in an
+// overflow table, which is garbage collected along with the styles.
+class CompactCellCodec {
+ public:
+  using StoredCell = CompactCell;
+
+  explicit CompactCellCodec(ColumnNumber columns)
+      : columns_(columns), row_buffer_(new Cell[columns]) {}
+  ~CompactCellCodec() = default;
+
+  bool Encode(const Cell& cell, StoredCell* stored_cell) {
+    uint32_t style_index;
+    if (!InternStyle(cell, &style_index))
+      return false;
+    *stored_cell = CompactCell(cell.character().codepoint(), style_index);
+    return true;
+  }
+  // Stores |cell| in the overflow table. (Only if that's full too, with
+  // |CompactCell::kMaxCodepoint + 1| cells, does the cell get the default
+  // style.)
+  StoredCell EncodeFallback(const Cell& cell) {
+    uint32_t overflow_index;
+    if (!overflow_free_list_.empty()) {
+      overflow_index = overflow_free_list_.back();
+      overflow_free_list_.pop_back();
+      overflow_cells_[overflow_index] = cell;
+    } else if (overflow_cells_.size() <= CompactCell::kMaxCodepoint) {
+      overflow_index = static_cast<uint32_t>(overflow_cells_.size());
+      overflow_cells_.push_back(cell);
+    } else {
+      return CompactCell(cell.character().codepoint(), 0u);
+    }
+    return CompactCell(overflow_index, CompactCell::kOverflowStyleIndex);
+  }
+
+  void EncodeRun(const Codepoint* codepoints,
+                 size_t num_codepoints,
+                 const StoredCell& style,
+                 StoredCell* stored_cells) {
+    const uint32_t style_index = style.style_index();
+    if (style_index == CompactCell::kOverflowStyleIndex) {
+      // Each cell gets its own entry in the overflow table. (This copies the
+      // style, since adding entries may reallocate the table.)
+      const Cell overflow_style = overflow_cells_[style.codepoint()];
+      const Character::Attribute attribute =
+          overflow_style.character().attribute();
+      for (size_t i = 0u; i < num_codepoints; i++) {
+        stored_cells[i] =
+            EncodeFallback(Cell(Character(attribute, codepoints[i]),
+                                overflow_style.fg(), overflow_style.bg()));
+      }
+      return;
+    }
+    for (size_t i = 0u; i < num_codepoints; i++)
+      stored_cells[i] = CompactCell(codepoints[i], style_index);
+  }
+
+  const Cell* DecodeRow(const StoredCell* stored_cells,
+                        ColumnNumber columns) const {
+    assert(columns == columns_);
+    for (ColumnNumber i = 0u; i < columns; i++) {
+      const uint32_t style_index = stored_cells[i].style_index();
+      if (style_index == CompactCell::kOverflowStyleIndex) {
+        row_buffer_[i] = overflow_cells_[stored_cells[i].codepoint()];
+        continue;
+      }
+      const Cell& style = style_table_.Get(style_index);
+      row_buffer_[i] = Cell(
+          Character(style.character().attribute(), stored_cells[i].codepoint()),
+          style.fg(), style.bg());
+    }
+    return row_buffer_.get();
+  }
+  Codepoint DecodeCodepoint(const StoredCell& stored_cell) const {
+    if (stored_cell.style_index() == CompactCell::kOverflowStyleIndex)
+      return overflow_cells_[stored_cell.codepoint()].character().codepoint();
+    return stored_cell.codepoint();
+  }
+
+  void BeginGarbageCollection() {
+    style_table_.BeginGarbageCollection();
+    overflow_marks_.assign(overflow_cells_.size(), false);
+    // The last style may be reclaimed.
+    have_last_style_ = false;
+  }
+  void Mark(const StoredCell& stored_cell) {
+    if (stored_cell.style_index() == CompactCell::kOverflowStyleIndex)
+      overflow_marks_[stored_cell.codepoint()] = true;
+    else
+      style_table_.Mark(stored_cell.style_index());
+  }
+  void EndGarbageCollection() {
+    style_table_.EndGarbageCollection();
+    // Drop the unused entries at the end of the overflow table, and add the
+    // others to the free list (in decreasing order, so that lower indices get
+    // reused first).
+    size_t size = overflow_cells_.size();
+    while (size && !overflow_marks_[size - 1u])
+      size--;
+    overflow_cells_.resize(size);
+    overflow_free_list_.clear();
+    for (size_t i = size; i-- > 0u;) {
+      if (!overflow_marks_[i])
+        overflow_free_list_.push_back(static_cast<uint32_t>(i));
+    }
+    overflow_marks_.clear();
+  }
+  size_t num_overflow_cells() const {
+    return overflow_cells_.size() - overflow_free_list_.size();
+  }
+
+  size_t GetMemoryUsage() const {
+    return style_table_.GetMemoryUsage() + columns_ * sizeof(Cell) +
+           overflow_cells_.capacity() * sizeof(Cell) +
+           overflow_free_list_.capacity() * sizeof(uint32_t);
+  }
+
+ private:
+  // Like |StyleTable::Intern()|, but first checks the last style interned
+  // (since consecutive writes usually have the same style).
+  bool InternStyle(const Cell& cell, uint32_t* style_index) {
+    if (have_last_style_ &&
+        cell.character().attribute() == last_style_.character().attribute() &&
+        cell.fg() == last_style_.fg() && cell.bg() == last_style_.bg()) {
+      *style_index = last_style_index_;
+      return true;
+    }
+    if (!style_table_.Intern(cell, style_index))
+      return false;
+    have_last_style_ = true;
+    last_style_ = cell;
+    last_style_index_ = *style_index;
+    return true;
+  }
+
+  const ColumnNumber columns_;
+  StyleTable style_table_;
+  bool have_last_style_ = false;
+  Cell last_style_;
+  uint32_t last_style_index_ = 0u;
+  // Cells stored by |EncodeFallback()| (as |CompactCell|s with style
+  // |CompactCell::kOverflowStyleIndex| and "codepoint" the index in
+  // |overflow_cells_|). Free entries are in |overflow_free_list_|.
+  std::vector<Cell> overflow_cells_;
+  std::vector<uint32_t> overflow_free_list_;
+  // Used for garbage collection (indexed like |overflow_cells_|).
+  std::vector<bool> overflow_marks_;
+  // |DecodeRow()| decodes to this.
+  std::unique_ptr<Cell[]> row_buffer_;
+};
+
+template <typename Codec>
+class ScreenBufferImpl : public ScreenBuffer {
+ public:
+  using StoredCell = typename Codec::StoredCell;
+
+  ScreenBufferImpl(uint32_t rows,
+                   ColumnNumber columns,
+                   uint32_t scrollback_capacity)
+      : ScreenBuffer(rows, columns, scrollback_capacity),
+        codec_(columns),
+        cells_(new StoredCell[static_cast<size_t>(rows) * columns]) {}
+  ~ScreenBufferImpl() override = default;
+
+  // |ScreenBuffer| implementation:
+  const Cell* GetRow(RowNumber row) const override {
+    return codec_.DecodeRow(GetStoredRow(row), columns());
+  }
+  Codepoint GetCodepoint(RowNumber row, ColumnNumber column) const override {
+    assert(column < columns());
+    return codec_.DecodeCodepoint(GetStoredRow(row)[column]);
+  }
+  void WriteCells(RowNumber row,
+                  ColumnNumber column,
+                  const Codepoint* codepoints,
+                  ColumnNumber num_codepoints,
+                  const Cell& style) override {
+    assert(column <= columns() && num_codepoints <= columns() - column);
+    StoredCell stored_style = Encode(style);
+    codec_.EncodeRun(codepoints, num_codepoints, stored_style,
+                     GetStoredRow(row) + column);
+  }
+  void SetCells(RowNumber row,
+                ColumnNumber column,
+                const Cell* cells,
+                ColumnNumber num_cells) override {
+    assert(column <= columns() && num_cells <= columns() - column);
+    StoredCell* stored_cells = GetStoredRow(row) + column;
+    for (ColumnNumber i = 0u; i < num_cells; i++)
+      stored_cells[i] = Encode(cells[i]);
+  }
+  void FillCells(RowNumber row,
+                 ColumnNumber left,
+                 ColumnNumber right,
+                 const Cell& cell) override {
+    assert(left <= right);
+    assert(right <= columns());
+    FillCellArray(GetStoredRow(row) + left, right - left, Encode(cell));
+  }
+  void FillRows(RowNumber top, RowNumber bottom, const Cell& cell) override {
+    assert(top <= bottom);
+    if (top == bottom)
+      return;
+    assert(IsValidRow(top));
+    assert(IsValidRow(bottom - 1u));
+    for (RowNumber row = top; row < bottom; row++)
+      SetRowWrapped(row, false);
+    // Rows with consecutive storage indices (usually all of them) are filled
+    // in one go.
+    const StoredCell stored_cell = Encode(cell);
+    for (RowNumber row = top; row < bottom;) {
+      const size_t index = GetStorageIndex(row);
+      size_t num_rows = 1u;
+      while (row + num_rows < bottom &&
+             GetStorageIndex(row + num_rows) == index + num_rows)
+        num_rows++;
+      FillCellArray(cells_.get() + index * columns(), num_rows * columns(),
+                    stored_cell);
+      row += num_rows;
+    }
+  }
+  void MoveCells(RowNumber row,
+                 ColumnNumber src,
+                 ColumnNumber dst,
+                 ColumnNumber count) override {
+    assert(src <= columns() && count <= columns() - src);
+    assert(dst <= columns() && count <= columns() - dst);
+    StoredCell* cells = GetStoredRow(row);
+    memmove(static_cast<void*>(cells + dst), cells + src,
+            count * sizeof(StoredCell));
+  }
+  void CopyRow(RowNumber src, RowNumber dst) override {
+    if (src != dst) {
+      memcpy(static_cast<void*>(GetStoredRow(dst)), GetStoredRow(src),
+             columns() * sizeof(StoredCell));
+      SetRowWrapped(dst, IsRowWrapped(src));
+    }
+  }
+  size_t cell_size() const override { return sizeof(StoredCell); }
+  uint64_t num_garbage_collections() const override {
+    return num_garbage_collections_;
+  }
+  size_t GetMemoryUsage() const override {
+    return num_slots() * columns() * sizeof(StoredCell) +
+           slot_storage_indices_size() + codec_.GetMemoryUsage();
+  }
+
+ protected:
+  void ReallocateSlots(size_t new_num_slots) override {
+    std::unique_ptr<StoredCell[]> new_cells(
+        new StoredCell[new_num_slots * columns()]);
+    // Copy the rows in use, in order, to the start of the new storage.
+    StoredCell* new_row = new_cells.get();
+    for (RowNumber row = scrollback_top(); row < first_row() + rows(); row++) {
+      memcpy(static_cast<void*>(new_row), GetStoredRow(row),
+             columns() * sizeof(StoredCell));
+      new_row += columns();
+    }
+    cells_ = std::move(new_cells);
+  }
+
+ private:
+  StoredCell* GetStoredRow(RowNumber row) {
+    return cells_.get() + GetStorageIndex(row) * columns();
+  }
+  const StoredCell* GetStoredRow(RowNumber row) const {
+    return cells_.get() + GetStorageIndex(row) * columns();
+  }
+
+  // Encodes |cell|, garbage collecting if necessary. (Garbage collection only
+  // changes the codec's state, not the stored cells.) Garbage collection scans
+  // every row, so it's rate limited (see |kGarbageCollectionCostRatio|):
+  // otherwise, if the styles in use don't fit, every write with a new style
+  // would scan every row (only for the cell to go in the overflow table
+  // anyway).
+  StoredCell Encode(const Cell& cell) {
+    StoredCell stored_cell;
+    if (codec_.Encode(cell, &stored_cell))
+      return stored_cell;
+    if (codec_.num_overflow_cells() >= next_gc_num_overflow_cells_) {
+      CollectGarbage();
+      if (codec_.Encode(cell, &stored_cell))
+        return stored_cell;
+    }
+    return codec_.EncodeFallback(cell);
+  }
+
+  void CollectGarbage() {
+    codec_.BeginGarbageCollection();
+    for (RowNumber row = scrollback_top(); row < first_row() + rows(); row++) {
+      const StoredCell* cells = GetStoredRow(row);
+      for (ColumnNumber i = 0u; i < columns(); i++)
+        codec_.Mark(cells[i]);
+    }
+    codec_.EndGarbageCollection();
+    num_garbage_collections_++;
+    next_gc_num_overflow_cells_ =
+        codec_.num_overflow_cells() +
+        num_rows_in_use() * columns() / kGarbageCollectionCostRatio;
+  }
+
+  Codec codec_;
+  std::unique_ptr<StoredCell[]> cells_;
+  uint64_t num_garbage_collections_ = 0u;
+  // Garbage collection isn't done until |codec_.num_overflow_cells()| reaches
+  // this.
+  size_t next_gc_num_overflow_cells_ = 0u;
+};
+
+}  // namespace
+
+// static
+std::unique_ptr<ScreenBuffer> ScreenBuffer::Create(
+    uint32_t rows,
+    ColumnNumber columns,
+    uint32_t scrollback_capacity,
+    Terminal::CellStorage cell_storage) {
+  switch (cell_storage) {
+    case Terminal::CellStorage::FULL:
+      // TODO(C++14): Here and below, no make_unique in C++11. :(
+      return std::unique_ptr<ScreenBuffer>(new ScreenBufferImpl<FullCellCodec>(
+          rows, columns, scrollback_capacity));
+    case Terminal::CellStorage::COMPACT:
+      return std::unique_ptr<ScreenBuffer>(
+          new ScreenBufferImpl<CompactCellCodec>(rows, columns,
+                                                 scrollback_capacity));
+  }
+  assert(false);
+  return nullptr;
+}
+
+constexpr uint32_t ScreenBuffer::kWrappedFlag;
+
+ScreenBuffer::~ScreenBuffer() = default;
+
+void ScreenBuffer::ShiftRowsUp(RowNumber top,
+                               RowNumber bottom,
+                               uint32_t count,
+                               const Cell& cell) {
+  assert(top <= bottom);
+  if (top == bottom || !count)
+    return;
+  assert(IsViewportRow(top));
+  assert(IsViewportRow(bottom - 1u));
+  RowNumber num_rows = bottom - top;
+  if (count > num_rows)
+    count = static_cast<uint32_t>(num_rows);
+  RotateRows(top, bottom, count);
+  FillRows(bottom - count, bottom, cell);
+}
+
+void ScreenBuffer::ShiftRowsDown(RowNumber top,
+                                 RowNumber bottom,
+                                 uint32_t count,
+                                 const Cell& cell) {
+  assert(top <= bottom);
+  if (top == bottom || !count)
+    return;
+  assert(IsViewportRow(top));
+  assert(IsViewportRow(bottom - 1u));
+  RowNumber num_rows = bottom - top;
+  if (count > num_rows)
+    count = static_cast<uint32_t>(num_rows);
+  RotateRows(top, bottom, static_cast<uint32_t>(num_rows - count));
+  FillRows(top, top + count, cell);
+}
+
+void ScreenBuffer::ScrollUp(uint32_t count, const Cell& cell) {
+  if (!count)
+    return;
+
+  RowNumber old_top = scrollback_top();
+  RowNumber old_bottom = first_row_ + rows_;
+  uint32_t new_num_scrollback_rows = static_cast<uint32_t>(
+      std::min(static_cast<uint64_t>(num_scrollback_rows_) + count,
+               static_cast<uint64_t>(scrollback_capacity_)));
+  MaybeGrow(static_cast<size_t>(new_num_scrollback_rows) + rows_);
+
+  // Rotate the ring (slot assignments are consistent modulo |num_slots_|).
+  first_row_ += count;
+  num_scrollback_rows_ = new_num_scrollback_rows;
+  top_slot_ = (top_slot_ +
+               static_cast<size_t>((scrollback_top() - old_top) % num_slots_)) %
+              num_slots_;
+
+  // Clear the rows that are new (i.e., were beyond the bottom of the viewport),
+  // whether they're in the viewport or (if |count| is large) the scrollback.
+  FillRows(std::max(old_bottom, scrollback_top()), first_row_ + rows_, cell);
+}
+
+void ScreenBuffer::ClearScrollback() {
+  top_slot_ = GetSlot(first_row_);
+  num_scrollback_rows_ = 0u;
+}
+
+ScreenBuffer::ScreenBuffer(uint32_t rows,
+                           ColumnNumber columns,
+                           uint32_t scrollback_capacity)
+    : rows_(rows),
+      columns_(columns),
+      scrollback_capacity_(scrollback_capacity),
+      num_slots_(rows),
+      slot_storage_indices_(rows) {
+  assert(rows_ > 0u);
+  assert(columns_ > 0u);
+  for (size_t i = 0u; i < num_slots_; i++)
+    slot_storage_indices_[i] = static_cast<uint32_t>(i);
+}
+
+void ScreenBuffer::MaybeGrow(size_t num_rows_needed) {
+  if (num_rows_needed <= num_slots_)
+    return;
+
+  size_t max_num_slots = static_cast<size_t>(rows_) + scrollback_capacity_;
+  size_t new_num_slots =
+      std::min(std::max(num_slots_ * 2u, num_rows_needed), max_num_slots);
+  assert(new_num_slots <= kWrappedFlag);
+  ReallocateSlots(new_num_slots);
+  // The rows in use are now in order at the start of the storage (and keep
+  // their wrapped flags).
+  std::vector<uint32_t> slot_storage_indices(new_num_slots);
+  for (size_t i = 0u; i < new_num_slots; i++) {
+    slot_storage_indices[i] = static_cast<uint32_t>(i);
+    if (i < num_rows_in_use() && IsRowWrapped(scrollback_top() + i))
+      slot_storage_indices[i] |= kWrappedFlag;
+  }
+  num_slots_ = new_num_slots;
+  top_slot_ = 0u;
+  slot_storage_indices_.swap(slot_storage_indices);
+}
+
+void ScreenBuffer::RotateRows(RowNumber top, RowNumber bottom, uint32_t count) {
+  // Rotate by reversing the two parts and then the whole (the rows' slots may
+  // wrap around the end of the ring, so this works on rows rather than on
+  // slots).
+  auto reverse = [this](RowNumber begin, RowNumber end) {
+    while (begin + 1u < end)
+      SwapRows(begin++, --end);
+  };
+  if (!count || count == bottom - top)
+    return;
+  reverse(top, top + count);
+  reverse(top + count, bottom);
+  reverse(top, bottom);
+}
+
+}  // namespace vtlib
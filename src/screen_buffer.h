@@ -0,0 +1,233 @@
+#ifndef VTLIB_SRC_SCREEN_BUFFER_H_
+#define VTLIB_SRC_SCREEN_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <vtlib/cell.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/coordinates.h>
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+
+// Storage for the cells of the viewport and the scrollback (the rows that have
+// scrolled off the top of the viewport). Each row is |columns()| cells, stored
+// contiguously (so that printing into a row and scanning a row left to right
+// both touch consecutive memory). How cells are represented depends on the
+// implementation (see |Terminal::CellStorage|).
+//
+// Rows are addressed by |RowNumber|: the viewport consists of rows
+// |first_row()| to |first_row() + rows() - 1|, and the scrollback of rows
+// |scrollback_top()| to |first_row() - 1|. Row access is O(1).
+//
+// The rows live in a ring of row "slots". |ScrollUp()| just advances the ring
+// (the top rows of the viewport become scrollback rows without being copied),
+// and once the scrollback is at capacity, the oldest scrollback rows' slots are
+// reused for the new rows at the bottom of the viewport. The ring is grown (by
+// doubling, up to the maximum) as the scrollback fills, so memory use is
+// proportional to the scrollback actually used.
+//
+// Each slot refers to a row of cell storage (all in one allocation) by index.
+// So shifting the rows of part of the viewport (e.g., scrolling within a
+// scrolling region) just rotates the slots' indices, without copying cells.
+// Each row also has a "wrapped" flag (kept with its index, so it moves along
+// with the row), which is set if the row was soft-wrapped, i.e., its line
+// continues on the next row.
+//
+// Bulk operations work on whole runs of cells (with |memmove()|/|memset()| when
+// possible), rather than cell by cell.
+class ScreenBuffer {
+ public:
+  // Creates a buffer with the given geometry (|rows| and |columns| must be
+  // nonzero) and maximum number of scrollback rows. All cells in the viewport
+  // are set to |Cell()|, and the scrollback is empty. The first row has row
+  // number 0.
+  static std::unique_ptr<ScreenBuffer> Create(
+      uint32_t rows,
+      ColumnNumber columns,
+      uint32_t scrollback_capacity,
+      Terminal::CellStorage cell_storage);
+
+  virtual ~ScreenBuffer();
+
+  ScreenBuffer(const ScreenBuffer&) = delete;
+  ScreenBuffer& operator=(const ScreenBuffer&) = delete;
+
+  uint32_t rows() const { return rows_; }
+  ColumnNumber columns() const { return columns_; }
+  uint32_t scrollback_capacity() const { return scrollback_capacity_; }
+  RowNumber first_row() const { return first_row_; }
+  RowNumber scrollback_top() const {
+    return first_row_ - num_scrollback_rows_;
+  }
+  uint32_t num_scrollback_rows() const { return num_scrollback_rows_; }
+  // Renumbers the rows so that the viewport starts at row |first_row| (without
+  // changing any cells).
+  void set_first_row(RowNumber first_row) { first_row_ = first_row; }
+
+  // Returns true if |row| is in the viewport or the scrollback.
+  bool IsValidRow(RowNumber row) const {
+    return row >= scrollback_top() &&
+           row - scrollback_top() < num_scrollback_rows_ + rows_;
+  }
+  bool IsViewportRow(RowNumber row) const {
+    return row >= first_row_ && row - first_row_ < rows_;
+  }
+
+  // Returns the |columns()| cells of |row| (which must be valid). The pointer
+  // is valid until the next call to |GetRow()| or to any non-const method.
+  virtual const Cell* GetRow(RowNumber row) const = 0;
+  // Returns the codepoint of the cell at |column| of |row| (which must be
+  // valid). Unlike |GetRow()|, this doesn't decode the whole row.
+  virtual Codepoint GetCodepoint(RowNumber row, ColumnNumber column) const = 0;
+
+  // Sets the |num_codepoints| cells of |row| starting at |column| to the given
+  // codepoints, with the attributes and colors of |style| (whose codepoint is
+  // ignored).
+  virtual void WriteCells(RowNumber row,
+                          ColumnNumber column,
+                          const Codepoint* codepoints,
+                          ColumnNumber num_codepoints,
+                          const Cell& style) = 0;
+  // Sets the |num_cells| cells of |row| starting at |column| to |cells|.
+  virtual void SetCells(RowNumber row,
+                        ColumnNumber column,
+                        const Cell* cells,
+                        ColumnNumber num_cells) = 0;
+
+  // Sets the cells in columns |left| to |right - 1| of |row| to |cell|.
+  virtual void FillCells(RowNumber row,
+                         ColumnNumber left,
+                         ColumnNumber right,
+                         const Cell& cell) = 0;
+  // Sets all the cells in rows |top| to |bottom - 1| to |cell|, and clears
+  // their wrapped flags.
+  virtual void FillRows(RowNumber top, RowNumber bottom, const Cell& cell) = 0;
+
+  // Moves |count| cells within |row| from column |src| to column |dst| (the
+  // ranges may overlap). The source cells are left unchanged, except where
+  // overwritten.
+  virtual void MoveCells(RowNumber row,
+                         ColumnNumber src,
+                         ColumnNumber dst,
+                         ColumnNumber count) = 0;
+  // Copies the contents (and wrapped flag) of row |src| to row |dst|.
+  virtual void CopyRow(RowNumber src, RowNumber dst) = 0;
+
+  // Returns whether |row| (which must be valid) is wrapped.
+  bool IsRowWrapped(RowNumber row) const {
+    return slot_storage_indices_[GetSlot(row)] & kWrappedFlag;
+  }
+  void SetRowWrapped(RowNumber row, bool wrapped) {
+    uint32_t& entry = slot_storage_indices_[GetSlot(row)];
+    entry = wrapped ? (entry | kWrappedFlag) : (entry & ~kWrappedFlag);
+  }
+
+  // Shifts the contents of (viewport) rows |top| to |bottom - 1| up
+  // (respectively, down) by |count| rows: the top (respectively, bottom)
+  // |count| rows of the range are discarded, and the rows vacated at the other
+  // end are filled with |cell|. Rows outside the range are not affected. This
+  // moves O(bottom - top) row indices, but only writes the cells of the
+  // vacated rows.
+  void ShiftRowsUp(RowNumber top,
+                   RowNumber bottom,
+                   uint32_t count,
+                   const Cell& cell);
+  void ShiftRowsDown(RowNumber top,
+                     RowNumber bottom,
+                     uint32_t count,
+                     const Cell& cell);
+
+  // Scrolls the whole viewport up by |count| rows: the top |count| rows of the
+  // viewport move to the scrollback (discarding the oldest scrollback rows if
+  // it's full), |first_row()| increases by |count|, and the new rows at the
+  // bottom are filled with |cell|. This takes time proportional to |count|
+  // (and not to the size of the viewport or the scrollback).
+  void ScrollUp(uint32_t count, const Cell& cell);
+  // Discards the scrollback (the viewport keeps its row numbers). The slots of
+  // the discarded rows are reused as the viewport scrolls.
+  void ClearScrollback();
+
+  // Returns the number of bytes used to store each cell.
+  virtual size_t cell_size() const = 0;
+  // Returns the number of times that unused styles have been garbage collected
+  // (only ever nonzero for |Terminal::CellStorage::COMPACT|).
+  virtual uint64_t num_garbage_collections() const = 0;
+  // Returns the number of bytes of memory used for cells (for the viewport and
+  // the scrollback together, plus any auxiliary tables).
+  virtual size_t GetMemoryUsage() const = 0;
+
+ protected:
+  // Set in a slot's entry in |slot_storage_indices_| if its row is wrapped.
+  static constexpr uint32_t kWrappedFlag = 0x80000000u;
+
+  ScreenBuffer(uint32_t rows,
+               ColumnNumber columns,
+               uint32_t scrollback_capacity);
+
+  size_t num_slots() const { return num_slots_; }
+  size_t top_slot() const { return top_slot_; }
+  // The number of rows (of viewport and scrollback) in the ring.
+  size_t num_rows_in_use() const {
+    return static_cast<size_t>(num_scrollback_rows_) + rows_;
+  }
+
+  // Returns the slot (index in the ring) for |row| (which must be valid).
+  size_t GetSlot(RowNumber row) const {
+    size_t slot = top_slot_ + static_cast<size_t>(row - scrollback_top());
+    return slot >= num_slots_ ? slot - num_slots_ : slot;
+  }
+  // Returns the index of the row of cell storage for |row| (which must be
+  // valid).
+  size_t GetStorageIndex(RowNumber row) const {
+    return slot_storage_indices_[GetSlot(row)] & ~kWrappedFlag;
+  }
+  size_t slot_storage_indices_size() const {
+    return slot_storage_indices_.capacity() * sizeof(uint32_t);
+  }
+
+  // Reallocates the cell storage to have room for |new_num_slots| rows, moving
+  // the rows in use (in order) to the storage indices starting at 0.
+  virtual void ReallocateSlots(size_t new_num_slots) = 0;
+
+ private:
+  // Rotates the storage indices of rows |top| to |bottom - 1| so that row
+  // |top + count| (modulo the range) is moved to |top|.
+  void RotateRows(RowNumber top, RowNumber bottom, uint32_t count);
+  // Swaps the storage indices of rows |a| and |b|.
+  void SwapRows(RowNumber a, RowNumber b) {
+    std::swap(slot_storage_indices_[GetSlot(a)],
+              slot_storage_indices_[GetSlot(b)]);
+  }
+
+  // Grows the ring (if possible) so that it has room for at least
+  // |num_rows_needed| rows (of viewport and scrollback).
+  void MaybeGrow(size_t num_rows_needed);
+
+  const uint32_t rows_;
+  const ColumnNumber columns_;
+  const uint32_t scrollback_capacity_;
+
+  RowNumber first_row_ = 0u;
+  uint32_t num_scrollback_rows_ = 0u;
+
+  // The ring has |num_slots_| row slots (each of |columns_| cells). The oldest
+  // scrollback row (or the first viewport row, if the scrollback is empty) is
+  // in slot |top_slot_|, and the following rows are in consecutive slots
+  // (modulo |num_slots_|).
+  size_t num_slots_;
+  size_t top_slot_ = 0u;
+  // The storage index for each slot (initially, and after the ring is grown,
+  // slot i uses storage index i), ORed with |kWrappedFlag| if the slot's row is
+  // wrapped.
+  std::vector<uint32_t> slot_storage_indices_;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_SCREEN_BUFFER_H_
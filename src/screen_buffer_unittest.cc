@@ -0,0 +1,486 @@
+#include "src/screen_buffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/character.h>
+#include <vtlib/color.h>
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+namespace {
+
+Cell MakeCell(uint32_t codepoint) {
+  return Cell(Character(Character::Attribute::BOLD, codepoint),
+              Color(Color::Type::ANSI_16, 1u), Color(Color::Type::RGB, 0x123456u));
+}
+
+// Sets each cell in |row| to |MakeCell(base + column)|.
+void SetRow(ScreenBuffer* buffer, RowNumber row, uint32_t base) {
+  std::vector<Cell> cells;
+  for (ColumnNumber i = 0u; i < buffer->columns(); i++)
+    cells.push_back(MakeCell(base + i));
+  buffer->SetCells(row, 0u, cells.data(), buffer->columns());
+}
+
+// Checks that each cell in |row| is |MakeCell(base + column)|.
+void CheckRow(const ScreenBuffer& buffer, RowNumber row, uint32_t base) {
+  const Cell* cells = buffer.GetRow(row);
+  for (ColumnNumber i = 0u; i < buffer.columns(); i++)
+    EXPECT_EQ(MakeCell(base + i), cells[i]) << "row " << row << ", column " << i;
+}
+
+void CheckRowIsBlank(const ScreenBuffer& buffer, RowNumber row) {
+  const Cell* cells = buffer.GetRow(row);
+  for (ColumnNumber i = 0u; i < buffer.columns(); i++)
+    EXPECT_EQ(Cell(), cells[i]) << "row " << row << ", column " << i;
+}
+
+// The tests are run for each |Terminal::CellStorage|.
+class ScreenBufferTest : public testing::TestWithParam<Terminal::CellStorage> {
+ protected:
+  std::unique_ptr<ScreenBuffer> Create(uint32_t rows,
+                                       ColumnNumber columns,
+                                       uint32_t scrollback_capacity) {
+    return ScreenBuffer::Create(rows, columns, scrollback_capacity, GetParam());
+  }
+};
+
+TEST_P(ScreenBufferTest, Basic) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(3u, 5u, 0u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  EXPECT_EQ(3u, buffer.rows());
+  EXPECT_EQ(5u, buffer.columns());
+  EXPECT_EQ(0u, buffer.scrollback_capacity());
+  EXPECT_EQ(0u, buffer.first_row());
+  EXPECT_EQ(0u, buffer.scrollback_top());
+  EXPECT_TRUE(buffer.IsValidRow(0u));
+  EXPECT_TRUE(buffer.IsValidRow(2u));
+  EXPECT_FALSE(buffer.IsValidRow(3u));
+  for (RowNumber row = 0u; row < 3u; row++)
+    CheckRowIsBlank(buffer, row);
+
+  SetRow(&buffer, 1u, 100u);
+  CheckRowIsBlank(buffer, 0u);
+  CheckRow(buffer, 1u, 100u);
+  CheckRowIsBlank(buffer, 2u);
+}
+
+TEST_P(ScreenBufferTest, Fill) {
+  // Use enough columns to exercise the doubling fill.
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(4u, 100u, 0u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  buffer.FillCells(1u, 10u, 90u, MakeCell('x'));
+  const Cell* cells = buffer.GetRow(1u);
+  for (ColumnNumber i = 0u; i < 100u; i++)
+    EXPECT_EQ((i >= 10u && i < 90u) ? MakeCell('x') : Cell(), cells[i]) << i;
+  CheckRowIsBlank(buffer, 0u);
+  CheckRowIsBlank(buffer, 2u);
+
+  buffer.FillCells(1u, 20u, 30u, Cell());
+  cells = buffer.GetRow(1u);
+  for (ColumnNumber i = 0u; i < 100u; i++) {
+    EXPECT_EQ((i >= 10u && i < 90u && !(i >= 20u && i < 30u)) ? MakeCell('x')
+                                                                : Cell(),
+              cells[i])
+        << i;
+  }
+
+  // Short fills.
+  buffer.FillCells(0u, 0u, 3u, MakeCell('y'));
+  buffer.FillCells(0u, 3u, 3u, MakeCell('z'));
+  EXPECT_EQ(MakeCell('y'), buffer.GetRow(0u)[2]);
+  EXPECT_EQ(Cell(), buffer.GetRow(0u)[3]);
+
+  buffer.FillRows(1u, 4u, MakeCell('w'));
+  for (RowNumber row = 1u; row < 4u; row++) {
+    for (ColumnNumber i = 0u; i < 100u; i++)
+      EXPECT_EQ(MakeCell('w'), buffer.GetRow(row)[i]);
+  }
+  EXPECT_EQ(MakeCell('y'), buffer.GetRow(0u)[0]);
+  buffer.FillRows(0u, 4u, Cell());
+  for (RowNumber row = 0u; row < 4u; row++)
+    CheckRowIsBlank(buffer, row);
+}
+
+TEST_P(ScreenBufferTest, FillRowsWrappingAround) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(4u, 20u, 0u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  // Scroll, so that the viewport wraps around the end of the ring.
+  buffer.ScrollUp(2u, Cell());
+  for (RowNumber row = 2u; row < 6u; row++)
+    SetRow(&buffer, row, 100u * row);
+
+  buffer.FillRows(3u, 6u, MakeCell('w'));
+  CheckRow(buffer, 2u, 200u);
+  for (RowNumber row = 3u; row < 6u; row++) {
+    for (ColumnNumber i = 0u; i < 20u; i++)
+      EXPECT_EQ(MakeCell('w'), buffer.GetRow(row)[i]) << row << ", " << i;
+  }
+}
+
+TEST_P(ScreenBufferTest, MoveCellsAndCopyRow) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(2u, 10u, 0u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  SetRow(&buffer, 0u, 0u);
+
+  // Shift right (overlapping).
+  buffer.MoveCells(0u, 2u, 5u, 5u);
+  const Cell* cells = buffer.GetRow(0u);
+  const uint32_t kExpected1[10] = {0, 1, 2, 3, 4, 2, 3, 4, 5, 6};
+  for (ColumnNumber i = 0u; i < 10u; i++)
+    EXPECT_EQ(MakeCell(kExpected1[i]), cells[i]) << i;
+
+  // Shift left (overlapping).
+  buffer.MoveCells(0u, 1u, 0u, 9u);
+  cells = buffer.GetRow(0u);
+  const uint32_t kExpected2[10] = {1, 2, 3, 4, 2, 3, 4, 5, 6, 6};
+  for (ColumnNumber i = 0u; i < 10u; i++)
+    EXPECT_EQ(MakeCell(kExpected2[i]), cells[i]) << i;
+
+  // Moving nothing is fine, even at the end.
+  buffer.MoveCells(0u, 10u, 0u, 0u);
+
+  buffer.CopyRow(0u, 1u);
+  for (ColumnNumber i = 0u; i < 10u; i++)
+    EXPECT_EQ(MakeCell(kExpected2[i]), buffer.GetRow(1u)[i]) << i;
+}
+
+TEST_P(ScreenBufferTest, ShiftRows) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(5u, 3u, 0u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  for (RowNumber row = 0u; row < 5u; row++)
+    SetRow(&buffer, row, static_cast<uint32_t>(row * 10u));
+
+  // Shift rows 1..3 up by 1.
+  buffer.ShiftRowsUp(1u, 4u, 1u, Cell());
+  CheckRow(buffer, 0u, 0u);
+  CheckRow(buffer, 1u, 20u);
+  CheckRow(buffer, 2u, 30u);
+  CheckRowIsBlank(buffer, 3u);
+  CheckRow(buffer, 4u, 40u);
+
+  // Shift rows 0..4 down by 2.
+  buffer.ShiftRowsDown(0u, 5u, 2u, Cell());
+  CheckRowIsBlank(buffer, 0u);
+  CheckRowIsBlank(buffer, 1u);
+  CheckRow(buffer, 2u, 0u);
+  CheckRow(buffer, 3u, 20u);
+  CheckRow(buffer, 4u, 30u);
+
+  // Shifting by at least the size of the range clears it.
+  buffer.ShiftRowsUp(2u, 4u, 7u, MakeCell('x'));
+  CheckRowIsBlank(buffer, 1u);
+  for (RowNumber row = 2u; row < 4u; row++) {
+    for (ColumnNumber i = 0u; i < 3u; i++)
+      EXPECT_EQ(MakeCell('x'), buffer.GetRow(row)[i]);
+  }
+  CheckRow(buffer, 4u, 30u);
+  buffer.ShiftRowsDown(3u, 5u, 2u, Cell());
+  CheckRowIsBlank(buffer, 3u);
+  CheckRowIsBlank(buffer, 4u);
+
+  // Empty ranges are fine.
+  buffer.ShiftRowsUp(1u, 1u, 1u, Cell());
+  buffer.ShiftRowsDown(5u, 5u, 1u, Cell());
+}
+
+TEST_P(ScreenBufferTest, ShiftRowsThenScrollAndGrow) {
+  // Shifting rows (which only moves their storage indices) interacts properly
+  // with scrolling (which rotates the ring) and growing the ring. |expected|
+  // has the base (see |SetRow()|) of each row, or 0 for blank rows. Rows with
+  // odd bases are marked wrapped (and the flags must move with the rows).
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(4u, 3u, 100u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  std::vector<uint32_t> expected;
+  for (RowNumber row = 0u; row < 4u; row++) {
+    SetRow(&buffer, row, 10u + static_cast<uint32_t>(row));
+    buffer.SetRowWrapped(row, row % 2u);
+    expected.push_back(10u + static_cast<uint32_t>(row));
+  }
+
+  for (uint32_t i = 0u; i < 20u; i++) {
+    buffer.ScrollUp(1u, Cell());
+    expected.push_back(0u);
+    RowNumber bottom = buffer.first_row() + 4u;
+    SetRow(&buffer, bottom - 1u, 100u + i);
+    buffer.SetRowWrapped(bottom - 1u, i % 2u);
+    expected[bottom - 1u] = 100u + i;
+    // Shift the bottom 3 rows of the viewport (whose slots wrap around the end
+    // of the ring, at some point).
+    RowNumber top = bottom - 3u;
+    if (i % 2u) {
+      buffer.ShiftRowsUp(top, bottom, 1u, Cell());
+      expected.erase(expected.begin() + static_cast<ptrdiff_t>(top));
+      expected.push_back(0u);
+    } else {
+      buffer.ShiftRowsDown(top, bottom, 2u, Cell());
+      expected.pop_back();
+      expected.pop_back();
+      expected.insert(expected.begin() + static_cast<ptrdiff_t>(top), 2u, 0u);
+    }
+  }
+
+  ASSERT_EQ(expected.size(), buffer.first_row() + 4u);
+  for (RowNumber row = 0u; row < expected.size(); row++) {
+    if (expected[row])
+      CheckRow(buffer, row, expected[row]);
+    else
+      CheckRowIsBlank(buffer, row);
+    EXPECT_EQ(expected[row] % 2u == 1u, buffer.IsRowWrapped(row))
+        << "row " << row;
+  }
+}
+
+TEST_P(ScreenBufferTest, ScrollUp) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(3u, 4u, 0u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  for (RowNumber row = 0u; row < 3u; row++)
+    SetRow(&buffer, row, static_cast<uint32_t>(row * 10u));
+
+  buffer.ScrollUp(1u, Cell());
+  EXPECT_EQ(1u, buffer.first_row());
+  EXPECT_FALSE(buffer.IsValidRow(0u));
+  EXPECT_TRUE(buffer.IsValidRow(3u));
+  EXPECT_FALSE(buffer.IsValidRow(4u));
+  // Rows keep their row numbers.
+  CheckRow(buffer, 1u, 10u);
+  CheckRow(buffer, 2u, 20u);
+  CheckRowIsBlank(buffer, 3u);
+
+  SetRow(&buffer, 3u, 30u);
+  buffer.ScrollUp(2u, MakeCell('x'));
+  EXPECT_EQ(3u, buffer.first_row());
+  CheckRow(buffer, 3u, 30u);
+  for (RowNumber row = 4u; row < 6u; row++) {
+    for (ColumnNumber i = 0u; i < 4u; i++)
+      EXPECT_EQ(MakeCell('x'), buffer.GetRow(row)[i]);
+  }
+
+  buffer.ScrollUp(5u, Cell());
+  EXPECT_EQ(8u, buffer.first_row());
+  EXPECT_EQ(8u, buffer.scrollback_top());
+  for (RowNumber row = 8u; row < 11u; row++)
+    CheckRowIsBlank(buffer, row);
+}
+
+TEST_P(ScreenBufferTest, Scrollback) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(3u, 4u, 5u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  EXPECT_EQ(5u, buffer.scrollback_capacity());
+  for (RowNumber row = 0u; row < 3u; row++)
+    SetRow(&buffer, row, static_cast<uint32_t>(row * 10u));
+
+  buffer.ScrollUp(1u, Cell());
+  EXPECT_EQ(1u, buffer.first_row());
+  EXPECT_EQ(0u, buffer.scrollback_top());
+  EXPECT_EQ(1u, buffer.num_scrollback_rows());
+  EXPECT_TRUE(buffer.IsValidRow(0u));
+  EXPECT_FALSE(buffer.IsViewportRow(0u));
+  EXPECT_TRUE(buffer.IsViewportRow(1u));
+  CheckRow(buffer, 0u, 0u);
+  CheckRow(buffer, 1u, 10u);
+  CheckRow(buffer, 2u, 20u);
+  CheckRowIsBlank(buffer, 3u);
+
+  // Fill the scrollback (and then some), a row at a time; each row is written
+  // when it's at the bottom of the viewport.
+  for (RowNumber row = 3u; row < 20u; row++) {
+    SetRow(&buffer, row, static_cast<uint32_t>(row * 10u));
+    buffer.ScrollUp(1u, Cell());
+    EXPECT_EQ(row - 1u, buffer.first_row());
+    EXPECT_EQ(std::min<RowNumber>(row - 1u, 5u), buffer.num_scrollback_rows());
+    for (RowNumber r = buffer.scrollback_top(); r < row + 1u; r++)
+      CheckRow(buffer, r, static_cast<uint32_t>(r * 10u));
+    CheckRowIsBlank(buffer, row + 1u);
+  }
+  EXPECT_EQ(13u, buffer.scrollback_top());
+  EXPECT_EQ(18u, buffer.first_row());
+
+  // Scroll by more than one row (the new rows, including any that are now in
+  // the scrollback, are filled).
+  buffer.ScrollUp(4u, MakeCell('x'));
+  EXPECT_EQ(22u, buffer.first_row());
+  EXPECT_EQ(17u, buffer.scrollback_top());
+  CheckRow(buffer, 17u, 170u);
+  CheckRow(buffer, 18u, 180u);
+  CheckRow(buffer, 19u, 190u);
+  CheckRowIsBlank(buffer, 20u);
+  for (RowNumber row = 21u; row < 25u; row++) {
+    for (ColumnNumber i = 0u; i < 4u; i++)
+      EXPECT_EQ(MakeCell('x'), buffer.GetRow(row)[i]);
+  }
+
+  buffer.ScrollUp(100u, Cell());
+  EXPECT_EQ(122u, buffer.first_row());
+  EXPECT_EQ(117u, buffer.scrollback_top());
+  EXPECT_FALSE(buffer.IsValidRow(116u));
+  EXPECT_TRUE(buffer.IsValidRow(124u));
+  EXPECT_FALSE(buffer.IsValidRow(125u));
+  for (RowNumber row = 117u; row < 125u; row++)
+    CheckRowIsBlank(buffer, row);
+
+  // Viewport operations don't affect the scrollback.
+  SetRow(&buffer, 121u, 1210u);
+  SetRow(&buffer, 122u, 1220u);
+  buffer.ShiftRowsDown(122u, 125u, 1u, Cell());
+  CheckRow(buffer, 121u, 1210u);
+  CheckRowIsBlank(buffer, 122u);
+  CheckRow(buffer, 123u, 1220u);
+  buffer.ShiftRowsUp(122u, 125u, 2u, MakeCell('x'));
+  CheckRow(buffer, 121u, 1210u);
+  CheckRowIsBlank(buffer, 122u);
+}
+
+// Scrolling many times with a large scrollback (exercising growth of the ring
+// and wrapping around).
+TEST_P(ScreenBufferTest, ClearScrollback) {
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(3u, 4u, 5u);
+  ScreenBuffer& buffer = *buffer_ptr;
+  for (RowNumber row = 0u; row < 3u; row++)
+    SetRow(&buffer, row, static_cast<uint32_t>(row * 10u));
+  buffer.ScrollUp(2u, Cell());
+  EXPECT_EQ(2u, buffer.num_scrollback_rows());
+
+  buffer.ClearScrollback();
+  EXPECT_EQ(0u, buffer.num_scrollback_rows());
+  EXPECT_EQ(2u, buffer.first_row());
+  EXPECT_EQ(2u, buffer.scrollback_top());
+  EXPECT_FALSE(buffer.IsValidRow(1u));
+  CheckRow(buffer, 2u, 20u);
+  CheckRowIsBlank(buffer, 3u);
+
+  // The ring keeps working (reusing the discarded rows' slots).
+  for (RowNumber row = 3u; row < 5u; row++)
+    SetRow(&buffer, row, static_cast<uint32_t>(row * 10u));
+  buffer.ScrollUp(7u, Cell());
+  EXPECT_EQ(5u, buffer.num_scrollback_rows());
+  CheckRow(buffer, 4u, 40u);
+  for (RowNumber row = 5u; row < 12u; row++)
+    CheckRowIsBlank(buffer, row);
+}
+
+TEST_P(ScreenBufferTest, ScrollbackLarge) {
+  const uint32_t kRows = 7u;
+  const uint32_t kCapacity = 1000u;
+  std::unique_ptr<ScreenBuffer> buffer_ptr = Create(kRows, 3u, kCapacity);
+  ScreenBuffer& buffer = *buffer_ptr;
+  for (RowNumber row = 0u; row < 5000u; row++) {
+    SetRow(&buffer, buffer.first_row(), static_cast<uint32_t>(row));
+    buffer.ScrollUp(1u, Cell());
+    if (row % 97u == 0u || row > 4990u) {
+      EXPECT_EQ(std::min<RowNumber>(row + 1u, kCapacity),
+                buffer.num_scrollback_rows());
+      // The scrollback rows were the top rows of the viewport.
+      for (RowNumber r = buffer.scrollback_top(); r < buffer.first_row(); r++)
+        CheckRow(buffer, r, static_cast<uint32_t>(r));
+    }
+  }
+}
+
+// With |Terminal::CellStorage::COMPACT|, styles that are no longer used are
+// reclaimed, so any number of styles can be used over time.
+TEST(ScreenBufferCompactTest, ManyStyles) {
+  std::unique_ptr<ScreenBuffer> buffer =
+      ScreenBuffer::Create(2u, 99u, 10u, Terminal::CellStorage::COMPACT);
+  const Codepoint kText[3] = {'a', 'b', 'c'};
+  // Write "abc" 33 times per row, each time with a different color.
+  for (uint32_t i = 0u; i < 10000u; i++) {
+    Cell style(Character(), Color(Color::Type::RGB, i), Color());
+    buffer->WriteCells(buffer->first_row() + 1u, (i % 33u) * 3u, kText, 3u,
+                       style);
+    if (i % 33u == 32u)
+      buffer->ScrollUp(1u, Cell());
+  }
+
+  // The cells still in the buffer are intact.
+  for (RowNumber row = buffer->scrollback_top(); row < buffer->first_row();
+       row++) {
+    uint32_t first = static_cast<uint32_t>(row - 1u) * 33u;
+    const Cell* cells = buffer->GetRow(row);
+    for (ColumnNumber i = 0u; i < 99u; i++) {
+      EXPECT_EQ(Cell(Character(Character::Attribute::NONE, kText[i % 3u]),
+                     Color(Color::Type::RGB, first + i / 3u), Color()),
+                cells[i])
+          << "row " << row << ", column " << i;
+    }
+  }
+  EXPECT_EQ(Cell(Character(Character::Attribute::NONE, 'a'),
+                 Color(Color::Type::RGB, 9999u), Color()),
+            buffer->GetRow(buffer->first_row() + 1u)[0]);
+}
+
+// More styles than fit in the style table can be in use at once, and garbage
+// collection (which can't free any) isn't redone for every write.
+TEST(ScreenBufferCompactTest, TooManyStyles) {
+  std::unique_ptr<ScreenBuffer> buffer =
+      ScreenBuffer::Create(30u, 100u, 0u, Terminal::CellStorage::COMPACT);
+  const RowNumber top = buffer->first_row();
+  auto make_cell = [](uint32_t i) {
+    return Cell(Character(Character::Attribute::BOLD, 'a' + i % 26u),
+                Color(Color::Type::RGB, i), Color(Color::Type::ANSI_16, 2u));
+  };
+  auto check_cells = [&buffer, &make_cell, top](uint32_t first) {
+    for (uint32_t i = 0u; i < 3000u; i++) {
+      EXPECT_EQ(make_cell(first + i), buffer->GetRow(top + i / 100u)[i % 100u])
+          << "cell " << i;
+      EXPECT_EQ('a' + (first + i) % 26u,
+                buffer->GetCodepoint(top + i / 100u, i % 100u))
+          << "cell " << i;
+    }
+  };
+
+  // 3000 cells, each with its own style.
+  for (uint32_t i = 0u; i < 3000u; i++) {
+    Cell cell = make_cell(i);
+    buffer->SetCells(top + i / 100u, i % 100u, &cell, 1u);
+  }
+  check_cells(0u);
+  EXPECT_GT(buffer->num_garbage_collections(), 0u);
+  EXPECT_LT(buffer->num_garbage_collections(), 10u);
+
+  // Overwrite them with another 3000 styles (the old ones are reclaimed).
+  buffer->FillRows(top, top + 30u, Cell());
+  for (uint32_t i = 0u; i < 3000u; i++) {
+    Cell cell = make_cell(10000u + i);
+    buffer->SetCells(top + i / 100u, i % 100u, &cell, 1u);
+  }
+  check_cells(10000u);
+  EXPECT_LT(buffer->num_garbage_collections(), 20u);
+
+  // Runs of characters with a style that doesn't fit.
+  const Codepoint kText[3] = {'x', 'y', 'z'};
+  const Cell style = make_cell(20000u);
+  buffer->WriteCells(top, 10u, kText, 3u, style);
+  for (ColumnNumber i = 0u; i < 3u; i++) {
+    EXPECT_EQ(Cell(Character(Character::Attribute::BOLD, kText[i]), style.fg(),
+                   style.bg()),
+              buffer->GetRow(top)[10u + i]);
+  }
+  EXPECT_EQ(make_cell(10009u), buffer->GetRow(top)[9u]);
+  EXPECT_EQ(make_cell(10013u), buffer->GetRow(top)[13u]);
+}
+
+TEST(ScreenBufferCompactTest, MemoryUsage) {
+  std::unique_ptr<ScreenBuffer> full =
+      ScreenBuffer::Create(50u, 200u, 0u, Terminal::CellStorage::FULL);
+  std::unique_ptr<ScreenBuffer> compact =
+      ScreenBuffer::Create(50u, 200u, 0u, Terminal::CellStorage::COMPACT);
+  EXPECT_EQ(sizeof(Cell), full->cell_size());
+  EXPECT_EQ(4u, compact->cell_size());
+  EXPECT_LT(compact->GetMemoryUsage(), full->GetMemoryUsage() / 2u);
+}
+
+INSTANTIATE_TEST_CASE_P(CellStorage,
+                        ScreenBufferTest,
+                        testing::Values(Terminal::CellStorage::FULL,
+                                        Terminal::CellStorage::COMPACT));
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,15 @@
+#include <vtlib/session_manager.h>
+
+#include "src/session_manager_impl.h"
+
+namespace vtlib {
+
+// static
+std::unique_ptr<SessionManager> SessionManager::Create(const Options& options,
+                                                       Delegate* delegate) {
+  // TODO(C++14): No make_unique in C++11.
+  return std::unique_ptr<SessionManager>(
+      new SessionManagerImpl(options, delegate));
+}
+
+}  // namespace vtlib
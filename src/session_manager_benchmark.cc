@@ -0,0 +1,72 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <vtlib/session_manager.h>
+#include <vtlib/terminal.h>
+
+#include "testing/benchmark_corpora.h"
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kCorpusSize = 4u << 20;  // 4 MiB.
+// Input is submitted in chunks of this size (like reads from a PTY).
+constexpr size_t kChunkSize = 4096u;
+
+// Measures processing a corpus spread over |state.range(0)| terminals (in
+// chunks, round robin), with |state.range(1)| worker threads. Also reports the
+// number of steals per iteration.
+void BM_SessionManager(benchmark::State& state, Corpus corpus) {
+  const size_t num_terminals = static_cast<size_t>(state.range(0));
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  SessionManager::Options options;
+  options.num_threads = static_cast<unsigned>(state.range(1));
+  std::unique_ptr<SessionManager> session_manager =
+      SessionManager::Create(options, nullptr);
+  Terminal::Options terminal_options;
+  terminal_options.rows = 50u;
+  terminal_options.columns = 200u;
+  // Keep the memory use reasonable with many terminals.
+  terminal_options.scrollback_rows = 100u;
+  std::vector<SessionManager::TerminalId> ids;
+  for (size_t i = 0u; i < num_terminals; i++)
+    ids.push_back(session_manager->AddTerminal(terminal_options));
+
+  for (auto _ : state) {
+    size_t terminal_index = 0u;
+    for (size_t i = 0u; i < input.size(); i += kChunkSize) {
+      size_t n = input.size() - i < kChunkSize ? input.size() - i : kChunkSize;
+      session_manager->SubmitInput(ids[terminal_index], input.data() + i, n);
+      terminal_index = (terminal_index + 1u) % num_terminals;
+    }
+    session_manager->WaitUntilIdle();
+  }
+
+  state.counters["steals_per_iteration"] =
+      static_cast<double>(session_manager->GetStats().num_steals) /
+      static_cast<double>(state.iterations());
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+void SessionManagerArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int num_terminals : {1, 16, 256, 1024}) {
+    for (int num_threads : {1, 2, 4, 8})
+      benchmark->Args({num_terminals, num_threads});
+  }
+  benchmark->ArgNames({"terminals", "threads"});
+  // Real time, since the work is done on the worker threads.
+  benchmark->UseRealTime();
+}
+
+BENCHMARK_CAPTURE(BM_SessionManager, ascii, Corpus::ASCII)
+    ->Apply(SessionManagerArgs);
+BENCHMARK_CAPTURE(BM_SessionManager, control_dense, Corpus::CONTROL_DENSE)
+    ->Apply(SessionManagerArgs);
+
+}  // namespace
+}  // namespace vtlib
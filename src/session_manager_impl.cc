@@ -0,0 +1,232 @@
+#include "src/session_manager_impl.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <utility>
+
+// Waking workers: |Enqueue()| increments |num_queued_| and then checks
+// |num_sleeping_|, while a worker about to sleep increments |num_sleeping_|
+// and then checks |num_queued_| (all sequentially consistent), so either the
+// worker sees the new session or |Enqueue()| sees the worker and wakes it.
+
+namespace vtlib {
+
+SessionManagerImpl::Session::Session(TerminalId id,
+                                     const Terminal::Options& terminal_options,
+                                     size_t worker_index)
+    : id(id),
+      terminal(Terminal::Create(terminal_options)),
+      worker_index(worker_index) {}
+
+SessionManagerImpl::SessionManagerImpl(const Options& options,
+                                       Delegate* delegate)
+    : options_(options),
+      delegate_(delegate),
+      num_queued_(0u),
+      num_sleeping_(0u),
+      stopping_(false),
+      num_scheduled_(0u) {
+  assert(options_.max_bytes_per_slice > 0u);
+  if (!options_.num_threads)
+    options_.num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  // Create all the workers before starting any, since they look at each
+  // other's queues.
+  for (unsigned i = 0u; i < options_.num_threads; i++)
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+  for (size_t i = 0u; i < workers_.size(); i++)
+    workers_[i]->thread = std::thread(&SessionManagerImpl::WorkerMain, this, i);
+}
+
+SessionManagerImpl::~SessionManagerImpl() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stopping_.store(true);
+    wake_cv_.notify_all();
+  }
+  for (const auto& worker : workers_)
+    worker->thread.join();
+
+  // Removed sessions that were still scheduled own themselves.
+  for (const auto& worker : workers_) {
+    for (Session* session : worker->queue) {
+      if (session->removed)
+        delete session;
+    }
+  }
+}
+
+SessionManager::TerminalId SessionManagerImpl::AddTerminal(
+    const Terminal::Options& options) {
+  TerminalId id = next_id_++;
+  sessions_[id] = std::unique_ptr<Session>(
+      new Session(id, options, static_cast<size_t>(id % workers_.size())));
+  return id;
+}
+
+void SessionManagerImpl::RemoveTerminal(TerminalId id) {
+  auto it = sessions_.find(id);
+  assert(it != sessions_.end());
+  std::unique_ptr<Session> session = std::move(it->second);
+  sessions_.erase(it);
+
+  std::lock_guard<std::mutex> lock(session->mutex);
+  if (session->scheduled) {
+    // A worker has it (or will): let it delete it.
+    session->removed = true;
+    session.release();
+  }
+}
+
+void SessionManagerImpl::SubmitInput(TerminalId id,
+                                     const uint8_t* input_bytes,
+                                     size_t num_input_bytes) {
+  if (!num_input_bytes)
+    return;
+  auto it = sessions_.find(id);
+  assert(it != sessions_.end());
+  Session* session = it->second.get();
+
+  bool schedule;
+  size_t worker_index;
+  {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->pending_input.insert(session->pending_input.end(), input_bytes,
+                                  input_bytes + num_input_bytes);
+    schedule = !session->scheduled;
+    session->scheduled = true;
+    worker_index = session->worker_index;
+  }
+  if (schedule) {
+    num_scheduled_.fetch_add(1u);
+    Enqueue(worker_index, session);
+  }
+}
+
+void SessionManagerImpl::WaitUntilIdle() {
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  idle_cv_.wait(lock, [this]() { return !num_scheduled_.load(); });
+}
+
+Terminal* SessionManagerImpl::GetTerminal(TerminalId id) {
+  auto it = sessions_.find(id);
+  assert(it != sessions_.end());
+  return it->second->terminal.get();
+}
+
+SessionManager::Stats SessionManagerImpl::GetStats() const {
+  Stats stats;
+  for (const auto& worker : workers_) {
+    stats.num_slices += worker->num_slices.load(std::memory_order_relaxed);
+    stats.num_steals += worker->num_steals.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void SessionManagerImpl::Enqueue(size_t worker_index, Session* session) {
+  num_queued_.fetch_add(1u);
+  {
+    Worker* worker = workers_[worker_index].get();
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->queue.push_back(session);
+  }
+  if (num_sleeping_.load()) {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_cv_.notify_one();
+  }
+}
+
+SessionManagerImpl::Session* SessionManagerImpl::Dequeue(size_t worker_index) {
+  // Try our own queue first, and then the others' (starting with the next
+  // worker's, so that different thieves tend to pick different victims).
+  for (size_t i = 0u; i < workers_.size(); i++) {
+    Worker* worker = workers_[(worker_index + i) % workers_.size()].get();
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->queue.empty())
+      continue;
+    // Take from the front: it has been waiting the longest.
+    Session* session = worker->queue.front();
+    worker->queue.pop_front();
+    num_queued_.fetch_sub(1u);
+    if (i) {
+      workers_[worker_index]->num_steals.fetch_add(1u,
+                                                   std::memory_order_relaxed);
+    }
+    return session;
+  }
+  return nullptr;
+}
+
+void SessionManagerImpl::RunSlice(size_t worker_index, Session* session) {
+  bool removed;
+  {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    removed = session->removed;
+    if (!removed && session->input_offset == session->input.size()) {
+      // Take the pending input (swapping buffers, so that neither needs to be
+      // reallocated once they're big enough).
+      session->input.swap(session->pending_input);
+      session->pending_input.clear();
+      session->input_offset = 0u;
+    }
+  }
+
+  if (!removed) {
+    size_t n = std::min(options_.max_bytes_per_slice,
+                        session->input.size() - session->input_offset);
+    assert(n);
+    session->terminal->ProcessBytes(
+        session->input.data() + session->input_offset, n);
+    session->input_offset += n;
+    workers_[worker_index]->num_slices.fetch_add(1u,
+                                                 std::memory_order_relaxed);
+    if (delegate_)
+      delegate_->OnInputProcessed(session->id, session->terminal.get());
+  }
+
+  bool reschedule;
+  {
+    std::lock_guard<std::mutex> lock(session->mutex);
+    removed = session->removed;
+    reschedule = !removed &&
+                 (session->input_offset < session->input.size() ||
+                  !session->pending_input.empty());
+    session->scheduled = reschedule;
+    // Keep the session with this worker (whose cache it's in), unless it gets
+    // stolen.
+    session->worker_index = worker_index;
+  }
+  // Note: Unless it's rescheduled or was removed, |session| may be deleted
+  // (by |RemoveTerminal()|) as soon as it's unscheduled.
+
+  if (reschedule) {
+    // To the back of the queue, so that other sessions get a turn.
+    Enqueue(worker_index, session);
+    return;
+  }
+  if (removed)
+    delete session;
+  if (num_scheduled_.fetch_sub(1u) == 1u) {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    idle_cv_.notify_all();
+  }
+}
+
+void SessionManagerImpl::WorkerMain(size_t worker_index) {
+  while (!stopping_.load()) {
+    if (Session* session = Dequeue(worker_index)) {
+      RunSlice(worker_index, session);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    num_sleeping_.fetch_add(1u);
+    wake_cv_.wait(lock, [this]() {
+      return stopping_.load() || num_queued_.load() > 0u;
+    });
+    num_sleeping_.fetch_sub(1u);
+  }
+}
+
+}  // namespace vtlib
@@ -0,0 +1,122 @@
+#ifndef VTLIB_SRC_SESSION_MANAGER_IMPL_H_
+#define VTLIB_SRC_SESSION_MANAGER_IMPL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vtlib/session_manager.h>
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+
+class SessionManagerImpl : public SessionManager {
+ public:
+  SessionManagerImpl(const Options& options, Delegate* delegate);
+  ~SessionManagerImpl() override;
+
+  SessionManagerImpl(const SessionManagerImpl&) = delete;
+  SessionManagerImpl& operator=(const SessionManagerImpl&) = delete;
+
+  const Options& options() const override { return options_; }
+
+  TerminalId AddTerminal(const Terminal::Options& options) override;
+  void RemoveTerminal(TerminalId id) override;
+
+  void SubmitInput(TerminalId id,
+                   const uint8_t* input_bytes,
+                   size_t num_input_bytes) override;
+  void WaitUntilIdle() override;
+
+  Terminal* GetTerminal(TerminalId id) override;
+
+  Stats GetStats() const override;
+
+ private:
+  struct Session {
+    Session(TerminalId id,
+            const Terminal::Options& terminal_options,
+            size_t worker_index);
+
+    const TerminalId id;
+    const std::unique_ptr<Terminal> terminal;
+
+    std::mutex mutex;
+    // The following are guarded by |mutex|.
+    // Input submitted but not yet taken by a worker.
+    std::vector<uint8_t> pending_input;
+    // Set while the session is in a worker's queue or being processed.
+    bool scheduled = false;
+    // Set by |RemoveTerminal()| if the session was scheduled, in which case
+    // the worker that next runs it deletes it.
+    bool removed = false;
+    // The worker whose queue the session goes into when input is submitted.
+    size_t worker_index;
+
+    // The following are only used by the worker processing the session.
+    // Input taken from |pending_input|, processed up to |input_offset|.
+    std::vector<uint8_t> input;
+    size_t input_offset = 0u;
+  };
+
+  struct Worker {
+    Worker() : num_slices(0u), num_steals(0u) {}
+
+    std::thread thread;
+
+    std::mutex mutex;
+    // Guarded by |mutex|.
+    std::deque<Session*> queue;
+
+    std::atomic<uint64_t> num_slices;
+    std::atomic<uint64_t> num_steals;
+  };
+
+  // Adds |session| (which must be scheduled) to the back of worker
+  // |worker_index|'s queue, waking a worker if necessary.
+  void Enqueue(size_t worker_index, Session* session);
+  // Takes a session from the front of worker |worker_index|'s queue, or failing
+  // that, from another worker's queue. Returns null if all the queues are
+  // empty.
+  Session* Dequeue(size_t worker_index);
+  // Processes up to |options_.max_bytes_per_slice| bytes of input for
+  // |session|, and then re-queues it (if it has more input) or unschedules it.
+  void RunSlice(size_t worker_index, Session* session);
+  void WorkerMain(size_t worker_index);
+
+  Options options_;
+  Delegate* const delegate_;
+
+  // The following are only accessed by the thread calling the
+  // |SessionManager| methods.
+  TerminalId next_id_ = 1u;
+  std::unordered_map<TerminalId, std::unique_ptr<Session>> sessions_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // The number of sessions in workers' queues (this may briefly be greater,
+  // while a session is being added).
+  std::atomic<size_t> num_queued_;
+  // The number of workers waiting on |wake_cv_| (or about to).
+  std::atomic<size_t> num_sleeping_;
+  std::atomic<bool> stopping_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+
+  // The number of scheduled sessions.
+  std::atomic<size_t> num_scheduled_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_SESSION_MANAGER_IMPL_H_
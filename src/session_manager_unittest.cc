@@ -0,0 +1,196 @@
+#include <vtlib/session_manager.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+namespace {
+
+// Records the IDs of the terminals for which input was processed, in order.
+// Optionally, the first call blocks until |Unblock()| is called.
+class RecordingDelegate : public SessionManager::Delegate {
+ public:
+  explicit RecordingDelegate(bool block_first_call)
+      : blocked_(block_first_call) {}
+  ~RecordingDelegate() override {}
+
+  std::vector<SessionManager::TerminalId> ids() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ids_;
+  }
+
+  // Waits until the first call is blocked, and then unblocks it.
+  void Unblock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return !ids_.empty(); });
+    blocked_ = false;
+    cv_.notify_all();
+  }
+
+  // |SessionManager::Delegate|:
+  void OnInputProcessed(SessionManager::TerminalId id,
+                        Terminal* terminal) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ids_.push_back(id);
+    cv_.notify_all();
+    cv_.wait(lock, [this]() { return !blocked_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool blocked_;
+  std::vector<SessionManager::TerminalId> ids_;
+};
+
+void SubmitString(SessionManager* session_manager,
+                  SessionManager::TerminalId id,
+                  const std::string& s) {
+  session_manager->SubmitInput(id, reinterpret_cast<const uint8_t*>(s.data()),
+                               s.size());
+}
+
+// Returns the text of the viewport, with rows separated by '|'.
+std::string GetViewportText(const Terminal& terminal) {
+  std::string rv;
+  for (uint32_t i = 0u; i < terminal.options().rows; i++) {
+    if (i)
+      rv += "|";
+    const Cell* cells = terminal.GetRow(terminal.viewport_top() + i);
+    for (ColumnNumber j = 0u; j < terminal.options().columns; j++) {
+      Codepoint c = cells[j].character().codepoint();
+      rv += c ? static_cast<char>(c) : ' ';
+    }
+  }
+  return rv;
+}
+
+Terminal::Options SmallTerminalOptions() {
+  Terminal::Options options;
+  options.rows = 2u;
+  options.columns = 6u;
+  options.scrollback_rows = 10u;
+  return options;
+}
+
+TEST(SessionManagerTest, Basic) {
+  RecordingDelegate delegate(false);
+  SessionManager::Options options;
+  options.num_threads = 2u;
+  std::unique_ptr<SessionManager> session_manager =
+      SessionManager::Create(options, &delegate);
+  EXPECT_EQ(2u, session_manager->options().num_threads);
+
+  SessionManager::TerminalId id1 =
+      session_manager->AddTerminal(SmallTerminalOptions());
+  SessionManager::TerminalId id2 =
+      session_manager->AddTerminal(SmallTerminalOptions());
+  EXPECT_NE(id1, id2);
+
+  SubmitString(session_manager.get(), id1, "ab");
+  SubmitString(session_manager.get(), id2, "xy");
+  SubmitString(session_manager.get(), id1, "\r\ncd");
+  session_manager->WaitUntilIdle();
+  EXPECT_EQ("ab    |cd    ",
+            GetViewportText(*session_manager->GetTerminal(id1)));
+  EXPECT_EQ("xy    |      ",
+            GetViewportText(*session_manager->GetTerminal(id2)));
+  EXPECT_GE(delegate.ids().size(), 2u);
+
+  // Removing a terminal discards its pending input.
+  SubmitString(session_manager.get(), id1, std::string(100000u, 'z'));
+  session_manager->RemoveTerminal(id1);
+  session_manager->WaitUntilIdle();
+
+  SessionManager::Stats stats = session_manager->GetStats();
+  EXPECT_GE(stats.num_slices, 2u);
+}
+
+// Input for each terminal is processed in order, even when it's submitted in
+// many small pieces for many terminals (so that terminals move between
+// workers).
+TEST(SessionManagerTest, Ordering) {
+  const size_t kNumTerminals = 20u;
+  const int kNumLines = 300;
+
+  SessionManager::Options options;
+  options.num_threads = 4u;
+  options.max_bytes_per_slice = 16u;
+  std::unique_ptr<SessionManager> session_manager =
+      SessionManager::Create(options, nullptr);
+
+  Terminal::Options terminal_options;
+  terminal_options.rows = 5u;
+  terminal_options.columns = 20u;
+  std::vector<SessionManager::TerminalId> ids;
+  for (size_t i = 0u; i < kNumTerminals; i++)
+    ids.push_back(session_manager->AddTerminal(terminal_options));
+  std::unique_ptr<Terminal> expected_terminal =
+      Terminal::Create(terminal_options);
+
+  for (int line = 0; line < kNumLines; line++) {
+    std::string s = "line " + std::to_string(line) + "\r\n";
+    for (SessionManager::TerminalId id : ids)
+      SubmitString(session_manager.get(), id, s);
+    expected_terminal->ProcessBytes(reinterpret_cast<const uint8_t*>(s.data()),
+                                    s.size());
+  }
+  session_manager->WaitUntilIdle();
+
+  std::string expected_text = GetViewportText(*expected_terminal);
+  for (SessionManager::TerminalId id : ids) {
+    EXPECT_EQ(expected_text,
+              GetViewportText(*session_manager->GetTerminal(id)));
+  }
+}
+
+// A terminal with a flood of input doesn't starve one with a little.
+TEST(SessionManagerTest, Fairness) {
+  RecordingDelegate delegate(true);
+  SessionManager::Options options;
+  options.num_threads = 1u;
+  options.max_bytes_per_slice = 1024u;
+  std::unique_ptr<SessionManager> session_manager =
+      SessionManager::Create(options, &delegate);
+
+  SessionManager::TerminalId flood_id =
+      session_manager->AddTerminal(SmallTerminalOptions());
+  SessionManager::TerminalId interactive_id =
+      session_manager->AddTerminal(SmallTerminalOptions());
+
+  std::string yes;
+  for (int i = 0; i < 100000; i++)
+    yes += "y\r\n";
+  SubmitString(session_manager.get(), flood_id, yes);
+  // Submit the interactive terminal's input while the (only) worker is busy
+  // with the first slice of the flood.
+  SubmitString(session_manager.get(), interactive_id, "$ ");
+  delegate.Unblock();
+  session_manager->WaitUntilIdle();
+
+  std::vector<SessionManager::TerminalId> ids = delegate.ids();
+  size_t num_flood_slices = 0u;
+  for (SessionManager::TerminalId id : ids) {
+    if (id == interactive_id)
+      break;
+    num_flood_slices++;
+  }
+  // Only one slice of the flood was processed before the interactive terminal
+  // got its turn.
+  EXPECT_EQ(1u, num_flood_slices);
+  EXPECT_EQ((yes.size() + 1023u) / 1024u + 1u, ids.size());
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,219 @@
+#include "src/sgr.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vtlib/character.h>
+#include <vtlib/color.h>
+
+#include "src/color_tables.h"
+
+namespace vtlib {
+namespace {
+
+using Attribute = Character::Attribute;
+
+constexpr uint16_t A(Attribute attribute) {
+  return static_cast<uint16_t>(attribute);
+}
+
+constexpr uint16_t kAllAttributes = 0x7ffu;
+
+// The attributes set and cleared by an SGR parameter.
+struct SgrAttributeUpdate {
+  uint16_t set;
+  uint16_t clear;
+};
+
+// Indexed by SGR parameter (0..29). (Parameters that we don't support are
+// no-ops.)
+constexpr SgrAttributeUpdate kSgrAttributeUpdates[] = {
+    {0u, kAllAttributes},                                             // 0
+    {A(Attribute::BOLD), 0u},                                         // 1
+    {A(Attribute::FAINT), 0u},                                        // 2
+    {A(Attribute::ITALICIZED), 0u},                                   // 3
+    {A(Attribute::UNDERLINED), A(Attribute::DOUBLY_UNDERLINE)},       // 4
+    {A(Attribute::BLINK), 0u},                                        // 5
+    {0u, 0u},                                                         // 6
+    {A(Attribute::INVERSE), 0u},                                      // 7
+    {A(Attribute::INVISIBLE), 0u},                                    // 8
+    {A(Attribute::CROSSED_OUT), 0u},                                  // 9
+    {0u, 0u}, {0u, 0u}, {0u, 0u}, {0u, 0u}, {0u, 0u},                 // 10-14
+    {0u, 0u}, {0u, 0u}, {0u, 0u}, {0u, 0u}, {0u, 0u},                 // 15-19
+    {0u, 0u},                                                         // 20
+    {A(Attribute::DOUBLY_UNDERLINE), A(Attribute::UNDERLINED)},       // 21
+    {0u, A(Attribute::BOLD) | A(Attribute::FAINT)},                   // 22
+    {0u, A(Attribute::ITALICIZED)},                                   // 23
+    {0u, A(Attribute::UNDERLINED) | A(Attribute::DOUBLY_UNDERLINE)},  // 24
+    {0u, A(Attribute::BLINK)},                                        // 25
+    {0u, 0u},                                                         // 26
+    {0u, A(Attribute::INVERSE)},                                      // 27
+    {0u, A(Attribute::INVISIBLE)},                                    // 28
+    {0u, A(Attribute::CROSSED_OUT)},                                  // 29
+};
+constexpr size_t kNumSgrAttributeUpdates =
+    sizeof(kSgrAttributeUpdates) / sizeof(kSgrAttributeUpdates[0]);
+static_assert(kNumSgrAttributeUpdates == 30u, "Bad SGR attribute table");
+
+void UpdateAttributes(const SgrAttributeUpdate& update, Cell* pen) {
+  Character character = pen->character();
+  character.set_attribute(static_cast<Attribute>(
+      (static_cast<uint32_t>(character.attribute()) & ~uint32_t{update.clear}) |
+      update.set));
+  pen->set_character(character);
+}
+
+// Sets the foreground color if |parameter| is 38, or the background color if
+// it's 48 (and ignores the color otherwise, e.g., for 58, the underline
+// color).
+void SetExtendedColor(uint32_t parameter, const Color& color, Cell* pen) {
+  if (parameter == 38u)
+    pen->set_fg(color);
+  else if (parameter == 48u)
+    pen->set_bg(color);
+}
+
+void SetColor256(uint32_t parameter, uint32_t index, Cell* pen) {
+  if (index <= 255u)
+    SetExtendedColor(parameter, Color256(index), pen);
+}
+
+void SetColorRgb(uint32_t parameter,
+                 uint32_t r,
+                 uint32_t g,
+                 uint32_t b,
+                 Cell* pen) {
+  if (r <= 255u && g <= 255u && b <= 255u) {
+    SetExtendedColor(parameter,
+                     Color(Color::Type::RGB, (r << 16) | (g << 8) | b), pen);
+  }
+}
+
+// Applies a single SGR parameter, other than the extended colors (38, 48, 58).
+void ApplySgrParameter(uint32_t parameter, Cell* pen) {
+  if (parameter < kNumSgrAttributeUpdates) {
+    UpdateAttributes(kSgrAttributeUpdates[parameter], pen);
+    if (!parameter) {
+      pen->set_fg(Color());
+      pen->set_bg(Color());
+    }
+    return;
+  }
+
+  if (parameter >= 30u && parameter <= 37u)
+    pen->set_fg(Color(Color::Type::ANSI_16, parameter - 30u));
+  else if (parameter == 39u)
+    pen->set_fg(Color());
+  else if (parameter >= 40u && parameter <= 47u)
+    pen->set_bg(Color(Color::Type::ANSI_16, parameter - 40u));
+  else if (parameter == 49u)
+    pen->set_bg(Color());
+  else if (parameter >= 90u && parameter <= 97u)
+    pen->set_fg(Color(Color::Type::ANSI_16, parameter - 90u + 8u));
+  else if (parameter >= 100u && parameter <= 107u)
+    pen->set_bg(Color(Color::Type::ANSI_16, parameter - 100u + 8u));
+  // Anything else is unsupported (or invalid).
+}
+
+// Handles the underline style subparameter (4:n).
+void ApplyUnderlineStyle(uint32_t style, Cell* pen) {
+  switch (style) {
+    case 0u:
+      ApplySgrParameter(24u, pen);
+      return;
+    case 2u:
+      ApplySgrParameter(21u, pen);
+      return;
+    default:
+      // Single, curly, dotted, and dashed underlines.
+      ApplySgrParameter(4u, pen);
+      return;
+  }
+}
+
+// Handles the extended color |sequence.parameters[i]| (38, 48, or 58) in its
+// colon-separated form (38:5:n, 38:2:r:g:b, or 38:2:cs:r:g:b), where the
+// |num_subparameters| parameters after it are subparameters.
+void ApplyExtendedColorSubparameters(const VtParser::Sequence& sequence,
+                                     size_t i,
+                                     size_t num_subparameters,
+                                     Cell* pen) {
+  const uint32_t* subparameters = &sequence.parameters[i + 1u];
+  if (subparameters[0] == 5u && num_subparameters >= 2u) {
+    SetColor256(sequence.parameters[i], subparameters[1], pen);
+  } else if (subparameters[0] == 2u && num_subparameters >= 4u) {
+    // With 4 or more subparameters after the 2, the first is a color space ID
+    // (typically empty), which we ignore.
+    size_t first = num_subparameters == 4u ? 1u : 2u;
+    SetColorRgb(sequence.parameters[i], subparameters[first],
+                subparameters[first + 1u], subparameters[first + 2u], pen);
+  }
+}
+
+}  // namespace
+
+void ApplySgr(const VtParser::Sequence& sequence, Cell* pen) {
+  const size_t n = sequence.num_parameters;
+  const uint32_t* parameters = sequence.parameters;
+
+  // Fast paths for the most common forms (without subparameters).
+  if (!sequence.subparameter_mask) {
+    if (n <= 1u) {
+      // E.g., CSI m, CSI 1 m, CSI 31 m.
+      ApplySgrParameter(n ? parameters[0] : 0u, pen);
+      return;
+    }
+    if (n == 3u && parameters[1] == 5u &&
+        (parameters[0] == 38u || parameters[0] == 48u)) {
+      // CSI 38;5;n m.
+      SetColor256(parameters[0], parameters[2], pen);
+      return;
+    }
+    if (n == 5u && parameters[1] == 2u &&
+        (parameters[0] == 38u || parameters[0] == 48u)) {
+      // CSI 38;2;r;g;b m.
+      SetColorRgb(parameters[0], parameters[2], parameters[3], parameters[4],
+                  pen);
+      return;
+    }
+  }
+
+  size_t i = 0u;
+  while (i < n) {
+    const uint32_t parameter = parameters[i];
+    // Count the subparameters (if any) following this parameter.
+    size_t num_subparameters = 0u;
+    while (sequence.is_subparameter(i + 1u + num_subparameters))
+      num_subparameters++;
+
+    if (parameter == 38u || parameter == 48u || parameter == 58u) {
+      if (num_subparameters) {
+        ApplyExtendedColorSubparameters(sequence, i, num_subparameters, pen);
+        i += 1u + num_subparameters;
+        continue;
+      }
+      // The semicolon-separated form.
+      if (i + 2u < n && parameters[i + 1u] == 5u) {
+        SetColor256(parameter, parameters[i + 2u], pen);
+        i += 3u;
+        continue;
+      }
+      if (i + 4u < n && parameters[i + 1u] == 2u) {
+        SetColorRgb(parameter, parameters[i + 2u], parameters[i + 3u],
+                    parameters[i + 4u], pen);
+        i += 5u;
+        continue;
+      }
+      // Malformed: like XTerm, ignore the rest of the sequence.
+      return;
+    }
+
+    if (parameter == 4u && num_subparameters)
+      ApplyUnderlineStyle(parameters[i + 1u], pen);
+    else
+      ApplySgrParameter(parameter, pen);
+    i += 1u + num_subparameters;
+  }
+}
+
+}  // namespace vtlib
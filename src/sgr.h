@@ -0,0 +1,26 @@
+#ifndef VTLIB_SRC_SGR_H_
+#define VTLIB_SRC_SGR_H_
+
+#include <vtlib/cell.h>
+
+#include "src/vt_parser.h"
+
+namespace vtlib {
+
+// Applies the SGR ("select graphic rendition") control sequence |sequence|
+// (CSI ... m) to the attributes and colors of |pen| (its codepoint is left
+// alone). Supported:
+//   - 0: reset; 1-5, 7-9, 21: set attributes (see |Character::Attribute|);
+//     22-25, 27-29: reset them; 4:0-4:5 (underline styles, approximated)
+//   - 30-37, 90-97 (40-47, 100-107): ANSI_16 foreground (background) colors;
+//     39 (49): default foreground (background) color
+//   - 38;5;n and 38;2;r;g;b (48;...), and their colon-separated forms (e.g.,
+//     38:5:n, 38:2:r:g:b, 38:2::r:g:b): 256-color (see |Color256()|) and RGB
+//     colors
+// Anything else is ignored. Nothing is allocated: this is called every few
+// characters in colorized output.
+void ApplySgr(const VtParser::Sequence& sequence, Cell* pen);
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_SGR_H_
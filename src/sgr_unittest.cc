@@ -0,0 +1,156 @@
+#include "src/sgr.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/character.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/color.h>
+
+#include "src/vt_parser.h"
+
+namespace vtlib {
+namespace {
+
+using Attribute = Character::Attribute;
+
+// Applies control sequences (for which it's the |VtParser|'s delegate) to a
+// pen.
+class SgrDelegate : public VtParser::Delegate {
+ public:
+  explicit SgrDelegate(Cell* pen) : pen_(pen) {}
+  ~SgrDelegate() override = default;
+
+  // |VtParser::Delegate| implementation:
+  void Print(const Codepoint* codepoints, size_t num_codepoints) override {}
+  void Execute(Codepoint codepoint) override {}
+  void EscDispatch(const VtParser::Sequence& sequence) override {}
+  void CsiDispatch(const VtParser::Sequence& sequence) override {
+    ASSERT_EQ(static_cast<Codepoint>('m'), sequence.final);
+    ApplySgr(sequence, pen_);
+  }
+  void OscDispatch(const Codepoint* data, size_t size) override {}
+  void DcsHook(const VtParser::Sequence& sequence) override {}
+  void DcsPut(Codepoint codepoint) override {}
+  void DcsUnhook() override {}
+
+ private:
+  Cell* const pen_;
+};
+
+// Applies "CSI |parameters| m" to |pen| and returns the result.
+Cell Sgr(const std::string& parameters, Cell pen = Cell()) {
+  SgrDelegate delegate(&pen);
+  VtParser parser(&delegate);
+  std::string s = "\x1b[" + parameters + "m";
+  for (char c : s) {
+    Codepoint codepoint = static_cast<Codepoint>(c);
+    parser.Parse(&codepoint, 1u);
+  }
+  return pen;
+}
+
+Cell MakeCell(Attribute attribute, const Color& fg, const Color& bg) {
+  return Cell(Character(attribute), fg, bg);
+}
+
+Color Ansi(uint32_t index) {
+  return Color(Color::Type::ANSI_16, index);
+}
+
+Color Rgb(uint32_t rgb) {
+  return Color(Color::Type::RGB, rgb);
+}
+
+TEST(SgrTest, Attributes) {
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Color(), Color()), Sgr("1"));
+  EXPECT_EQ(MakeCell(Attribute::BOLD | Attribute::ITALICIZED | Attribute::BLINK,
+                     Color(), Color()),
+            Sgr("1;3;5"));
+  EXPECT_EQ(MakeCell(Attribute::FAINT | Attribute::INVERSE |
+                         Attribute::INVISIBLE | Attribute::CROSSED_OUT,
+                     Color(), Color()),
+            Sgr("2;7;8;9"));
+  EXPECT_EQ(MakeCell(Attribute::DOUBLY_UNDERLINE, Color(), Color()),
+            Sgr("4;21"));
+  EXPECT_EQ(MakeCell(Attribute::UNDERLINED, Color(), Color()), Sgr("21;4"));
+
+  Cell all = Sgr("1;2;3;4;5;7;8;9");
+  EXPECT_EQ(Cell(), Sgr("22;23;24;25;27;28;29", all));
+  EXPECT_EQ(MakeCell(Attribute::ITALICIZED, Color(), Color()),
+            Sgr("22;24;25;27;28;29", all));
+
+  // Underline styles.
+  EXPECT_EQ(MakeCell(Attribute::UNDERLINED, Color(), Color()), Sgr("4:3"));
+  EXPECT_EQ(MakeCell(Attribute::DOUBLY_UNDERLINE, Color(), Color()),
+            Sgr("4:2"));
+  EXPECT_EQ(Cell(), Sgr("4:0", Sgr("4")));
+
+  // Unsupported parameters are ignored.
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Color(), Color()), Sgr("6;1;10;20;73"));
+}
+
+TEST(SgrTest, Reset) {
+  Cell pen = Sgr("1;31;42");
+  EXPECT_EQ(Cell(), Sgr("", pen));
+  EXPECT_EQ(Cell(), Sgr("0", pen));
+  // A missing parameter is 0.
+  EXPECT_EQ(MakeCell(Attribute::ITALICIZED, Color(), Color()), Sgr(";3", pen));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Ansi(1u), Color()), Sgr("1;31;0;31"));
+
+  // The codepoint is left alone.
+  pen.set_character(Character(Attribute::BOLD, 'x'));
+  EXPECT_EQ(Cell(Character(Attribute::NONE, 'x'), Color(), Color()),
+            Sgr("0", pen));
+}
+
+TEST(SgrTest, Ansi16Colors) {
+  EXPECT_EQ(MakeCell(Attribute::NONE, Ansi(1u), Color()), Sgr("31"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Ansi(7u), Ansi(0u)), Sgr("37;40"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Ansi(8u), Ansi(15u)), Sgr("90;107"));
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Ansi(2u), Color()), Sgr("01;32"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Color(), Ansi(4u)),
+            Sgr("39", Sgr("33;44")));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Ansi(3u), Color()),
+            Sgr("49", Sgr("33;44")));
+}
+
+TEST(SgrTest, ExtendedColors) {
+  // 256 colors.
+  EXPECT_EQ(MakeCell(Attribute::NONE, Ansi(9u), Color()), Sgr("38;5;9"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Color(), Rgb(0xff8700u)),
+            Sgr("48;5;208"));
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Rgb(0x000000u), Rgb(0xeeeeeeu)),
+            Sgr("1;38;5;16;48;5;255"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Rgb(0x5fd7ffu), Color()),
+            Sgr("38:5:81"));
+
+  // RGB.
+  EXPECT_EQ(MakeCell(Attribute::NONE, Rgb(0x0a141eu), Color()),
+            Sgr("38;2;10;20;30"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Rgb(0x0a141eu), Rgb(0x010203u)),
+            Sgr("38;2;10;20;30;48;2;1;2;3"));
+  EXPECT_EQ(MakeCell(Attribute::UNDERLINED, Color(), Rgb(0xff0000u)),
+            Sgr("48:2:255:0:0;4"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Rgb(0x102030u), Color()),
+            Sgr("38:2::16:32:48"));
+  EXPECT_EQ(MakeCell(Attribute::NONE, Rgb(0x102030u), Color()),
+            Sgr("38:2:0:16:32:48"));
+
+  // Underline colors are ignored (but consumed).
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Color(), Color()), Sgr("58;5;3;1"));
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Color(), Color()), Sgr("58:2::1:2:3;1"));
+
+  // Out of range or malformed.
+  EXPECT_EQ(Cell(), Sgr("38;5;256"));
+  EXPECT_EQ(Cell(), Sgr("38;2;1;2;256"));
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Color(), Color()), Sgr("1;38;3;4"));
+  EXPECT_EQ(MakeCell(Attribute::BOLD, Color(), Color()), Sgr("1;38;2;1;2"));
+}
+
+}  // namespace
+}  // namespace vtlib
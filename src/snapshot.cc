@@ -0,0 +1,100 @@
+#include <vtlib/snapshot.h>
+
+#include <assert.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace vtlib {
+
+Snapshot::Snapshot(uint64_t generation,
+                   RowNumber viewport_top,
+                   uint32_t rows,
+                   ColumnNumber columns,
+                   RowNumber cursor_row,
+                   ColumnNumber cursor_column)
+    : generation_(generation),
+      viewport_top_(viewport_top),
+      columns_(columns),
+      cursor_row_(cursor_row),
+      cursor_column_(cursor_column),
+      rows_(rows) {}
+
+Snapshot::~Snapshot() = default;
+
+void Snapshot::SetRow(uint32_t i, const Cell* cells) {
+  assert(i < rows());
+  std::shared_ptr<Row> row(new Row());
+  row->generation = generation_;
+  row->cells.assign(cells, cells + columns_);
+  rows_[i] = std::move(row);
+}
+
+const Codepoint* Snapshot::GetCluster(uint32_t i,
+                                     Codepoint cluster,
+                                     size_t* num_codepoints) const {
+  assert(i < rows());
+  const Row& row = *rows_[i];
+  auto it = std::lower_bound(
+      row.clusters.begin(), row.clusters.end(), cluster,
+      [](const Cluster& a, Codepoint b) { return a.cluster < b; });
+  assert(it != row.clusters.end() && it->cluster == cluster);
+  *num_codepoints = it->length;
+  return row.cluster_codepoints.data() + it->offset;
+}
+
+void Snapshot::ShareRow(uint32_t i, const Snapshot& other, uint32_t other_i) {
+  assert(i < rows());
+  assert(other_i < other.rows());
+  assert(other.columns_ == columns_);
+  rows_[i] = other.rows_[other_i];
+}
+
+void Snapshot::AddCluster(uint32_t i,
+                          Codepoint cluster,
+                          const Codepoint* codepoints,
+                          size_t num_codepoints) {
+  assert(i < rows());
+  Row& row = *rows_[i];
+  assert(row.generation == generation_);
+  assert(row.clusters.empty() || row.clusters.back().cluster < cluster);
+  Cluster entry;
+  entry.cluster = cluster;
+  entry.offset = static_cast<uint32_t>(row.cluster_codepoints.size());
+  entry.length = static_cast<uint32_t>(num_codepoints);
+  row.clusters.push_back(entry);
+  row.cluster_codepoints.insert(row.cluster_codepoints.end(), codepoints,
+                                codepoints + num_codepoints);
+}
+
+SnapshotHandle::SnapshotHandle(const Snapshot* snapshot,
+                               std::atomic<uint64_t>* reader_count)
+    : snapshot_(snapshot), reader_count_(reader_count) {}
+
+SnapshotHandle::SnapshotHandle(SnapshotHandle&& other)
+    : snapshot_(other.snapshot_), reader_count_(other.reader_count_) {
+  other.snapshot_ = nullptr;
+  other.reader_count_ = nullptr;
+}
+
+SnapshotHandle& SnapshotHandle::operator=(SnapshotHandle&& other) {
+  if (this != &other) {
+    reset();
+    std::swap(snapshot_, other.snapshot_);
+    std::swap(reader_count_, other.reader_count_);
+  }
+  return *this;
+}
+
+SnapshotHandle::~SnapshotHandle() {
+  reset();
+}
+
+void SnapshotHandle::reset() {
+  if (reader_count_)
+    reader_count_->fetch_sub(1u);
+  snapshot_ = nullptr;
+  reader_count_ = nullptr;
+}
+
+}  // namespace vtlib
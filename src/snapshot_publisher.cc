@@ -0,0 +1,73 @@
+#include "src/snapshot_publisher.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <utility>
+
+// Note: All atomic operations are sequentially consistent. In particular, the
+// writer's "store |epoch_|, then load |num_readers_[p]|" and a reader's
+// "increment |num_readers_[p]|, then load |epoch_|" must not be reordered.
+
+namespace vtlib {
+
+SnapshotPublisher::SnapshotPublisher() : epoch_(0u), current_(nullptr) {
+  num_readers_[0].store(0u);
+  num_readers_[1].store(0u);
+}
+
+SnapshotPublisher::~SnapshotPublisher() {
+  assert(!num_readers_[0].load());
+  assert(!num_readers_[1].load());
+}
+
+void SnapshotPublisher::Publish(std::unique_ptr<Snapshot> snapshot) {
+  assert(snapshot);
+  current_.store(snapshot.get());
+  uint64_t epoch = epoch_.load();
+  if (latest_) {
+    Retired retired;
+    retired.epoch = epoch;
+    retired.snapshot = std::move(latest_);
+    retired_.push_back(std::move(retired));
+  }
+  latest_ = std::move(snapshot);
+  epoch_.store(epoch + 1u);
+
+  Reclaim();
+}
+
+SnapshotHandle SnapshotPublisher::Acquire() const {
+  for (;;) {
+    uint64_t epoch = epoch_.load();
+    std::atomic<uint64_t>* reader_count = &num_readers_[epoch % 2u];
+    reader_count->fetch_add(1u);
+    if (epoch_.load() == epoch) {
+      const Snapshot* snapshot = current_.load();
+      if (!snapshot) {
+        reader_count->fetch_sub(1u);
+        return SnapshotHandle();
+      }
+      return SnapshotHandle(snapshot, reader_count);
+    }
+    // The epoch changed, so the writer may already have checked (and
+    // disregarded) |*reader_count|. Try again.
+    reader_count->fetch_sub(1u);
+  }
+}
+
+void SnapshotPublisher::Reclaim() {
+  // Parity |(epoch - 1) % 2| no longer gets new readers, so if its count is 0,
+  // all the readers that registered with that parity (in an epoch before
+  // |epoch|) are done.
+  uint64_t epoch = epoch_.load();
+  size_t parity = static_cast<size_t>((epoch - 1u) % 2u);
+  if (!num_readers_[parity].load())
+    drained_before_[parity] = epoch;
+
+  uint64_t drained_before = std::min(drained_before_[0], drained_before_[1]);
+  while (!retired_.empty() && retired_.front().epoch < drained_before)
+    retired_.pop_front();
+}
+
+}  // namespace vtlib
@@ -0,0 +1,77 @@
+#ifndef VTLIB_SRC_SNAPSHOT_PUBLISHER_H_
+#define VTLIB_SRC_SNAPSHOT_PUBLISHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#include <vtlib/snapshot.h>
+
+namespace vtlib {
+
+// Publishes |Snapshot|s from one ("writer") thread to any number of ("reader")
+// threads, RCU-style: readers get the latest snapshot without locking (and
+// without blocking the writer), and snapshots that have been replaced are
+// reclaimed (by the writer, when it next publishes) once no reader can still be
+// using them.
+//
+// Reclamation is epoch-based. The writer advances |epoch_| on each publish. A
+// reader registers in |num_readers_[epoch % 2]| (and then checks that the
+// epoch didn't change, retrying if it did) before loading |current_|, and
+// stays registered until it's done with the snapshot. A snapshot replaced in
+// epoch E can only be in use by readers that registered in an epoch <= E, so
+// it can be reclaimed once the writer has seen each parity's count drop to 0
+// after that parity stopped receiving new readers.
+class SnapshotPublisher {
+ public:
+  SnapshotPublisher();
+  // No reader may still hold a snapshot.
+  ~SnapshotPublisher();
+
+  SnapshotPublisher(const SnapshotPublisher&) = delete;
+  SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+  // Writer thread only:
+
+  // Returns the most recently published snapshot (or null if none).
+  const Snapshot* latest() const { return latest_.get(); }
+  // Publishes |snapshot| (replacing |latest()|), and reclaims replaced
+  // snapshots that are no longer in use.
+  void Publish(std::unique_ptr<Snapshot> snapshot);
+  // The number of replaced snapshots not yet reclaimed.
+  size_t num_retired() const { return retired_.size(); }
+
+  // Any thread:
+
+  // Returns a handle to the latest snapshot (or a null handle if none has
+  // been published). This is lock-free.
+  SnapshotHandle Acquire() const;
+
+ private:
+  struct Retired {
+    // The epoch in which |snapshot| was replaced.
+    uint64_t epoch;
+    std::unique_ptr<Snapshot> snapshot;
+  };
+
+  void Reclaim();
+
+  std::atomic<uint64_t> epoch_;
+  mutable std::atomic<uint64_t> num_readers_[2];
+  std::atomic<const Snapshot*> current_;
+
+  // The following are only accessed by the writer thread.
+
+  std::unique_ptr<Snapshot> latest_;
+  std::deque<Retired> retired_;
+  // Readers with epoch of parity p and less than |drained_before_[p]| are known
+  // to be done.
+  uint64_t drained_before_[2] = {0u, 0u};
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_SNAPSHOT_PUBLISHER_H_
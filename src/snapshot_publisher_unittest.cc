@@ -0,0 +1,245 @@
+#include "src/snapshot_publisher.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/snapshot.h>
+#include <vtlib/terminal.h>
+
+namespace vtlib {
+namespace {
+
+std::unique_ptr<Snapshot> MakeSnapshot(uint64_t generation) {
+  std::unique_ptr<Snapshot> snapshot(
+      new Snapshot(generation, 0u, 1u, 1u, 0u, 0u));
+  Cell cell;
+  snapshot->SetRow(0u, &cell);
+  return snapshot;
+}
+
+TEST(SnapshotPublisherTest, Basic) {
+  SnapshotPublisher publisher;
+  EXPECT_FALSE(publisher.latest());
+  EXPECT_FALSE(publisher.Acquire());
+
+  publisher.Publish(MakeSnapshot(1u));
+  SnapshotHandle handle = publisher.Acquire();
+  ASSERT_TRUE(handle);
+  EXPECT_EQ(1u, handle->generation());
+  EXPECT_EQ(publisher.latest(), handle.get());
+
+  // A handle keeps referring to the same snapshot.
+  publisher.Publish(MakeSnapshot(2u));
+  EXPECT_EQ(1u, handle->generation());
+  EXPECT_EQ(2u, publisher.Acquire()->generation());
+
+  SnapshotHandle handle2 = std::move(handle);
+  EXPECT_FALSE(handle);
+  EXPECT_EQ(1u, handle2->generation());
+  handle2.reset();
+  EXPECT_FALSE(handle2);
+}
+
+TEST(SnapshotPublisherTest, Reclamation) {
+  SnapshotPublisher publisher;
+  for (uint64_t i = 1u; i <= 10u; i++)
+    publisher.Publish(MakeSnapshot(i));
+  // Without readers, replaced snapshots are reclaimed promptly.
+  EXPECT_LE(publisher.num_retired(), 2u);
+
+  // Snapshots can't be reclaimed while a reader may be using them.
+  SnapshotHandle handle = publisher.Acquire();
+  for (uint64_t i = 11u; i <= 20u; i++)
+    publisher.Publish(MakeSnapshot(i));
+  EXPECT_GE(publisher.num_retired(), 10u);
+  EXPECT_EQ(10u, handle->generation());
+
+  handle.reset();
+  for (uint64_t i = 21u; i <= 23u; i++)
+    publisher.Publish(MakeSnapshot(i));
+  EXPECT_LE(publisher.num_retired(), 2u);
+}
+
+bool ProcessString(Terminal* terminal, const std::string& s) {
+  return terminal->ProcessBytes(reinterpret_cast<const uint8_t*>(s.data()),
+                                s.size());
+}
+
+TEST(SnapshotPublisherTest, TerminalSnapshots) {
+  Terminal::Options options;
+  options.rows = 3u;
+  options.columns = 4u;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  EXPECT_FALSE(terminal->AcquireSnapshot());
+
+  ProcessString(terminal.get(), "ab\r\ncd");
+  terminal->PublishSnapshot();
+  SnapshotHandle snapshot1 = terminal->AcquireSnapshot();
+  ASSERT_TRUE(snapshot1);
+  EXPECT_EQ(1u, snapshot1->generation());
+  EXPECT_EQ(0u, snapshot1->viewport_top());
+  EXPECT_EQ(3u, snapshot1->rows());
+  EXPECT_EQ(4u, snapshot1->columns());
+  EXPECT_EQ(1u, snapshot1->cursor_row());
+  EXPECT_EQ(2u, snapshot1->cursor_column());
+  EXPECT_EQ('b', snapshot1->GetRow(0u)[1].character().codepoint());
+  EXPECT_EQ('d', snapshot1->GetRow(1u)[1].character().codepoint());
+
+  // Only the changed row is copied.
+  ProcessString(terminal.get(), "e");
+  terminal->PublishSnapshot();
+  SnapshotHandle snapshot2 = terminal->AcquireSnapshot();
+  EXPECT_EQ(2u, snapshot2->generation());
+  EXPECT_EQ(snapshot1->GetRow(0u), snapshot2->GetRow(0u));
+  EXPECT_EQ(1u, snapshot2->GetRowGeneration(0u));
+  EXPECT_NE(snapshot1->GetRow(1u), snapshot2->GetRow(1u));
+  EXPECT_EQ(2u, snapshot2->GetRowGeneration(1u));
+  EXPECT_EQ('e', snapshot2->GetRow(1u)[2].character().codepoint());
+  // The old snapshot is unchanged.
+  EXPECT_EQ(0u, snapshot1->GetRow(1u)[2].character().codepoint());
+
+  // After scrolling, rows keep their row numbers (and are still shared).
+  ProcessString(terminal.get(), "\r\n\r\nf");
+  terminal->PublishSnapshot();
+  SnapshotHandle snapshot3 = terminal->AcquireSnapshot();
+  EXPECT_EQ(1u, snapshot3->viewport_top());
+  EXPECT_EQ(snapshot2->GetRow(1u), snapshot3->GetRow(0u));
+  EXPECT_EQ(snapshot2->GetRow(2u), snapshot3->GetRow(1u));
+  EXPECT_EQ('f', snapshot3->GetRow(2u)[0].character().codepoint());
+  EXPECT_EQ(3u, snapshot3->GetRowGeneration(2u));
+}
+
+// Returns the codepoints of cluster |cluster| in row |i| of |snapshot|.
+std::vector<Codepoint> GetSnapshotCluster(const Snapshot& snapshot,
+                                          uint32_t i,
+                                          Codepoint cluster) {
+  size_t num_codepoints;
+  const Codepoint* codepoints =
+      snapshot.GetCluster(i, cluster, &num_codepoints);
+  return std::vector<Codepoint>(codepoints, codepoints + num_codepoints);
+}
+
+// Snapshots keep their own copies of the grapheme clusters that they use, which
+// stay valid after the terminal has reclaimed them (and reused their values).
+TEST(SnapshotPublisherTest, TerminalSnapshotClusters) {
+  Terminal::Options options;
+  options.rows = 2u;
+  options.columns = 10u;
+  options.scrollback_rows = 0u;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+
+  // "e" with a combining acute accent (U+0301).
+  ProcessString(terminal.get(), "e\xcc\x81");
+  terminal->PublishSnapshot();
+  SnapshotHandle snapshot1 = terminal->AcquireSnapshot();
+  const Codepoint cluster1 = snapshot1->GetRow(0u)[0].character().codepoint();
+  ASSERT_TRUE(IsClusterCodepoint(cluster1));
+  EXPECT_EQ((std::vector<Codepoint>{'e', 0x301u}),
+            GetSnapshotCluster(*snapshot1, 0u, cluster1));
+
+  // Print enough other clusters (each a letter and one of the combining marks
+  // U+0300 to U+036F) for the first one to be garbage collected.
+  std::string s;
+  for (uint32_t i = 0u; i < 2000u; i++) {
+    const uint32_t mark = 0x300u + (i / 26u) % 0x70u;
+    s += static_cast<char>('a' + i % 26u);
+    s += static_cast<char>(0xc0u | (mark >> 6u));
+    s += static_cast<char>(0x80u | (mark & 0x3fu));
+  }
+  ProcessString(terminal.get(), s);
+  EXPECT_LT(terminal->GetMemoryUsage().num_clusters, 1000u);
+  terminal->PublishSnapshot();
+  SnapshotHandle snapshot2 = terminal->AcquireSnapshot();
+
+  // The old snapshot is unaffected.
+  EXPECT_EQ(cluster1, snapshot1->GetRow(0u)[0].character().codepoint());
+  EXPECT_EQ((std::vector<Codepoint>{'e', 0x301u}),
+            GetSnapshotCluster(*snapshot1, 0u, cluster1));
+  // The new one has the current clusters.
+  for (uint32_t i = 0u; i < snapshot2->rows(); i++) {
+    for (ColumnNumber j = 0u; j < snapshot2->columns(); j++) {
+      const Codepoint cluster = snapshot2->GetRow(i)[j].character().codepoint();
+      if (!IsClusterCodepoint(cluster))
+        continue;
+      size_t num_codepoints;
+      const Codepoint* codepoints =
+          terminal->GetCluster(cluster, &num_codepoints);
+      EXPECT_EQ(std::vector<Codepoint>(codepoints, codepoints + num_codepoints),
+                GetSnapshotCluster(*snapshot2, i, cluster));
+    }
+  }
+}
+
+// Checks that each row of |snapshot| is either blank or all the same
+// character.
+void CheckStressSnapshot(const Snapshot& snapshot) {
+  for (uint32_t i = 0u; i < snapshot.rows(); i++) {
+    ASSERT_LE(snapshot.GetRowGeneration(i), snapshot.generation());
+    const Cell* cells = snapshot.GetRow(i);
+    for (ColumnNumber j = 1u; j < snapshot.columns(); j++) {
+      ASSERT_EQ(cells[0].character().codepoint(),
+                cells[j].character().codepoint())
+          << "generation " << snapshot.generation() << ", row " << i;
+    }
+  }
+}
+
+// A producer thread writes lines to a terminal (publishing a snapshot after
+// each batch), while a consumer thread repeatedly takes snapshots and checks
+// them. Run this under ThreadSanitizer (e.g., with |is_tsan = true|).
+TEST(SnapshotPublisherTest, Stress) {
+  const ColumnNumber kColumns = 40u;
+  const int kNumBatches = 2000;
+  const int kLinesPerBatch = 7;
+
+  Terminal::Options options;
+  options.rows = 10u;
+  options.columns = kColumns;
+  options.scrollback_rows = 100u;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  std::atomic<bool> done(false);
+
+  std::thread producer([&terminal, &done]() {
+    int line = 0;
+    for (int i = 0; i < kNumBatches; i++) {
+      std::string s;
+      for (int j = 0; j < kLinesPerBatch; j++, line++) {
+        // Each line is entirely one character (and fills its row).
+        s += std::string(kColumns, static_cast<char>('a' + line % 26));
+        s += "\r\n";
+      }
+      ProcessString(terminal.get(), s);
+      terminal->PublishSnapshot();
+    }
+    done.store(true);
+  });
+
+  uint64_t last_generation = 0u;
+  uint64_t num_snapshots = 0u;
+  while (!done.load()) {
+    SnapshotHandle snapshot = terminal->AcquireSnapshot();
+    if (!snapshot)
+      continue;
+    num_snapshots++;
+    EXPECT_GE(snapshot->generation(), last_generation);
+    last_generation = snapshot->generation();
+    CheckStressSnapshot(*snapshot);
+  }
+  producer.join();
+
+  EXPECT_GT(num_snapshots, 0u);
+  EXPECT_EQ(static_cast<uint64_t>(kNumBatches),
+            terminal->AcquireSnapshot()->generation());
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,108 @@
+#include "src/style_table.h"
+
+#include <assert.h>
+
+#include <vtlib/character.h>
+#include <vtlib/color.h>
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kHashTableSize = 4096u;
+static_assert(!(kHashTableSize & (kHashTableSize - 1u)),
+              "kHashTableSize must be a power of 2");
+static_assert(kHashTableSize >= 2u * StyleTable::kMaxStyles,
+              "kHashTableSize is too small");
+
+uint32_t ColorToRaw(const Color& color) {
+  return (static_cast<uint32_t>(color.type()) << 24u) | color.data();
+}
+
+size_t HashStyle(const Cell& cell) {
+  uint64_t h = static_cast<uint32_t>(cell.character().attribute());
+  h = h * 0x9e3779b97f4a7c15u + ColorToRaw(cell.fg());
+  h = h * 0x9e3779b97f4a7c15u + ColorToRaw(cell.bg());
+  return static_cast<size_t>((h * 0x9e3779b97f4a7c15u) >> 32u);
+}
+
+// Returns |cell| with codepoint 0.
+Cell GetStyle(const Cell& cell) {
+  return Cell(Character(cell.character().attribute()), cell.fg(), cell.bg());
+}
+
+}  // namespace
+
+constexpr size_t StyleTable::kMaxStyles;
+constexpr uint16_t StyleTable::kEmpty;
+
+StyleTable::StyleTable() : styles_(1u), hash_table_(kHashTableSize, kEmpty) {
+  Insert(0u);
+}
+
+StyleTable::~StyleTable() = default;
+
+bool StyleTable::Intern(const Cell& cell, uint32_t* style_index) {
+  Cell style = GetStyle(cell);
+  size_t position = Find(style);
+  if (hash_table_[position] != kEmpty) {
+    *style_index = hash_table_[position];
+    return true;
+  }
+
+  if (!free_list_.empty()) {
+    *style_index = free_list_.back();
+    free_list_.pop_back();
+    styles_[*style_index] = style;
+  } else if (styles_.size() < kMaxStyles) {
+    *style_index = static_cast<uint32_t>(styles_.size());
+    styles_.push_back(style);
+  } else {
+    return false;
+  }
+  hash_table_[position] = static_cast<uint16_t>(*style_index);
+  return true;
+}
+
+void StyleTable::BeginGarbageCollection() {
+  marks_.assign(styles_.size(), false);
+  marks_[0] = true;
+}
+
+void StyleTable::EndGarbageCollection() {
+  assert(marks_.size() == styles_.size());
+  free_list_.clear();
+  hash_table_.assign(kHashTableSize, kEmpty);
+  // Add the free indices in decreasing order, so that lower indices get
+  // reused first.
+  for (size_t i = styles_.size(); i-- > 0u;) {
+    if (marks_[i]) {
+      Insert(static_cast<uint32_t>(i));
+    } else {
+      styles_[i] = Cell();
+      free_list_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  marks_.clear();
+}
+
+size_t StyleTable::GetMemoryUsage() const {
+  return sizeof(*this) + styles_.capacity() * sizeof(Cell) +
+         free_list_.capacity() * sizeof(uint32_t) + marks_.capacity() / 8u +
+         hash_table_.capacity() * sizeof(uint16_t);
+}
+
+size_t StyleTable::Find(const Cell& cell) const {
+  size_t position = HashStyle(cell) & (kHashTableSize - 1u);
+  while (hash_table_[position] != kEmpty &&
+         styles_[hash_table_[position]] != cell)
+    position = (position + 1u) & (kHashTableSize - 1u);
+  return position;
+}
+
+void StyleTable::Insert(uint32_t style_index) {
+  size_t position = Find(styles_[style_index]);
+  assert(hash_table_[position] == kEmpty);
+  hash_table_[position] = static_cast<uint16_t>(style_index);
+}
+
+}  // namespace vtlib
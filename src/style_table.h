@@ -0,0 +1,77 @@
+#ifndef VTLIB_SRC_STYLE_TABLE_H_
+#define VTLIB_SRC_STYLE_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <vtlib/cell.h>
+
+#include "src/compact_cell.h"
+
+namespace vtlib {
+
+// A table of interned "styles" (attributes and foreground and background
+// colors, represented as a |Cell| with codepoint 0), for use with
+// |CompactCell|. Style 0 is always the default style (|Cell()|). (The largest
+// |CompactCell| style index isn't used; see |CompactCell::kOverflowStyleIndex|.)
+//
+// Unused styles are reclaimed by (mark-and-sweep) garbage collection, driven by
+// the owner of the cells: when |Intern()| fails because the table is full, the
+// owner calls |BeginGarbageCollection()|, then |Mark()| for every style index
+// still in use, and then |EndGarbageCollection()|.
+class StyleTable {
+ public:
+  static constexpr size_t kMaxStyles = CompactCell::kOverflowStyleIndex;
+
+  StyleTable();
+  ~StyleTable();
+
+  StyleTable(const StyleTable&) = delete;
+  StyleTable& operator=(const StyleTable&) = delete;
+
+  // Looks up (adding if necessary) the style of |cell| (its codepoint is
+  // ignored), storing its index in |*style_index|. Returns false (only) if the
+  // style isn't present and the table is full.
+  bool Intern(const Cell& cell, uint32_t* style_index);
+
+  // Returns the style with index |style_index| (which must be in use).
+  const Cell& Get(uint32_t style_index) const {
+    return styles_[style_index];
+  }
+
+  // The number of styles in use (including the default style).
+  size_t num_styles() const { return styles_.size() - free_list_.size(); }
+
+  void BeginGarbageCollection();
+  void Mark(uint32_t style_index) { marks_[style_index] = true; }
+  void EndGarbageCollection();
+
+  // Returns the (approximate) number of bytes of memory used.
+  size_t GetMemoryUsage() const;
+
+ private:
+  // Returns the position in |hash_table_| for |cell|: either the one
+  // containing its index or the (empty) one where it should be added.
+  size_t Find(const Cell& cell) const;
+  void Insert(uint32_t style_index);
+
+  // Indexed by style index. Free entries are in |free_list_| (and are set to
+  // |Cell()|).
+  std::vector<Cell> styles_;
+  std::vector<uint32_t> free_list_;
+  // Used for garbage collection (indexed by style index).
+  std::vector<bool> marks_;
+
+  // An open-addressing (linear probing) hash table of style indices (with
+  // |kEmpty| for empty entries); its size is a power of 2, at least twice
+  // |kMaxStyles|. It is rebuilt after garbage collection (so there are no
+  // deletions).
+  static constexpr uint16_t kEmpty = 0xffffu;
+  std::vector<uint16_t> hash_table_;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_STYLE_TABLE_H_
@@ -0,0 +1,108 @@
+#include "src/style_table.h"
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/character.h>
+#include <vtlib/color.h>
+
+namespace vtlib {
+namespace {
+
+Cell MakeStyle(uint32_t n, uint32_t codepoint = 0u) {
+  return Cell(Character(Character::Attribute::BOLD, codepoint),
+              Color(Color::Type::RGB, n), Color(Color::Type::ANSI_16, 3u));
+}
+
+TEST(StyleTableTest, Intern) {
+  StyleTable table;
+  EXPECT_EQ(1u, table.num_styles());
+  EXPECT_EQ(Cell(), table.Get(0u));
+
+  // The default style is always 0 (whatever the codepoint).
+  uint32_t index = 123u;
+  EXPECT_TRUE(table.Intern(Cell(), &index));
+  EXPECT_EQ(0u, index);
+  EXPECT_TRUE(table.Intern(
+      Cell(Character(Character::Attribute::NONE, 'x'), Color(), Color()),
+      &index));
+  EXPECT_EQ(0u, index);
+
+  // Codepoints are ignored.
+  uint32_t index1;
+  EXPECT_TRUE(table.Intern(MakeStyle(1u, 'a'), &index1));
+  EXPECT_NE(0u, index1);
+  EXPECT_EQ(MakeStyle(1u), table.Get(index1));
+  EXPECT_TRUE(table.Intern(MakeStyle(1u, 'b'), &index));
+  EXPECT_EQ(index1, index);
+  EXPECT_EQ(2u, table.num_styles());
+
+  // Attributes and both colors matter.
+  uint32_t index2;
+  EXPECT_TRUE(table.Intern(MakeStyle(2u), &index2));
+  EXPECT_NE(index1, index2);
+  uint32_t index3;
+  EXPECT_TRUE(table.Intern(
+      Cell(Character(Character::Attribute::ITALICIZED), Color(Color::Type::RGB, 1u),
+           Color(Color::Type::ANSI_16, 3u)),
+      &index3));
+  EXPECT_NE(index1, index3);
+  EXPECT_NE(index2, index3);
+  uint32_t index4;
+  EXPECT_TRUE(table.Intern(Cell(Character(Character::Attribute::BOLD),
+                                Color(Color::Type::RGB, 1u), Color()),
+                           &index4));
+  EXPECT_NE(index1, index4);
+  EXPECT_EQ(5u, table.num_styles());
+}
+
+TEST(StyleTableTest, Full) {
+  StyleTable table;
+  uint32_t index;
+  for (uint32_t i = 1u; i < StyleTable::kMaxStyles; i++) {
+    ASSERT_TRUE(table.Intern(MakeStyle(i), &index));
+    EXPECT_EQ(i, index);
+  }
+  EXPECT_EQ(StyleTable::kMaxStyles, table.num_styles());
+  EXPECT_FALSE(table.Intern(MakeStyle(0u), &index));
+  // Existing styles can still be looked up.
+  EXPECT_TRUE(table.Intern(MakeStyle(100u), &index));
+  EXPECT_EQ(100u, index);
+}
+
+TEST(StyleTableTest, GarbageCollection) {
+  StyleTable table;
+  uint32_t index;
+  for (uint32_t i = 1u; i < StyleTable::kMaxStyles; i++)
+    ASSERT_TRUE(table.Intern(MakeStyle(i), &index));
+
+  // Keep only the odd styles.
+  table.BeginGarbageCollection();
+  for (uint32_t i = 1u; i < StyleTable::kMaxStyles; i += 2u)
+    table.Mark(i);
+  table.EndGarbageCollection();
+  EXPECT_EQ(1u + StyleTable::kMaxStyles / 2u, table.num_styles());
+  for (uint32_t i = 1u; i < StyleTable::kMaxStyles; i += 2u) {
+    EXPECT_EQ(MakeStyle(i), table.Get(i));
+    EXPECT_TRUE(table.Intern(MakeStyle(i), &index));
+    EXPECT_EQ(i, index);
+  }
+
+  // Freed indices get reused (lowest first).
+  EXPECT_TRUE(table.Intern(MakeStyle(100000u), &index));
+  EXPECT_EQ(2u, index);
+  EXPECT_EQ(MakeStyle(100000u), table.Get(2u));
+  EXPECT_TRUE(table.Intern(MakeStyle(4u), &index));
+  EXPECT_EQ(4u, index);
+
+  // The default style is never collected.
+  table.BeginGarbageCollection();
+  table.EndGarbageCollection();
+  EXPECT_EQ(1u, table.num_styles());
+  EXPECT_TRUE(table.Intern(Cell(), &index));
+  EXPECT_EQ(0u, index);
+}
+
+}  // namespace
+}  // namespace vtlib
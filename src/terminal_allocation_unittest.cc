@@ -0,0 +1,122 @@
+// Checks that, once warmed up, processing output doesn't allocate from the
+// heap. This replaces the global |operator new| (to count allocations), so it's
+// a separate test binary.
+
+#include <vtlib/terminal.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::atomic<uint64_t> g_num_allocations(0u);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_num_allocations++;
+  void* rv = malloc(size ? size : 1u);
+  if (!rv)
+    abort();
+  return rv;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+namespace vtlib {
+namespace {
+
+// Output with colors, wide characters, and grapheme clusters (a different
+// cluster in each line, so that the cluster table keeps getting garbage
+// collected).
+std::string MakeOutput(uint32_t n) {
+  std::string rv;
+  for (uint32_t i = 0u; i < 100u; i++, n++) {
+    rv += "\x1b[1;3" + std::to_string(n % 8u) + "mline " + std::to_string(n) +
+          "\x1b[m \xe4\xb8\x80\xe4\xba\x8c some more text ";
+    // "e" followed by 1 to 4 combining marks (U+0300 to U+030F).
+    rv += "e";
+    for (uint32_t j = 0u; j <= n % 4u; j++) {
+      rv += "\xcc";
+      rv += static_cast<char>(0x80u + (n / 4u + j) % 16u);
+    }
+    // An emoji ZWJ sequence.
+    rv += " \xf0\x9f\x91\xa9\xe2\x80\x8d\xf0\x9f\x92\xbb\r\n";
+  }
+  return rv;
+}
+
+void ProcessString(Terminal* terminal, const std::string& s) {
+  terminal->ProcessBytes(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+  terminal->reset_display_updates();
+}
+
+TEST(TerminalAllocationTest, NoAllocationsAfterWarmUp) {
+  for (bool compress : {false, true}) {
+    Terminal::Options options;
+    options.rows = 24u;
+    options.columns = 80u;
+    options.scrollback_rows = 2000u;
+    options.hot_scrollback_rows = 500u;
+    options.compress_scrollback = compress;
+    std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+
+    // Prepare the output up front (so that building it doesn't count).
+    std::string outputs[10];
+    for (uint32_t i = 0u; i < 10u; i++)
+      outputs[i] = MakeOutput(i * 100u);
+
+    // Warm up: fill the scrollback (several times over).
+    for (uint32_t i = 0u; i < 100u; i++)
+      ProcessString(terminal.get(), outputs[i % 10u]);
+    Terminal::AllocationStats stats = terminal->GetAllocationStats();
+    EXPECT_GT(stats.num_chunks_in_use, 0u);
+
+    uint64_t num_allocations = g_num_allocations;
+    for (uint32_t i = 0u; i < 100u; i++)
+      ProcessString(terminal.get(), outputs[i % 10u]);
+    EXPECT_EQ(num_allocations, g_num_allocations) << "compress " << compress;
+    EXPECT_EQ(stats.num_slab_allocations,
+              terminal->GetAllocationStats().num_slab_allocations);
+    EXPECT_GT(terminal->GetAllocationStats().num_chunk_allocations,
+              stats.num_chunk_allocations);
+  }
+}
+
+TEST(TerminalAllocationTest, NoAllocationsSwitchingScreens) {
+  Terminal::Options options;
+  options.rows = 24u;
+  options.columns = 80u;
+  options.scrollback_rows = 2000u;
+  options.hot_scrollback_rows = 500u;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+
+  // Like running a full-screen program (e.g., an editor) on the alternate
+  // screen, and then returning to the shell.
+  const std::string output = "\x1b[?1049h" + MakeOutput(0u) + "\x1b[?1049l" +
+                             MakeOutput(100u);
+  for (uint32_t i = 0u; i < 100u; i++)
+    ProcessString(terminal.get(), output);
+
+  uint64_t num_allocations = g_num_allocations;
+  for (uint32_t i = 0u; i < 100u; i++)
+    ProcessString(terminal.get(), output);
+  EXPECT_EQ(num_allocations, g_num_allocations);
+}
+
+}  // namespace
+}  // namespace vtlib
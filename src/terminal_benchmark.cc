@@ -0,0 +1,198 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <vtlib/terminal.h>
+
+#include "testing/benchmark_corpora.h"
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kCorpusSize = 1u << 20;  // 1 MiB.
+// Feed input in chunks of this size (like reads from a PTY).
+constexpr size_t kChunkSize = 4096u;
+
+// Measures |Terminal::ProcessBytes()| (i.e., decoding, parsing, and updating
+// the screen) end to end.
+void BM_ProcessBytes(benchmark::State& state,
+                     Corpus corpus,
+                     Terminal::CellStorage cell_storage) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  Terminal::Options options;
+  options.rows = 50u;
+  options.columns = 200u;
+  options.cell_storage = cell_storage;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  for (auto _ : state) {
+    for (size_t i = 0u; i < input.size(); i += kChunkSize) {
+      size_t n = input.size() - i < kChunkSize ? input.size() - i : kChunkSize;
+      benchmark::DoNotOptimize(terminal->ProcessBytes(input.data() + i, n));
+    }
+    terminal->reset_display_updates();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+// Measures output like that of |yes|, which is dominated by scrolling: with
+// enough iterations the scrollback fills up, which shouldn't make a difference.
+void BM_ProcessBytesYes(benchmark::State& state) {
+  std::vector<uint8_t> input;
+  while (input.size() < kCorpusSize) {
+    input.push_back('y');
+    input.push_back('\r');
+    input.push_back('\n');
+  }
+  Terminal::Options options;
+  options.rows = 50u;
+  options.columns = 200u;
+  options.scrollback_rows = static_cast<uint32_t>(state.range(0));
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        terminal->ProcessBytes(input.data(), input.size()));
+    terminal->reset_display_updates();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+BENCHMARK(BM_ProcessBytesYes)->Arg(0)->Arg(10000);
+
+// Fills the scrollback with a corpus, and then measures reading all of it
+// (most of which is in the compact "cold" tier). Also reports the memory used
+// per row by each tier.
+void BM_ReadScrollback(benchmark::State& state,
+                       Corpus corpus,
+                       bool compress_scrollback) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, 8u * kCorpusSize);
+  Terminal::Options options;
+  options.rows = 50u;
+  options.columns = 200u;
+  options.scrollback_rows = 100000u;
+  options.hot_scrollback_rows = 1000u;
+  options.compress_scrollback = compress_scrollback;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  terminal->ProcessBytes(input.data(), input.size());
+
+  for (auto _ : state) {
+    for (RowNumber row = terminal->scrollback_top();
+         row < terminal->viewport_top(); row++)
+      benchmark::DoNotOptimize(terminal->GetRow(row));
+  }
+
+  Terminal::MemoryUsage memory_usage = terminal->GetMemoryUsage();
+  state.counters["hot_bytes_per_row"] =
+      static_cast<double>(memory_usage.hot_scrollback_bytes) /
+      static_cast<double>(memory_usage.num_hot_scrollback_rows);
+  state.counters["cold_bytes_per_row"] =
+      static_cast<double>(memory_usage.cold_scrollback_bytes) /
+      static_cast<double>(memory_usage.num_cold_scrollback_rows);
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) *
+      static_cast<int64_t>(terminal->viewport_top() -
+                           terminal->scrollback_top()));
+}
+
+BENCHMARK_CAPTURE(BM_ReadScrollback, ascii, Corpus::ASCII, false);
+BENCHMARK_CAPTURE(BM_ReadScrollback, ascii_compressed, Corpus::ASCII, true);
+BENCHMARK_CAPTURE(BM_ReadScrollback,
+                  control_dense_compressed,
+                  Corpus::CONTROL_DENSE,
+                  true);
+
+// Measures reading the viewport and the "hot" scrollback (e.g., as when
+// repainting), for each |Terminal::CellStorage|. Also reports the memory used
+// per hot row.
+void BM_ReadHotRows(benchmark::State& state,
+                    Corpus corpus,
+                    Terminal::CellStorage cell_storage) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  Terminal::Options options;
+  options.rows = 50u;
+  options.columns = 200u;
+  options.scrollback_rows = 1000u;
+  options.hot_scrollback_rows = 1000u;
+  options.cell_storage = cell_storage;
+  std::unique_ptr<Terminal> terminal = Terminal::Create(options);
+  terminal->ProcessBytes(input.data(), input.size());
+
+  const RowNumber bottom = terminal->viewport_top() + options.rows;
+  for (auto _ : state) {
+    for (RowNumber row = terminal->scrollback_top(); row < bottom; row++)
+      benchmark::DoNotOptimize(terminal->GetRow(row));
+  }
+
+  Terminal::MemoryUsage memory_usage = terminal->GetMemoryUsage();
+  state.counters["hot_bytes_per_row"] =
+      static_cast<double>(memory_usage.hot_scrollback_bytes) /
+      static_cast<double>(memory_usage.num_hot_scrollback_rows);
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations()) *
+      static_cast<int64_t>(bottom - terminal->scrollback_top()));
+}
+
+BENCHMARK_CAPTURE(BM_ReadHotRows,
+                  ascii_full,
+                  Corpus::ASCII,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ReadHotRows,
+                  ascii_compact,
+                  Corpus::ASCII,
+                  Terminal::CellStorage::COMPACT);
+BENCHMARK_CAPTURE(BM_ReadHotRows,
+                  control_dense_full,
+                  Corpus::CONTROL_DENSE,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ReadHotRows,
+                  control_dense_compact,
+                  Corpus::CONTROL_DENSE,
+                  Terminal::CellStorage::COMPACT);
+
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  ascii,
+                  Corpus::ASCII,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  latin_cjk,
+                  Corpus::LATIN_CJK,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  emoji,
+                  Corpus::EMOJI,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  control_dense,
+                  Corpus::CONTROL_DENSE,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  colorized_log,
+                  Corpus::COLORIZED_LOG,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  full_screen_tui,
+                  Corpus::FULL_SCREEN_TUI,
+                  Terminal::CellStorage::FULL);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  ascii_compact,
+                  Corpus::ASCII,
+                  Terminal::CellStorage::COMPACT);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  control_dense_compact,
+                  Corpus::CONTROL_DENSE,
+                  Terminal::CellStorage::COMPACT);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  colorized_log_compact,
+                  Corpus::COLORIZED_LOG,
+                  Terminal::CellStorage::COMPACT);
+BENCHMARK_CAPTURE(BM_ProcessBytes,
+                  full_screen_tui_compact,
+                  Corpus::FULL_SCREEN_TUI,
+                  Terminal::CellStorage::COMPACT);
+
+}  // namespace
+}  // namespace vtlib
@@ -2,22 +2,302 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
+#include <utility>
+
+#include "src/character_width.h"
+#include "src/reflow.h"
+#include "src/sgr.h"
+
 namespace vtlib {
+namespace {
+
+// |ProcessBytes()| decodes up to this many codepoints at a time before
+// dispatching them.
+constexpr size_t kCodepointBatchSize = 1024u;
+
+// Initially (and in columns added by resizing), horizontal tab stops are at
+// every |kTabWidth| columns.
+constexpr ColumnNumber kTabWidth = 8u;
+
+// Beyond this many (unmerged) scrolls in |DisplayUpdates::scrolls|, the whole
+// viewport is just marked dirty instead.
+constexpr size_t kMaxScrolls = 32u;
+
+// |cluster_table_| isn't garbage collected until it has at least this many
+// clusters.
+constexpr size_t kMinClustersForGarbageCollection = 1024u;
+// Codepoints beyond this many (e.g., in "Zalgo" text) aren't added to a
+// grapheme cluster.
+constexpr size_t kMaxClusterLength = 32u;
+
+constexpr Codepoint kZeroWidthJoiner = 0x200du;
+
+// Emoji modifiers (the skin tones) belong to the preceding character.
+bool IsEmojiModifier(Codepoint codepoint) {
+  return codepoint >= 0x1f3fbu && codepoint <= 0x1f3ffu;
+}
+
+// A pair of regional indicators is a flag.
+bool IsRegionalIndicator(Codepoint codepoint) {
+  return codepoint >= 0x1f1e6u && codepoint <= 0x1f1ffu;
+}
+
+// Returns true if |row| of |buffer| is empty (and isn't wrapped).
+bool IsEmptyRow(const ScreenBuffer& buffer, RowNumber row) {
+  if (buffer.IsRowWrapped(row))
+    return false;
+  const Cell* cells = buffer.GetRow(row);
+  return std::all_of(cells, cells + buffer.columns(),
+                     [](const Cell& cell) { return cell == Cell(); });
+}
+
+}  // namespace
 
 TerminalImpl::TerminalImpl(const Options& options)
     : options_(options),
-      character_decoder_(CharacterDecoder::Create(options.character_encoding)) {
+      character_decoder_(CharacterDecoder::Create(options.character_encoding)),
+      vt_parser_(this),
+      screen_buffer_(ScreenBuffer::Create(
+          options.rows,
+          options.columns,
+          std::min(options.hot_scrollback_rows, options.scrollback_rows),
+          options.cell_storage)),
+      inactive_screen_buffer_(ScreenBuffer::Create(options.rows,
+                                                   options.columns,
+                                                   0u,
+                                                   options.cell_storage)),
+      cold_scrollback_(new ColdScrollback(
+          options.scrollback_rows - screen_buffer_->scrollback_capacity(),
+          options.columns,
+          options.compress_scrollback,
+          options.columns * sizeof(Cell))),
+      cold_row_(new Cell[options.columns]),
+      print_row_(new Codepoint[options.columns]),
+      scroll_bottom_(options.rows),
+      cluster_gc_threshold_(kMinClustersForGarbageCollection) {
   codepoints_.reserve(10u);  // Pick a random number; 10 should be plenty.
+  ResizeTabStops(options.columns);
+
+  display_updates_.row_damage = RowDamage(options.rows, options.columns);
+  snapshot_damage_ = RowDamage(options.rows, options.columns);
 
-//FIXME mark the whole viewport dirty
+  MarkDirty(screen_buffer_->first_row(),
+            screen_buffer_->first_row() + screen_buffer_->rows(), 0u,
+            screen_buffer_->columns());
 }
 
 TerminalImpl::~TerminalImpl() = default;
 
+const Cell* TerminalImpl::GetRow(RowNumber row) const {
+  if (screen_buffer_->IsViewportRow(row))
+    return screen_buffer_->GetRow(row);
+  const ScreenBuffer* main_screen = main_screen_buffer();
+  if (row >= main_screen->scrollback_top())
+    return main_screen->GetRow(row);
+
+  // (If this reflows the row's block, |scrollback_top()| may change; see
+  // |ColdScrollback::GetRow()|.)
+  assert(row >= scrollback_top());
+  cold_scrollback_->GetRow(static_cast<size_t>(row - scrollback_top()),
+                           cold_row_.get(), screen_buffer_->columns());
+  return cold_row_.get();
+}
+
+bool TerminalImpl::IsRowWrapped(RowNumber row) const {
+  if (screen_buffer_->IsViewportRow(row))
+    return screen_buffer_->IsRowWrapped(row);
+  const ScreenBuffer* main_screen = main_screen_buffer();
+  if (row >= main_screen->scrollback_top())
+    return main_screen->IsRowWrapped(row);
+
+  assert(row >= scrollback_top());
+  bool wrapped = false;
+  cold_scrollback_->GetRowLength(static_cast<size_t>(row - scrollback_top()),
+                                 &wrapped);
+  return wrapped;
+}
+
+Terminal::MemoryUsage TerminalImpl::GetMemoryUsage() const {
+  const ScreenBuffer* main_screen = main_screen_buffer();
+  const ScreenBuffer* alternate_screen = alternate_screen_active_
+                                             ? screen_buffer_.get()
+                                             : inactive_screen_buffer_.get();
+  MemoryUsage rv;
+  rv.viewport_bytes = static_cast<size_t>(main_screen->rows()) *
+                      main_screen->columns() * main_screen->cell_size();
+  rv.alternate_screen_bytes = alternate_screen->GetMemoryUsage();
+  rv.num_hot_scrollback_rows = main_screen->num_scrollback_rows();
+  rv.hot_scrollback_bytes = main_screen->GetMemoryUsage() - rv.viewport_bytes;
+  rv.num_cold_scrollback_rows = cold_scrollback_->num_rows();
+  rv.cold_scrollback_bytes = cold_scrollback_->GetMemoryUsage();
+  rv.num_clusters = cluster_table_.num_clusters();
+  rv.cluster_bytes = cluster_table_.GetMemoryUsage();
+  return rv;
+}
+
+Terminal::AllocationStats TerminalImpl::GetAllocationStats() const {
+  const BlockPool::Stats& stats = cold_scrollback_->chunk_pool_stats();
+  AllocationStats rv;
+  rv.num_slab_allocations = stats.num_slab_allocations;
+  rv.num_chunk_allocations = stats.num_block_allocations;
+  rv.num_chunks_in_use = stats.num_blocks_in_use;
+  rv.num_free_chunks = stats.num_free_blocks;
+  return rv;
+}
+
+void TerminalImpl::Resize(uint32_t rows, ColumnNumber columns) {
+  assert(rows > 0u);
+  assert(columns > 0u);
+  if (rows == screen_buffer_->rows() && columns == screen_buffer_->columns())
+    return;
+
+  RowNumber cursor_row = 0u;
+  ColumnNumber cursor_x = 0u;
+  std::unique_ptr<ScreenBuffer> main_screen =
+      ReflowMainScreen(rows, columns, &cursor_row, &cursor_x);
+  std::unique_ptr<ScreenBuffer> alternate_screen =
+      ResizeAlternateScreen(rows, columns);
+
+  if (alternate_screen_active_) {
+    cursor_y_ = std::min(cursor_y_, rows - 1u);
+    cursor_x_ = std::min(cursor_x_, columns - 1u);
+  } else {
+    // (If the cursor's line is taller than the viewport, the cursor may have
+    // ended up in the scrollback.)
+    cursor_y_ = cursor_row < main_screen->first_row()
+                    ? 0u
+                    : static_cast<uint32_t>(cursor_row -
+                                            main_screen->first_row());
+    cursor_x_ = cursor_x;
+  }
+  wrap_pending_ = false;
+  zwj_pending_ = false;
+  scroll_top_ = 0u;
+  scroll_bottom_ = rows;
+  ResizeTabStops(columns);
+
+  // Renumber the rows, leaving room for the cold scrollback to fill (e.g., as
+  // it's reflowed) without |scrollback_top()| going below 0.
+  const RowNumber first_row = std::max(
+      screen_buffer_->first_row(),
+      main_screen->num_scrollback_rows() + cold_scrollback_->capacity());
+  main_screen->set_first_row(first_row);
+  alternate_screen->set_first_row(first_row);
+  if (alternate_screen_active_) {
+    screen_buffer_ = std::move(alternate_screen);
+    inactive_screen_buffer_ = std::move(main_screen);
+  } else {
+    screen_buffer_ = std::move(main_screen);
+    inactive_screen_buffer_ = std::move(alternate_screen);
+  }
+
+  options_.rows = rows;
+  options_.columns = columns;
+  cold_row_.reset(new Cell[columns]);
+  print_row_.reset(new Codepoint[columns]);
+
+  // Everything needs to be redrawn.
+  display_updates_.dirty = Rectangle();
+  display_updates_.row_damage = RowDamage(rows, columns, first_row);
+  display_updates_.scrolls.clear();
+  snapshot_damage_ = RowDamage(rows, columns, first_row);
+  MarkDirty(first_row, first_row + rows, 0u, columns);
+}
+
+void TerminalImpl::reset_display_updates() {
+  display_updates_.bell_count = 0u;
+  display_updates_.dirty = Rectangle();
+  display_updates_.row_damage.Clear();
+  display_updates_.scrolls.clear();
+  // If a synchronized update timed out, (a partial frame was just drawn and)
+  // it's over: updates are no longer held back until the next one.
+  if (display_updates_.synchronized_update && !InSynchronizedUpdate())
+    display_updates_.synchronized_update = false;
+}
+
+void TerminalImpl::PublishSnapshot() {
+  if (InSynchronizedUpdate())
+    return;
+  const RowNumber top = screen_buffer_->first_row();
+  const uint32_t rows = screen_buffer_->rows();
+  std::unique_ptr<Snapshot> snapshot(
+      new Snapshot(++snapshot_generation_, top, rows, screen_buffer_->columns(),
+                   cursor_row(), cursor_x_));
+  // Rows that are unchanged (and were in the previous snapshot) are shared.
+  const Snapshot* previous = snapshot_publisher_.latest();
+  for (uint32_t i = 0u; i < rows; i++) {
+    RowNumber row = top + i;
+    if (previous && row >= previous->viewport_top() &&
+        row - previous->viewport_top() < previous->rows() &&
+        !snapshot_damage_.IsRowDirty(row)) {
+      snapshot->ShareRow(
+          i, *previous, static_cast<uint32_t>(row - previous->viewport_top()));
+    } else {
+      const Cell* cells = screen_buffer_->GetRow(row);
+      snapshot->SetRow(i, cells);
+      AddSnapshotClusters(cells, i, snapshot.get());
+    }
+  }
+  snapshot_damage_.Clear();
+  snapshot_publisher_.Publish(std::move(snapshot));
+}
+
+void TerminalImpl::AddSnapshotClusters(const Cell* cells,
+                                       uint32_t i,
+                                       Snapshot* snapshot) {
+  snapshot_clusters_.clear();
+  for (ColumnNumber j = 0u; j < screen_buffer_->columns(); j++) {
+    const Codepoint codepoint = cells[j].character().codepoint();
+    if (IsClusterCodepoint(codepoint))
+      snapshot_clusters_.push_back(codepoint);
+  }
+  if (snapshot_clusters_.empty())
+    return;
+  std::sort(snapshot_clusters_.begin(), snapshot_clusters_.end());
+  snapshot_clusters_.erase(
+      std::unique(snapshot_clusters_.begin(), snapshot_clusters_.end()),
+      snapshot_clusters_.end());
+  for (Codepoint cluster : snapshot_clusters_) {
+    size_t num_codepoints;
+    const Codepoint* codepoints = cluster_table_.Get(cluster, &num_codepoints);
+    snapshot->AddCluster(i, cluster, codepoints, num_codepoints);
+  }
+}
+
 bool TerminalImpl::ProcessByte(uint8_t input_byte) {
+  return ProcessBytes(&input_byte, 1u);
+}
+
+bool TerminalImpl::ProcessBytes(const uint8_t* input_bytes,
+                                size_t num_input_bytes) {
   assert(codepoints_.empty());
-  character_decoder_->ProcessByte(input_byte, &codepoints_);
-  return ProcessCodepoints();
+  CharacterDecoder* decoder = character_decoder_.get();
+  bool supports_8bit_C1 = decoder->Supports8bitC1();
+  bool have_state_changes = false;
+  Codepoint codepoints[kCodepointBatchSize];
+  while (num_input_bytes) {
+    size_t num_codepoints = 0u;
+    size_t num_consumed =
+        decoder->Decode(input_bytes, num_input_bytes, codepoints,
+                        kCodepointBatchSize, &num_codepoints);
+    have_state_changes |= ProcessCodepoints(codepoints, num_codepoints);
+    input_bytes += num_consumed;
+    num_input_bytes -= num_consumed;
+
+    if (num_input_bytes &&
+        CharacterDecoder::is_control_code(*input_bytes, supports_8bit_C1)) {
+      have_state_changes |= ProcessControlByte(*input_bytes);
+      input_bytes++;
+      num_input_bytes--;
+    } else {
+      // Otherwise, |Decode()| must have stopped due to lack of output space.
+      assert(num_consumed);
+    }
+  }
+  return have_state_changes;
 }
 
 bool TerminalImpl::options_set_character_encoding(
@@ -30,17 +310,898 @@ bool TerminalImpl::options_set_character_encoding(
   return rv;
 }
 
+bool TerminalImpl::ProcessControlByte(uint8_t control_byte) {
+  assert(codepoints_.empty());
+  // Control codes interrupt any partially-decoded character.
+  character_decoder_->Flush(&codepoints_);
+  if (CharacterDecoder::is_C0_control_code(control_byte) ||
+      options_.accept_8bit_C1)
+    codepoints_.push_back(static_cast<Codepoint>(control_byte));
+  else  // Let the decoder handle 8-bit C1 control codes that we don't accept.
+    character_decoder_->ProcessByte(control_byte, &codepoints_);
+  return ProcessCodepoints();
+}
+
 bool TerminalImpl::ProcessCodepoints() {
-  bool have_state_changes = false;
-  for (auto codepoint : codepoints_)
-    have_state_changes |= ProcessCodepoint(codepoint);
+  bool have_state_changes = ProcessCodepoints(codepoints_.data(),
+                                              codepoints_.size());
   codepoints_.clear();
   return have_state_changes;
 }
 
-bool TerminalImpl::ProcessCodepoint(Codepoint codepoint) {
+bool TerminalImpl::ProcessCodepoints(const Codepoint* codepoints,
+                                     size_t num_codepoints) {
+  have_state_changes_ = false;
+  vt_parser_.Parse(codepoints, num_codepoints);
+  return have_state_changes_;
+}
+
+void TerminalImpl::WrapLine() {
+  screen_buffer_->SetRowWrapped(screen_buffer_->first_row() + cursor_y_, true);
+  cursor_x_ = 0u;
+  LineFeed();
+}
+
+void TerminalImpl::LineFeed() {
+  if (cursor_y_ + 1u != scroll_bottom_) {
+    // (Below the scrolling region, the cursor stops at the bottom row.)
+    if (cursor_y_ + 1u < screen_buffer_->rows())
+      cursor_y_++;
+    return;
+  }
+
+  // Only the main screen's rows go to the scrollback.
+  if (scroll_top_ || scroll_bottom_ != screen_buffer_->rows() ||
+      alternate_screen_active_) {
+    ShiftRows(scroll_top_, scroll_bottom_, 1);
+    return;
+  }
+  ScrollUp();
+  RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  MarkDirty(row, row + 1u, 0u, screen_buffer_->columns());
+}
+
+void TerminalImpl::ReverseIndex() {
+  if (cursor_y_ == scroll_top_)
+    ShiftRows(scroll_top_, scroll_bottom_, -1);
+  else if (cursor_y_ > 0u)
+    cursor_y_--;
+}
+
+void TerminalImpl::ScrollUp() {
+  assert(!alternate_screen_active_);
+  ScrollUpScreenBuffer(screen_buffer_.get(), ErasedCell());
+  display_updates_.row_damage.ScrollUp(1u);
+  snapshot_damage_.ScrollUp(1u);
+  AddScroll(0u, screen_buffer_->rows(), 1);
+
+  if (cluster_table_.num_clusters() &&
+      ++num_scrolls_since_cluster_gc_ >=
+          static_cast<size_t>(options_.rows) + options_.scrollback_rows)
+    CollectClusterGarbage();
+}
+
+void TerminalImpl::ScrollUpScreenBuffer(ScreenBuffer* buffer,
+                                        const Cell& fill) {
+  if (buffer->num_scrollback_rows() == buffer->scrollback_capacity()) {
+    const RowNumber row = buffer->scrollback_top();
+    cold_scrollback_->AppendRow(buffer->GetRow(row), buffer->columns(),
+                                buffer->IsRowWrapped(row));
+  }
+  buffer->ScrollUp(1u, fill);
+}
+
+std::unique_ptr<ScreenBuffer> TerminalImpl::ReflowMainScreen(
+    uint32_t rows,
+    ColumnNumber columns,
+    RowNumber* cursor_row,
+    ColumnNumber* cursor_x) {
+  const ScreenBuffer& old_buffer = *main_screen_buffer();
+  std::unique_ptr<ScreenBuffer> buffer =
+      ScreenBuffer::Create(rows, columns, old_buffer.scrollback_capacity(),
+                           options_.cell_storage);
+
+  // The cursor's position in its line (if the main screen is active). If a
+  // wrap is pending, that's just past the last character printed.
+  const bool track_cursor = !alternate_screen_active_;
+  const RowNumber old_cursor_row = old_buffer.first_row() + cursor_y_;
+  size_t cursor_offset = 0u;
+
+  // The cold scrollback is reflowed lazily (see |ColdScrollback|), except for
+  // its last line if that continues in the hot scrollback (or the viewport):
+  // it's joined with the rest of its line here.
+  std::vector<Cell> line;
+  cold_scrollback_->RemoveUnfinishedLine(&line);
+  cold_scrollback_->set_columns(columns);
+
+  // The empty rows at the bottom of the viewport (below the cursor) are
+  // dropped, so that they don't push the rows above them into the scrollback.
+  // (But if there's a line from the cold scrollback, the first row is kept, so
+  // that the line is laid out even if the rest of it is empty.)
+  const RowNumber min_end = old_buffer.first_row() + (line.empty() ? 0u : 1u);
+  RowNumber end = old_buffer.first_row() + old_buffer.rows();
+  while (end > min_end &&
+         !(track_cursor && end - 1u == old_cursor_row) &&
+         IsEmptyRow(old_buffer, end - 1u))
+    end--;
+
+  // The rows of the hot scrollback and the viewport are gathered into lines,
+  // which are laid out in rows of the new width, filling the new buffer's
+  // viewport from the top; once it's full, each further row scrolls it up (so
+  // the oldest rows move to its scrollback, and then to the cold scrollback).
+  std::vector<Cell> new_cells(columns);
+  uint32_t num_rows_written = 0u;
+  for (RowNumber row = old_buffer.scrollback_top(); row < end; row++) {
+    const bool cursor_in_line = track_cursor && row == old_cursor_row;
+    if (cursor_in_line)
+      cursor_offset = line.size() + cursor_x_ + (wrap_pending_ ? 1u : 0u);
+    const bool wrapped = old_buffer.IsRowWrapped(row) && row + 1u < end;
+    AppendRowToLine(old_buffer.GetRow(row), old_buffer.columns(), wrapped,
+                    &line);
+    if (wrapped)
+      continue;
+
+    // Make sure that the cursor's cell is in the line.
+    if (cursor_in_line && line.size() <= cursor_offset)
+      line.resize(cursor_offset + 1u);
+    size_t offset = 0u;
+    bool more;
+    do {
+      const size_t row_begin = offset;
+      more = LayOutRow(line, &offset, columns, new_cells.data());
+      if (num_rows_written == rows)
+        ScrollUpScreenBuffer(buffer.get(), Cell());
+      else
+        num_rows_written++;
+      const RowNumber new_row = buffer->first_row() + num_rows_written - 1u;
+      buffer->SetCells(new_row, 0u, new_cells.data(), columns);
+      buffer->SetRowWrapped(new_row, more);
+      if (cursor_in_line && cursor_offset >= row_begin &&
+          (cursor_offset < offset || !more)) {
+        *cursor_row = new_row;
+        *cursor_x = static_cast<ColumnNumber>(
+            std::min(cursor_offset - row_begin, size_t{columns - 1u}));
+      }
+    } while (more);
+    line.clear();
+  }
+  return buffer;
+}
+
+std::unique_ptr<ScreenBuffer> TerminalImpl::ResizeAlternateScreen(
+    uint32_t rows,
+    ColumnNumber columns) {
+  const ScreenBuffer& old_buffer = alternate_screen_active_
+                                       ? *screen_buffer_
+                                       : *inactive_screen_buffer_;
+  std::unique_ptr<ScreenBuffer> buffer =
+      ScreenBuffer::Create(rows, columns, 0u, options_.cell_storage);
+  const ColumnNumber n = std::min(columns, old_buffer.columns());
+  for (uint32_t i = 0u; i < std::min(rows, old_buffer.rows()); i++) {
+    const Cell* cells = old_buffer.GetRow(old_buffer.first_row() + i);
+    buffer->SetCells(i, 0u, cells, n);
+    // Don't leave half of a wide character at the right edge.
+    if (n < old_buffer.columns() &&
+        cells[n].character().codepoint() == CODEPOINT_WIDE_PADDING)
+      buffer->FillCells(i, n - 1u, n, Cell());
+  }
+  return buffer;
+}
+
+void TerminalImpl::ResizeTabStops(ColumnNumber columns) {
+  const ColumnNumber old_columns =
+      static_cast<ColumnNumber>(tab_stops_.size());
+  tab_stops_.resize(columns);
+  for (ColumnNumber i = old_columns; i < columns; i++)
+    tab_stops_[i] = i % kTabWidth == 0u;
+}
+
+void TerminalImpl::SaveCursor() {
+  saved_cursor_.y = cursor_y_;
+  saved_cursor_.x = cursor_x_;
+  saved_cursor_.wrap_pending = wrap_pending_;
+  saved_cursor_.pen = pen_;
+}
+
+void TerminalImpl::RestoreCursor() {
+  cursor_y_ = std::min(saved_cursor_.y, screen_buffer_->rows() - 1u);
+  cursor_x_ = std::min(saved_cursor_.x, screen_buffer_->columns() - 1u);
+  wrap_pending_ = saved_cursor_.wrap_pending;
+  pen_ = saved_cursor_.pen;
+}
+
+void TerminalImpl::SwitchScreen(bool alternate) {
+  if (alternate == alternate_screen_active_)
+    return;
+
+  const RowNumber first_row = screen_buffer_->first_row();
+  std::swap(screen_buffer_, inactive_screen_buffer_);
+  std::swap(saved_cursor_, inactive_saved_cursor_);
+  alternate_screen_active_ = alternate;
+  // (The main screen doesn't scroll while the alternate screen is active, so
+  // its row numbers are still right.)
+  screen_buffer_->set_first_row(first_row);
+  zwj_pending_ = false;
+
+  // Everything needs to be redrawn, so moves of the other screen's rows don't
+  // matter.
+  display_updates_.scrolls.clear();
+  MarkDirty(first_row, first_row + screen_buffer_->rows(), 0u,
+            screen_buffer_->columns());
+}
+
+void TerminalImpl::AddScroll(uint32_t top, uint32_t bottom, int32_t count) {
+  std::vector<DisplayUpdates::Scroll>& scrolls = display_updates_.scrolls;
+  const int32_t max_count = static_cast<int32_t>(bottom - top);
+  if (!scrolls.empty() && scrolls.back().top == top &&
+      scrolls.back().bottom == bottom) {
+    int32_t merged_count = scrolls.back().count + count;
+    scrolls.back().count =
+        std::max(-max_count, std::min(merged_count, max_count));
+    if (!scrolls.back().count)
+      scrolls.pop_back();
+    return;
+  }
+
+  if (scrolls.size() == kMaxScrolls) {
+    // Give up on describing the moves: everything needs to be redrawn.
+    scrolls.clear();
+    RowNumber first_row = screen_buffer_->first_row();
+    MarkDirty(first_row, first_row + screen_buffer_->rows(), 0u,
+              screen_buffer_->columns());
+    return;
+  }
+  scrolls.push_back(DisplayUpdates::Scroll(
+      top, bottom, std::max(-max_count, std::min(count, max_count))));
+}
+
+void TerminalImpl::MarkDirty(RowNumber top,
+                             RowNumber bottom,
+                             ColumnNumber left,
+                             ColumnNumber right) {
+  for (RowNumber row = top; row < bottom; row++)
+    display_updates_.row_damage.MarkDirty(row, left, right);
+  MarkChanged(top, bottom, left, right);
+}
+
+void TerminalImpl::MarkChanged(RowNumber top,
+                               RowNumber bottom,
+                               ColumnNumber left,
+                               ColumnNumber right) {
+  Rectangle& dirty = display_updates_.dirty;
+  if (dirty.is_empty()) {
+    dirty.top = top;
+    dirty.bottom = bottom;
+    dirty.left = left;
+    dirty.right = right;
+  } else {
+    dirty.top = std::min(dirty.top, top);
+    dirty.bottom = std::max(dirty.bottom, bottom);
+    dirty.left = std::min(dirty.left, left);
+    dirty.right = std::max(dirty.right, right);
+  }
+
+  for (RowNumber row = top; row < bottom; row++)
+    snapshot_damage_.MarkDirty(row, left, right);
+}
+
+void TerminalImpl::Print(const Codepoint* codepoints, size_t num_codepoints) {
+  const ColumnNumber columns = screen_buffer_->columns();
+  while (num_codepoints) {
+    // Combining characters (and some wide ones, e.g., emoji modifiers) are
+    // added to the preceding character's grapheme cluster.
+    const CharacterWidth width = GetCharacterWidth(*codepoints);
+    if (width == CharacterWidth::COMBINING ||
+        (width == CharacterWidth::WIDE && JoinsPrecedingCluster(*codepoints))) {
+      AddToCluster(*codepoints);
+      codepoints++;
+      num_codepoints--;
+      continue;
+    }
+    zwj_pending_ = false;
+
+    if (wrap_pending_) {
+      wrap_pending_ = false;
+      WrapLine();
+    }
+
+    // Write as much as fits on the current row in one go. Runs of narrow
+    // characters (e.g., all of ASCII) are written directly.
+    const ColumnNumber room = columns - cursor_x_;
+    size_t n = CountNarrowCharacters(
+        codepoints, std::min(num_codepoints, static_cast<size_t>(room)));
+    if (n) {
+      WriteAtCursor(codepoints, static_cast<ColumnNumber>(n));
+      codepoints += n;
+      num_codepoints -= n;
+      continue;
+    }
+
+    // Otherwise, lay out the characters (wide ones take two cells), up to the
+    // next combining character, emoji modifier or regional indicator (which
+    // are handled above, once the preceding characters have been written).
+    ColumnNumber num_cells = 0u;
+    bool wrap = false;
+    for (n = 0u; n < num_codepoints && num_cells < room; n++) {
+      const Codepoint codepoint = codepoints[n];
+      const CharacterWidth width = GetCharacterWidth(codepoint);
+      if (width == CharacterWidth::COMBINING)
+        break;
+      if (width == CharacterWidth::NARROW) {
+        print_row_[num_cells++] = codepoint;
+        continue;
+      }
+      if (n && (IsEmojiModifier(codepoint) || IsRegionalIndicator(codepoint)))
+        break;
+      // A wide character can't be displayed with only one column.
+      if (columns < 2u)
+        continue;
+      // If it doesn't fit on the current row, it goes on the next one (and the
+      // last column is blanked, since it's part of the wrapped line).
+      if (room - num_cells < 2u) {
+        wrap = true;
+        break;
+      }
+      print_row_[num_cells++] = codepoint;
+      print_row_[num_cells++] = CODEPOINT_WIDE_PADDING;
+    }
+    if (num_cells)
+      WriteAtCursor(print_row_.get(), num_cells);
+    codepoints += n;
+    num_codepoints -= n;
+    if (wrap) {
+      EraseCells(screen_buffer_->first_row() + cursor_y_, cursor_x_, columns);
+      WrapLine();
+    }
+  }
+  have_state_changes_ = true;
+}
+
+void TerminalImpl::WriteAtCursor(const Codepoint* codepoints,
+                                 ColumnNumber num_cells) {
+  const ColumnNumber columns = screen_buffer_->columns();
+  assert(num_cells <= columns - cursor_x_);
+  RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  ColumnNumber left = cursor_x_;
+  ColumnNumber right = cursor_x_ + num_cells;
+  // Don't leave half of a wide character behind.
+  ExtendToWholeCharacters(row, &left, &right);
+  if (left < cursor_x_)
+    screen_buffer_->FillCells(row, left, cursor_x_, Cell());
+  if (right > cursor_x_ + num_cells)
+    screen_buffer_->FillCells(row, cursor_x_ + num_cells, right, Cell());
+
+  screen_buffer_->WriteCells(row, cursor_x_, codepoints, num_cells, pen_);
+  MarkDirty(row, row + 1u, left, right);
+
+  cursor_x_ += num_cells;
+  if (cursor_x_ == columns) {
+    cursor_x_ = columns - 1u;
+    wrap_pending_ = true;
+  }
+}
+
+bool TerminalImpl::FindPrecedingCharacter(ColumnNumber* column,
+                                          ColumnNumber* width) const {
+  // The preceding character is just before the cursor (or at it, if a wrap is
+  // pending), or in the cell before that if it's wide.
+  if (!wrap_pending_ && !cursor_x_)
+    return false;
+  const RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  *column = wrap_pending_ ? cursor_x_ : cursor_x_ - 1u;
+  *width = 1u;
+  if (*column > 0u &&
+      screen_buffer_->GetCodepoint(row, *column) == CODEPOINT_WIDE_PADDING) {
+    (*column)--;
+    *width = 2u;
+  }
+  return screen_buffer_->GetCodepoint(row, *column) != 0u;
+}
+
+bool TerminalImpl::JoinsPrecedingCluster(Codepoint codepoint) const {
+  const RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  if (zwj_pending_ && row == zwj_cursor_row_ && cursor_x_ == zwj_cursor_x_)
+    return true;
+  if (!IsEmojiModifier(codepoint) && !IsRegionalIndicator(codepoint))
+    return false;
+  ColumnNumber column;
+  ColumnNumber width;
+  if (!FindPrecedingCharacter(&column, &width))
+    return false;
+  // The second regional indicator of a pair joins the first (which isn't
+  // already part of a cluster).
+  return IsEmojiModifier(codepoint) ||
+         IsRegionalIndicator(screen_buffer_->GetCodepoint(row, column));
+}
+
+void TerminalImpl::AddToCluster(Codepoint codepoint) {
+  zwj_pending_ = false;
+  // If there's no preceding character (on the cursor's row), |codepoint| is
+  // dropped.
+  ColumnNumber column;
+  ColumnNumber width;
+  if (!FindPrecedingCharacter(&column, &width))
+    return;
+  const RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  const Codepoint base = screen_buffer_->GetCodepoint(row, column);
+
+  cluster_codepoints_.clear();
+  if (IsClusterCodepoint(base)) {
+    size_t num_codepoints;
+    const Codepoint* codepoints = cluster_table_.Get(base, &num_codepoints);
+    cluster_codepoints_.assign(codepoints, codepoints + num_codepoints);
+  } else {
+    cluster_codepoints_.push_back(base);
+  }
+  if (cluster_codepoints_.size() >= kMaxClusterLength)
+    return;
+  cluster_codepoints_.push_back(codepoint);
+  Codepoint cluster;
+  if (!InternCluster(cluster_codepoints_.data(), cluster_codepoints_.size(),
+                     &cluster))
+    return;
+
+  Cell cell = screen_buffer_->GetRow(row)[column];
+  Character character = cell.character();
+  character.set_codepoint(cluster);
+  cell.set_character(character);
+  screen_buffer_->SetCells(row, column, &cell, 1u);
+  MarkDirty(row, row + 1u, column, column + width);
+
+  if (codepoint == kZeroWidthJoiner && width == 2u) {
+    zwj_pending_ = true;
+    zwj_cursor_row_ = row;
+    zwj_cursor_x_ = cursor_x_;
+  }
+}
+
+bool TerminalImpl::InternCluster(const Codepoint* codepoints,
+                                 size_t num_codepoints,
+                                 Codepoint* cluster) {
+  if (cluster_table_.num_clusters() >= cluster_gc_threshold_)
+    CollectClusterGarbage();
+  if (cluster_table_.Intern(codepoints, num_codepoints, cluster))
+    return true;
+  // The table is full (which takes a pathological number of distinct clusters
+  // in the viewport and the scrollback).
+  CollectClusterGarbage();
+  return cluster_table_.Intern(codepoints, num_codepoints, cluster);
+}
+
+void TerminalImpl::CollectClusterGarbage() {
+  cluster_table_.BeginGarbageCollection();
+  // Clusters on the inactive screen must survive too.
+  for (const ScreenBuffer* buffer :
+       {screen_buffer_.get(), inactive_screen_buffer_.get()}) {
+    const ColumnNumber columns = buffer->columns();
+    for (RowNumber row = buffer->scrollback_top();
+         row < buffer->first_row() + buffer->rows(); row++) {
+      const Cell* cells = buffer->GetRow(row);
+      for (ColumnNumber i = 0u; i < columns; i++) {
+        Codepoint codepoint = cells[i].character().codepoint();
+        if (IsClusterCodepoint(codepoint))
+          cluster_table_.Mark(codepoint);
+      }
+    }
+  }
+  cold_scrollback_->MarkClusters(&cluster_table_);
+  cluster_table_.EndGarbageCollection();
+
+  cluster_gc_threshold_ = std::max(kMinClustersForGarbageCollection,
+                                   2u * cluster_table_.num_clusters());
+  num_scrolls_since_cluster_gc_ = 0u;
+}
+
+void TerminalImpl::EraseInDisplay(uint32_t mode) {
+  const RowNumber first_row = screen_buffer_->first_row();
+  const RowNumber bottom = first_row + screen_buffer_->rows();
+  const RowNumber row = first_row + cursor_y_;
+  const ColumnNumber columns = screen_buffer_->columns();
+  switch (mode) {
+    case 0u:  // From the cursor to the end of the viewport.
+      EraseCells(row, cursor_x_, columns);
+      if (row + 1u < bottom) {
+        screen_buffer_->FillRows(row + 1u, bottom, ErasedCell());
+        MarkDirty(row + 1u, bottom, 0u, columns);
+      }
+      break;
+    case 1u:  // From the start of the viewport to the cursor.
+      if (first_row < row) {
+        screen_buffer_->FillRows(first_row, row, ErasedCell());
+        MarkDirty(first_row, row, 0u, columns);
+      }
+      EraseCells(row, 0u, cursor_x_ + 1u);
+      break;
+    case 2u:  // The whole viewport.
+      screen_buffer_->FillRows(first_row, bottom, ErasedCell());
+      MarkDirty(first_row, bottom, 0u, columns);
+      break;
+    case 3u:  // The scrollback (of the main screen, even if it's inactive).
+      ClearScrollback();
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalImpl::ClearScrollback() {
+  ScreenBuffer* main_screen = alternate_screen_active_
+                                  ? inactive_screen_buffer_.get()
+                                  : screen_buffer_.get();
+  const RowNumber old_scrollback_top = scrollback_top();
+  main_screen->ClearScrollback();
+  cold_scrollback_->Clear();
+  // The viewport keeps its row numbers; the rows above it are gone.
+  MarkDirty(old_scrollback_top, main_screen->first_row(), 0u,
+            main_screen->columns());
+}
+
+void TerminalImpl::EraseInLine(uint32_t mode) {
+  const RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  switch (mode) {
+    case 0u:  // From the cursor to the end of the row.
+      EraseCells(row, cursor_x_, screen_buffer_->columns());
+      break;
+    case 1u:  // From the start of the row to the cursor.
+      EraseCells(row, 0u, cursor_x_ + 1u);
+      break;
+    case 2u:  // The whole row.
+      EraseCells(row, 0u, screen_buffer_->columns());
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalImpl::InsertCharacters(ColumnNumber count) {
+  const ColumnNumber columns = screen_buffer_->columns();
+  const RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  const Cell erased_cell = ErasedCell();
+  ColumnNumber left = cursor_x_;
+  count = std::min(count, columns - cursor_x_);
+  // A wide character at the cursor is split, so it's erased.
+  if (left > 0u &&
+      screen_buffer_->GetCodepoint(row, left) == CODEPOINT_WIDE_PADDING) {
+    left--;
+    screen_buffer_->FillCells(row, left, cursor_x_ + 1u, erased_cell);
+  }
+  // So is one that would be pushed halfway off the end of the row.
+  const bool split_at_end =
+      cursor_x_ + count < columns &&
+      screen_buffer_->GetCodepoint(row, columns - count) ==
+          CODEPOINT_WIDE_PADDING;
+
+  screen_buffer_->MoveCells(row, cursor_x_, cursor_x_ + count,
+                            columns - cursor_x_ - count);
+  screen_buffer_->FillCells(row, cursor_x_, cursor_x_ + count, erased_cell);
+  if (split_at_end)
+    screen_buffer_->FillCells(row, columns - 1u, columns, erased_cell);
+  MarkDirty(row, row + 1u, left, columns);
+  wrap_pending_ = false;
+}
+
+void TerminalImpl::DeleteCharacters(ColumnNumber count) {
+  const ColumnNumber columns = screen_buffer_->columns();
+  const RowNumber row = screen_buffer_->first_row() + cursor_y_;
+  const Cell erased_cell = ErasedCell();
+  ColumnNumber left = cursor_x_;
+  count = std::min(count, columns - cursor_x_);
+  // Wide characters partially deleted (at either end of the deleted cells)
+  // are erased.
+  if (left > 0u &&
+      screen_buffer_->GetCodepoint(row, left) == CODEPOINT_WIDE_PADDING) {
+    left--;
+    screen_buffer_->FillCells(row, left, left + 1u, erased_cell);
+  }
+  const bool split_at_end =
+      cursor_x_ + count < columns &&
+      screen_buffer_->GetCodepoint(row, cursor_x_ + count) ==
+          CODEPOINT_WIDE_PADDING;
+
+  screen_buffer_->MoveCells(row, cursor_x_ + count, cursor_x_,
+                            columns - cursor_x_ - count);
+  screen_buffer_->FillCells(row, columns - count, columns, erased_cell);
+  if (split_at_end)
+    screen_buffer_->FillCells(row, cursor_x_, cursor_x_ + 1u, erased_cell);
+  MarkDirty(row, row + 1u, left, columns);
+  wrap_pending_ = false;
+}
+
+void TerminalImpl::InsertLines(uint32_t count) {
+  // This only works within the scrolling region.
+  if (cursor_y_ < scroll_top_ || cursor_y_ >= scroll_bottom_)
+    return;
+  ShiftRows(cursor_y_, scroll_bottom_,
+            -static_cast<int32_t>(std::min(count, scroll_bottom_ - cursor_y_)));
+  cursor_x_ = 0u;
+  wrap_pending_ = false;
+}
+
+void TerminalImpl::DeleteLines(uint32_t count) {
+  if (cursor_y_ < scroll_top_ || cursor_y_ >= scroll_bottom_)
+    return;
+  ShiftRows(cursor_y_, scroll_bottom_,
+            static_cast<int32_t>(std::min(count, scroll_bottom_ - cursor_y_)));
+  cursor_x_ = 0u;
+  wrap_pending_ = false;
+}
+
+void TerminalImpl::SetDecPrivateMode(uint32_t mode, bool set) {
+  switch (mode) {
+    case 47u:  // Use the alternate screen.
+      SwitchScreen(set);
+      break;
+    case 1047u:  // Use the alternate screen, clearing it when leaving it.
+      if (!set && alternate_screen_active_) {
+        screen_buffer_->FillRows(screen_buffer_->first_row(),
+                                 screen_buffer_->first_row() +
+                                     screen_buffer_->rows(),
+                                 ErasedCell());
+      }
+      SwitchScreen(set);
+      break;
+    case 1049u:  // Save the cursor and use the (cleared) alternate screen.
+      if (set) {
+        if (alternate_screen_active_)
+          break;
+        SaveCursor();
+        SwitchScreen(true);
+        screen_buffer_->FillRows(screen_buffer_->first_row(),
+                                 screen_buffer_->first_row() +
+                                     screen_buffer_->rows(),
+                                 ErasedCell());
+      } else if (alternate_screen_active_) {
+        SwitchScreen(false);
+        RestoreCursor();
+      }
+      break;
+    case 2026u:  // Synchronized update.
+      if (set) {
+        // A new frame (re)starts the timeout, but repeating the DECSET within
+        // a frame doesn't extend it.
+        if (!InSynchronizedUpdate()) {
+          display_updates_.synchronized_update_deadline =
+              std::chrono::steady_clock::now() +
+              options_.synchronized_update_timeout;
+        }
+        display_updates_.synchronized_update = true;
+      } else {
+        display_updates_.synchronized_update = false;
+      }
+      break;
+    default:
+//FIXME
+      break;
+  }
+}
+
+bool TerminalImpl::InSynchronizedUpdate() const {
+  return display_updates_.synchronized_update &&
+         std::chrono::steady_clock::now() <
+             display_updates_.synchronized_update_deadline;
+}
+
+void TerminalImpl::EraseCells(RowNumber row,
+                              ColumnNumber left,
+                              ColumnNumber right) {
+  right = std::min(right, screen_buffer_->columns());
+  if (left >= right)
+    return;
+  ExtendToWholeCharacters(row, &left, &right);
+  screen_buffer_->FillCells(row, left, right, ErasedCell());
+  if (right == screen_buffer_->columns())
+    screen_buffer_->SetRowWrapped(row, false);
+  MarkDirty(row, row + 1u, left, right);
+}
+
+void TerminalImpl::ExtendToWholeCharacters(RowNumber row,
+                                           ColumnNumber* left,
+                                           ColumnNumber* right) const {
+  if (*left > 0u && *left < screen_buffer_->columns() &&
+      screen_buffer_->GetCodepoint(row, *left) == CODEPOINT_WIDE_PADDING)
+    (*left)--;
+  if (*right < screen_buffer_->columns() &&
+      screen_buffer_->GetCodepoint(row, *right) == CODEPOINT_WIDE_PADDING)
+    (*right)++;
+}
+
+void TerminalImpl::ShiftRows(uint32_t top, uint32_t bottom, int32_t count) {
+  assert(top <= bottom && bottom <= screen_buffer_->rows());
+  const uint32_t n = std::min(
+      static_cast<uint32_t>(count < 0 ? -count : count), bottom - top);
+  if (!n)
+    return;
+  const RowNumber first_row = screen_buffer_->first_row();
+  const ColumnNumber columns = screen_buffer_->columns();
+  RowDamage& row_damage = display_updates_.row_damage;
+  ColumnNumber left;
+  ColumnNumber right;
+  uint32_t vacated_top;
+  // The damage to the rows that moved moves with them (since a renderer
+  // applies |display_updates_.scrolls| before redrawing the damage).
+  if (count > 0) {
+    screen_buffer_->ShiftRowsUp(first_row + top, first_row + bottom, n,
+                                ErasedCell());
+    for (RowNumber row = first_row + top + n; row < first_row + bottom; row++) {
+      if (row_damage.GetDirtyColumns(row, &left, &right))
+        row_damage.MarkDirty(row - n, left, right);
+    }
+    AddScroll(top, bottom, static_cast<int32_t>(n));
+    vacated_top = bottom - n;
+  } else {
+    screen_buffer_->ShiftRowsDown(first_row + top, first_row + bottom, n,
+                                  ErasedCell());
+    for (RowNumber row = first_row + bottom - n; row-- > first_row + top;) {
+      if (row_damage.GetDirtyColumns(row, &left, &right))
+        row_damage.MarkDirty(row + n, left, right);
+    }
+    AddScroll(top, bottom, -static_cast<int32_t>(n));
+    vacated_top = top;
+  }
+  MarkChanged(first_row + top, first_row + bottom, 0u, columns);
+  MarkDirty(first_row + vacated_top, first_row + vacated_top + n, 0u, columns);
+}
+
+void TerminalImpl::Execute(Codepoint codepoint) {
+  switch (codepoint) {
+    case CODEPOINT_BEL:
+      display_updates_.bell_count++;
+      break;
+    case CODEPOINT_BS:
+      if (cursor_x_ > 0u)
+        cursor_x_--;
+      wrap_pending_ = false;
+      break;
+    case CODEPOINT_HT: {
+      // Move to the next tab stop (or the last column, if there isn't one).
+      const ColumnNumber last_column = screen_buffer_->columns() - 1u;
+      while (cursor_x_ < last_column && !tab_stops_[++cursor_x_]) {
+      }
+      wrap_pending_ = false;
+      break;
+    }
+    case CODEPOINT_LF:
+    case CODEPOINT_VT:
+    case CODEPOINT_FF:
+      wrap_pending_ = false;
+      LineFeed();
+      break;
+    case CODEPOINT_CR:
+      cursor_x_ = 0u;
+      wrap_pending_ = false;
+      break;
+    default:
+//FIXME
+      return;
+  }
+  have_state_changes_ = true;
+}
+
+void TerminalImpl::EscDispatch(const VtParser::Sequence& sequence) {
+  if (sequence.num_intermediates) {
+//FIXME
+    return;
+  }
+
+  switch (sequence.final) {
+    case '7':  // DECSC (save cursor).
+      SaveCursor();
+      break;
+    case '8':  // DECRC (restore cursor).
+      RestoreCursor();
+      break;
+    case 'H':  // HTS (horizontal tab set).
+      tab_stops_[cursor_x_] = true;
+      break;
+    case 'M':  // RI (reverse index).
+      wrap_pending_ = false;
+      ReverseIndex();
+      break;
+    default:
+//FIXME
+      return;
+  }
+  have_state_changes_ = true;
+}
+
+void TerminalImpl::CsiDispatch(const VtParser::Sequence& sequence) {
+  if (sequence.private_marker == '?' && !sequence.num_intermediates &&
+      (sequence.final == 'h' || sequence.final == 'l')) {
+    // DECSET/DECRST (DEC private mode set/reset).
+    for (size_t i = 0u; i < sequence.num_parameters; i++) {
+      if (!sequence.is_subparameter(i))
+        SetDecPrivateMode(sequence.parameters[i], sequence.final == 'h');
+    }
+    have_state_changes_ = true;
+    return;
+  }
+  if (sequence.private_marker || sequence.num_intermediates) {
+//FIXME
+    return;
+  }
+
+  switch (sequence.final) {
+    case '@':  // ICH (insert character).
+      InsertCharacters(sequence.parameter(0u, 1u));
+      break;
+    case 'H':  // CUP (cursor position).
+    case 'f':  // HVP (horizontal and vertical position).
+      //FIXME origin mode
+      cursor_y_ = std::min(sequence.parameter(0u, 1u) - 1u,
+                           screen_buffer_->rows() - 1u);
+      cursor_x_ = std::min(sequence.parameter(1u, 1u) - 1u,
+                           screen_buffer_->columns() - 1u);
+      wrap_pending_ = false;
+      break;
+    case 'J':  // ED (erase in display).
+      EraseInDisplay(sequence.parameter(0u, 0u));
+      break;
+    case 'K':  // EL (erase in line).
+      EraseInLine(sequence.parameter(0u, 0u));
+      break;
+    case 'L':  // IL (insert line).
+      InsertLines(sequence.parameter(0u, 1u));
+      break;
+    case 'M':  // DL (delete line).
+      DeleteLines(sequence.parameter(0u, 1u));
+      break;
+    case 'P':  // DCH (delete character).
+      DeleteCharacters(sequence.parameter(0u, 1u));
+      break;
+    case 'X':  // ECH (erase character).
+      EraseCells(screen_buffer_->first_row() + cursor_y_, cursor_x_,
+                 cursor_x_ + std::min(sequence.parameter(0u, 1u),
+                                      screen_buffer_->columns() - cursor_x_));
+      break;
+    case 'g':  // TBC (tab clear).
+      switch (sequence.parameter(0u, 0u)) {
+        case 0u:  // At the cursor.
+          tab_stops_[cursor_x_] = false;
+          break;
+        case 3u:  // All.
+          std::fill(tab_stops_.begin(), tab_stops_.end(), false);
+          break;
+        default:
+          return;
+      }
+      break;
+    case 'm':  // SGR (select graphic rendition).
+      ApplySgr(sequence, &pen_);
+      break;
+    case 'r': {  // DECSTBM (set top and bottom margins).
+      const uint32_t top = sequence.parameter(0u, 1u) - 1u;
+      const uint32_t bottom = std::min(
+          sequence.parameter(1u, screen_buffer_->rows()),
+          screen_buffer_->rows());
+      // The region must have at least two rows.
+      if (top + 1u >= bottom)
+        return;
+      scroll_top_ = top;
+      scroll_bottom_ = bottom;
+      //FIXME origin mode
+      cursor_y_ = 0u;
+      cursor_x_ = 0u;
+      wrap_pending_ = false;
+      break;
+    }
+    default:
+//FIXME
+      return;
+  }
+  have_state_changes_ = true;
+}
+
+void TerminalImpl::OscDispatch(const Codepoint* data, size_t size) {
 //FIXME
-  return false;
 }
 
+void TerminalImpl::DcsHook(const VtParser::Sequence& sequence) {
+  // We don't support any device control strings, but we still need to parse
+  // them (so that they're not displayed).
+}
+
+void TerminalImpl::DcsPut(Codepoint codepoint) {}
+
+void TerminalImpl::DcsUnhook() {}
+
 }  // namespace vtlib
@@ -2,14 +2,24 @@
 #define VTLIB_SRC_TERMINAL_IMPL_H_
 
 #include <memory>
+#include <vector>
 
+#include <vtlib/cell.h>
+#include <vtlib/character.h>
 #include <vtlib/character_decoder.h>
 #include <vtlib/codepoint.h>
+#include <vtlib/color.h>
 #include <vtlib/terminal.h>
 
+#include "src/cluster_table.h"
+#include "src/cold_scrollback.h"
+#include "src/screen_buffer.h"
+#include "src/snapshot_publisher.h"
+#include "src/vt_parser.h"
+
 namespace vtlib {
 
-class TerminalImpl : public Terminal {
+class TerminalImpl : public Terminal, public VtParser::Delegate {
  public:
   explicit TerminalImpl(const Options& options);
   ~TerminalImpl() override;
@@ -18,6 +28,8 @@ class TerminalImpl : public Terminal {
   TerminalImpl& operator=(const TerminalImpl&) = delete;
 
   bool ProcessByte(uint8_t input_byte) override;
+  bool ProcessBytes(const uint8_t* input_bytes,
+                    size_t num_input_bytes) override;
 
   const Options& options() const override { return options_; }
   bool options_set_accept_8bit_C1(bool accept_8bit_C1) override {
@@ -27,24 +39,268 @@ class TerminalImpl : public Terminal {
   bool options_set_character_encoding(
       CharacterEncoding character_encoding) override;
 
+  RowNumber viewport_top() const override {
+    return screen_buffer_->first_row();
+  }
+  RowNumber scrollback_top() const override {
+    return main_screen_buffer()->scrollback_top() -
+           cold_scrollback_->num_rows();
+  }
+  const Cell* GetRow(RowNumber row) const override;
+  bool IsRowWrapped(RowNumber row) const override;
+  const Codepoint* GetCluster(Codepoint cluster,
+                              size_t* num_codepoints) const override {
+    return cluster_table_.Get(cluster, num_codepoints);
+  }
+
+  RowNumber cursor_row() const override {
+    return screen_buffer_->first_row() + cursor_y_;
+  }
+  ColumnNumber cursor_column() const override { return cursor_x_; }
+
+  MemoryUsage GetMemoryUsage() const override;
+  AllocationStats GetAllocationStats() const override;
+
   const DisplayUpdates& display_updates() const override {
     return display_updates_;
   }
-  void reset_display_updates() override { display_updates_ = DisplayUpdates(); }
+  void reset_display_updates() override;
+
+  void Resize(uint32_t rows, ColumnNumber columns) override;
+
+  void PublishSnapshot() override;
+  SnapshotHandle AcquireSnapshot() const override {
+    return snapshot_publisher_.Acquire();
+  }
+
+  // |VtParser::Delegate| implementation:
+  void Print(const Codepoint* codepoints, size_t num_codepoints) override;
+  void Execute(Codepoint codepoint) override;
+  void EscDispatch(const VtParser::Sequence& sequence) override;
+  void CsiDispatch(const VtParser::Sequence& sequence) override;
+  void OscDispatch(const Codepoint* data, size_t size) override;
+  void DcsHook(const VtParser::Sequence& sequence) override;
+  void DcsPut(Codepoint codepoint) override;
+  void DcsUnhook() override;
 
  private:
-  // Helper for |ProcessByte()|, etc.
+  // The cursor state saved by DECSC (and restored by DECRC).
+  struct SavedCursor {
+    uint32_t y = 0u;
+    ColumnNumber x = 0u;
+    bool wrap_pending = false;
+    Cell pen;
+  };
+
+  // Returns the screen buffer of the main screen (which has the hot
+  // scrollback), whether or not it's active.
+  const ScreenBuffer* main_screen_buffer() const {
+    return alternate_screen_active_ ? inactive_screen_buffer_.get()
+                                    : screen_buffer_.get();
+  }
+
+  // Helpers for |ProcessBytes()|, etc.
+  bool ProcessControlByte(uint8_t control_byte);
+  // Processes (and clears) |codepoints_|.
   bool ProcessCodepoints();
-  bool ProcessCodepoint(Codepoint codepoint);
+  bool ProcessCodepoints(const Codepoint* codepoints, size_t num_codepoints);
+
+  // Helper for |Print()|: writes |num_cells| cells (which must fit on the
+  // cursor's row) at the cursor, and advances the cursor. Wide characters that
+  // are partially overwritten are blanked.
+  void WriteAtCursor(const Codepoint* codepoints, ColumnNumber num_cells);
+  // Finds the character preceding the cursor on the cursor's row, setting
+  // |*column| to its (first) column and |*width| to its width. Returns false if
+  // there isn't one.
+  bool FindPrecedingCharacter(ColumnNumber* column, ColumnNumber* width) const;
+  // Returns true if the wide character |codepoint| belongs to the grapheme
+  // cluster of the character preceding the cursor: after a ZWJ, if it's an
+  // emoji modifier, or if it's the second regional indicator of a flag.
+  bool JoinsPrecedingCluster(Codepoint codepoint) const;
+  // Adds |codepoint| to the grapheme cluster of the character preceding the
+  // cursor (if any).
+  void AddToCluster(Codepoint codepoint);
+  // Like |ClusterTable::Intern()|, but garbage collects |cluster_table_| as
+  // needed.
+  bool InternCluster(const Codepoint* codepoints,
+                     size_t num_codepoints,
+                     Codepoint* cluster);
+  void CollectClusterGarbage();
+
+  // Helpers for |CsiDispatch()|. These work on the cursor's row (or the rows
+  // below it), with whole runs of cells, and mark each affected row dirty as
+  // a single span.
+  void EraseInDisplay(uint32_t mode);  // ED.
+  // Discards the main screen's scrollback (hot and cold), for ED 3.
+  void ClearScrollback();
+  void EraseInLine(uint32_t mode);     // EL.
+  void InsertCharacters(ColumnNumber count);  // ICH.
+  void DeleteCharacters(ColumnNumber count);  // DCH.
+  void InsertLines(uint32_t count);           // IL.
+  void DeleteLines(uint32_t count);           // DL.
+  // Sets (DECSET) or resets (DECRST) DEC private mode |mode|.
+  void SetDecPrivateMode(uint32_t mode, bool set);
+  // Returns true if a synchronized update (DECSET 2026) is in progress and
+  // hasn't timed out.
+  bool InSynchronizedUpdate() const;
+  // Sets the cells in columns |left| to |right - 1| of |row| (in the viewport)
+  // to |ErasedCell()|, along with the other halves of any wide characters that
+  // are partially erased. If that reaches the last column, the row is no
+  // longer wrapped (as for |ScreenBuffer::FillRows()|): its line ends there.
+  void EraseCells(RowNumber row, ColumnNumber left, ColumnNumber right);
+  // Extends columns |*left| to |*right - 1| of |row| so as to not split any
+  // wide characters.
+  void ExtendToWholeCharacters(RowNumber row,
+                               ColumnNumber* left,
+                               ColumnNumber* right) const;
+  // Returns the cell that erased cells are set to: blank, but with the pen's
+  // background color.
+  Cell ErasedCell() const {
+    return Cell(Character(), Color(), pen_.bg());
+  }
+
+  // Shifts the contents of viewport rows |top| to |bottom - 1| (relative to
+  // the top of the viewport) up by |count| rows (down if it's negative),
+  // filling the vacated rows with |ErasedCell()|. Unlike |ScrollUp()|, nothing
+  // moves to the scrollback.
+  void ShiftRows(uint32_t top, uint32_t bottom, int32_t count);
+
+  // Moves the cursor to the start of the next row (as for an automatic wrap),
+  // marking the cursor's row as wrapped.
+  void WrapLine();
+  // Moves the cursor down one row, scrolling the scrolling region if it's on
+  // the bottom row of the region.
+  void LineFeed();
+  // Moves the cursor up one row, scrolling the scrolling region down if it's on
+  // the top row of the region.
+  void ReverseIndex();
+  // Scrolls the whole viewport (of the main screen) up by one row, moving the
+  // oldest row of the screen buffer to the cold scrollback if necessary. The
+  // new bottom row is filled with |ErasedCell()|, as for |ShiftRows()|.
+  void ScrollUp();
+  // The part of |ScrollUp()| that modifies |buffer| (the main screen's, which
+  // may be a new one being filled by |Resize()|) and the cold scrollback,
+  // filling the new bottom row with |fill|.
+  void ScrollUpScreenBuffer(ScreenBuffer* buffer, const Cell& fill);
+
+  // Helpers for |Resize()|: these return new main and alternate screen buffers
+  // of the given size, with the contents of the current ones reflowed
+  // (respectively, cropped or extended). |ReflowMainScreen()| also changes the
+  // width of the cold scrollback and, if the main screen is active, sets
+  // |*cursor_row| and |*cursor_x| to where the cursor goes in the new buffer.
+  std::unique_ptr<ScreenBuffer> ReflowMainScreen(uint32_t rows,
+                                                 ColumnNumber columns,
+                                                 RowNumber* cursor_row,
+                                                 ColumnNumber* cursor_x);
+  std::unique_ptr<ScreenBuffer> ResizeAlternateScreen(uint32_t rows,
+                                                      ColumnNumber columns);
+
+  // Resizes |tab_stops_| to |columns| columns, keeping the existing tab stops
+  // (and adding the default ones in new columns).
+  void ResizeTabStops(ColumnNumber columns);
+
+  void SaveCursor();     // DECSC.
+  void RestoreCursor();  // DECRC.
+  // Switches to the alternate screen (or back to the main screen), by swapping
+  // |screen_buffer_| with |inactive_screen_buffer_| (along with the saved
+  // cursors). The whole viewport is marked dirty.
+  void SwitchScreen(bool alternate);
+  // Records (in |display_updates_.scrolls|) that the contents of viewport rows
+  // |top| to |bottom - 1| moved up by |count| rows (down if it's negative).
+  void AddScroll(uint32_t top, uint32_t bottom, int32_t count);
+  // Adds the given rectangle to |display_updates_.dirty| and (for rows in the
+  // viewport) |display_updates_.row_damage| and |snapshot_damage_|.
+  void MarkDirty(RowNumber top,
+                 RowNumber bottom,
+                 ColumnNumber left,
+                 ColumnNumber right);
+  // Like |MarkDirty()|, but doesn't mark |display_updates_.row_damage|: e.g.,
+  // for contents that moved within the viewport (as recorded in
+  // |display_updates_.scrolls|).
+  void MarkChanged(RowNumber top,
+                   RowNumber bottom,
+                   ColumnNumber left,
+                   ColumnNumber right);
+  // Copies the grapheme clusters used by |cells| (a row of the viewport) to row
+  // |i| of |snapshot|.
+  void AddSnapshotClusters(const Cell* cells, uint32_t i, Snapshot* snapshot);
 
   Options options_;
   DisplayUpdates display_updates_;
 
   std::unique_ptr<CharacterDecoder> character_decoder_;
+  VtParser vt_parser_;
+
+  // The viewport and the "hot" scrollback of the active screen. The other
+  // screen's buffer is |inactive_screen_buffer_|. The alternate screen has no
+  // scrollback (rows scrolled off its top are discarded), and its row numbers
+  // are those of the main screen's viewport.
+  std::unique_ptr<ScreenBuffer> screen_buffer_;
+  std::unique_ptr<ScreenBuffer> inactive_screen_buffer_;
+  bool alternate_screen_active_ = false;
+  // (|GetRow()| and |IsRowWrapped()| may reflow some of its rows, since it's
+  // reflowed lazily after a resize.)
+  std::unique_ptr<ColdScrollback> cold_scrollback_;
+  // |GetRow()| decodes rows from |cold_scrollback_| into this.
+  std::unique_ptr<Cell[]> cold_row_;
+  // |Print()| lays out characters (other than runs of narrow characters) into
+  // this, one row's worth at a time.
+  std::unique_ptr<Codepoint[]> print_row_;
+  // The scrolling region (set by DECSTBM): rows |scroll_top_| to
+  // |scroll_bottom_ - 1|, relative to the viewport. Only when it's the whole
+  // viewport do rows scrolled off the top go to the scrollback.
+  uint32_t scroll_top_ = 0u;
+  uint32_t scroll_bottom_;
+  // The cursor position, relative to the viewport.
+  uint32_t cursor_y_ = 0u;
+  ColumnNumber cursor_x_ = 0u;
+  // Set if a character was printed in the last column (so that the next
+  // printed character will go on the next line). Cleared by any cursor
+  // movement.
+  bool wrap_pending_ = false;
+  // The attributes and colors for printed characters (the codepoint is
+  // ignored).
+  Cell pen_;
+  // Whether each column has a horizontal tab stop (set by HTS, cleared by
+  // TBC). Shared by both screens.
+  std::vector<bool> tab_stops_;
+  // The saved cursors of the active and the inactive screens.
+  SavedCursor saved_cursor_;
+  SavedCursor inactive_saved_cursor_;
 
-  // Used by |ProcessByte()|. This is here so we don't have to re-create it each
-  // time.
+  // The grapheme clusters used by the viewport and the scrollback. It's
+  // garbage collected when the number of clusters doubles (or reaches
+  // |kMinClustersForGarbageCollection|), and after every row has scrolled
+  // (so that clusters that have scrolled out of the scrollback are reclaimed).
+  ClusterTable cluster_table_;
+  size_t cluster_gc_threshold_;
+  size_t num_scrolls_since_cluster_gc_ = 0u;
+  // Used by |AddToCluster()|. This is here so we don't have to re-create it
+  // each time.
+  CodepointVector cluster_codepoints_;
+  // Set if a ZWJ was just added to a (wide) character's cluster, in which case
+  // a wide character (e.g., an emoji) printed next, with the cursor still at
+  // the given position, joins the cluster.
+  bool zwj_pending_ = false;
+  RowNumber zwj_cursor_row_ = 0u;
+  ColumnNumber zwj_cursor_x_ = 0u;
+
+  // Set by the |VtParser::Delegate| methods if the state of the terminal
+  // changed (reset by |ProcessCodepoints()|).
+  bool have_state_changes_ = false;
+
+  // Used by |ProcessControlByte()|, etc. This is here so we don't have to
+  // re-create it each time.
   CodepointVector codepoints_;
+
+  // The rows of the viewport that have changed since the last snapshot was
+  // published.
+  RowDamage snapshot_damage_;
+  // Used by |AddSnapshotClusters()|. This is here so we don't have to re-create
+  // it each time.
+  CodepointVector snapshot_clusters_;
+  uint64_t snapshot_generation_ = 0u;
+  SnapshotPublisher snapshot_publisher_;
 };
 
 }  // namespace vtlib
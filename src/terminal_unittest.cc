@@ -0,0 +1,1090 @@
+#include <vtlib/terminal.h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/cell.h>
+#include <vtlib/character.h>
+#include <vtlib/codepoint.h>
+#include <vtlib/color.h>
+#include <vtlib/coordinates.h>
+
+namespace vtlib {
+namespace {
+
+std::unique_ptr<Terminal> CreateTerminal(uint32_t rows,
+                                         ColumnNumber columns,
+                                         uint32_t scrollback_rows = 0u,
+                                         uint32_t hot_scrollback_rows = 0u) {
+  Terminal::Options options;
+  options.rows = rows;
+  options.columns = columns;
+  options.scrollback_rows = scrollback_rows;
+  options.hot_scrollback_rows = hot_scrollback_rows;
+  return Terminal::Create(options);
+}
+
+bool ProcessString(Terminal* terminal, const std::string& s) {
+  return terminal->ProcessBytes(reinterpret_cast<const uint8_t*>(s.data()),
+                                s.size());
+}
+
+// Returns the contents of |row| as a string (empty cells are spaces; assumes
+// that all the characters are ASCII).
+std::string GetRowText(const Terminal& terminal, RowNumber row) {
+  const Cell* cells = terminal.GetRow(row);
+  std::string rv;
+  for (ColumnNumber i = 0u; i < terminal.options().columns; i++) {
+    uint32_t codepoint = cells[i].character().codepoint();
+    rv += codepoint ? static_cast<char>(codepoint) : ' ';
+  }
+  return rv;
+}
+
+// Returns the contents of the viewport, with rows separated by '|'.
+std::string GetViewportText(const Terminal& terminal) {
+  std::string rv;
+  for (uint32_t i = 0u; i < terminal.options().rows; i++) {
+    if (i)
+      rv += "|";
+    rv += GetRowText(terminal, terminal.viewport_top() + i);
+  }
+  return rv;
+}
+
+TEST(TerminalTest, Create) {
+  auto terminal = CreateTerminal(3u, 5u);
+  EXPECT_EQ(3u, terminal->options().rows);
+  EXPECT_EQ(5u, terminal->options().columns);
+  EXPECT_EQ(0u, terminal->viewport_top());
+  EXPECT_EQ(0u, terminal->cursor_row());
+  EXPECT_EQ(0u, terminal->cursor_column());
+  EXPECT_EQ("     |     |     ", GetViewportText(*terminal));
+
+  // Initially, the whole viewport is dirty.
+  const Rectangle& dirty = terminal->display_updates().dirty;
+  EXPECT_EQ(0u, dirty.top);
+  EXPECT_EQ(3u, dirty.bottom);
+  EXPECT_EQ(0u, dirty.left);
+  EXPECT_EQ(5u, dirty.right);
+  EXPECT_TRUE(terminal->display_updates().needs_update());
+  terminal->reset_display_updates();
+  EXPECT_FALSE(terminal->display_updates().needs_update());
+}
+
+TEST(TerminalTest, Print) {
+  auto terminal = CreateTerminal(3u, 5u);
+  terminal->reset_display_updates();
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "ab"));
+  EXPECT_EQ("ab   |     |     ", GetViewportText(*terminal));
+  EXPECT_EQ(0u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+  const Rectangle& dirty = terminal->display_updates().dirty;
+  EXPECT_EQ(0u, dirty.top);
+  EXPECT_EQ(1u, dirty.bottom);
+  EXPECT_EQ(0u, dirty.left);
+  EXPECT_EQ(2u, dirty.right);
+
+  // The cursor stays in the last column until the next character is printed.
+  EXPECT_TRUE(ProcessString(terminal.get(), "cde"));
+  EXPECT_EQ("abcde|     |     ", GetViewportText(*terminal));
+  EXPECT_EQ(0u, terminal->cursor_row());
+  EXPECT_EQ(4u, terminal->cursor_column());
+  EXPECT_TRUE(ProcessString(terminal.get(), "fghijkl"));
+  EXPECT_EQ("abcde|fghij|kl   ", GetViewportText(*terminal));
+  EXPECT_EQ(2u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+  EXPECT_EQ(0u, dirty.top);
+  EXPECT_EQ(3u, dirty.bottom);
+  EXPECT_EQ(0u, dirty.left);
+  EXPECT_EQ(5u, dirty.right);
+}
+
+// Returns the codepoints of the cells of |row|.
+std::vector<Codepoint> GetRowCodepoints(const Terminal& terminal,
+                                        RowNumber row) {
+  const Cell* cells = terminal.GetRow(row);
+  std::vector<Codepoint> rv;
+  for (ColumnNumber i = 0u; i < terminal.options().columns; i++)
+    rv.push_back(cells[i].character().codepoint());
+  return rv;
+}
+
+TEST(TerminalTest, PrintWide) {
+  const Codepoint kWide = 0x4e2du;
+  const Codepoint kPadding = CODEPOINT_WIDE_PADDING;
+  auto terminal = CreateTerminal(2u, 5u);
+
+  // "a", U+4E2D (wide), "b".
+  EXPECT_TRUE(ProcessString(terminal.get(), "a\xe4\xb8\xad" "b"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', kWide, kPadding, 'b', 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_EQ(0u, terminal->cursor_row());
+  EXPECT_EQ(4u, terminal->cursor_column());
+
+  // A wide character that doesn't fit goes on the next row.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\xe4\xb8\xad"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', kWide, kPadding, 'b', 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_EQ((std::vector<Codepoint>{kWide, kPadding, 0u, 0u, 0u}),
+            GetRowCodepoints(*terminal, 1u));
+  EXPECT_EQ(1u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+
+  // Overwriting either half of a wide character blanks the other half.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\rx"));
+  EXPECT_EQ((std::vector<Codepoint>{'x', 0u, 0u, 0u, 0u}),
+            GetRowCodepoints(*terminal, 1u));
+  EXPECT_TRUE(ProcessString(terminal.get(), "y\xe4\xb8\xad"));
+  EXPECT_EQ((std::vector<Codepoint>{'x', 'y', kWide, kPadding, 0u}),
+            GetRowCodepoints(*terminal, 1u));
+  EXPECT_EQ(4u, terminal->cursor_column());
+  EXPECT_TRUE(ProcessString(terminal.get(), "\bz"));
+  EXPECT_EQ((std::vector<Codepoint>{'x', 'y', 0u, 'z', 0u}),
+            GetRowCodepoints(*terminal, 1u));
+
+  // The last column, skipped by a wide character that doesn't fit, is blanked
+  // (it's part of the wrapped line), rather than left as it was.
+  terminal = CreateTerminal(2u, 5u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "abcde\x1b[H1234\xe4\xb8\xad"));
+  EXPECT_EQ((std::vector<Codepoint>{'1', '2', '3', '4', 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  terminal->Resize(2u, 8u);
+  EXPECT_EQ((std::vector<Codepoint>{'1', '2', '3', '4', 0u, kWide, kPadding,
+                                    0u}),
+            GetRowCodepoints(*terminal, terminal->viewport_top()));
+}
+
+// Returns the codepoints of the grapheme cluster |cluster|.
+std::vector<Codepoint> GetCluster(const Terminal& terminal, Codepoint cluster) {
+  EXPECT_TRUE(IsClusterCodepoint(cluster));
+  size_t num_codepoints = 0u;
+  const Codepoint* codepoints = terminal.GetCluster(cluster, &num_codepoints);
+  return std::vector<Codepoint>(codepoints, codepoints + num_codepoints);
+}
+
+TEST(TerminalTest, GraphemeClusters) {
+  auto terminal = CreateTerminal(2u, 5u);
+
+  // "e" + U+0301 + U+0323 (combining acute accent and dot below), and U+4E2D
+  // (wide) + U+0301.
+  EXPECT_TRUE(ProcessString(terminal.get(),
+                            "e\xcc\x81\xcc\xa3\xe4\xb8\xad\xcc\x81x"));
+  std::vector<Codepoint> row = GetRowCodepoints(*terminal, 0u);
+  EXPECT_EQ((std::vector<Codepoint>{'e', 0x0301u, 0x0323u}),
+            GetCluster(*terminal, row[0]));
+  EXPECT_EQ((std::vector<Codepoint>{0x4e2du, 0x0301u}),
+            GetCluster(*terminal, row[1]));
+  EXPECT_EQ(CODEPOINT_WIDE_PADDING, row[2]);
+  EXPECT_EQ('x', row[3]);
+  EXPECT_EQ(4u, terminal->cursor_column());
+  // (Including the intermediate cluster "e" + U+0301, until it's garbage
+  // collected.)
+  EXPECT_EQ(3u, terminal->GetMemoryUsage().num_clusters);
+
+  // The same cluster is shared. A combining character with a pending wrap goes
+  // with the character in the last column.
+  EXPECT_TRUE(ProcessString(terminal.get(), "e\xcc\x81\xcc\xa3"));
+  row = GetRowCodepoints(*terminal, 0u);
+  EXPECT_EQ(row[0], row[4]);
+  EXPECT_EQ(3u, terminal->GetMemoryUsage().num_clusters);
+
+  // An emoji ZWJ sequence (man, ZWJ, woman, ZWJ, girl) is one cluster (and
+  // occupies two cells).
+  EXPECT_TRUE(ProcessString(terminal.get(),
+                            "\xf0\x9f\x91\xa8\xe2\x80\x8d"
+                            "\xf0\x9f\x91\xa9\xe2\x80\x8d"
+                            "\xf0\x9f\x91\xa7"));
+  row = GetRowCodepoints(*terminal, 1u);
+  EXPECT_EQ((std::vector<Codepoint>{0x1f468u, 0x200du, 0x1f469u, 0x200du,
+                                    0x1f467u}),
+            GetCluster(*terminal, row[0]));
+  EXPECT_EQ(CODEPOINT_WIDE_PADDING, row[1]);
+  EXPECT_EQ(0u, row[2]);
+  EXPECT_EQ(2u, terminal->cursor_column());
+
+  // Without a ZWJ, emoji aren't joined.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\xf0\x9f\x91\xa8"
+                                            "\xf0\x9f\x91\xa9"));
+  EXPECT_EQ((std::vector<Codepoint>{0x1f468u, CODEPOINT_WIDE_PADDING, 0x1f469u,
+                                    CODEPOINT_WIDE_PADDING, 0u}),
+            GetRowCodepoints(*terminal, 1u));
+
+  // A combining character with nothing before it is dropped.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\xcc\x81"));
+  EXPECT_EQ(0x1f468u, GetRowCodepoints(*terminal, 1u)[0]);
+}
+
+TEST(TerminalTest, GraphemeClustersEmoji) {
+  auto terminal = CreateTerminal(3u, 7u);
+
+  // An emoji modifier (U+1F44D thumbs up + U+1F3FD medium skin tone) joins the
+  // preceding character's cluster. With nothing before it, it's shown by
+  // itself.
+  EXPECT_TRUE(ProcessString(terminal.get(),
+                            "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd\r\n"
+                            "\xf0\x9f\x8f\xbd"));
+  std::vector<Codepoint> row = GetRowCodepoints(*terminal, 0u);
+  EXPECT_EQ((std::vector<Codepoint>{0x1f44du, 0x1f3fdu}),
+            GetCluster(*terminal, row[0]));
+  EXPECT_EQ(CODEPOINT_WIDE_PADDING, row[1]);
+  EXPECT_EQ(0u, row[2]);
+  EXPECT_EQ((std::vector<Codepoint>{0x1f3fdu, CODEPOINT_WIDE_PADDING, 0u, 0u,
+                                    0u, 0u, 0u}),
+            GetRowCodepoints(*terminal, 1u));
+
+  // Regional indicators pair up into flags (U+1F1FA U+1F1F8 is "US"); an
+  // unpaired one is shown by itself.
+  EXPECT_TRUE(ProcessString(terminal.get(),
+                            "\r\n\xf0\x9f\x87\xba\xf0\x9f\x87\xb8"
+                            "\xf0\x9f\x87\xba\xf0\x9f\x87\xb8"
+                            "\xf0\x9f\x87\xba"));
+  row = GetRowCodepoints(*terminal, 2u);
+  EXPECT_EQ((std::vector<Codepoint>{0x1f1fau, 0x1f1f8u}),
+            GetCluster(*terminal, row[0]));
+  EXPECT_EQ(CODEPOINT_WIDE_PADDING, row[1]);
+  EXPECT_EQ(row[0], row[2]);
+  EXPECT_EQ(CODEPOINT_WIDE_PADDING, row[3]);
+  EXPECT_EQ(0x1f1fau, row[4]);
+  EXPECT_EQ(CODEPOINT_WIDE_PADDING, row[5]);
+  EXPECT_EQ(6u, terminal->cursor_column());
+
+  // The next one completes the pair.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\xf0\x9f\x87\xb8"));
+  row = GetRowCodepoints(*terminal, 2u);
+  EXPECT_EQ(row[0], row[4]);
+  EXPECT_EQ(6u, terminal->cursor_column());
+}
+
+TEST(TerminalTest, GraphemeClustersReclaimed) {
+  auto terminal = CreateTerminal(2u, 10u, 10u, 10u);
+  // Lots of distinct clusters (U+0100 to U+07FF, each with U+0301), which
+  // scroll out of the scrollback.
+  for (Codepoint i = 0x100u; i < 0x800u; i++) {
+    std::string s;
+    s += static_cast<char>(0xc0u | (i >> 6u));
+    s += static_cast<char>(0x80u | (i & 0x3fu));
+    s += "\xcc\x81\r\n";
+    ProcessString(terminal.get(), s);
+  }
+  Terminal::MemoryUsage memory_usage = terminal->GetMemoryUsage();
+  EXPECT_LE(memory_usage.num_clusters, 1024u);
+
+  // After every row has scrolled, only the clusters in the viewport and the
+  // scrollback (here, none) remain.
+  for (int i = 0; i < 20; i++)
+    ProcessString(terminal.get(), "\n");
+  memory_usage = terminal->GetMemoryUsage();
+  EXPECT_EQ(0u, memory_usage.num_clusters);
+}
+
+// Expects |actual| to have the same contents (of the viewport and scrollback,
+// comparing grapheme clusters by their codepoints) and cursor as |expected|.
+void ExpectSameContents(const Terminal& expected, const Terminal& actual) {
+  ASSERT_EQ(expected.scrollback_top(), actual.scrollback_top());
+  ASSERT_EQ(expected.viewport_top(), actual.viewport_top());
+  EXPECT_EQ(expected.cursor_row(), actual.cursor_row());
+  EXPECT_EQ(expected.cursor_column(), actual.cursor_column());
+  const RowNumber bottom = expected.viewport_top() + expected.options().rows;
+  for (RowNumber row = expected.scrollback_top(); row < bottom; row++) {
+    EXPECT_EQ(expected.IsRowWrapped(row), actual.IsRowWrapped(row));
+    const Cell* expected_cells = expected.GetRow(row);
+    const Cell* actual_cells = actual.GetRow(row);
+    for (ColumnNumber i = 0u; i < expected.options().columns; i++) {
+      const Codepoint codepoint = expected_cells[i].character().codepoint();
+      if (IsClusterCodepoint(codepoint)) {
+        EXPECT_EQ(GetCluster(expected, codepoint),
+                  GetCluster(actual, actual_cells[i].character().codepoint()));
+        EXPECT_EQ(expected_cells[i].fg(), actual_cells[i].fg());
+        EXPECT_EQ(expected_cells[i].bg(), actual_cells[i].bg());
+      } else {
+        EXPECT_EQ(expected_cells[i], actual_cells[i]);
+      }
+    }
+  }
+}
+
+TEST(TerminalTest, ProcessBytesSplit) {
+  // UTF-8 (including a wide character, a combining character, an emoji ZWJ
+  // sequence, an invalid byte and a sequence interrupted by a control code),
+  // escape sequences (CSI, OSC, with attributes), and 8-bit C1 control codes
+  // (CSI and NEL), with enough lines to scroll.
+  const std::string input =
+      "ab\xe4\xb8\xad\x1b[31mred\x1b[m e\xcc\x81\r\n"
+      "\xf0\x9f\x91\xa8\xe2\x80\x8d\xf0\x9f\x91\xa9\xff\xe4\x1b[C"
+      "\x1b]0;title\x07\x9b" "2Dxy\x85z\r\n\x1b[1;44mwrapped text\x9b" "1;1H"
+      "\xc3\xa9\x1b[K\n\n\n";
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input.data());
+
+  for (int accept_8bit_C1 = 0; accept_8bit_C1 < 2; accept_8bit_C1++) {
+    SCOPED_TRACE(accept_8bit_C1);
+    // The reference: one byte at a time, noting each |ProcessByte()| result.
+    auto expected = CreateTerminal(3u, 8u, 10u, 10u);
+    expected->options_set_accept_8bit_C1(accept_8bit_C1 != 0);
+    std::vector<bool> results;
+    for (uint8_t byte : input)
+      results.push_back(expected->ProcessByte(byte));
+    EXPECT_LT(expected->scrollback_top(), expected->viewport_top());
+
+    // |ProcessBytes()| (in two calls, split at each offset) is equivalent,
+    // and returns true iff any of the corresponding |ProcessByte()| calls
+    // did.
+    for (size_t split = 0u; split <= input.size(); split++) {
+      SCOPED_TRACE(split);
+      auto terminal = CreateTerminal(3u, 8u, 10u, 10u);
+      terminal->options_set_accept_8bit_C1(accept_8bit_C1 != 0);
+      EXPECT_EQ(std::find(results.begin(), results.begin() + split, true) !=
+                    results.begin() + split,
+                terminal->ProcessBytes(bytes, split));
+      EXPECT_EQ(std::find(results.begin() + split, results.end(), true) !=
+                    results.end(),
+                terminal->ProcessBytes(bytes + split, input.size() - split));
+      ExpectSameContents(*expected, *terminal);
+    }
+  }
+}
+
+TEST(TerminalTest, ControlCodes) {
+  auto terminal = CreateTerminal(3u, 10u);
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "abc\rx\ny\bz"));
+  EXPECT_EQ("xbc       | z        |          ", GetViewportText(*terminal));
+  EXPECT_EQ(1u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "\tt\t\t\tu"));
+  EXPECT_EQ("xbc       | z      tu|          ", GetViewportText(*terminal));
+
+  // Backspace at the left edge does nothing.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\n\b\bv"));
+  EXPECT_EQ(2u, terminal->cursor_row());
+  EXPECT_EQ("xbc       | z      tu|v         ", GetViewportText(*terminal));
+
+  terminal->reset_display_updates();
+  EXPECT_TRUE(ProcessString(terminal.get(), "\a\a"));
+  EXPECT_EQ(2u, terminal->display_updates().bell_count);
+  EXPECT_TRUE(terminal->display_updates().dirty.is_empty());
+}
+
+TEST(TerminalTest, TabStops) {
+  auto terminal = CreateTerminal(2u, 20u);
+  // Initially, every 8 columns.
+  EXPECT_TRUE(ProcessString(terminal.get(), "a\tb"));
+  // HTS (set one in column 3).
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[1;4H\x1bH\r\tc"));
+  // TBC (clear the one in column 8).
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[1;9H\x1b[g\r\t\td"));
+  // TBC (clear all of them): tab goes to the last column.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[3g\r\te"));
+  EXPECT_EQ("a  c    b       d  e|                    ",
+            GetViewportText(*terminal));
+
+  // New columns get the default tab stops.
+  terminal->Resize(2u, 30u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\tf"));
+  EXPECT_EQ(25u, terminal->cursor_column());
+}
+
+TEST(TerminalTest, Sgr) {
+  auto terminal = CreateTerminal(2u, 10u);
+
+  EXPECT_TRUE(ProcessString(terminal.get(),
+                            "a\x1b[1;31mb\x1b[38;5;208;48;2;1;2;3mc\x1b[md"));
+  EXPECT_EQ("abcd      |          ", GetViewportText(*terminal));
+  const Cell* cells = terminal->GetRow(terminal->viewport_top());
+  EXPECT_EQ(Cell(Character(Character::Attribute::NONE, 'a'), Color(), Color()),
+            cells[0]);
+  EXPECT_EQ(Cell(Character(Character::Attribute::BOLD, 'b'),
+                 Color(Color::Type::ANSI_16, 1u), Color()),
+            cells[1]);
+  EXPECT_EQ(Cell(Character(Character::Attribute::BOLD, 'c'),
+                 Color(Color::Type::RGB, 0xff8700u),
+                 Color(Color::Type::RGB, 0x010203u)),
+            cells[2]);
+  EXPECT_EQ(Cell(Character(Character::Attribute::NONE, 'd'), Color(), Color()),
+            cells[3]);
+}
+
+TEST(TerminalTest, CursorPosition) {
+  auto terminal = CreateTerminal(3u, 5u);
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[2;3Hx"));
+  EXPECT_EQ("     |  x  |     ", GetViewportText(*terminal));
+  // Defaults to the top left, and is clamped to the viewport.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[Hy\x1b[9;9fz"));
+  EXPECT_EQ("y    |  x  |    z", GetViewportText(*terminal));
+  EXPECT_EQ(2u, terminal->cursor_row());
+  EXPECT_EQ(4u, terminal->cursor_column());
+}
+
+TEST(TerminalTest, EraseInDisplay) {
+  auto terminal = CreateTerminal(3u, 4u);
+  const std::string kFill = "\x1b[Habcd\r\nefgh\r\nijkl\x1b[2;2H";
+
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[J"));
+  EXPECT_EQ("abcd|e   |    ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1J"));
+  EXPECT_EQ("    |  gh|ijkl", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2J"));
+  EXPECT_EQ("    |    |    ", GetViewportText(*terminal));
+  // The cursor doesn't move.
+  EXPECT_EQ(1u, terminal->cursor_row());
+  EXPECT_EQ(1u, terminal->cursor_column());
+
+  // Each row is damaged as a single span.
+  ProcessString(terminal.get(), kFill);
+  terminal->reset_display_updates();
+  ProcessString(terminal.get(), "\x1b[J");
+  const RowDamage& damage = terminal->display_updates().row_damage;
+  EXPECT_EQ(2u, damage.num_dirty_rows());
+  ColumnNumber left = 0u;
+  ColumnNumber right = 0u;
+  EXPECT_TRUE(damage.GetDirtyColumns(1u, &left, &right));
+  EXPECT_EQ(1u, left);
+  EXPECT_EQ(4u, right);
+  EXPECT_TRUE(damage.GetDirtyColumns(2u, &left, &right));
+  EXPECT_EQ(0u, left);
+  EXPECT_EQ(4u, right);
+}
+
+TEST(TerminalTest, EraseScrollback) {
+  // 2 rows of hot scrollback, and 3 of cold scrollback.
+  auto terminal = CreateTerminal(2u, 4u, 5u, 2u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "1\r\n2\r\n3\r\n4\r\n5\r\n6\r\n7"));
+  const RowNumber viewport_top = terminal->viewport_top();
+  EXPECT_EQ(viewport_top - 5u, terminal->scrollback_top());
+  EXPECT_EQ(3u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+
+  // ED 3 discards the scrollback (hot and cold), but not the viewport, which
+  // keeps its row numbers.
+  terminal->reset_display_updates();
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[3J"));
+  EXPECT_EQ(viewport_top, terminal->viewport_top());
+  EXPECT_EQ(viewport_top, terminal->scrollback_top());
+  EXPECT_EQ(0u, terminal->GetMemoryUsage().num_hot_scrollback_rows);
+  EXPECT_EQ(0u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+  EXPECT_EQ("6   |7   ", GetViewportText(*terminal));
+  EXPECT_EQ(viewport_top - 5u, terminal->display_updates().dirty.top);
+  EXPECT_TRUE(terminal->display_updates().row_damage.is_empty());
+
+  // The scrollback fills again.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\n8\r\n9\r\na\r\nb"));
+  EXPECT_EQ(viewport_top + 4u, terminal->viewport_top());
+  EXPECT_EQ(viewport_top, terminal->scrollback_top());
+  EXPECT_EQ(2u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(std::string(1u, "6789"[i]) + "   ",
+              GetRowText(*terminal, viewport_top + static_cast<RowNumber>(i)));
+  }
+  EXPECT_EQ("a   |b   ", GetViewportText(*terminal));
+}
+
+TEST(TerminalTest, EraseInLine) {
+  auto terminal = CreateTerminal(1u, 6u);
+  const std::string kFill = "\x1b[Habcdef\x1b[1;4H";
+
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[K"));
+  EXPECT_EQ("abc   ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1K"));
+  EXPECT_EQ("    ef", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2K"));
+  EXPECT_EQ("      ", GetViewportText(*terminal));
+
+  // Erased cells get the pen's background color (but no attributes).
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1;44m\x1b[K\x1b[m"));
+  const Cell* cells = terminal->GetRow(terminal->viewport_top());
+  EXPECT_EQ(Cell(Character(Character::Attribute::NONE, 'c'), Color(), Color()),
+            cells[2]);
+  EXPECT_EQ(Cell(Character(), Color(), Color(Color::Type::ANSI_16, 4u)),
+            cells[3]);
+  EXPECT_EQ(Cell(Character(), Color(), Color(Color::Type::ANSI_16, 4u)),
+            cells[5]);
+}
+
+TEST(TerminalTest, EraseWrappedRow) {
+  auto terminal = CreateTerminal(3u, 4u);
+  const std::string kFill = "\x1b[2J\x1b[Habcdefgh\x1b[1;2H";
+
+  // Erasing up to the last column ends the line there.
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[K"));
+  EXPECT_FALSE(terminal->IsRowWrapped(0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2K"));
+  EXPECT_FALSE(terminal->IsRowWrapped(0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[J"));
+  EXPECT_FALSE(terminal->IsRowWrapped(0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[3X"));
+  EXPECT_FALSE(terminal->IsRowWrapped(0u));
+
+  // But not erasing only part of the row.
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1K"));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1X"));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  EXPECT_EQ("a cd|efgh|    ", GetViewportText(*terminal));
+}
+
+TEST(TerminalTest, InsertDeleteEraseCharacters) {
+  auto terminal = CreateTerminal(1u, 6u);
+  const std::string kFill = "\x1b[Habcdef\x1b[1;3H";
+
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2@"));
+  EXPECT_EQ("ab  cd", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[@"));
+  EXPECT_EQ("ab cde", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[99@"));
+  EXPECT_EQ("ab    ", GetViewportText(*terminal));
+
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2P"));
+  EXPECT_EQ("abef  ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[P"));
+  EXPECT_EQ("abdef ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[99P"));
+  EXPECT_EQ("ab    ", GetViewportText(*terminal));
+
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2X"));
+  EXPECT_EQ("ab  ef", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[X"));
+  EXPECT_EQ("ab def", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[99X"));
+  EXPECT_EQ("ab    ", GetViewportText(*terminal));
+  EXPECT_EQ(2u, terminal->cursor_column());
+}
+
+TEST(TerminalTest, InsertDeleteEraseWideCharacters) {
+  const Codepoint kWide = 0x4e2du;
+  const Codepoint kPadding = CODEPOINT_WIDE_PADDING;
+  auto terminal = CreateTerminal(1u, 6u);
+  // "a", U+4E2D (wide), "b", U+4E2D.
+  const std::string kFill = "\x1b[Ha\xe4\xb8\xad" "b\xe4\xb8\xad";
+
+  // Wide characters that are split are erased.
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1;3H\x1b[X"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', 0u, 0u, 'b', kWide, kPadding}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1;2H\x1b[@"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', 0u, kWide, kPadding, 'b', 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1;3H\x1b[@"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', 0u, 0u, 0u, 'b', 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1;2H\x1b[P"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', 0u, 'b', kWide, kPadding, 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[1;1H\x1b[2P"));
+  EXPECT_EQ((std::vector<Codepoint>{0u, 'b', kWide, kPadding, 0u, 0u}),
+            GetRowCodepoints(*terminal, 0u));
+}
+
+TEST(TerminalTest, InsertDeleteLines) {
+  auto terminal = CreateTerminal(4u, 3u);
+  const std::string kFill = "\x1b[Haaa\r\nbbb\r\nccc\r\nddd\x1b[2;2H";
+
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[L"));
+  EXPECT_EQ("aaa|   |bbb|ccc", GetViewportText(*terminal));
+  // The cursor moves to the left edge.
+  EXPECT_EQ(0u, terminal->cursor_column());
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2M"));
+  EXPECT_EQ("aaa|ddd|   |   ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[9L"));
+  EXPECT_EQ("aaa|   |   |   ", GetViewportText(*terminal));
+
+  // They're reported as scrolls of the rows from the cursor down, with the
+  // vacated rows damaged.
+  ProcessString(terminal.get(), kFill);
+  terminal->reset_display_updates();
+  ProcessString(terminal.get(), "\x1b[M");
+  const DisplayUpdates& updates = terminal->display_updates();
+  ASSERT_EQ(1u, updates.scrolls.size());
+  EXPECT_EQ(1u, updates.scrolls[0].top);
+  EXPECT_EQ(4u, updates.scrolls[0].bottom);
+  EXPECT_EQ(1, updates.scrolls[0].count);
+  EXPECT_EQ(1u, updates.row_damage.num_dirty_rows());
+  EXPECT_TRUE(updates.row_damage.IsRowDirty(3u));
+  // (The contents of the rows that moved changed.)
+  EXPECT_EQ(1u, updates.dirty.top);
+  EXPECT_EQ(4u, updates.dirty.bottom);
+
+  // Damage to rows that move moves with them.
+  terminal->reset_display_updates();
+  ProcessString(terminal.get(), "\x1b[3;3Hx\x1b[2;1H\x1b[L");
+  EXPECT_EQ("aaa|   |ccc|ddx", GetViewportText(*terminal));
+  ASSERT_EQ(1u, updates.scrolls.size());
+  EXPECT_EQ(-1, updates.scrolls[0].count);
+  EXPECT_TRUE(updates.row_damage.IsRowDirty(1u));
+  ColumnNumber left = 0u;
+  ColumnNumber right = 0u;
+  EXPECT_TRUE(updates.row_damage.GetDirtyColumns(3u, &left, &right));
+  EXPECT_EQ(2u, left);
+  EXPECT_EQ(3u, right);
+}
+
+TEST(TerminalTest, Scroll) {
+  auto terminal = CreateTerminal(3u, 4u);
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "1\r\n2\r\n3"));
+  EXPECT_EQ(0u, terminal->viewport_top());
+  EXPECT_EQ("1   |2   |3   ", GetViewportText(*terminal));
+
+  terminal->reset_display_updates();
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\n4"));
+  EXPECT_EQ(1u, terminal->viewport_top());
+  EXPECT_EQ(3u, terminal->cursor_row());
+  EXPECT_EQ("2   |3   |4   ", GetViewportText(*terminal));
+  // Only the new row is dirty.
+  const Rectangle& dirty = terminal->display_updates().dirty;
+  EXPECT_EQ(3u, dirty.top);
+  EXPECT_EQ(4u, dirty.bottom);
+
+  // Wrapping also scrolls.
+  EXPECT_TRUE(ProcessString(terminal.get(), "567890"));
+  EXPECT_EQ(2u, terminal->viewport_top());
+  EXPECT_EQ("3   |4567|890 ", GetViewportText(*terminal));
+
+  // Lots of scrolling.
+  for (int i = 0; i < 1000; i++)
+    EXPECT_TRUE(ProcessString(terminal.get(), "\nx"));
+  EXPECT_EQ(1002u, terminal->viewport_top());
+  EXPECT_EQ("   x|   x|   x", GetViewportText(*terminal));
+
+  // The new row gets the pen's background color (as for erasing, and for
+  // scrolling within a scrolling region).
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[44m\n\x1b[m"));
+  const Cell* cells = terminal->GetRow(terminal->viewport_top() + 2u);
+  for (ColumnNumber i = 0u; i < 4u; i++) {
+    EXPECT_EQ(Cell(Character(), Color(), Color(Color::Type::ANSI_16, 4u)),
+              cells[i]);
+  }
+}
+
+TEST(TerminalTest, ScrollRegion) {
+  auto terminal = CreateTerminal(5u, 3u);
+  const std::string kFill = "\x1b[r\x1b[Haaa\r\nbbb\r\nccc\r\nddd\r\neee";
+
+  // DECSTBM homes the cursor.
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2;4r"));
+  EXPECT_EQ(0u, terminal->cursor_row());
+  EXPECT_EQ(0u, terminal->cursor_column());
+
+  // Line feeds on the bottom row of the region only scroll the region, and
+  // don't add to the scrollback.
+  terminal->reset_display_updates();
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[4;1H\n\nx"));
+  EXPECT_EQ("aaa|ddd|   |x  |eee", GetViewportText(*terminal));
+  EXPECT_EQ(0u, terminal->viewport_top());
+  const DisplayUpdates& updates = terminal->display_updates();
+  ASSERT_EQ(1u, updates.scrolls.size());
+  EXPECT_EQ(1u, updates.scrolls[0].top);
+  EXPECT_EQ(4u, updates.scrolls[0].bottom);
+  EXPECT_EQ(2, updates.scrolls[0].count);
+
+  // Below the region, the cursor stops at the bottom row.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[5;1H\n\ny"));
+  EXPECT_EQ("aaa|ddd|   |x  |yee", GetViewportText(*terminal));
+  EXPECT_EQ(0u, terminal->viewport_top());
+
+  // RI on the top row of the region scrolls it down.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[2;1H\x1bMz"));
+  EXPECT_EQ("aaa|z  |ddd|   |yee", GetViewportText(*terminal));
+  // Elsewhere it just moves the cursor up.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[3;2H\x1bM\x1bMw"));
+  EXPECT_EQ("aaa| w |z  |ddd|yee", GetViewportText(*terminal));
+
+  // IL and DL only affect the region, and are ignored outside it.
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2;4r\x1b[3H\x1b[L"));
+  EXPECT_EQ("aaa|bbb|   |ccc|eee", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[2H\x1b[9M"));
+  EXPECT_EQ("aaa|   |   |   |eee", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), kFill + "\x1b[2;4r\x1b[5H\x1b[M"));
+  EXPECT_EQ("aaa|bbb|ccc|ddd|eee", GetViewportText(*terminal));
+
+  // Invalid regions are ignored.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[3;4H\x1b[3;3r"));
+  EXPECT_EQ(2u, terminal->cursor_row());
+
+  // A region of the whole screen still adds to the scrollback.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[1;9r\x1b[5H\n"));
+  EXPECT_EQ(1u, terminal->viewport_top());
+  EXPECT_EQ("bbb|ccc|ddd|eee|   ", GetViewportText(*terminal));
+}
+
+TEST(TerminalTest, Scrollback) {
+  auto terminal = CreateTerminal(2u, 4u, 3u, 3u);
+  EXPECT_EQ(0u, terminal->scrollback_top());
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "1\r\n2\r\n3"));
+  EXPECT_EQ(0u, terminal->scrollback_top());
+  EXPECT_EQ(1u, terminal->viewport_top());
+  EXPECT_EQ("1   ", GetRowText(*terminal, 0u));
+  EXPECT_EQ("2   |3   ", GetViewportText(*terminal));
+
+  EXPECT_TRUE(ProcessString(terminal.get(), "\r\n4\r\n5\r\n6\r\n7"));
+  EXPECT_EQ(2u, terminal->scrollback_top());
+  EXPECT_EQ(5u, terminal->viewport_top());
+  EXPECT_EQ("3   ", GetRowText(*terminal, 2u));
+  EXPECT_EQ("4   ", GetRowText(*terminal, 3u));
+  EXPECT_EQ("5   ", GetRowText(*terminal, 4u));
+  EXPECT_EQ("6   |7   ", GetViewportText(*terminal));
+}
+
+TEST(TerminalTest, SaveRestoreCursor) {
+  auto terminal = CreateTerminal(3u, 4u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[2;3H\x1b[31m\x1b" "7"));
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[m\x1b[H\x1b" "8x"));
+  EXPECT_EQ("    |  x |    ", GetViewportText(*terminal));
+  EXPECT_EQ(Color(Color::Type::ANSI_16, 1u), terminal->GetRow(1u)[2].fg());
+}
+
+TEST(TerminalTest, AlternateScreen) {
+  auto terminal = CreateTerminal(3u, 4u, 10u, 10u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "1\r\n2\r\n3\r\n4"));
+  EXPECT_EQ(1u, terminal->viewport_top());
+
+  // Switching (with 1049, which saves the cursor and clears the alternate
+  // screen) is reported as the whole viewport being dirty.
+  terminal->reset_display_updates();
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?1049h"));
+  EXPECT_EQ("    |    |    ", GetViewportText(*terminal));
+  EXPECT_EQ(3u, terminal->cursor_row());
+  EXPECT_EQ(1u, terminal->cursor_column());
+  const DisplayUpdates& updates = terminal->display_updates();
+  EXPECT_TRUE(updates.scrolls.empty());
+  EXPECT_EQ(1u, updates.dirty.top);
+  EXPECT_EQ(4u, updates.dirty.bottom);
+  EXPECT_EQ(0u, updates.dirty.left);
+  EXPECT_EQ(4u, updates.dirty.right);
+  EXPECT_EQ(3u, updates.row_damage.num_dirty_rows());
+  EXPECT_GE(terminal->GetMemoryUsage().alternate_screen_bytes,
+            3u * 4u * sizeof(Cell));
+
+  // Rows scrolled off the top of the alternate screen are discarded.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[Hab\r\ncd\r\nef\r\ngh"));
+  EXPECT_EQ("cd  |ef  |gh  ", GetViewportText(*terminal));
+  EXPECT_EQ(1u, terminal->viewport_top());
+  EXPECT_EQ(0u, terminal->scrollback_top());
+  EXPECT_EQ("1   ", GetRowText(*terminal, 0u));
+
+  // Switching back restores the main screen and the cursor.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?1049l"));
+  EXPECT_EQ("2   |3   |4   ", GetViewportText(*terminal));
+  EXPECT_EQ(3u, terminal->cursor_row());
+  EXPECT_EQ(1u, terminal->cursor_column());
+
+  // 47 doesn't clear the alternate screen; 1047 clears it on leaving it.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?47h"));
+  EXPECT_EQ("cd  |ef  |gh  ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?47l\x1b[?1047h"));
+  EXPECT_EQ("cd  |ef  |gh  ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?1047l"));
+  EXPECT_EQ("2   |3   |4   ", GetViewportText(*terminal));
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?47h"));
+  EXPECT_EQ("    |    |    ", GetViewportText(*terminal));
+
+  // Grapheme clusters on the inactive screen aren't garbage collected.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[He\xcc\x81\x1b[?47l"));
+  for (int i = 0; i < 20; i++)
+    ProcessString(terminal.get(), "\n");
+  EXPECT_EQ(19u, terminal->viewport_top());
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?47h"));
+  EXPECT_EQ((std::vector<Codepoint>{'e', 0x0301u}),
+            GetCluster(*terminal, GetRowCodepoints(*terminal, 19u)[0]));
+}
+
+TEST(TerminalTest, ColdScrollback) {
+  // 4 rows of hot scrollback, and 100 - 4 = 96 rows of cold scrollback.
+  auto terminal = CreateTerminal(2u, 10u, 100u, 4u);
+  for (int i = 0; i < 200; i++)
+    ProcessString(terminal.get(), "line " + std::to_string(i) + "\r\n");
+  EXPECT_EQ(199u, terminal->viewport_top());
+  EXPECT_EQ(99u, terminal->scrollback_top());
+  for (RowNumber row = terminal->scrollback_top();
+       row < terminal->viewport_top(); row++) {
+    std::string expected = "line " + std::to_string(row);
+    expected.resize(10u, ' ');
+    EXPECT_EQ(expected, GetRowText(*terminal, row));
+  }
+
+  Terminal::MemoryUsage memory_usage = terminal->GetMemoryUsage();
+  EXPECT_EQ(2u * 10u * sizeof(Cell), memory_usage.viewport_bytes);
+  EXPECT_EQ(4u, memory_usage.num_hot_scrollback_rows);
+  // (Plus the storage index of each of the 2 + 4 rows.)
+  EXPECT_EQ(4u * 10u * sizeof(Cell) + 6u * sizeof(uint32_t),
+            memory_usage.hot_scrollback_bytes);
+  EXPECT_EQ(96u, memory_usage.num_cold_scrollback_rows);
+  EXPECT_GT(memory_usage.cold_scrollback_bytes, 0u);
+}
+
+TEST(TerminalTest, RowDamage) {
+  auto terminal = CreateTerminal(4u, 10u, 10u, 10u);
+  // Initially, the whole viewport is dirty.
+  EXPECT_EQ(4u, terminal->display_updates().row_damage.num_dirty_rows());
+  terminal->reset_display_updates();
+  EXPECT_TRUE(terminal->display_updates().row_damage.is_empty());
+
+  // Changes at the top left and bottom right only damage those rows.
+  ProcessString(terminal.get(), "a\r\n\n\n         b");
+  const RowDamage& damage = terminal->display_updates().row_damage;
+  EXPECT_EQ(2u, damage.num_dirty_rows());
+  ColumnNumber left = 0u;
+  ColumnNumber right = 0u;
+  EXPECT_TRUE(damage.GetDirtyColumns(0u, &left, &right));
+  EXPECT_EQ(0u, left);
+  EXPECT_EQ(1u, right);
+  EXPECT_FALSE(damage.GetDirtyColumns(1u, &left, &right));
+  EXPECT_FALSE(damage.GetDirtyColumns(2u, &left, &right));
+  EXPECT_TRUE(damage.GetDirtyColumns(3u, &left, &right));
+  EXPECT_EQ(0u, left);
+  EXPECT_EQ(10u, right);
+  // (Whereas the bounding rectangle covers everything.)
+  EXPECT_EQ(0u, terminal->display_updates().dirty.top);
+  EXPECT_EQ(4u, terminal->display_updates().dirty.bottom);
+
+  // Scrolling: the new row is dirty; the others just move.
+  terminal->reset_display_updates();
+  ProcessString(terminal.get(), "\n");
+  EXPECT_EQ(1u, damage.first_row());
+  EXPECT_EQ(1u, damage.num_dirty_rows());
+  EXPECT_EQ(4u, damage.FindNextDirtyRow(damage.first_row()));
+}
+
+TEST(TerminalTest, Scrolls) {
+  auto terminal = CreateTerminal(3u, 10u, 10u, 10u);
+  terminal->reset_display_updates();
+
+  // No scrolling.
+  ProcessString(terminal.get(), "a\r\nb\r\nc");
+  EXPECT_TRUE(terminal->display_updates().scrolls.empty());
+
+  // Consecutive scrolls (of the whole viewport) are merged. Only the new rows
+  // are damaged.
+  terminal->reset_display_updates();
+  ProcessString(terminal.get(), "\r\nd\r\ne");
+  const DisplayUpdates& updates = terminal->display_updates();
+  ASSERT_EQ(1u, updates.scrolls.size());
+  EXPECT_EQ(0u, updates.scrolls[0].top);
+  EXPECT_EQ(3u, updates.scrolls[0].bottom);
+  EXPECT_EQ(2, updates.scrolls[0].count);
+  EXPECT_TRUE(updates.needs_update());
+  EXPECT_EQ(2u, terminal->viewport_top());
+  EXPECT_EQ(2u, updates.row_damage.num_dirty_rows());
+  EXPECT_EQ(3u, updates.row_damage.FindNextDirtyRow(0u));
+  EXPECT_EQ(4u, updates.row_damage.FindNextDirtyRow(4u));
+
+  // The count is capped at the size of the region.
+  terminal->reset_display_updates();
+  EXPECT_FALSE(terminal->display_updates().needs_update());
+  ProcessString(terminal.get(), "\n\n\n\n\n");
+  ASSERT_EQ(1u, updates.scrolls.size());
+  EXPECT_EQ(3, updates.scrolls[0].count);
+  EXPECT_EQ(3u, updates.row_damage.num_dirty_rows());
+}
+
+TEST(TerminalTest, Resize) {
+  auto terminal = CreateTerminal(3u, 6u, 10u, 10u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "abcdefgh\r\nxy"));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  EXPECT_FALSE(terminal->IsRowWrapped(1u));
+
+  // Wider: the wrapped line is joined.
+  terminal->Resize(3u, 8u);
+  EXPECT_EQ(3u, terminal->options().rows);
+  EXPECT_EQ(8u, terminal->options().columns);
+  EXPECT_EQ("abcdefgh|xy      |        ", GetViewportText(*terminal));
+  EXPECT_FALSE(terminal->IsRowWrapped(0u));
+  EXPECT_EQ(1u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+
+  // Narrower: it's split again.
+  terminal->Resize(3u, 4u);
+  EXPECT_EQ("abcd|efgh|xy  ", GetViewportText(*terminal));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  EXPECT_EQ(2u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+
+  // Fewer rows: the top row moves to the scrollback ...
+  terminal->Resize(2u, 4u);
+  EXPECT_EQ("efgh|xy  ", GetViewportText(*terminal));
+  EXPECT_EQ(1u, terminal->viewport_top() - terminal->scrollback_top());
+  EXPECT_EQ("abcd", GetRowText(*terminal, terminal->scrollback_top()));
+  EXPECT_TRUE(terminal->IsRowWrapped(terminal->scrollback_top()));
+
+  // ... and more rows bring it back.
+  terminal->reset_display_updates();
+  terminal->Resize(3u, 6u);
+  EXPECT_EQ(terminal->viewport_top(), terminal->scrollback_top());
+  EXPECT_EQ("abcdef|gh    |xy    ", GetViewportText(*terminal));
+  EXPECT_EQ(terminal->viewport_top() + 2u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+  // Everything is redrawn.
+  const DisplayUpdates& updates = terminal->display_updates();
+  EXPECT_TRUE(updates.scrolls.empty());
+  EXPECT_EQ(terminal->viewport_top(), updates.row_damage.first_row());
+  EXPECT_EQ(6u, updates.row_damage.columns());
+  EXPECT_EQ(3u, updates.row_damage.num_dirty_rows());
+
+  // A pending wrap is kept (as the cursor being after the last character).
+  terminal = CreateTerminal(2u, 4u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "abcd"));
+  terminal->Resize(2u, 6u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "e"));
+  EXPECT_EQ("abcde |      ", GetViewportText(*terminal));
+}
+
+TEST(TerminalTest, ResizeWideCharacters) {
+  const Codepoint kWide = 0x4e2du;
+  const Codepoint kPadding = CODEPOINT_WIDE_PADDING;
+  auto terminal = CreateTerminal(3u, 4u);
+  // "ab", U+4E2D (wide), "c".
+  EXPECT_TRUE(ProcessString(terminal.get(), "ab\xe4\xb8\xad" "c"));
+  EXPECT_EQ((std::vector<Codepoint>{'a', 'b', kWide, kPadding}),
+            GetRowCodepoints(*terminal, 0u));
+
+  // The wide character doesn't fit at the end of the first row.
+  terminal->Resize(3u, 3u);
+  EXPECT_EQ((std::vector<Codepoint>{'a', 'b', 0u}),
+            GetRowCodepoints(*terminal, 0u));
+  EXPECT_TRUE(terminal->IsRowWrapped(0u));
+  EXPECT_EQ((std::vector<Codepoint>{kWide, kPadding, 'c'}),
+            GetRowCodepoints(*terminal, 1u));
+  EXPECT_EQ(2u, terminal->cursor_row());
+  EXPECT_EQ(0u, terminal->cursor_column());
+}
+
+TEST(TerminalTest, ResizeAlternateScreen) {
+  auto terminal = CreateTerminal(3u, 6u, 10u, 10u);
+  EXPECT_TRUE(ProcessString(terminal.get(), "abcdefgh"));
+  EXPECT_TRUE(
+      ProcessString(terminal.get(), "\x1b[?1049h\x1b[H12345\x1b[3;6H6"));
+
+  // The alternate screen is cropped (and the cursor kept in it).
+  terminal->Resize(2u, 4u);
+  EXPECT_EQ("1234|    ", GetViewportText(*terminal));
+  EXPECT_EQ(terminal->viewport_top() + 1u, terminal->cursor_row());
+  EXPECT_EQ(3u, terminal->cursor_column());
+
+  // The main screen was reflowed.
+  EXPECT_TRUE(ProcessString(terminal.get(), "\x1b[?1049l"));
+  EXPECT_EQ("abcd|efgh", GetViewportText(*terminal));
+  EXPECT_EQ(terminal->viewport_top() + 1u, terminal->cursor_row());
+  EXPECT_EQ(2u, terminal->cursor_column());
+}
+
+TEST(TerminalTest, ResizeColdScrollback) {
+  // 2 rows of hot scrollback, and 200 - 2 = 198 rows of cold scrollback.
+  auto terminal = CreateTerminal(2u, 10u, 200u, 2u);
+  // 50 lines of 15 characters ("aaa...", "bbb...", etc.), each on 2 rows.
+  for (int n = 0; n < 50; n++) {
+    ProcessString(terminal.get(),
+                  std::string(15u, static_cast<char>('a' + n % 26)) + "\r\n");
+  }
+  // Lines 0 to 47 (the first 32 in a sealed block), and the first row of line
+  // 48 ("w"), are in the cold scrollback.
+  EXPECT_EQ(97u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+
+  // Line 48 is joined with its first row (and reflowed with the hot
+  // scrollback), as are lines 32 to 47 (the cold scrollback's open block), but
+  // the sealed block isn't reflowed yet.
+  terminal->Resize(2u, 20u);
+  EXPECT_EQ(64u + 16u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+  EXPECT_EQ("xxxxxxxxxxxxxxx     |                    ",
+            GetViewportText(*terminal));
+  const RowNumber viewport_top = terminal->viewport_top();
+  EXPECT_EQ(std::string(15u, 'w') + "     ",
+            GetRowText(*terminal, viewport_top - 1u));
+  EXPECT_FALSE(terminal->IsRowWrapped(viewport_top - 1u));
+  EXPECT_EQ(std::string(15u, 'v') + "     ",
+            GetRowText(*terminal, viewport_top - 2u));
+  EXPECT_EQ(80u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+  EXPECT_EQ(viewport_top - 81u, terminal->scrollback_top());
+
+  // The sealed block is reflowed when it's read, which only changes the row
+  // numbers of its rows.
+  EXPECT_EQ(std::string(15u, 'a') + "     ",
+            GetRowText(*terminal, terminal->scrollback_top()));
+  EXPECT_EQ(48u, terminal->GetMemoryUsage().num_cold_scrollback_rows);
+  EXPECT_EQ(viewport_top - 49u, terminal->scrollback_top());
+  for (int n = 0; n < 48; n++) {
+    RowNumber row = terminal->scrollback_top() + static_cast<RowNumber>(n);
+    EXPECT_EQ(std::string(15u, static_cast<char>('a' + n % 26)) + "     ",
+              GetRowText(*terminal, row));
+    EXPECT_FALSE(terminal->IsRowWrapped(row));
+  }
+}
+
+TEST(TerminalTest, SynchronizedUpdate) {
+  auto terminal = CreateTerminal(3u, 10u, 10u, 10u);
+  terminal->reset_display_updates();
+  terminal->PublishSnapshot();
+
+  // Changes accumulate, but aren't reported until the frame ends (or until
+  // the deadline).
+  ProcessString(terminal.get(), "\x1b[?2026hab\r\ncd");
+  const DisplayUpdates& updates = terminal->display_updates();
+  EXPECT_TRUE(updates.synchronized_update);
+  EXPECT_FALSE(updates.needs_update(updates.synchronized_update_deadline -
+                                    std::chrono::milliseconds(1)));
+  EXPECT_TRUE(updates.needs_update(updates.synchronized_update_deadline));
+  EXPECT_EQ(2u, updates.row_damage.num_dirty_rows());
+  // Snapshots aren't published either.
+  terminal->PublishSnapshot();
+  EXPECT_EQ(1u, terminal->AcquireSnapshot()->generation());
+
+  // The whole frame is delivered at once.
+  ProcessString(terminal.get(), "\x1b[3Hef\x1b[?2026l");
+  EXPECT_FALSE(updates.synchronized_update);
+  EXPECT_TRUE(updates.needs_update());
+  EXPECT_EQ(3u, updates.row_damage.num_dirty_rows());
+  terminal->PublishSnapshot();
+  {
+    SnapshotHandle snapshot = terminal->AcquireSnapshot();
+    EXPECT_EQ(2u, snapshot->generation());
+    EXPECT_EQ('f', snapshot->GetRow(2u)[1].character().codepoint());
+  }
+
+  // A synchronized update that times out is over once it's been drawn.
+  Terminal::Options options = terminal->options();
+  options.synchronized_update_timeout = std::chrono::milliseconds(0);
+  terminal = Terminal::Create(options);
+  terminal->reset_display_updates();
+  ProcessString(terminal.get(), "\x1b[?2026hx");
+  EXPECT_TRUE(terminal->display_updates().synchronized_update);
+  EXPECT_TRUE(terminal->display_updates().needs_update());
+  terminal->reset_display_updates();
+  EXPECT_FALSE(terminal->display_updates().synchronized_update);
+}
+
+TEST(TerminalTest, CompactCellStorage) {
+  Terminal::Options options;
+  options.rows = 2u;
+  options.columns = 10u;
+  options.scrollback_rows = 100u;
+  options.hot_scrollback_rows = 4u;
+  options.cell_storage = Terminal::CellStorage::COMPACT;
+  auto terminal = Terminal::Create(options);
+  for (int i = 0; i < 200; i++)
+    ProcessString(terminal.get(), "line " + std::to_string(i) + "\r\n");
+  EXPECT_EQ(99u, terminal->scrollback_top());
+  for (RowNumber row = terminal->scrollback_top();
+       row < terminal->viewport_top(); row++) {
+    std::string expected = "line " + std::to_string(row);
+    expected.resize(10u, ' ');
+    EXPECT_EQ(expected, GetRowText(*terminal, row));
+  }
+  EXPECT_EQ("line 199  |          ", GetViewportText(*terminal));
+
+  Terminal::MemoryUsage memory_usage = terminal->GetMemoryUsage();
+  EXPECT_EQ(2u * 10u * 4u, memory_usage.viewport_bytes);
+  EXPECT_EQ(4u, memory_usage.num_hot_scrollback_rows);
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -4,6 +4,8 @@
 
 #include <vtlib/codepoint.h>
 
+#include "src/printable_ascii.h"
+
 // Notes:
 //
 // 1 byte:  0xxxxxxx                            - 7 bits
@@ -65,37 +67,86 @@ bool Utf8CharacterDecoder::Supports8bitC1() const {
 
 void Utf8CharacterDecoder::ProcessByte(uint8_t input_byte,
                                        CodepointVector* output_codepoints) {
+  Codepoint codepoints[kMaxCodepointsPerByte];
+  size_t n = DecodeByte(input_byte, codepoints);
+  output_codepoints->insert(output_codepoints->end(), codepoints,
+                            codepoints + n);
+}
+
+size_t Utf8CharacterDecoder::Decode(const uint8_t* input_bytes,
+                                    size_t num_input_bytes,
+                                    Codepoint* output_codepoints,
+                                    size_t output_capacity,
+                                    size_t* num_output_codepoints) {
+  assert(output_capacity >= kMaxCodepointsPerByte);
+  size_t num_output = 0u;
+  size_t i = 0u;
+  while (i < num_input_bytes &&
+         output_capacity - num_output >= kMaxCodepointsPerByte) {
+    uint8_t input_byte = input_bytes[i];
+
+    // Fast path: in the neutral state, printable ASCII decodes to itself (and
+    // is typically the vast majority of the input).
+    if (!num_needed_ && IsPrintableAscii(input_byte)) {
+      size_t n = num_input_bytes - i;
+      if (n > output_capacity - num_output)
+        n = output_capacity - num_output;
+      n = DecodePrintableAscii(input_bytes + i, n,
+                               output_codepoints + num_output);
+      i += n;
+      num_output += n;
+      continue;
+    }
+
+    if (is_C0_control_code(input_byte))  // We don't support 8-bit C1.
+      break;
+    num_output += DecodeByte(input_byte, output_codepoints + num_output);
+    i++;
+  }
+  *num_output_codepoints = num_output;
+  return i;
+}
+
+void Utf8CharacterDecoder::Flush(CodepointVector* output_codepoints) {
+  Codepoint codepoints[kMaxCodepointsPerByte];
+  size_t n = FlushTo(codepoints);
+  output_codepoints->insert(output_codepoints->end(), codepoints,
+                            codepoints + n);
+}
+
+size_t Utf8CharacterDecoder::DecodeByte(uint8_t input_byte,
+                                        Codepoint* output_codepoints) {
   // Regardless, if we see a leading byte, we resynchronize.
   if (size_t n = IsLeadingByte(input_byte))
-    ProcessLeadingByte(n, input_byte, output_codepoints);
-  else
-    ProcessContinuationByte(input_byte, output_codepoints);
+    return ProcessLeadingByte(n, input_byte, output_codepoints);
+  return ProcessContinuationByte(input_byte, output_codepoints);
 }
 
-void Utf8CharacterDecoder::Flush(CodepointVector* output_codepoints) {
+size_t Utf8CharacterDecoder::FlushTo(Codepoint* output_codepoints) {
   // Output replacement characters for any buffered bytes.
-  for (size_t i = 0u; i < num_have_; i++)
-    output_codepoints->push_back(CODEPOINT_REPLACEMENT);
+  size_t num_output = num_have_;
+  for (size_t i = 0u; i < num_output; i++)
+    output_codepoints[i] = CODEPOINT_REPLACEMENT;
 
   num_needed_ = 0u;
   num_have_ = 0u;
+  return num_output;
 }
 
-void Utf8CharacterDecoder::ProcessLeadingByte(
-    size_t n,
-    uint8_t input_byte,
-    CodepointVector* output_codepoints) {
+size_t Utf8CharacterDecoder::ProcessLeadingByte(size_t n,
+                                                uint8_t input_byte,
+                                                Codepoint* output_codepoints) {
   // If we see a leading byte, we resynchronize.
-  Flush(output_codepoints);
+  size_t num_output = FlushTo(output_codepoints);
 
   switch (n) {
     case 1u:
-      output_codepoints->push_back(static_cast<Codepoint>(input_byte));
+      output_codepoints[num_output++] = static_cast<Codepoint>(input_byte);
       break;
     case 2u: {
       uint8_t data = input_byte & 0x1fu;
       if (data < 0x02u) {  // Overlong encoding.
-        output_codepoints->push_back(CODEPOINT_REPLACEMENT);
+        output_codepoints[num_output++] = CODEPOINT_REPLACEMENT;
       } else {
         num_needed_ = 2u;
         num_have_ = 1u;
@@ -111,7 +162,7 @@ void Utf8CharacterDecoder::ProcessLeadingByte(
     case 4u: {
       uint8_t data = input_byte & 0x07u;
       if (data >= 0x05u) {  // Invalid codepoint (greater than U+10FFFF).
-        output_codepoints->push_back(CODEPOINT_REPLACEMENT);
+        output_codepoints[num_output++] = CODEPOINT_REPLACEMENT;
       } else {
         num_needed_ = 4u;
         num_have_ = 1u;
@@ -120,46 +171,47 @@ void Utf8CharacterDecoder::ProcessLeadingByte(
       break;
     }
     case static_cast<size_t>(-1):  // Invalid byte.
-      output_codepoints->push_back(CODEPOINT_REPLACEMENT);
+      output_codepoints[num_output++] = CODEPOINT_REPLACEMENT;
       break;
   }
+  return num_output;
 }
 
-void Utf8CharacterDecoder::ProcessContinuationByte(
+size_t Utf8CharacterDecoder::ProcessContinuationByte(
     uint8_t input_byte,
-    CodepointVector* output_codepoints) {
+    Codepoint* output_codepoints) {
   uint8_t data = input_byte & 0x3fu;
   switch (num_needed_) {
     case 0u:  // Unexpected continuation.
-      output_codepoints->push_back(CODEPOINT_REPLACEMENT);
-      return;
+      output_codepoints[0] = CODEPOINT_REPLACEMENT;
+      return 1u;
     case 2u:
       break;
     case 3u:
       // Overlong encoding or invalid codepoint (U+D800 to U+DFFF).
       if (num_have_ == 1u && ((!current_value_ && data < 0x20u) ||
                               (current_value_ == 0xd000u && data >= 0x20u))) {
-        output_codepoints->push_back(CODEPOINT_REPLACEMENT);
-        output_codepoints->push_back(CODEPOINT_REPLACEMENT);
+        output_codepoints[0] = CODEPOINT_REPLACEMENT;
+        output_codepoints[1] = CODEPOINT_REPLACEMENT;
         num_needed_ = 0u;
         num_have_ = 0u;
-        return;
+        return 2u;
       }
       break;
     case 4u:
       // Overlong encoding or invalid codepoint (greater than U+10FFFF).
       if (num_have_ == 1u && ((!current_value_ && data < 0x10u) ||
                               (current_value_ >= 0x100000 && data >= 0x10u))) {
-        output_codepoints->push_back(CODEPOINT_REPLACEMENT);
-        output_codepoints->push_back(CODEPOINT_REPLACEMENT);
+        output_codepoints[0] = CODEPOINT_REPLACEMENT;
+        output_codepoints[1] = CODEPOINT_REPLACEMENT;
         num_needed_ = 0u;
         num_have_ = 0u;
-        return;
+        return 2u;
       }
       break;
     default:
       assert(false);
-      return;
+      return 0u;
   }
 
   assert(num_have_ < num_needed_);
@@ -170,10 +222,12 @@ void Utf8CharacterDecoder::ProcessContinuationByte(
   if (num_have_ == num_needed_) {
     assert(!(current_value_ >= 0xd800 && current_value_ <= 0xdfff));
     assert(current_value_ <= 0x10ffff);
-    output_codepoints->push_back(current_value_);
+    output_codepoints[0] = current_value_;
     num_needed_ = 0u;
     num_have_ = 0u;
+    return 1u;
   }
+  return 0u;
 }
 
 }  // namespace vtlib
@@ -54,15 +54,28 @@ class Utf8CharacterDecoder : public CharacterDecoder {
   bool Supports8bitC1() const override;
   void ProcessByte(uint8_t input_byte,
                    CodepointVector* output_codepoints) override;
+  size_t Decode(const uint8_t* input_bytes,
+                size_t num_input_bytes,
+                Codepoint* output_codepoints,
+                size_t output_capacity,
+                size_t* num_output_codepoints) override;
   void Flush(CodepointVector* output_codepoints) override;
 
  private:
-  // Helpers for |ProcessByte()|:
-  void ProcessLeadingByte(size_t n,
-                          uint8_t input_byte,
-                          CodepointVector* output_codepoints);
-  void ProcessContinuationByte(uint8_t input_byte,
-                               CodepointVector* output_codepoints);
+  // The helpers below write their output codepoints to |output_codepoints|,
+  // which must have room for |kMaxCodepointsPerByte| codepoints, and return the
+  // number of codepoints written.
+
+  // Helper for |ProcessByte()| and |Decode()|:
+  size_t DecodeByte(uint8_t input_byte, Codepoint* output_codepoints);
+  // Helper for |Flush()|, etc.:
+  size_t FlushTo(Codepoint* output_codepoints);
+  // Helpers for |DecodeByte()|:
+  size_t ProcessLeadingByte(size_t n,
+                            uint8_t input_byte,
+                            Codepoint* output_codepoints);
+  size_t ProcessContinuationByte(uint8_t input_byte,
+                                 Codepoint* output_codepoints);
 
   // Number of bytes needed for the current encoded codepoint (valid values: 0,
   // 2, 3, 4). UTF-8 uses most 4 bytes per codepoint encoding and 1 is not
@@ -503,6 +503,98 @@ TEST(Utf8CharacterDecoderTest, InvalidByte) {
   }
 }
 
+// Tests that |Decode()| gives the same results as |ProcessByte()|, for various
+// output capacities.
+TEST(Utf8CharacterDecoderTest, DecodeMatchesProcessByte) {
+  // A mix of valid and invalid sequences (see above), with no control codes.
+  const std::vector<uint8_t> input = {
+      0x41u, 0xc4u, 0xa3u, 0xe1u, 0x88u, 0xb4u, 0xf4u, 0x82u, 0x8du, 0x85u,
+      0xf8u, 0x80u, 0xe1u, 0x41u, 0xf4u, 0x82u, 0x8du, 0xf8u, 0xedu, 0xa0u,
+      0x80u, 0xc0u, 0x80u, 0xf0u, 0x80u, 0x41u, 0x7fu, 0xc4u};
+
+  Utf8CharacterDecoder expected_d;
+  CodepointVector expected;
+  for (uint8_t b : input)
+    expected_d.ProcessByte(b, &expected);
+
+  for (size_t capacity = CharacterDecoder::kMaxCodepointsPerByte;
+       capacity <= 2u * input.size(); capacity++) {
+    Utf8CharacterDecoder d;
+    CodepointVector t;
+    CodepointVector buffer(capacity);
+    size_t consumed = 0u;
+    while (consumed < input.size()) {
+      size_t num_output = 0u;
+      size_t n = d.Decode(input.data() + consumed, input.size() - consumed,
+                          buffer.data(), capacity, &num_output);
+      ASSERT_GT(n, 0u) << capacity;
+      ASSERT_LE(num_output, capacity) << capacity;
+      t.insert(t.end(), buffer.begin(), buffer.begin() + num_output);
+      consumed += n;
+    }
+    EXPECT_EQ(expected, t) << capacity;
+  }
+}
+
+TEST(Utf8CharacterDecoderTest, DecodeStopsAtControlCodes) {
+  Utf8CharacterDecoder d;
+  Codepoint buffer[100];
+  size_t num_output = 0u;
+
+  const uint8_t input1[] = {0x41u, 0xc4u, 0xa3u, 0xe1u, 0x0au, 0x41u};
+  EXPECT_EQ(4u, d.Decode(input1, sizeof(input1), buffer, 100u, &num_output));
+  EXPECT_EQ(CodepointVector({0x41u, 0x123u}),
+            CodepointVector(buffer, buffer + num_output));
+
+  // The pending 0xe1 is only flushed by |Flush()| (or |ProcessByte()|).
+  CodepointVector t;
+  d.ProcessByte(0x0au, &t);
+  EXPECT_EQ(CodepointVector({CODEPOINT_REPLACEMENT, 0x0au}), t);
+
+  // Stops immediately on a control code; bytes 128..159 are continuation bytes
+  // (not C1 control codes) in UTF-8.
+  const uint8_t input2[] = {0x1bu, 0x41u};
+  EXPECT_EQ(0u, d.Decode(input2, sizeof(input2), buffer, 100u, &num_output));
+  EXPECT_EQ(0u, num_output);
+  const uint8_t input3[] = {0x9bu, 0x1bu};
+  EXPECT_EQ(1u, d.Decode(input3, sizeof(input3), buffer, 100u, &num_output));
+  EXPECT_EQ(CodepointVector({CODEPOINT_REPLACEMENT}),
+            CodepointVector(buffer, buffer + num_output));
+}
+
+// Tests |Decode()| on longer inputs (so that any vectorized fast path for ASCII
+// is exercised), with ASCII interrupted by various things.
+TEST(Utf8CharacterDecoderTest, DecodeLongInputs) {
+  const std::vector<std::vector<uint8_t>> kInterruptions = {
+      {0xc4u, 0xa3u}, {0xe1u, 0x88u, 0xb4u}, {0xf4u, 0x82u, 0x8du, 0x85u},
+      {0xe1u},        {0xf4u, 0x82u},        {0xedu, 0xa0u, 0x80u},
+      {0x80u},        {0xf8u},               {0x7fu}};
+
+  for (const auto& interruption : kInterruptions) {
+    for (size_t position = 0u; position < 70u; position++) {
+      std::vector<uint8_t> input;
+      for (size_t i = 0u; i < 100u; i++) {
+        if (i == position || i == 2u * position + 33u)
+          input.insert(input.end(), interruption.begin(), interruption.end());
+        input.push_back(static_cast<uint8_t>('a' + i % 26u));
+      }
+
+      Utf8CharacterDecoder expected_d;
+      CodepointVector expected;
+      for (uint8_t b : input)
+        expected_d.ProcessByte(b, &expected);
+
+      Utf8CharacterDecoder d;
+      CodepointVector t(expected.size() + 10u);
+      size_t num_output = 0u;
+      EXPECT_EQ(input.size(), d.Decode(input.data(), input.size(), t.data(),
+                                       t.size(), &num_output));
+      t.resize(num_output);
+      EXPECT_EQ(expected, t) << position;
+    }
+  }
+}
+
 // TODO(vtl): Test |Flush()|.
 
 }  // namespace
@@ -0,0 +1,241 @@
+#include "src/utf8_dfa_character_decoder.h"
+
+#include <assert.h>
+
+#include <vtlib/codepoint.h>
+
+#include "src/printable_ascii.h"
+
+// See utf8_character_decoder.cc for notes on UTF-8 and which encodings are
+// invalid. Here, all of that is encoded in the tables below.
+
+namespace vtlib {
+namespace {
+
+// Byte classes. Bytes in the same class are treated identically by the state
+// machine (though the data bits they contribute differ).
+enum ByteClass : uint8_t {
+  A,   // 0x00..0x7f: ASCII (including C0 control codes).
+  C8,  // 0x80..0x8f: continuation.
+  C9,  // 0x90..0x9f: continuation.
+  CA,  // 0xa0..0xbf: continuation.
+  X,   // 0xc0, 0xc1, 0xf5..0xff: never valid.
+  L2,  // 0xc2..0xdf: leading byte of a 2-byte encoding.
+  E0,  // 0xe0: leading byte of a 3-byte encoding (second byte 0xa0..0xbf).
+  L3,  // 0xe1..0xec, 0xee, 0xef: leading byte of a 3-byte encoding.
+  ED,  // 0xed: leading byte of a 3-byte encoding (second byte 0x80..0x9f).
+  F0,  // 0xf0: leading byte of a 4-byte encoding (second byte 0x90..0xbf).
+  L4,  // 0xf1..0xf3: leading byte of a 4-byte encoding.
+  F4,  // 0xf4: leading byte of a 4-byte encoding (second byte 0x80..0x8f).
+  kNumByteClasses
+};
+
+const uint8_t kByteClasses[256] = {
+    // 0x00..0x0f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x10..0x1f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x20..0x2f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x30..0x3f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x40..0x4f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x50..0x5f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x60..0x6f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x70..0x7f:
+    A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    // 0x80..0x8f:
+    C8, C8, C8, C8, C8, C8, C8, C8, C8, C8, C8, C8, C8, C8, C8, C8,
+    // 0x90..0x9f:
+    C9, C9, C9, C9, C9, C9, C9, C9, C9, C9, C9, C9, C9, C9, C9, C9,
+    // 0xa0..0xaf:
+    CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA,
+    // 0xb0..0xbf:
+    CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA, CA,
+    // 0xc0..0xcf:
+    X, X, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2,
+    // 0xd0..0xdf:
+    L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2, L2,
+    // 0xe0..0xef:
+    E0, L3, L3, L3, L3, L3, L3, L3, L3, L3, L3, L3, L3, ED, L3, L3,
+    // 0xf0..0xff:
+    F0, L4, L4, L4, F4, X, X, X, X, X, X, X, X, X, X, X,
+};
+
+// For each byte class, the mask for the data bits in the byte.
+const uint8_t kDataMasks[kNumByteClasses] = {
+    0x7fu, 0x3fu, 0x3fu, 0x3fu, 0x00u, 0x1fu,
+    0x0fu, 0x0fu, 0x0fu, 0x07u, 0x07u, 0x07u,
+};
+
+// For each byte class, the mask to apply to the shifted current value: the
+// current value is only continued by continuation bytes.
+const uint32_t kContinueMasks[kNumByteClasses] = {
+    0u, ~0u, ~0u, ~0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u, 0u,
+};
+
+// States. The name indicates the number of bytes in the encoding being decoded
+// and the number of bytes seen (or the leading byte, if it restricts the next
+// byte).
+enum State : uint8_t {
+  S0,     // Neutral.
+  S2_1,   // 2-byte encoding, 1 byte seen.
+  S3_E0,  // 3-byte encoding, 0xe0 seen.
+  S3_ED,  // 3-byte encoding, 0xed seen.
+  S3_1,   // 3-byte encoding, 1 (other) byte seen.
+  S3_2,   // 3-byte encoding, 2 bytes seen.
+  S4_F0,  // 4-byte encoding, 0xf0 seen.
+  S4_F4,  // 4-byte encoding, 0xf4 seen.
+  S4_1,   // 4-byte encoding, 1 (other) byte seen.
+  S4_2,   // 4-byte encoding, 2 bytes seen.
+  S4_3,   // 4-byte encoding, 3 bytes seen.
+  kNumStates
+};
+
+// For each state, the number of bytes seen (i.e., the number of replacement
+// characters to emit if the encoding is interrupted).
+const uint8_t kNumPendingBytes[kNumStates] = {0u, 1u, 1u, 1u, 1u, 2u,
+                                              1u, 1u, 1u, 2u, 3u};
+
+// A transition consists of: the next state (bits 0-3), the number of
+// replacement characters to emit (bits 4-6; at most 4), and whether to then
+// emit the current value (bit 7).
+constexpr uint8_t T(State next_state,
+                    unsigned num_replacements,
+                    unsigned emit_value) {
+  return static_cast<uint8_t>(next_state | (num_replacements << 4u) |
+                              (emit_value << 7u));
+}
+
+// Indexed by |state * kNumByteClasses + byte_class|.
+const uint8_t kTransitions[kNumStates * kNumByteClasses] = {
+    // S0:
+    T(S0, 0, 1), T(S0, 1, 0), T(S0, 1, 0), T(S0, 1, 0),
+    T(S0, 1, 0), T(S2_1, 0, 0), T(S3_E0, 0, 0), T(S3_1, 0, 0),
+    T(S3_ED, 0, 0), T(S4_F0, 0, 0), T(S4_1, 0, 0), T(S4_F4, 0, 0),
+    // S2_1:
+    T(S0, 1, 1), T(S0, 0, 1), T(S0, 0, 1), T(S0, 0, 1),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S3_E0:
+    T(S0, 1, 1), T(S0, 2, 0), T(S0, 2, 0), T(S3_2, 0, 0),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S3_ED:
+    T(S0, 1, 1), T(S3_2, 0, 0), T(S3_2, 0, 0), T(S0, 2, 0),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S3_1:
+    T(S0, 1, 1), T(S3_2, 0, 0), T(S3_2, 0, 0), T(S3_2, 0, 0),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S3_2:
+    T(S0, 2, 1), T(S0, 0, 1), T(S0, 0, 1), T(S0, 0, 1),
+    T(S0, 3, 0), T(S2_1, 2, 0), T(S3_E0, 2, 0), T(S3_1, 2, 0),
+    T(S3_ED, 2, 0), T(S4_F0, 2, 0), T(S4_1, 2, 0), T(S4_F4, 2, 0),
+    // S4_F0:
+    T(S0, 1, 1), T(S0, 2, 0), T(S4_2, 0, 0), T(S4_2, 0, 0),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S4_F4:
+    T(S0, 1, 1), T(S4_2, 0, 0), T(S0, 2, 0), T(S0, 2, 0),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S4_1:
+    T(S0, 1, 1), T(S4_2, 0, 0), T(S4_2, 0, 0), T(S4_2, 0, 0),
+    T(S0, 2, 0), T(S2_1, 1, 0), T(S3_E0, 1, 0), T(S3_1, 1, 0),
+    T(S3_ED, 1, 0), T(S4_F0, 1, 0), T(S4_1, 1, 0), T(S4_F4, 1, 0),
+    // S4_2:
+    T(S0, 2, 1), T(S4_3, 0, 0), T(S4_3, 0, 0), T(S4_3, 0, 0),
+    T(S0, 3, 0), T(S2_1, 2, 0), T(S3_E0, 2, 0), T(S3_1, 2, 0),
+    T(S3_ED, 2, 0), T(S4_F0, 2, 0), T(S4_1, 2, 0), T(S4_F4, 2, 0),
+    // S4_3:
+    T(S0, 3, 1), T(S0, 0, 1), T(S0, 0, 1), T(S0, 0, 1),
+    T(S0, 4, 0), T(S2_1, 3, 0), T(S3_E0, 3, 0), T(S3_1, 3, 0),
+    T(S3_ED, 3, 0), T(S4_F0, 3, 0), T(S4_1, 3, 0), T(S4_F4, 3, 0),
+};
+
+}  // namespace
+
+Utf8DfaCharacterDecoder::Utf8DfaCharacterDecoder() = default;
+
+Utf8DfaCharacterDecoder::~Utf8DfaCharacterDecoder() = default;
+
+bool Utf8DfaCharacterDecoder::Supports8bitC1() const {
+  return false;
+}
+
+void Utf8DfaCharacterDecoder::ProcessByte(uint8_t input_byte,
+                                          CodepointVector* output_codepoints) {
+  Codepoint codepoints[kMaxCodepointsPerByte];
+  size_t n = DecodeByte(input_byte, codepoints);
+  output_codepoints->insert(output_codepoints->end(), codepoints,
+                            codepoints + n);
+}
+
+size_t Utf8DfaCharacterDecoder::Decode(const uint8_t* input_bytes,
+                                       size_t num_input_bytes,
+                                       Codepoint* output_codepoints,
+                                       size_t output_capacity,
+                                       size_t* num_output_codepoints) {
+  assert(output_capacity >= kMaxCodepointsPerByte);
+  size_t num_output = 0u;
+  size_t i = 0u;
+  while (i < num_input_bytes &&
+         output_capacity - num_output >= kMaxCodepointsPerByte) {
+    uint8_t input_byte = input_bytes[i];
+
+    // Fast path (see |Utf8CharacterDecoder::Decode()|).
+    if (state_ == S0 && IsPrintableAscii(input_byte)) {
+      size_t n = num_input_bytes - i;
+      if (n > output_capacity - num_output)
+        n = output_capacity - num_output;
+      n = DecodePrintableAscii(input_bytes + i, n,
+                               output_codepoints + num_output);
+      i += n;
+      num_output += n;
+      continue;
+    }
+
+    if (is_C0_control_code(input_byte))  // We don't support 8-bit C1.
+      break;
+    num_output += DecodeByte(input_byte, output_codepoints + num_output);
+    i++;
+  }
+  *num_output_codepoints = num_output;
+  return i;
+}
+
+void Utf8DfaCharacterDecoder::Flush(CodepointVector* output_codepoints) {
+  output_codepoints->insert(output_codepoints->end(), kNumPendingBytes[state_],
+                            CODEPOINT_REPLACEMENT);
+  state_ = S0;
+}
+
+size_t Utf8DfaCharacterDecoder::DecodeByte(uint8_t input_byte,
+                                           Codepoint* output_codepoints) {
+  uint8_t byte_class = kByteClasses[input_byte];
+  uint8_t transition = kTransitions[state_ * kNumByteClasses + byte_class];
+
+  current_value_ = ((current_value_ << 6u) & kContinueMasks[byte_class]) |
+                   (input_byte & kDataMasks[byte_class]);
+  state_ = transition & 0x0fu;
+
+  // Unconditionally write (up to) |kMaxCodepointsPerByte| codepoints, and then
+  // only count the ones we actually want. (If the value is emitted, there are
+  // at most 3 replacement characters before it.)
+  size_t num_replacements = (transition >> 4u) & 0x07u;
+  bool emit_value = !!(transition & 0x80u);
+  output_codepoints[0] = CODEPOINT_REPLACEMENT;
+  output_codepoints[1] = CODEPOINT_REPLACEMENT;
+  output_codepoints[2] = CODEPOINT_REPLACEMENT;
+  output_codepoints[3] = CODEPOINT_REPLACEMENT;
+  output_codepoints[num_replacements & 3u] =
+      emit_value ? current_value_ : CODEPOINT_REPLACEMENT;
+  return num_replacements + emit_value;
+}
+
+}  // namespace vtlib
@@ -0,0 +1,52 @@
+#ifndef VTLIB_SRC_UTF8_DFA_CHARACTER_DECODER_H_
+#define VTLIB_SRC_UTF8_DFA_CHARACTER_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vtlib/character_decoder.h>
+
+namespace vtlib {
+
+// An alternative character decoder for UTF-8, built around a byte-class table
+// and a state-transition table (a la Bjoern Hoehrmann's DFA decoder). Its
+// output is identical to that of |Utf8CharacterDecoder| (including the "early"
+// emission of multiple replacement characters for invalid sequences; see
+// utf8_character_decoder.h), but each byte is processed with a couple of table
+// lookups and no data-dependent branches. The tables take up under 400 bytes.
+class Utf8DfaCharacterDecoder : public CharacterDecoder {
+ public:
+  Utf8DfaCharacterDecoder();
+  ~Utf8DfaCharacterDecoder() override;
+
+  Utf8DfaCharacterDecoder(const Utf8DfaCharacterDecoder&) = delete;
+  Utf8DfaCharacterDecoder& operator=(const Utf8DfaCharacterDecoder&) = delete;
+
+  // |CharacterDecoder| implementation:
+  bool Supports8bitC1() const override;
+  void ProcessByte(uint8_t input_byte,
+                   CodepointVector* output_codepoints) override;
+  size_t Decode(const uint8_t* input_bytes,
+                size_t num_input_bytes,
+                Codepoint* output_codepoints,
+                size_t output_capacity,
+                size_t* num_output_codepoints) override;
+  void Flush(CodepointVector* output_codepoints) override;
+
+ private:
+  // Writes the output codepoints for |input_byte| to |output_codepoints| (which
+  // must have room for |kMaxCodepointsPerByte| codepoints) and returns the
+  // number written.
+  size_t DecodeByte(uint8_t input_byte, Codepoint* output_codepoints);
+
+  // The current state (see the .cc file); 0 is the neutral state.
+  uint8_t state_ = 0u;
+
+  // The value of the current codepoint, as far as we've seen (only meaningful
+  // if |state_| is not the neutral state).
+  Codepoint current_value_ = 0u;
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_UTF8_DFA_CHARACTER_DECODER_H_
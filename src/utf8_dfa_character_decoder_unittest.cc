@@ -0,0 +1,92 @@
+#include "src/utf8_dfa_character_decoder.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/codepoint.h>
+
+#include "src/utf8_character_decoder.h"
+
+namespace vtlib {
+namespace {
+
+// Checks that |Utf8DfaCharacterDecoder| produces the same output as
+// |Utf8CharacterDecoder| for every extension of |*prefix| by one byte (for each
+// byte, and for the final |Flush()|). It then recurses on the extensions that
+// leave the decoders in the middle of an encoding without having produced any
+// output, up to a total length of 4. This covers all sequences of up to 4
+// bytes: whenever output is produced, both decoders are left either in the
+// neutral state or in the state they'd be in after seeing just the last
+// (leading) byte, both of which are covered by shorter sequences.
+void CheckAllExtensions(std::vector<uint8_t>* prefix) {
+  // Record the outputs for all the bytes (and the flush) together, separated by
+  // a non-codepoint.
+  const Codepoint kSeparator = 0xffffffffu;
+  Utf8CharacterDecoder expected_d;
+  Utf8DfaCharacterDecoder d;
+  CodepointVector expected;
+  CodepointVector t;
+
+  for (uint32_t b = 0u; b < 256u; b++) {
+    prefix->push_back(static_cast<uint8_t>(b));
+
+    expected.clear();
+    t.clear();
+    for (uint8_t input_byte : *prefix) {
+      expected_d.ProcessByte(input_byte, &expected);
+      expected.push_back(kSeparator);
+      d.ProcessByte(input_byte, &t);
+      t.push_back(kSeparator);
+    }
+    // Note that this also resets the decoders for the next iteration.
+    size_t flush_start = expected.size();
+    expected_d.Flush(&expected);
+    d.Flush(&t);
+
+    if (expected != t) {
+      std::string sequence;
+      for (uint8_t input_byte : *prefix)
+        sequence += std::to_string(input_byte) + " ";
+      ADD_FAILURE() << "Failed for sequence: " << sequence;
+      return;
+    }
+
+    // If only the flush produced output, the decoders were in the middle of an
+    // encoding without having produced any output.
+    bool only_flush_output = flush_start == prefix->size() &&
+                             expected.size() > flush_start;
+    if (only_flush_output && prefix->size() < 4u)
+      CheckAllExtensions(prefix);
+    prefix->pop_back();
+  }
+}
+
+TEST(Utf8DfaCharacterDecoderTest, MatchesUtf8CharacterDecoder) {
+  std::vector<uint8_t> prefix;
+  CheckAllExtensions(&prefix);
+}
+
+TEST(Utf8DfaCharacterDecoderTest, Create) {
+  std::unique_ptr<CharacterDecoder> d = CharacterDecoder::Create(
+      CharacterEncoding::UTF8, CharacterDecoder::Implementation::TABLE_DRIVEN);
+  ASSERT_TRUE(d);
+  EXPECT_FALSE(d->Supports8bitC1());
+
+  // U+1234 and then an interrupted sequence (see utf8_character_decoder.h).
+  const uint8_t input[] = {0xe1u, 0x88u, 0xb4u, 0xedu, 0xa0u, 'X', 0xf4u};
+  Codepoint buffer[20];
+  size_t num_output = 0u;
+  EXPECT_EQ(sizeof(input),
+            d->Decode(input, sizeof(input), buffer, 20u, &num_output));
+  EXPECT_EQ(CodepointVector({0x1234u, CODEPOINT_REPLACEMENT,
+                             CODEPOINT_REPLACEMENT, 'X'}),
+            CodepointVector(buffer, buffer + num_output));
+  CodepointVector t;
+  d->Flush(&t);
+  EXPECT_EQ(CodepointVector({CODEPOINT_REPLACEMENT}), t);
+}
+
+}  // namespace
+}  // namespace vtlib
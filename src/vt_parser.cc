@@ -0,0 +1,404 @@
+#include "src/vt_parser.h"
+
+#include <assert.h>
+
+namespace vtlib {
+namespace {
+
+// Character classes. Codepoints in the same class are treated identically by
+// the state machine (codepoints >= 160 are all |NON_ASCII|).
+enum CharacterClass : uint8_t {
+  C0,                // C0 control codes, other than those below.
+  BEL,               // 0x07.
+  CAN_SUB,           // 0x18, 0x1a.
+  ESC,               // 0x1b.
+  INTERMEDIATE,      // 0x20..0x2f.
+  DIGIT,             // 0x30..0x39.
+  COLON,             // 0x3a.
+  SEMICOLON,         // 0x3b.
+  PRIVATE_MARKER,    // 0x3c..0x3f.
+  FINAL,             // 0x40..0x7e, other than those below.
+  FINAL_DCS,         // 'P' (0x50).
+  FINAL_SOS_PM_APC,  // 'X', '^', '_' (0x58, 0x5e, 0x5f).
+  FINAL_CSI,         // '[' (0x5b).
+  FINAL_OSC,         // ']' (0x5d).
+  DEL,               // 0x7f.
+  C1,                // C1 control codes, other than those below.
+  C1_DCS,            // 0x90.
+  C1_SOS_PM_APC,     // 0x98, 0x9e, 0x9f.
+  C1_CSI,            // 0x9b.
+  C1_ST,             // 0x9c.
+  C1_OSC,            // 0x9d.
+  NON_ASCII,         // >= 0xa0.
+  kNumCharacterClasses
+};
+
+enum State : uint8_t {
+  GROUND,
+  ESCAPE,
+  ESCAPE_INTERMEDIATE,
+  CSI_ENTRY,
+  CSI_PARAM,
+  CSI_INTERMEDIATE,
+  CSI_IGNORE,
+  DCS_ENTRY,
+  DCS_PARAM,
+  DCS_INTERMEDIATE,
+  DCS_PASSTHROUGH,
+  DCS_IGNORE,
+  OSC_STRING,
+  SOS_PM_APC_STRING,
+  kNumStates
+};
+
+enum Action : uint8_t {
+  NONE,  // Also "ignore".
+  PRINT,
+  EXECUTE,
+  COLLECT,
+  PARAM,
+  ESC_DISPATCH,
+  CSI_DISPATCH,
+  PUT,
+  OSC_PUT,
+};
+
+// A transition consists of: the next state (bits 0-3), the action (bits 4-7),
+// and whether it's a "real" transition (bit 8), in which case the exit action
+// for the current state and the entry action for the next state are performed
+// (even if the next state is the same as the current state).
+constexpr uint16_t kTransitionBit = 1u << 8u;
+
+}  // namespace
+
+struct VtParser::Tables {
+  Tables();
+
+  void Set(State state, CharacterClass c, Action action) {
+    transitions[state * kNumCharacterClasses + c] =
+        static_cast<uint16_t>(state | (action << 4u));
+  }
+  void Set(State state, CharacterClass c, Action action, State next_state) {
+    transitions[state * kNumCharacterClasses + c] =
+        static_cast<uint16_t>(next_state | (action << 4u) | kTransitionBit);
+  }
+  void SetRange(State state,
+                CharacterClass first,
+                CharacterClass last,
+                Action action) {
+    for (int c = first; c <= last; c++)
+      Set(state, static_cast<CharacterClass>(c), action);
+  }
+  void SetRange(State state,
+                CharacterClass first,
+                CharacterClass last,
+                Action action,
+                State next_state) {
+    for (int c = first; c <= last; c++)
+      Set(state, static_cast<CharacterClass>(c), action, next_state);
+  }
+
+  // Classes for codepoints 0..159.
+  uint8_t classes[0xa0];
+  // Indexed by |state * kNumCharacterClasses + character_class|.
+  uint16_t transitions[kNumStates * kNumCharacterClasses];
+};
+
+// This follows the diagram at https://vt100.net/emu/dec_ansi_parser.
+VtParser::Tables::Tables() {
+  for (Codepoint c = 0u; c < 0xa0u; c++) {
+    CharacterClass character_class;
+    if (c == 0x07u)
+      character_class = BEL;
+    else if (c == 0x18u || c == 0x1au)
+      character_class = CAN_SUB;
+    else if (c == 0x1bu)
+      character_class = ESC;
+    else if (c < 0x20u)
+      character_class = C0;
+    else if (c < 0x30u)
+      character_class = INTERMEDIATE;
+    else if (c < 0x3au)
+      character_class = DIGIT;
+    else if (c == 0x3au)
+      character_class = COLON;
+    else if (c == 0x3bu)
+      character_class = SEMICOLON;
+    else if (c < 0x40u)
+      character_class = PRIVATE_MARKER;
+    else if (c == 'P')
+      character_class = FINAL_DCS;
+    else if (c == 'X' || c == '^' || c == '_')
+      character_class = FINAL_SOS_PM_APC;
+    else if (c == '[')
+      character_class = FINAL_CSI;
+    else if (c == ']')
+      character_class = FINAL_OSC;
+    else if (c < 0x7fu)
+      character_class = FINAL;
+    else if (c == 0x7fu)
+      character_class = DEL;
+    else if (c == 0x90u)
+      character_class = C1_DCS;
+    else if (c == 0x98u || c == 0x9eu || c == 0x9fu)
+      character_class = C1_SOS_PM_APC;
+    else if (c == 0x9bu)
+      character_class = C1_CSI;
+    else if (c == 0x9cu)
+      character_class = C1_ST;
+    else if (c == 0x9du)
+      character_class = C1_OSC;
+    else
+      character_class = C1;
+    classes[c] = character_class;
+  }
+
+  for (int i = 0; i < kNumStates; i++) {
+    State s = static_cast<State>(i);
+
+    // By default, ignore everything.
+    SetRange(s, C0, NON_ASCII, NONE);
+
+    // "Anywhere" transitions.
+    Set(s, CAN_SUB, EXECUTE, GROUND);
+    Set(s, C1, EXECUTE, GROUND);
+    Set(s, C1_ST, NONE, GROUND);
+    Set(s, ESC, NONE, ESCAPE);
+    Set(s, C1_DCS, NONE, DCS_ENTRY);
+    Set(s, C1_SOS_PM_APC, NONE, SOS_PM_APC_STRING);
+    Set(s, C1_CSI, NONE, CSI_ENTRY);
+    Set(s, C1_OSC, NONE, OSC_STRING);
+
+    // C0 control codes are executed in all the escape and control sequence
+    // states (but ignored or passed through in control strings).
+    if (s <= CSI_IGNORE) {
+      Set(s, C0, EXECUTE);
+      Set(s, BEL, EXECUTE);
+    }
+  }
+
+  // Note: We print |NON_ASCII| in the ground state (as if it were GL).
+  SetRange(GROUND, INTERMEDIATE, FINAL_OSC, PRINT);
+  Set(GROUND, NON_ASCII, PRINT);
+
+  Set(ESCAPE, INTERMEDIATE, COLLECT, ESCAPE_INTERMEDIATE);
+  SetRange(ESCAPE, DIGIT, FINAL, ESC_DISPATCH, GROUND);
+  Set(ESCAPE, FINAL_DCS, NONE, DCS_ENTRY);
+  Set(ESCAPE, FINAL_SOS_PM_APC, NONE, SOS_PM_APC_STRING);
+  Set(ESCAPE, FINAL_CSI, NONE, CSI_ENTRY);
+  Set(ESCAPE, FINAL_OSC, NONE, OSC_STRING);
+
+  Set(ESCAPE_INTERMEDIATE, INTERMEDIATE, COLLECT);
+  SetRange(ESCAPE_INTERMEDIATE, DIGIT, FINAL_OSC, ESC_DISPATCH, GROUND);
+
+  // Note: Unlike the Williams state machine, we accept colons.
+  Set(CSI_ENTRY, INTERMEDIATE, COLLECT, CSI_INTERMEDIATE);
+  SetRange(CSI_ENTRY, DIGIT, SEMICOLON, PARAM, CSI_PARAM);
+  Set(CSI_ENTRY, PRIVATE_MARKER, COLLECT, CSI_PARAM);
+  SetRange(CSI_ENTRY, FINAL, FINAL_OSC, CSI_DISPATCH, GROUND);
+
+  SetRange(CSI_PARAM, DIGIT, SEMICOLON, PARAM);
+  Set(CSI_PARAM, INTERMEDIATE, COLLECT, CSI_INTERMEDIATE);
+  Set(CSI_PARAM, PRIVATE_MARKER, NONE, CSI_IGNORE);
+  SetRange(CSI_PARAM, FINAL, FINAL_OSC, CSI_DISPATCH, GROUND);
+
+  Set(CSI_INTERMEDIATE, INTERMEDIATE, COLLECT);
+  SetRange(CSI_INTERMEDIATE, DIGIT, PRIVATE_MARKER, NONE, CSI_IGNORE);
+  SetRange(CSI_INTERMEDIATE, FINAL, FINAL_OSC, CSI_DISPATCH, GROUND);
+
+  SetRange(CSI_IGNORE, FINAL, FINAL_OSC, NONE, GROUND);
+
+  Set(DCS_ENTRY, INTERMEDIATE, COLLECT, DCS_INTERMEDIATE);
+  SetRange(DCS_ENTRY, DIGIT, SEMICOLON, PARAM, DCS_PARAM);
+  Set(DCS_ENTRY, PRIVATE_MARKER, COLLECT, DCS_PARAM);
+  SetRange(DCS_ENTRY, FINAL, FINAL_OSC, NONE, DCS_PASSTHROUGH);
+
+  SetRange(DCS_PARAM, DIGIT, SEMICOLON, PARAM);
+  Set(DCS_PARAM, INTERMEDIATE, COLLECT, DCS_INTERMEDIATE);
+  Set(DCS_PARAM, PRIVATE_MARKER, NONE, DCS_IGNORE);
+  SetRange(DCS_PARAM, FINAL, FINAL_OSC, NONE, DCS_PASSTHROUGH);
+
+  Set(DCS_INTERMEDIATE, INTERMEDIATE, COLLECT);
+  SetRange(DCS_INTERMEDIATE, DIGIT, PRIVATE_MARKER, NONE, DCS_IGNORE);
+  SetRange(DCS_INTERMEDIATE, FINAL, FINAL_OSC, NONE, DCS_PASSTHROUGH);
+
+  Set(DCS_PASSTHROUGH, C0, PUT);
+  Set(DCS_PASSTHROUGH, BEL, PUT);
+  SetRange(DCS_PASSTHROUGH, INTERMEDIATE, FINAL_OSC, PUT);
+  Set(DCS_PASSTHROUGH, NON_ASCII, PUT);
+
+  // Note: Unlike the Williams state machine, BEL terminates OSC strings.
+  Set(OSC_STRING, BEL, NONE, GROUND);
+  SetRange(OSC_STRING, INTERMEDIATE, FINAL_OSC, OSC_PUT);
+  Set(OSC_STRING, NON_ASCII, OSC_PUT);
+}
+
+namespace {
+
+// Returns true if |codepoint| is printed (in the ground state).
+bool IsPrintable(Codepoint codepoint) {
+  return (codepoint >= 0x20u && codepoint < 0x7fu) || codepoint >= 0xa0u;
+}
+
+}  // namespace
+
+constexpr size_t VtParser::kMaxParameters;
+constexpr size_t VtParser::kMaxIntermediates;
+constexpr uint32_t VtParser::kMaxParameterValue;
+constexpr size_t VtParser::kMaxOscStringLength;
+
+// static
+const VtParser::Tables* VtParser::GetTables() {
+  static const Tables tables;
+  return &tables;
+}
+
+VtParser::VtParser(Delegate* delegate)
+    : delegate_(delegate), tables_(GetTables()) {
+  Clear();
+}
+
+VtParser::~VtParser() = default;
+
+void VtParser::Parse(const Codepoint* codepoints, size_t num_codepoints) {
+  size_t i = 0u;
+  while (i < num_codepoints) {
+    // Fast path: pass runs of printable characters in the ground state to the
+    // delegate directly.
+    if (state_ == GROUND) {
+      size_t j = i;
+      while (j < num_codepoints && IsPrintable(codepoints[j]))
+        j++;
+      if (j > i) {
+        delegate_->Print(codepoints + i, j - i);
+        i = j;
+        continue;
+      }
+    }
+
+    ProcessCodepoint(codepoints[i]);
+    i++;
+  }
+}
+
+void VtParser::ProcessCodepoint(Codepoint codepoint) {
+  uint8_t character_class = (codepoint < 0xa0u)
+                                ? tables_->classes[codepoint]
+                                : static_cast<uint8_t>(NON_ASCII);
+  uint16_t transition =
+      tables_->transitions[state_ * kNumCharacterClasses + character_class];
+  uint8_t action = (transition >> 4u) & 0x0fu;
+
+  if (!(transition & kTransitionBit)) {
+    PerformAction(action, codepoint);
+    return;
+  }
+
+  // Exit action.
+  if (state_ == OSC_STRING)
+    delegate_->OscDispatch(osc_string_, osc_string_length_);
+  else if (state_ == DCS_PASSTHROUGH)
+    delegate_->DcsUnhook();
+
+  PerformAction(action, codepoint);
+  state_ = transition & 0x0fu;
+
+  // Entry action.
+  switch (state_) {
+    case ESCAPE:
+    case CSI_ENTRY:
+    case DCS_ENTRY:
+      Clear();
+      break;
+    case OSC_STRING:
+      osc_string_length_ = 0u;
+      break;
+    case DCS_PASSTHROUGH:
+      if (ignore_sequence_) {
+        state_ = DCS_IGNORE;
+      } else {
+        sequence_.final = codepoint;
+        delegate_->DcsHook(sequence_);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void VtParser::PerformAction(uint8_t action, Codepoint codepoint) {
+  switch (action) {
+    case NONE:
+      break;
+    case PRINT:
+      delegate_->Print(&codepoint, 1u);
+      break;
+    case EXECUTE:
+      delegate_->Execute(codepoint);
+      break;
+    case COLLECT:
+      if (codepoint >= 0x3cu) {
+        sequence_.private_marker = codepoint;
+      } else if (sequence_.num_intermediates < kMaxIntermediates) {
+        sequence_.intermediates[sequence_.num_intermediates++] = codepoint;
+      } else {
+        ignore_sequence_ = true;
+      }
+      break;
+    case PARAM:
+      if (!sequence_.num_parameters) {
+        sequence_.num_parameters = 1u;
+        sequence_.parameters[0] = 0u;
+      }
+      if (codepoint <= '9') {
+        if (!too_many_parameters_) {
+          uint32_t* p = &sequence_.parameters[sequence_.num_parameters - 1u];
+          *p = *p * 10u + (codepoint - '0');
+          if (*p > kMaxParameterValue)
+            *p = kMaxParameterValue;
+        }
+      } else if (sequence_.num_parameters < kMaxParameters) {
+        // ';' or ':'.
+        if (codepoint == ':')
+          sequence_.subparameter_mask |= 1u << sequence_.num_parameters;
+        sequence_.parameters[sequence_.num_parameters++] = 0u;
+      } else {
+        too_many_parameters_ = true;
+      }
+      break;
+    case ESC_DISPATCH:
+      if (!ignore_sequence_) {
+        sequence_.final = codepoint;
+        delegate_->EscDispatch(sequence_);
+      }
+      break;
+    case CSI_DISPATCH:
+      if (!ignore_sequence_) {
+        sequence_.final = codepoint;
+        delegate_->CsiDispatch(sequence_);
+      }
+      break;
+    case PUT:
+      delegate_->DcsPut(codepoint);
+      break;
+    case OSC_PUT:
+      if (osc_string_length_ < kMaxOscStringLength)
+        osc_string_[osc_string_length_++] = codepoint;
+      break;
+    default:
+      assert(false);
+      break;
+  }
+}
+
+void VtParser::Clear() {
+  sequence_.private_marker = 0u;
+  sequence_.num_intermediates = 0u;
+  sequence_.num_parameters = 0u;
+  sequence_.subparameter_mask = 0u;
+  sequence_.final = 0u;
+  ignore_sequence_ = false;
+  too_many_parameters_ = false;
+}
+
+}  // namespace vtlib
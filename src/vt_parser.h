@@ -0,0 +1,128 @@
+#ifndef VTLIB_SRC_VT_PARSER_H_
+#define VTLIB_SRC_VT_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+
+// A parser for (ECMA-48/DEC-style) escape sequences, control sequences, and
+// control strings, following Paul Williams's state machine
+// (https://vt100.net/emu/dec_ansi_parser). It operates on (decoded) codepoints
+// and reports what it finds to a |Delegate|.
+//
+// Differences from the Williams state machine:
+//   - Codepoints >= 160 (i.e., beyond Latin-1's C1 control codes) are treated
+//     as printable characters in the ground state and as data in control
+//     strings, and are ignored elsewhere.
+//   - BEL terminates an OSC string (as in XTerm).
+//   - Colons are accepted as (sub)parameter separators in control sequences
+//     (see |Sequence::subparameter_mask|).
+//
+// Runs of printable characters in the ground state are passed to the delegate
+// in bulk. Nothing is allocated while parsing: parameters and OSC strings are
+// accumulated in fixed-size buffers (excess parameters and data are dropped).
+class VtParser {
+ public:
+  // Maximum number of parameters recorded for a control sequence.
+  static constexpr size_t kMaxParameters = 32u;
+  // Maximum number of intermediate characters (0x20..0x2f); sequences with
+  // more are ignored.
+  static constexpr size_t kMaxIntermediates = 2u;
+  // Maximum parameter value (larger values are clamped).
+  static constexpr uint32_t kMaxParameterValue = 65535u;
+  // Maximum length of an OSC string (longer strings are truncated).
+  static constexpr size_t kMaxOscStringLength = 1024u;
+
+  // The "collected" parts of an escape sequence, control sequence, or device
+  // control string.
+  struct Sequence {
+    // Returns the |i|-th parameter, or |default_value| if it's missing or 0.
+    uint32_t parameter(size_t i, uint32_t default_value) const {
+      return (i < num_parameters && parameters[i]) ? parameters[i]
+                                                   : default_value;
+    }
+    // Returns true if the |i|-th parameter was preceded by a colon (i.e., it's
+    // a subparameter of the previous parameter).
+    bool is_subparameter(size_t i) const {
+      return i < num_parameters && ((subparameter_mask >> i) & 1u);
+    }
+
+    // The private marker (0x3c..0x3f, e.g., '?'), or 0 if none.
+    Codepoint private_marker;
+    size_t num_intermediates;
+    Codepoint intermediates[kMaxIntermediates];
+    // Missing parameters have value 0.
+    size_t num_parameters;
+    uint32_t parameters[kMaxParameters];
+    // Bit i is set if parameter i was preceded by a colon.
+    uint32_t subparameter_mask;
+    // The final character.
+    Codepoint final;
+  };
+
+  class Delegate {
+   public:
+    // Called with runs of (one or more) printable characters.
+    virtual void Print(const Codepoint* codepoints, size_t num_codepoints) = 0;
+    // Called with C0 and C1 control codes (other than those that affect
+    // parsing, like ESC).
+    virtual void Execute(Codepoint codepoint) = 0;
+    virtual void EscDispatch(const Sequence& sequence) = 0;
+    virtual void CsiDispatch(const Sequence& sequence) = 0;
+    // |data| is the contents of the OSC string.
+    virtual void OscDispatch(const Codepoint* data, size_t size) = 0;
+    // A device control string consists of a call to |DcsHook()|, followed by
+    // calls to |DcsPut()| for each data codepoint, and a call to
+    // |DcsUnhook()|.
+    virtual void DcsHook(const Sequence& sequence) = 0;
+    virtual void DcsPut(Codepoint codepoint) = 0;
+    virtual void DcsUnhook() = 0;
+
+   protected:
+    virtual ~Delegate() = default;
+  };
+
+  // |delegate| must outlive this object.
+  explicit VtParser(Delegate* delegate);
+  ~VtParser();
+
+  VtParser(const VtParser&) = delete;
+  VtParser& operator=(const VtParser&) = delete;
+
+  // Parses the given codepoints (continuing from any previous calls).
+  void Parse(const Codepoint* codepoints, size_t num_codepoints);
+
+  // Returns true if the parser is in the ground state (i.e., not in the middle
+  // of a sequence or control string).
+  bool is_in_ground_state() const { return state_ == 0u; }
+
+ private:
+  void ProcessCodepoint(Codepoint codepoint);
+  void PerformAction(uint8_t action, Codepoint codepoint);
+  void Clear();
+
+  // The character class and state transition tables (see the .cc file).
+  struct Tables;
+  static const Tables* GetTables();
+
+  Delegate* const delegate_;
+  const Tables* const tables_;
+  // The current state; 0 is the ground state.
+  uint8_t state_ = 0u;
+
+  Sequence sequence_;
+  // Set if a sequence has too many intermediates (and so should be ignored).
+  bool ignore_sequence_ = false;
+  // Set if a sequence has too many parameters (the excess are dropped).
+  bool too_many_parameters_ = false;
+
+  size_t osc_string_length_ = 0u;
+  Codepoint osc_string_[kMaxOscStringLength];
+};
+
+}  // namespace vtlib
+
+#endif  // VTLIB_SRC_VT_PARSER_H_
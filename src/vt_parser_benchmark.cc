@@ -0,0 +1,105 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <vtlib/cell.h>
+#include <vtlib/character_decoder.h>
+#include <vtlib/character_encoding.h>
+#include <vtlib/codepoint.h>
+
+#include "src/sgr.h"
+#include "src/vt_parser.h"
+#include "testing/benchmark_corpora.h"
+
+namespace vtlib {
+namespace {
+
+constexpr size_t kCorpusSize = 1u << 20;  // 1 MiB.
+
+// A delegate that does (almost) nothing, so that only the parser is measured.
+class NullDelegate : public VtParser::Delegate {
+ public:
+  NullDelegate() = default;
+  ~NullDelegate() override = default;
+
+  // |VtParser::Delegate| implementation:
+  void Print(const Codepoint* codepoints, size_t num_codepoints) override {
+    benchmark::DoNotOptimize(codepoints);
+  }
+  void Execute(Codepoint codepoint) override {}
+  void EscDispatch(const VtParser::Sequence& sequence) override {}
+  void CsiDispatch(const VtParser::Sequence& sequence) override {
+    benchmark::DoNotOptimize(sequence.parameters);
+  }
+  void OscDispatch(const Codepoint* data, size_t size) override {}
+  void DcsHook(const VtParser::Sequence& sequence) override {}
+  void DcsPut(Codepoint codepoint) override {}
+  void DcsUnhook() override {}
+};
+
+// A delegate that applies SGR sequences to a pen (and does nothing else).
+class SgrDelegate : public NullDelegate {
+ public:
+  SgrDelegate() = default;
+  ~SgrDelegate() override = default;
+
+  void CsiDispatch(const VtParser::Sequence& sequence) override {
+    if (sequence.final == 'm')
+      ApplySgr(sequence, &pen_);
+    benchmark::DoNotOptimize(pen_);
+  }
+
+ private:
+  Cell pen_;
+};
+
+// Decodes all of |input| (as UTF-8) using |CharacterDecoder::ProcessByte()|.
+CodepointVector DecodeCorpus(const std::vector<uint8_t>& input) {
+  std::unique_ptr<CharacterDecoder> decoder =
+      CharacterDecoder::Create(CharacterEncoding::UTF8);
+  CodepointVector output;
+  for (uint8_t input_byte : input)
+    decoder->ProcessByte(input_byte, &output);
+  decoder->Flush(&output);
+  return output;
+}
+
+// Measures |VtParser::Parse()| on already-decoded input (bytes processed are
+// the bytes of the original input).
+void BM_Parse(benchmark::State& state, Corpus corpus) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  CodepointVector codepoints = DecodeCorpus(input);
+  NullDelegate delegate;
+  VtParser parser(&delegate);
+  for (auto _ : state)
+    parser.Parse(codepoints.data(), codepoints.size());
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+BENCHMARK_CAPTURE(BM_Parse, ascii, Corpus::ASCII);
+BENCHMARK_CAPTURE(BM_Parse, latin_cjk, Corpus::LATIN_CJK);
+BENCHMARK_CAPTURE(BM_Parse, emoji, Corpus::EMOJI);
+BENCHMARK_CAPTURE(BM_Parse, control_dense, Corpus::CONTROL_DENSE);
+BENCHMARK_CAPTURE(BM_Parse, colorized_log, Corpus::COLORIZED_LOG);
+
+// Like |BM_Parse|, but also applies SGR sequences (compare with
+// |BM_Parse/colorized_log| for the cost of |ApplySgr()|).
+void BM_ParseAndApplySgr(benchmark::State& state, Corpus corpus) {
+  std::vector<uint8_t> input = GenerateCorpus(corpus, kCorpusSize);
+  CodepointVector codepoints = DecodeCorpus(input);
+  SgrDelegate delegate;
+  VtParser parser(&delegate);
+  for (auto _ : state)
+    parser.Parse(codepoints.data(), codepoints.size());
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(input.size()));
+}
+
+BENCHMARK_CAPTURE(BM_ParseAndApplySgr, colorized_log, Corpus::COLORIZED_LOG);
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,241 @@
+#include "src/vt_parser.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <vtlib/codepoint.h>
+
+namespace vtlib {
+namespace {
+
+// Records calls as a string (codepoints >= 128 are written as "U+xxxx").
+class TestDelegate : public VtParser::Delegate {
+ public:
+  TestDelegate() = default;
+  ~TestDelegate() override = default;
+
+  // |VtParser::Delegate| implementation:
+  void Print(const Codepoint* codepoints, size_t num_codepoints) override {
+    log_ += "Print(";
+    AppendCodepoints(codepoints, num_codepoints);
+    log_ += ")";
+  }
+  void Execute(Codepoint codepoint) override {
+    log_ += "Execute(" + std::to_string(codepoint) + ")";
+  }
+  void EscDispatch(const VtParser::Sequence& sequence) override {
+    log_ += "Esc(";
+    AppendSequence(sequence);
+    log_ += ")";
+  }
+  void CsiDispatch(const VtParser::Sequence& sequence) override {
+    log_ += "Csi(";
+    AppendSequence(sequence);
+    log_ += ")";
+  }
+  void OscDispatch(const Codepoint* data, size_t size) override {
+    log_ += "Osc(";
+    AppendCodepoints(data, size);
+    log_ += ")";
+  }
+  void DcsHook(const VtParser::Sequence& sequence) override {
+    log_ += "DcsHook(";
+    AppendSequence(sequence);
+    log_ += ")";
+  }
+  void DcsPut(Codepoint codepoint) override {
+    log_ += "DcsPut(";
+    AppendCodepoints(&codepoint, 1u);
+    log_ += ")";
+  }
+  void DcsUnhook() override { log_ += "DcsUnhook()"; }
+
+  std::string TakeLog() {
+    std::string rv;
+    rv.swap(log_);
+    return rv;
+  }
+
+ private:
+  void AppendCodepoints(const Codepoint* codepoints, size_t num_codepoints) {
+    for (size_t i = 0u; i < num_codepoints; i++) {
+      if (codepoints[i] < 0x20u)
+        log_ += "^" + std::string(1u, static_cast<char>(codepoints[i] + 0x40u));
+      else if (codepoints[i] < 0x80u)
+        log_ += static_cast<char>(codepoints[i]);
+      else
+        log_ += "U+" + std::to_string(codepoints[i]);
+    }
+  }
+
+  // E.g., "?;1:2;3;h" for "CSI ? 1 : 2 ; 3 h" and "(;B" for "ESC ( B".
+  void AppendSequence(const VtParser::Sequence& sequence) {
+    if (sequence.private_marker)
+      log_ += static_cast<char>(sequence.private_marker);
+    for (size_t i = 0u; i < sequence.num_intermediates; i++)
+      log_ += static_cast<char>(sequence.intermediates[i]);
+    log_ += ";";
+    for (size_t i = 0u; i < sequence.num_parameters; i++) {
+      if (i)
+        log_ += sequence.is_subparameter(i) ? ":" : ",";
+      log_ += std::to_string(sequence.parameters[i]);
+    }
+    log_ += ";";
+    log_ += static_cast<char>(sequence.final);
+  }
+
+  std::string log_;
+};
+
+void ParseCodepoints(VtParser* parser,
+                     const std::vector<Codepoint>& codepoints) {
+  parser->Parse(codepoints.data(), codepoints.size());
+}
+
+void Parse(VtParser* parser, const std::string& s) {
+  std::vector<Codepoint> codepoints;
+  for (char c : s)
+    codepoints.push_back(static_cast<uint8_t>(c));
+  ParseCodepoints(parser, codepoints);
+}
+
+TEST(VtParserTest, Print) {
+  TestDelegate d;
+  VtParser p(&d);
+
+  EXPECT_TRUE(p.is_in_ground_state());
+  Parse(&p, "Hello, world!");
+  EXPECT_EQ("Print(Hello, world!)", d.TakeLog());
+
+  // Control codes split runs; DEL is ignored.
+  Parse(&p, "ab\r\ncd\x7f" "e\x07");
+  EXPECT_EQ("Print(ab)Execute(13)Execute(10)Print(cd)Print(e)Execute(7)",
+            d.TakeLog());
+
+  // Non-ASCII codepoints are printed, C1 control codes are executed.
+  ParseCodepoints(&p, {0x41u, 0xe9u, 0x1234u, 0x85u, 0x1f600u});
+  EXPECT_EQ("Print(AU+233U+4660)Execute(133)Print(U+128512)", d.TakeLog());
+  EXPECT_TRUE(p.is_in_ground_state());
+}
+
+TEST(VtParserTest, Escape) {
+  TestDelegate d;
+  VtParser p(&d);
+
+  Parse(&p, "\x1b" "7a\x1b(B\x1b#8\x1b=");
+  EXPECT_EQ("Esc(;;7)Print(a)Esc((;;B)Esc(#;;8)Esc(;;=)", d.TakeLog());
+
+  // Too many intermediates: ignored.
+  Parse(&p, "\x1b ##Fa");
+  EXPECT_EQ("Print(a)", d.TakeLog());
+
+  // C0 control codes are executed in the middle; CAN cancels; ESC restarts.
+  Parse(&p, "\x1b(\nB\x1b(\x18" "B\x1b(\x1b" "c");
+  EXPECT_EQ("Execute(10)Esc((;;B)Execute(24)Print(B)Esc(;;c)", d.TakeLog());
+
+  // A sequence may be split across calls.
+  Parse(&p, "\x1b");
+  EXPECT_FALSE(p.is_in_ground_state());
+  Parse(&p, "(");
+  Parse(&p, "0");
+  EXPECT_EQ("Esc((;;0)", d.TakeLog());
+  EXPECT_TRUE(p.is_in_ground_state());
+}
+
+TEST(VtParserTest, Csi) {
+  TestDelegate d;
+  VtParser p(&d);
+
+  Parse(&p, "\x1b[m\x1b[1;23m\x1b[;5H\x1b[2 q");
+  EXPECT_EQ("Csi(;;m)Csi(;1,23;m)Csi(;0,5;H)Csi( ;2;q)", d.TakeLog());
+
+  Parse(&p, "\x1b[?1049h\x1b[>c\x1b[38:2::10:20:30m");
+  EXPECT_EQ("Csi(?;1049;h)Csi(>;;c)Csi(;38:2:0:10:20:30;m)", d.TakeLog());
+
+  // 8-bit CSI.
+  ParseCodepoints(&p, {0x9bu, '5', 'A'});
+  EXPECT_EQ("Csi(;5;A)", d.TakeLog());
+
+  // C0 control codes are executed in the middle.
+  Parse(&p, "\x1b[1\r;2\bH");
+  EXPECT_EQ("Execute(13)Execute(8)Csi(;1,2;H)", d.TakeLog());
+
+  // Large parameters are clamped.
+  Parse(&p, "\x1b[99999999999;1H");
+  EXPECT_EQ("Csi(;65535,1;H)", d.TakeLog());
+
+  // Excess parameters are dropped.
+  std::string s = "\x1b[";
+  std::string expected = "Csi(;";
+  for (size_t i = 0u; i < 40u; i++) {
+    s += std::to_string(i + 1u) + ";";
+    if (i < VtParser::kMaxParameters)
+      expected += (i ? "," : "") + std::to_string(i + 1u);
+  }
+  Parse(&p, s + "m");
+  EXPECT_EQ(expected + ";m)", d.TakeLog());
+
+  // Malformed sequences are ignored (until the final character).
+  Parse(&p, "\x1b[1?2ha\x1b[1 2hb\x1b[1;2\x18" "c");
+  EXPECT_EQ("Print(a)Print(b)Execute(24)Print(c)", d.TakeLog());
+
+  // Non-ASCII codepoints are ignored.
+  ParseCodepoints(&p, {0x1bu, '[', '1', 0x1234u, 'A'});
+  EXPECT_EQ("Csi(;1;A)", d.TakeLog());
+}
+
+TEST(VtParserTest, Osc) {
+  TestDelegate d;
+  VtParser p(&d);
+
+  // Terminated by BEL or ST (ESC \).
+  Parse(&p, "\x1b]0;title\x07" "a\x1b]2;x y\x1b\\b");
+  EXPECT_EQ("Osc(0;title)Print(a)Osc(2;x y)Esc(;;\\)Print(b)", d.TakeLog());
+
+  // 8-bit OSC and ST; non-ASCII codepoints are included, C0 control codes
+  // (other than BEL) are ignored.
+  ParseCodepoints(&p, {0x9du, '0', ';', 0x1234u, '\n', 'x', 0x9cu});
+  EXPECT_EQ("Osc(0;U+4660x)", d.TakeLog());
+
+  // CAN cancels (the OSC is still dispatched, as in the Williams state
+  // machine).
+  Parse(&p, "\x1b]0;abc\x18" "d");
+  EXPECT_EQ("Osc(0;abc)Execute(24)Print(d)", d.TakeLog());
+
+  // Long strings are truncated.
+  std::string title(VtParser::kMaxOscStringLength + 100u, 'x');
+  Parse(&p, "\x1b]" + title + "\x07");
+  EXPECT_EQ("Osc(" + title.substr(0u, VtParser::kMaxOscStringLength) + ")",
+            d.TakeLog());
+}
+
+TEST(VtParserTest, Dcs) {
+  TestDelegate d;
+  VtParser p(&d);
+
+  Parse(&p, "\x1bP1;2|ab\ncd\x1b\\e");
+  EXPECT_EQ(
+      "DcsHook(;1,2;|)DcsPut(a)DcsPut(b)DcsPut(^J)DcsPut(c)DcsPut(d)"
+      "DcsUnhook()Esc(;;\\)Print(e)",
+      d.TakeLog());
+
+  ParseCodepoints(&p, {0x90u, '$', 'q', 'm', 0x9cu});
+  EXPECT_EQ("DcsHook($;;q)DcsPut(m)DcsUnhook()", d.TakeLog());
+
+  // Malformed: ignored.
+  Parse(&p, "\x1bP1?2|ab\x1b\\c");
+  EXPECT_EQ("Esc(;;\\)Print(c)", d.TakeLog());
+}
+
+TEST(VtParserTest, SosPmApc) {
+  TestDelegate d;
+  VtParser p(&d);
+
+  Parse(&p, "\x1bXab\x1b\\c\x1b^de\x1b\\f\x1b_gh\x1b\\i");
+  EXPECT_EQ("Esc(;;\\)Print(c)Esc(;;\\)Print(f)Esc(;;\\)Print(i)",
+            d.TakeLog());
+}
+
+}  // namespace
+}  // namespace vtlib
@@ -0,0 +1,233 @@
+#include "testing/benchmark_corpora.h"
+
+#include <string.h>
+
+#include <string>
+
+namespace vtlib {
+namespace {
+
+// A simple (deterministic) pseudorandom number generator (xorshift32).
+class Random {
+ public:
+  Random() = default;
+
+  uint32_t Next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+
+  // Returns a value in the range 0..n-1.
+  size_t Uniform(size_t n) { return static_cast<size_t>(Next() % n); }
+
+  template <typename T, size_t N>
+  const T& Pick(const T (&array)[N]) {
+    return array[Uniform(N)];
+  }
+
+ private:
+  uint32_t state_ = 0x12345678u;
+};
+
+void Append(const char* s, std::vector<uint8_t>* output) {
+  output->insert(output->end(), s, s + strlen(s));
+}
+
+void AppendAsciiLine(Random* random, std::vector<uint8_t>* output) {
+  static const char* const kWords[] = {
+      "[INFO]", "[WARN]", "Compiling", "src/terminal_impl.cc", "{\"id\":",
+      "\"status\":", "\"ok\",", "42,", "elapsed", "1.234ms", "request",
+      "-> ", "done.", "std::vector<uint8_t>", "0x7f3a9c", "=", "(", ")"};
+  size_t num_words = 4u + random->Uniform(12u);
+  for (size_t i = 0u; i < num_words; i++) {
+    if (i)
+      output->push_back(' ');
+    Append(random->Pick(kWords), output);
+  }
+  output->push_back('\r');
+  output->push_back('\n');
+}
+
+void AppendLatinCjk(Random* random, std::vector<uint8_t>* output) {
+  static const char* const kWords[] = {
+      "the",        "café",     "naïve",       "Zürich",   "façade",
+      "Ελληνικά",   "Кириллица", "日本語",      "中文字符", "한국어",
+      "テキスト",   "漢字かな",  "表示されます", "ok",       "déjà vu"};
+  Append(random->Pick(kWords), output);
+  output->push_back(random->Uniform(10u) ? ' ' : '\n');
+}
+
+void AppendEmoji(Random* random, std::vector<uint8_t>* output) {
+  static const char* const kEmoji[] = {
+      "\xF0\x9F\x98\x80",  // U+1F600 GRINNING FACE
+      "\xF0\x9F\x9A\x80",  // U+1F680 ROCKET
+      "\xF0\x9F\x94\xA5",  // U+1F525 FIRE
+      "\xE2\x9C\x85",      // U+2705 WHITE HEAVY CHECK MARK
+      "\xE2\x9D\xA4\xEF\xB8\x8F",  // U+2764 U+FE0F HEAVY BLACK HEART
+      // U+1F468 U+200D U+1F469 U+200D U+1F467 (family: man, woman, girl)
+      "\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7",
+      // U+1F44D U+1F3FD (thumbs up, medium skin tone)
+      "\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD",
+      // U+1F1EF U+1F1F5 (flag: Japan)
+      "\xF0\x9F\x87\xAF\xF0\x9F\x87\xB5"};
+  Append(random->Pick(kEmoji), output);
+  if (!random->Uniform(8u))
+    output->push_back(' ');
+}
+
+void AppendInvalidUtf8(Random* random, std::vector<uint8_t>* output) {
+  static const char* const kSequences[] = {
+      "\xC4",              // Truncated 2-byte encoding.
+      "\xE1\x88",          // Truncated 3-byte encoding.
+      "\xF4\x82\x8D",      // Truncated 4-byte encoding.
+      "\xC0\xAF",          // Overlong 2-byte encoding.
+      "\xE0\x80\xAF",      // Overlong 3-byte encoding.
+      "\xF0\x80\x80\xAF",  // Overlong 4-byte encoding.
+      "\xED\xA0\x80",      // Surrogate (U+D800).
+      "\xF4\x90\x80\x80",  // U+110000.
+      "\x80\xBF",          // Stray continuation bytes.
+      "\xF8\xFF",          // Never-valid bytes.
+      "a",
+  };
+  Append(random->Pick(kSequences), output);
+}
+
+void AppendControlDense(Random* random, std::vector<uint8_t>* output) {
+  static const char* const kControls[] = {
+      "\x1b[0m", "\x1b[1m",    "\x1b[31m",          "\x1b[1;32m",
+      "\x1b[K",  "\x1b[2;5H",  "\x1b[38;5;208m",    "\x1b[38;2;10;20;30m",
+      "\r\n",    "\t",         "\b",                "\x1b]0;title\x07"};
+  static const char* const kText[] = {"a", "ls", "error", ":", "12", " ",
+                                      "warning: unused"};
+  Append(random->Pick(kControls), output);
+  Append(random->Pick(kText), output);
+}
+
+void AppendColorizedLogLine(Random* random, std::vector<uint8_t>* output) {
+  // Like GCC/Clang diagnostics, |grep --color|, |ls --color|, and (with 256
+  // and RGB colors) tools like |bat| and |delta|.
+  static const char* const kSgrs[] = {
+      "\x1b[01m\x1b[K",    "\x1b[m\x1b[K",         "\x1b[01;31m\x1b[K",
+      "\x1b[01;35m\x1b[K", "\x1b[01;32m\x1b[K",    "\x1b[0m",
+      "\x1b[1;34m",        "\x1b[38;5;208m",       "\x1b[38;5;244m",
+      "\x1b[48;5;236m",    "\x1b[38;2;249;38;114m", "\x1b[38;2;166;226;46m",
+      "\x1b[39m",          "\x1b[1m",              "\x1b[22m"};
+  static const char* const kText[] = {
+      "src/terminal_impl.cc:123:45:", " ", "error:", "warning:", "note:",
+      "expected ';' after expression", "unused variable 'x'", "  123 | ",
+      "      |     ^", "int", "return", "std::vector<Cell>", "~~~~~^~~~~",
+      "[-Wunused-variable]", "main.o", "Makefile"};
+  size_t num_runs = 3u + random->Uniform(8u);
+  for (size_t i = 0u; i < num_runs; i++) {
+    Append(random->Pick(kSgrs), output);
+    Append(random->Pick(kText), output);
+  }
+  Append("\x1b[m\r\n", output);
+}
+
+void AppendCursorPosition(size_t row, size_t column,
+                          std::vector<uint8_t>* output) {
+  Append(("\x1b[" + std::to_string(row) + ";" + std::to_string(column) + "H")
+             .c_str(),
+         output);
+}
+
+void AppendFullScreenTuiFrame(Random* random, std::vector<uint8_t>* output) {
+  static const char* const kSgrs[] = {
+      "\x1b[m", "\x1b[1;36m", "\x1b[32m", "\x1b[30;46m", "\x1b[1;31m",
+      "\x1b[38;5;245m", "\x1b[48;5;236m", "\x1b[7m", "\x1b[33;1m"};
+  static const char* const kText[] = {
+      "  PID USER      PRI  NI  VIRT   RES   SHR S CPU% MEM%   TIME+  Command",
+      " 1234 root       20   0  163M 12.3M  8.1M S  0.7  0.2  0:03.21 systemd",
+      "[||||||||||||||        38.2%]", "Tasks: 142, 503 thr; 2 running",
+      "Load average: 0.52 0.61 0.58", "void TerminalImpl::Print(",
+      "  for (size_t i = 0u; i < n; i++) {", "~", "-- INSERT --",
+      "\"src/terminal_impl.cc\" 812L, 27341B"};
+
+  switch (random->Uniform(4u)) {
+    case 0u:
+      // A full redraw (like htop's): clear, then each row.
+      Append("\x1b[H\x1b[2J", output);
+      for (size_t row = 1u; row <= 50u; row++) {
+        AppendCursorPosition(row, 1u, output);
+        Append(random->Pick(kSgrs), output);
+        Append(random->Pick(kText), output);
+        Append("\x1b[K", output);
+      }
+      break;
+    case 1u:
+      // Updating some rows in place (like htop's process list).
+      for (size_t i = 0u; i < 20u; i++) {
+        AppendCursorPosition(1u + random->Uniform(50u),
+                             1u + random->Uniform(40u), output);
+        Append(random->Pick(kSgrs), output);
+        Append(random->Pick(kText), output);
+        Append("\x1b[m\x1b[K", output);
+      }
+      break;
+    case 2u:
+      // Scrolling part of the screen with insert/delete line (like vim or
+      // less), and drawing the new rows.
+      AppendCursorPosition(1u + random->Uniform(10u), 1u, output);
+      Append(random->Uniform(2u) ? "\x1b[3M" : "\x1b[3L", output);
+      for (size_t i = 0u; i < 3u; i++) {
+        Append(random->Pick(kText), output);
+        Append("\x1b[K\r\n", output);
+      }
+      AppendCursorPosition(50u, 1u, output);
+      Append("\x1b[7m", output);
+      Append(random->Pick(kText), output);
+      Append("\x1b[m\x1b[K", output);
+      break;
+    case 3u:
+      // Editing a line (like typing in vim's insert mode), and then clearing
+      // the bottom of the screen.
+      for (size_t i = 0u; i < 10u; i++) {
+        AppendCursorPosition(1u + random->Uniform(49u),
+                             1u + random->Uniform(60u), output);
+        Append(random->Uniform(2u) ? "\x1b[@x" : "\x1b[P", output);
+        Append("\x1b[4X", output);
+      }
+      AppendCursorPosition(40u, 1u, output);
+      Append("\x1b[J", output);
+      break;
+  }
+}
+
+}  // namespace
+
+std::vector<uint8_t> GenerateCorpus(Corpus corpus, size_t size) {
+  Random random;
+  std::vector<uint8_t> output;
+  output.reserve(size + 100u);
+  while (output.size() < size) {
+    switch (corpus) {
+      case Corpus::ASCII:
+        AppendAsciiLine(&random, &output);
+        break;
+      case Corpus::LATIN_CJK:
+        AppendLatinCjk(&random, &output);
+        break;
+      case Corpus::EMOJI:
+        AppendEmoji(&random, &output);
+        break;
+      case Corpus::INVALID_UTF8:
+        AppendInvalidUtf8(&random, &output);
+        break;
+      case Corpus::CONTROL_DENSE:
+        AppendControlDense(&random, &output);
+        break;
+      case Corpus::COLORIZED_LOG:
+        AppendColorizedLogLine(&random, &output);
+        break;
+      case Corpus::FULL_SCREEN_TUI:
+        AppendFullScreenTuiFrame(&random, &output);
+        break;
+    }
+  }
+  return output;
+}
+
+}  // namespace vtlib
@@ -0,0 +1,41 @@
+#ifndef VTLIB_TESTING_BENCHMARK_CORPORA_H_
+#define VTLIB_TESTING_BENCHMARK_CORPORA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace vtlib {
+
+// Kinds of (synthetic) terminal output, for use by benchmarks.
+enum class Corpus {
+  // Printable 7-bit ASCII, in lines (like a build or JSON log).
+  ASCII,
+  // A mix of ASCII, accented Latin characters, and CJK characters.
+  LATIN_CJK,
+  // Mostly emoji (including ZWJ sequences and variation selectors).
+  EMOJI,
+  // Mostly invalid UTF-8 (truncated and overlong encodings, surrogates, stray
+  // continuation bytes, and bytes that are never valid).
+  INVALID_UTF8,
+  // Short runs of text between control codes and escape sequences (like
+  // colorized output).
+  CONTROL_DENSE,
+  // Colorized compiler diagnostics and similar tool output, with an SGR
+  // sequence every few characters (16-color, 256-color, and RGB).
+  COLORIZED_LOG,
+  // Redraws of a full-screen TUI (like htop, vim, or less, for a viewport of
+  // up to 50 rows): cursor positioning followed by colored text, with erase
+  // (ED, EL, ECH), insert/delete character (ICH, DCH), and insert/delete line
+  // (IL, DL) on nearly every frame.
+  FULL_SCREEN_TUI,
+};
+
+// Returns (at least) |size| bytes of generated output of the given kind. The
+// output is deterministic (for given arguments).
+std::vector<uint8_t> GenerateCorpus(Corpus corpus, size_t size);
+
+}  // namespace vtlib
+
+#endif  // VTLIB_TESTING_BENCHMARK_CORPORA_H_